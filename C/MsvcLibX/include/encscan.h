@@ -0,0 +1,50 @@
+/*****************************************************************************\
+*                                                                             *
+*   Filename:	    encscan.h						      *
+*                                                                             *
+*   Description:    Fast scans of text buffers, for encoding detection        *
+*                                                                             *
+*   Notes:	    These routines use only standard C types, and are built   *
+*		    with any C compiler, for any OS, including Linux.	      *
+*									      *
+*   History:								      *
+*    2026-10-18 JFL Created this file.                                        *
+*    2026-10-18 JFL Added EncScanUTF8().				      *
+*									      *
+*                    Copyright 2026 Jean-Franois Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#ifndef _ENCSCAN_H_
+#define _ENCSCAN_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Return the number of leading bytes that are ASCII, and not NUL */
+size_t EncScanASCII(const char *pBuf, size_t nBuf);
+
+/* Return the number of leading 16-bits words that are not 0, 0xFFFE, 0xFFFF,
+   nor part of a surrogate pair. Add those with a NUL high byte to *pnHiNUL8 */
+size_t EncScanUTF16(const char *pBuf, size_t nWords, size_t *pnHiNUL8);
+
+/* Return the number of leading 32-bits words that are not 0, 0xFFFE, 0xFFFF,
+   more than 21 bits, nor have low 16 bits reserved for surrogate pairs.
+   Add those with a NUL high 16-bits word to *pnHiNUL16 */
+size_t EncScanUTF32(const char *pBuf, size_t nDWords, size_t *pnHiNUL16);
+
+/* Return the number of leading bytes that are valid UTF-8 characters, and not NUL.
+   Add the number of multi-byte characters among them to *pnMulti */
+size_t EncScanUTF8(const char *pBuf, size_t nBuf, size_t *pnMulti);
+
+/* Select the implementation. -1=Best available; 0=Scalar; 1=SSE2; 2=AVX2 */
+int EncScanSelect(int iLevel);	/* Returns the level actually selected */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(_ENCSCAN_H_) */
@@ -39,6 +39,7 @@
 #    2024-10-14 JFL Renamed variable I as XI to avoid conflicts with the I    #
 #                   variable in DOS.mak and WIN32.mak.			      #
 #    2017-03-03 JFL Added getenv.obj.   		                      #
+#    2026-10-18 JFL Added encscan.obj.					      #
 #                   							      #
 #          Copyright 2016 Hewlett Packard Enterprise Development LP          #
 # Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 #
@@ -104,6 +105,7 @@ OBJECTS = \
 WIN32_OBJECTS = \
     +aswprintf.obj		\
     +daswprintf.obj		\
+    +encscan.obj		\
     +fileid.obj			\
     +GetEncoding.obj		\
     +getenv.obj			\
@@ -210,6 +212,8 @@ dirname.c: $(XI)\libgen.h $(XI)\limits.h $(XI)\msvclibx.h $(XI)\stdlib.h $(XI)\s
 
 encoding.c: $(MI)\debugm.h $(XI)\iconv.h $(XI)\msvclibx.h $(XI)\stdio.h $(XI)\string.h
 
+encscan.c: $(XI)\encscan.h $(XI)\limits.h
+
 err2errno.c: $(MI)\debugm.h $(XI)\errno.h $(XI)\msvclibx.h $(XI)\stdio.h $(XI)\windows.h
 
 fileid.c: $(MI)\debugm.h $(XI)\msvclibx.h $(XI)\errno.h $(XI)\stdio.h $(XI)\sys\stat.h
@@ -234,7 +238,7 @@ getenv.c: $(MI)\debugm.h $(CI)\dict.h $(XI)\errno.h $(XI)\stdlib.h $(XI)\string.
 
 getline.c: $(MI)\debugm.h $(XI)\limits.h $(XI)\errno.h $(XI)\stdio.h
 
-GetEncoding.c: $(MI)\debugm.h $(XI)\errno.h $(XI)\iconv.h $(XI)\stdio.h $(XI)\string.h
+GetEncoding.c: $(MI)\debugm.h $(XI)\encscan.h $(XI)\errno.h $(XI)\iconv.h $(XI)\stdio.h $(XI)\string.h
 
 GetFileAttributes.c: $(XI)\limits.h $(XI)\windows.h
 
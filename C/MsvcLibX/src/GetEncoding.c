@@ -14,6 +14,10 @@
 *   History								      *
 *    2021-05-18 JFL Created this module, based on code in conv.c.	      *
 *    2021-06-01 JFL Improved the heuristic, making it more rigorous.	      *
+*    2026-10-18 JFL Use the encscan.c vector routines for skipping quickly    *
+*		    over runs of ASCII characters, and UTF-16/32 words.	      *
+*    2026-10-18 JFL Validate UTF-8 with EncScanUTF8(). This also rejects      *
+*		    overlong encodings and surrogates.			      *
 *                                                                             *
 *          Copyright 2021 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -28,6 +32,7 @@
 /* MsvcLibX library extensions */
 #include "iconv.h"
 #include "debugm.h"
+#include "encscan.h"
 
 #ifdef _MSDOS
 
@@ -78,6 +83,8 @@
 |		    							      |
 |   History								      |
 |    2021-05-18 JFL Created this routine, based on code in conv.c.	      |
+|    2026-10-18 JFL Use EncScanXxx() to skip the simple cases quickly.	      |
+|    2026-10-18 JFL Validate UTF-8 with EncScanUTF8().			      |
 *									      *
 \*---------------------------------------------------------------------------*/
 
@@ -130,54 +137,27 @@ UINT GetBufferEncoding(const char *pszBuffer, size_t nBufSize, DWORD dwFlags) {
     nMax = nBufSize;
     if (nMax && !pszBuffer[nMax-1]) nMax -= 1; // Support strings with a final NUL
     if (dwFlags & BE_TEST_UTF8) {
-      isValidUTF8 = TRUE;
-      for (n=0; n<nMax; n++) {
-	char c = pszBuffer[n];
-	if (!c) {
+      size_t nSkip;
+      /* Skip the valid UTF-8 characters, up to the next NUL or invalid byte.
+	 Scan by chunks, to stop soon after having seen enough UTF-8 characters */
+#define ENOUGH8 20 	// If we've seen that many, we're confident it UTF-8
+#define CHUNK8 4096
+      for (n = 0; (n < nMax) && (nValidUTF8 <= ENOUGH8); n += nSkip) {
+	nSkip = nMax - n;
+	if (nSkip > CHUNK8) nSkip = CHUNK8;
+	// A character cut at the end of the chunk is checked again in the next one
+	nSkip = EncScanUTF8(pszBuffer+n, nSkip, &nValidUTF8);
+	if (!nSkip) break;
+      }
+      isValidUTF8 = (n >= nMax) || (nValidUTF8 > ENOUGH8);
+      if (!isValidUTF8) {	// It stopped on a NUL or an invalid byte
+	if (!pszBuffer[n]) {
 	  nNUL8 += 1;
-	  if (nNUL8 > 0) {
-	    isValidUTF8 = FALSE;
-	    break;		// No need to scan any further, it's something else
-	  }
+	} else {
+	  nNonASCII += 1;
 	}
-/* See https://en.wikipedia.org/wiki/UTF-8 */
-#define IS_ASCII(c)     ((c&0x80) == 0)
-#define IS_LEAD_BYTE(c) ((c&0xC0) == 0xC0)
-#define IS_TAIL_BYTE(c) ((c&0xC0) == 0x80)
-	if (IS_ASCII(c)) continue;
-	nNonASCII += 1;
-	if (IS_LEAD_BYTE(c)) {
-	  int nTailBytesExpected = 0;
-	  if ((c&0x20) == 0) {
-	    nTailBytesExpected = 1;
-	    if ((c == '\xC0') || (c == '\xC1')) isValidUTF8 = FALSE; /* Overlong encoding of 7-bits ASCII */
-	  } else if ((c&0x10) == 0) {
-	    nTailBytesExpected = 2;
-	  } else if ((c&0x08) == 0) {
-	    nTailBytesExpected = 3;
-	    if ((c >= '\xF5') && (c <= '\xF7')) isValidUTF8 = FALSE; /* Encoding of invalid Unicode chars > \u10FFFF */
-	  } else {	/* No valid Unicode character requires a 5-bytes or more encoding */
-	    isValidUTF8 = FALSE;
-	    break;		// No need to scan any further, it's something else
-	  }
-	  /* Then make sure that the expected tail bytes are all there */
-	  for ( ; nTailBytesExpected && (++n < nBufSize); nTailBytesExpected--) {
-	    c = pszBuffer[n];
-	    if (!IS_ASCII(c)) nNonASCII += 1;
-	    if (!IS_TAIL_BYTE(c)) { /* Invalid UTF-8 sequence */
-	      isValidUTF8 = FALSE;
-	      break;		// No need to scan any further, it's something else
-	    }
-	  }
-	  if (nTailBytesExpected) isValidUTF8 = FALSE; /* Incomplete UTF-8 sequence at the end of the buffer */
-	} else { /* Invalid UTF-8 tail byte not preceeded by a lead byte */
-	  isValidUTF8 = FALSE;
-	  break;		// No need to scan any further, it's something else
-	} /* End if (IS_LEAD_BYTE(c)) */
-	if (!isValidUTF8) break;	// No need to scan any further, it's something else
-#define ENOUGH8 20 	// If we've seen that many, we're confident it UTF-8
-	if (++nValidUTF8 > ENOUGH8) break;	// No need to scan any further, it's UTF-8
-      } /* End for each byte in pszBuffer[] */
+      }
+      nNonASCII += nValidUTF8;	// Count the multi-byte characters as one non-ASCII byte
       DEBUG_PRINTF(("nNUL8 = %lu\n", (unsigned long)nNUL8));
       DEBUG_PRINTF(("nValidUTF8 = %d\n", nValidUTF8));
       DEBUG_PRINTF(("isValidUTF8 = %s\n", isValidUTF8 ? "TRUE" : "FALSE"));
@@ -187,17 +167,16 @@ UINT GetBufferEncoding(const char *pszBuffer, size_t nBufSize, DWORD dwFlags) {
     /* Check if this may be ASCII - Must immedately follow the test for UTF-8 */
     if (dwFlags & BE_TEST_ASCII) {
       isASCII = TRUE;
-      if ((nNUL8 <= 0) && !nNonASCII) for ( ; n<nMax; n++) {
-	char c = pszBuffer[n];
-	if (!c) {
-	  nNUL8 += 1;
-	  if (nNUL8 > 0) break;	// No need to scan any further, it's something else
-	}
-	if (c & 0x80) {
-	  nNonASCII += 1;
-	  break;			// No need to scan any further, it's something else
-	}
+      if ((nNUL8 <= 0) && !nNonASCII && (n < nMax)) {
 	// To be sure it's ASCII, we must scan to the very end
+	n += EncScanASCII(pszBuffer+n, nMax-n);
+	if (n < nMax) {		// It stopped on a NUL or a non-ASCII byte
+	  if (!pszBuffer[n]) {
+	    nNUL8 += 1;
+	  } else {
+	    nNonASCII += 1;
+	  }
+	}
       }
       isASCII = isASCII && (nNUL8 <= 0) && !nNonASCII;
       DEBUG_PRINTF(("nNUL8 = %lu\n", (unsigned long)nNUL8));
@@ -211,8 +190,16 @@ UINT GetBufferEncoding(const char *pszBuffer, size_t nBufSize, DWORD dwFlags) {
       isValidUTF16 = TRUE;
       nMax = nBufSize & ~1;
       if (nMax && !*(WORD *)(pszBuffer+nMax-2)) nMax -= 2; // Support strings with a final NUL
+#define ENOUGH16 10000 // If we've seen that many, we're confident it UTF-16
       for (n=0; n < nMax; n+=2) {
-	WORD w = *(WORD *)(pszBuffer+n);
+	WORD w;
+	size_t nWords = (nMax - n) / 2;
+	if (nWords > (ENOUGH16 + 1 - nValidUTF16)) nWords = ENOUGH16 + 1 - nValidUTF16;
+	nWords = EncScanUTF16(pszBuffer+n, nWords, &nHiNUL8); // Skip the words that are valid alone
+	nValidUTF16 += nWords;
+	n += 2 * nWords;
+	if ((nValidUTF16 > ENOUGH16) || (n >= nMax)) break;
+	w = *(WORD *)(pszBuffer+n);
 	if (!w) {
 	  nNUL16 += 1;
 	  if (nNUL16 > 0) {
@@ -232,7 +219,6 @@ UINT GetBufferEncoding(const char *pszBuffer, size_t nBufSize, DWORD dwFlags) {
 	  isValidUTF16 = FALSE;
 	  break;			// No need to scan any further, it's something else
 	}
-#define ENOUGH16 10000 // If we've seen that many, we're confident it UTF-16
 	if (++nValidUTF16 > ENOUGH16) break;	// No need to scan any further, it's UTF-16
       }
       DEBUG_PRINTF(("nNUL16 = %lu\n", (unsigned long)nNUL16));
@@ -246,8 +232,16 @@ UINT GetBufferEncoding(const char *pszBuffer, size_t nBufSize, DWORD dwFlags) {
       isValidUTF32 = TRUE;
       nMax = nBufSize & ~3;
       if (nMax && !*(DWORD *)(pszBuffer+nMax-4)) nMax -= 4; // Support strings with a final NUL
+#define ENOUGH32 10000 // If we've seen that many, we're confident it UTF-32
       for (n=0; n < nMax; n+=4) {
-	DWORD dw = *(DWORD *)(pszBuffer+n);
+	DWORD dw;
+	size_t nDWords = (nMax - n) / 4;
+	if (nDWords > (ENOUGH32 + 1 - nValidUTF32)) nDWords = ENOUGH32 + 1 - nValidUTF32;
+	nDWords = EncScanUTF32(pszBuffer+n, nDWords, &nHiNUL16); // Skip the valid dwords
+	nValidUTF32 += nDWords;
+	n += 4 * nDWords;
+	if ((nValidUTF32 > ENOUGH32) || (n >= nMax)) break;
+	dw = *(DWORD *)(pszBuffer+n);
 	if (!dw) {
 	  nNUL32 += 1;
 	  if (nNUL32 > 0) {
@@ -263,7 +257,6 @@ UINT GetBufferEncoding(const char *pszBuffer, size_t nBufSize, DWORD dwFlags) {
 	  isValidUTF32 = FALSE;
 	  break;			// No need to scan any further, it's something else
 	}
-#define ENOUGH32 10000 // If we've seen that many, we're confident it UTF-32
 	if (++nValidUTF32 > ENOUGH32) break;	// No need to scan any further, it's UTF-32
       }
       DEBUG_PRINTF(("nNUL32 = %lu\n", (unsigned long)nNUL32));
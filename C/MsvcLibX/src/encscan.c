@@ -0,0 +1,602 @@
+/*****************************************************************************\
+*                                                                             *
+*   Filename	    encscan.c						      *
+*									      *
+*   Description     Fast scans of text buffers, for encoding detection        *
+*                                                                             *
+*   Notes	    Used by GetBufferEncoding() to skip quickly over the      *
+*		    bytes or words that need no further analysis, and to      *
+*		    validate UTF-8 text.				      *
+*		    							      *
+*		    The x86 and amd64 versions use SSE2 or AVX2 vector	      *
+*		    instructions, selected at run time depending on the CPU.  *
+*		    Other processors use a scalar version, which processes    *
+*		    ASCII one size_t word at a time.			      *
+*		    							      *
+*		    This module uses only standard C types, and does not      *
+*		    depend on any other MsvcLibX module. So it can be built   *
+*		    and tested with any C compiler, including gcc in Linux.   *
+*		    							      *
+*   History								      *
+*    2026-10-18 JFL Created this module.				      *
+*    2026-10-18 JFL Added EncScanUTF8(), for validating UTF-8 text.	      *
+*                                                                             *
+*                    Copyright 2026 Jean-Franois Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#include <limits.h>
+#include "encscan.h"
+
+/* A 32-bits unsigned integer, even for 16-bits compilers */
+#if UINT_MAX == 0xFFFFFFFF
+typedef unsigned int encU32;
+#else
+typedef unsigned long encU32;
+#endif
+
+/* Vector instructions support */
+#if !defined(_MSDOS) && (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__))
+#if defined(_MSC_VER) && (_MSC_VER >= 1800)	/* Visual C++ 2013 or later */
+#include <intrin.h>
+#include <immintrin.h>
+#define HAS_AVX2 1
+#define TARGET_SSE2
+#define TARGET_AVX2
+#elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5))
+#include <immintrin.h>	/* Defines all intrinsics, for use with the target attribute */
+#define HAS_AVX2 1
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif /* x86 or amd64 */
+#ifndef HAS_AVX2
+#define HAS_AVX2 0
+#endif
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    EncScanASCII / EncScanUTF16 / EncScanUTF32		      |
+|									      |
+|   Description     Skip the data that needs no further analysis	      |
+|									      |
+|   Parameters      const char *pBuf	The data to scan		      |
+|		    size_t nBuf		The number of bytes to scan	      |
+|		    size_t nWords	The number of 16-bits words to scan   |
+|		    size_t nDWords	The number of 32-bits words to scan   |
+|		    size_t *pnHiNUL8	Incremented for words < 0x100	      |
+|		    size_t *pnHiNUL16	Incremented for dwords < 0x10000      |
+|		    							      |
+|   Returns	    The number of leading bytes or words skipped	      |
+|		    							      |
+|   Notes	    EncScanASCII() stops on the first NUL or non-ASCII byte.  |
+|		    EncScanUTF16() stops on the first NUL word, forbidden     |
+|		    0xFFFE or 0xFFFF, or surrogate, as these must be checked  |
+|		    with the next word.					      |
+|		    EncScanUTF32() stops on the first NUL dword, forbidden    |
+|		    0xFFFE or 0xFFFF, value with more than 21 bits, or value  |
+|		    with low 16 bits in the surrogates range.		      |
+|		    The counts are only for the words skipped.		      |
+|		    							      |
+|		    The vector versions process blocks of 16 or 32 bytes, and |
+|		    let the scalar version find the exact stop in the last    |
+|		    block, and process the incomplete block at the end.	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created these routines.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+/* Scalar versions */
+
+static size_t ScanASCIIScalar(const char *pBuf, size_t nBuf) {
+  size_t n = 0;
+  const size_t ONES = (size_t)-1 / 0xFF;	/* 0x0101...01 */
+  const size_t HIGHS = ONES << 7;		/* 0x8080...80 */
+
+  /* Get aligned, then check a whole size_t at a time */
+  while ((n < nBuf) && ((size_t)(pBuf + n) & (sizeof(size_t) - 1))) {
+    if ((pBuf[n] & 0x80) || !pBuf[n]) return n;
+    n += 1;
+  }
+  for ( ; (n + sizeof(size_t)) <= nBuf; n += sizeof(size_t)) {
+    size_t v = *(const size_t *)(pBuf + n);
+    /* The high bit of (v - ONES) is set for every NUL byte, and v's for every non-ASCII byte */
+    if ((v | (v - ONES)) & HIGHS) break;
+  }
+  while ((n < nBuf) && !(pBuf[n] & 0x80) && pBuf[n]) n += 1;
+  return n;
+}
+
+static size_t ScanUTF16Scalar(const char *pBuf, size_t nWords, size_t *pnHiNUL8) {
+  size_t n;
+
+  for (n = 0; n < nWords; n++) {
+    unsigned short w = ((const unsigned short *)pBuf)[n];
+    if (   !w				/* NUL */
+	|| (w >= 0xFFFE)		/* Forbidden values */
+	|| ((w & 0xF800) == 0xD800)	/* Surrogate pair word */
+       ) break;
+    if (!(w & 0xFF00)) *pnHiNUL8 += 1;
+  }
+  return n;
+}
+
+static size_t ScanUTF32Scalar(const char *pBuf, size_t nDWords, size_t *pnHiNUL16) {
+  size_t n;
+
+  for (n = 0; n < nDWords; n++) {
+    encU32 dw = ((const encU32 *)pBuf)[n];
+    if (   !dw				/* NUL */
+	|| (dw & 0xFFE00000UL)		/* More than 21 bits */
+	|| (dw == 0xFFFF) || (dw == 0xFFFE) /* Forbidden values */
+	|| ((dw & 0xF800) == 0xD800)	/* Reserved for UTF16 surrogate pairs */
+       ) break;
+    if (!(dw & 0xFFFF0000UL)) *pnHiNUL16 += 1;
+  }
+  return n;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    EncScanUTF8						      |
+|									      |
+|   Description     Skip the valid UTF-8 characters			      |
+|									      |
+|   Parameters      const char *pBuf	The data to scan		      |
+|		    size_t nBuf		The number of bytes to scan	      |
+|		    size_t *pnMulti	Incremented for multi-byte characters |
+|		    							      |
+|   Returns	    The number of leading bytes skipped			      |
+|		    							      |
+|   Notes	    Stops on the first NUL, or the first byte that does not   |
+|		    begin a complete and valid UTF-8 sequence. Overlong	      |
+|		    encodings, surrogates, and characters > \u10FFFF are      |
+|		    invalid.						      |
+|		    The count is only for the characters skipped.	      |
+|		    							      |
+|		    The SSE2 version only skips ASCII runs 16 bytes at a      |
+|		    time, as SSE2 has no byte shuffle for looking up tables.  |
+|		    The AVX2 version validates whole 32-bytes blocks, using   |
+|		    the lookup tables algorithm of John Keiser & Daniel       |
+|		    Lemire, and lets the scalar version find the exact stop.  |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+/* Get the length of the valid UTF-8 sequence at p, or 0 if none */
+static size_t UTF8SeqLength(const unsigned char *p, size_t nLeft) {
+  unsigned char c = p[0];
+  unsigned char cMin = 0x80, cMax = 0xBF; /* The range of the second byte */
+  size_t l, i;
+
+  if (c < 0x80) return c ? 1 : 0;	/* ASCII, but not NUL */
+  if (c < 0xC2) return 0;		/* Tail byte, or overlong encoding of ASCII */
+  if (c < 0xE0) {
+    l = 2;
+  } else if (c < 0xF0) {
+    l = 3;
+    if (c == 0xE0) cMin = 0xA0;		/* Overlong encoding */
+    if (c == 0xED) cMax = 0x9F;		/* Surrogates */
+  } else if (c < 0xF5) {
+    l = 4;
+    if (c == 0xF0) cMin = 0x90;		/* Overlong encoding */
+    if (c == 0xF4) cMax = 0x8F;		/* Characters > \u10FFFF */
+  } else {
+    return 0;				/* Characters > \u10FFFF, or 5+ bytes */
+  }
+  if (nLeft < l) return 0;		/* Incomplete sequence */
+  if ((p[1] < cMin) || (p[1] > cMax)) return 0;
+  for (i = 2; i < l; i++) if ((p[i] & 0xC0) != 0x80) return 0;
+  return l;
+}
+
+static size_t ScanUTF8Scalar(const char *pBuf, size_t nBuf, size_t *pnMulti) {
+  size_t n = 0;
+
+  while (n < nBuf) {
+    size_t l;
+    n += ScanASCIIScalar(pBuf + n, nBuf - n);
+    if (n >= nBuf) break;
+    l = UTF8SeqLength((const unsigned char *)pBuf + n, nBuf - n);
+    if (!l) break;
+    if (l > 1) *pnMulti += 1;
+    n += l;
+  }
+  return n;
+}
+
+#if HAS_AVX2
+
+static int FirstBit(unsigned int u) { /* Index of the lowest bit set. u must not be 0 */
+#if defined(_MSC_VER)
+  unsigned long ul;
+  _BitScanForward(&ul, u);
+  return (int)ul;
+#else
+  return __builtin_ctz(u);
+#endif
+}
+
+static int BitCount(unsigned int u) { /* Number of bits set in a 32-bits integer */
+  u = u - ((u >> 1) & 0x55555555);
+  u = (u & 0x33333333) + ((u >> 2) & 0x33333333);
+  return (int)((((u + (u >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+}
+
+/* SSE2 versions, 16 bytes at a time */
+
+TARGET_SSE2 static size_t ScanASCIISSE2(const char *pBuf, size_t nBuf) {
+  size_t n;
+  const __m128i zero = _mm_setzero_si128();
+
+  for (n = 0; (n + 16) <= nBuf; n += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pBuf + n));
+    /* The high bit of every byte is set for non-ASCII bytes, and for NULs after the compare */
+    unsigned int uStop = (unsigned int)_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+    if (uStop) return n + FirstBit(uStop);
+  }
+  return n + ScanASCIIScalar(pBuf + n, nBuf - n);
+}
+
+TARGET_SSE2 static size_t ScanUTF16SSE2(const char *pBuf, size_t nWords, size_t *pnHiNUL8) {
+  size_t n;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i xFFFF = _mm_set1_epi16(-1);
+  const __m128i xFF00 = _mm_set1_epi16((short)0xFF00);
+  const __m128i xF800 = _mm_set1_epi16((short)0xF800);
+  const __m128i xD800 = _mm_set1_epi16((short)0xD800);
+
+  for (n = 0; (n + 8) <= nWords; n += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pBuf + 2*n));
+    __m128i vStop = _mm_or_si128(_mm_or_si128(
+	_mm_cmpeq_epi16(v, zero),				/* NUL */
+	_mm_cmpeq_epi16(_mm_or_si128(v, one), xFFFF)),		/* 0xFFFE or 0xFFFF */
+	_mm_cmpeq_epi16(_mm_and_si128(v, xF800), xD800));	/* Surrogate */
+    if (_mm_movemask_epi8(vStop)) break;
+    *pnHiNUL8 += BitCount(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, xFF00), zero))) / 2;
+  }
+  return n + ScanUTF16Scalar(pBuf + 2*n, nWords - n, pnHiNUL8);
+}
+
+TARGET_SSE2 static size_t ScanUTF32SSE2(const char *pBuf, size_t nDWords, size_t *pnHiNUL16) {
+  size_t n;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i xFFFF = _mm_set1_epi32(0xFFFF);
+  const __m128i xFFE00000 = _mm_set1_epi32((int)0xFFE00000);
+  const __m128i xFFFF0000 = _mm_set1_epi32((int)0xFFFF0000);
+  const __m128i xF800 = _mm_set1_epi32(0xF800);
+  const __m128i xD800 = _mm_set1_epi32(0xD800);
+
+  for (n = 0; (n + 4) <= nDWords; n += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pBuf + 4*n));
+    __m128i vOK = _mm_cmpeq_epi32(_mm_and_si128(v, xFFE00000), zero); /* <= 21 bits */
+    __m128i vStop = _mm_or_si128(_mm_or_si128(
+	_mm_cmpeq_epi32(v, zero),				/* NUL */
+	_mm_cmpeq_epi32(_mm_or_si128(v, one), xFFFF)),		/* 0xFFFE or 0xFFFF */
+	_mm_cmpeq_epi32(_mm_and_si128(v, xF800), xD800));	/* Surrogate */
+    if (_mm_movemask_epi8(_mm_andnot_si128(vOK, _mm_cmpeq_epi32(zero, zero))) | _mm_movemask_epi8(vStop)) break;
+    *pnHiNUL16 += BitCount(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v, xFFFF0000), zero))) / 4;
+  }
+  return n + ScanUTF32Scalar(pBuf + 4*n, nDWords - n, pnHiNUL16);
+}
+
+TARGET_SSE2 static size_t ScanUTF8SSE2(const char *pBuf, size_t nBuf, size_t *pnMulti) {
+  size_t n = 0;
+  const __m128i zero = _mm_setzero_si128();
+
+  while ((n + 16) <= nBuf) {
+    size_t nEnd = n + 16;
+    __m128i v = _mm_loadu_si128((const __m128i *)(pBuf + n));
+    unsigned int uStop = (unsigned int)_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+    if (!uStop) {
+      n = nEnd;
+      continue;
+    }
+    /* Check the characters up to the end of this block one at a time */
+    for (n += FirstBit(uStop); n < nEnd; ) {
+      size_t l = UTF8SeqLength((const unsigned char *)pBuf + n, nBuf - n);
+      if (!l) return n;
+      if (l > 1) *pnMulti += 1;
+      n += l;
+    }
+  }
+  return n + ScanUTF8Scalar(pBuf + n, nBuf - n, pnMulti);
+}
+
+/* AVX2 versions, 32 bytes at a time */
+
+TARGET_AVX2 static size_t ScanASCIIAVX2(const char *pBuf, size_t nBuf) {
+  size_t n;
+  const __m256i zero = _mm256_setzero_si256();
+
+  for (n = 0; (n + 32) <= nBuf; n += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(pBuf + n));
+    unsigned int uStop = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(v, _mm256_cmpeq_epi8(v, zero)));
+    if (uStop) return n + FirstBit(uStop);
+  }
+  return n + ScanASCIIScalar(pBuf + n, nBuf - n);
+}
+
+TARGET_AVX2 static size_t ScanUTF16AVX2(const char *pBuf, size_t nWords, size_t *pnHiNUL8) {
+  size_t n;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i xFFFF = _mm256_set1_epi16(-1);
+  const __m256i xFF00 = _mm256_set1_epi16((short)0xFF00);
+  const __m256i xF800 = _mm256_set1_epi16((short)0xF800);
+  const __m256i xD800 = _mm256_set1_epi16((short)0xD800);
+
+  for (n = 0; (n + 16) <= nWords; n += 16) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(pBuf + 2*n));
+    __m256i vStop = _mm256_or_si256(_mm256_or_si256(
+	_mm256_cmpeq_epi16(v, zero),
+	_mm256_cmpeq_epi16(_mm256_or_si256(v, one), xFFFF)),
+	_mm256_cmpeq_epi16(_mm256_and_si256(v, xF800), xD800));
+    if (_mm256_movemask_epi8(vStop)) break;
+    *pnHiNUL8 += BitCount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(v, xFF00), zero))) / 2;
+  }
+  return n + ScanUTF16Scalar(pBuf + 2*n, nWords - n, pnHiNUL8);
+}
+
+TARGET_AVX2 static size_t ScanUTF32AVX2(const char *pBuf, size_t nDWords, size_t *pnHiNUL16) {
+  size_t n;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i xFFFF = _mm256_set1_epi32(0xFFFF);
+  const __m256i xFFE00000 = _mm256_set1_epi32((int)0xFFE00000);
+  const __m256i xFFFF0000 = _mm256_set1_epi32((int)0xFFFF0000);
+  const __m256i xF800 = _mm256_set1_epi32(0xF800);
+  const __m256i xD800 = _mm256_set1_epi32(0xD800);
+
+  for (n = 0; (n + 8) <= nDWords; n += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(pBuf + 4*n));
+    __m256i vOK = _mm256_cmpeq_epi32(_mm256_and_si256(v, xFFE00000), zero);
+    __m256i vStop = _mm256_or_si256(_mm256_or_si256(
+	_mm256_cmpeq_epi32(v, zero),
+	_mm256_cmpeq_epi32(_mm256_or_si256(v, one), xFFFF)),
+	_mm256_cmpeq_epi32(_mm256_and_si256(v, xF800), xD800));
+    if (((unsigned int)_mm256_movemask_epi8(vOK) != 0xFFFFFFFF) || _mm256_movemask_epi8(vStop)) break;
+    *pnHiNUL16 += BitCount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(v, xFFFF0000), zero))) / 4;
+  }
+  return n + ScanUTF32Scalar(pBuf + 4*n, nDWords - n, pnHiNUL16);
+}
+
+/* Error flags for the Keiser & Lemire UTF-8 validation algorithm.
+   Each flag is set in the three tables below for the byte pairs that it
+   may apply to, so that ANDing the three lookups leaves only real errors. */
+#define U8_TOO_SHORT	0x01 /* 11______ 0_______ or 11______ 11______ */
+#define U8_TOO_LONG	0x02 /* 0_______ 10______ */
+#define U8_OVERLONG_3	0x04 /* 11100000 100_____ */
+#define U8_TOO_LARGE	0x08 /* 11110100 1001____ or 11110100 101_____ */
+#define U8_SURROGATE	0x10 /* 11101101 101_____ */
+#define U8_OVERLONG_2	0x20 /* 1100000_ 10______ */
+#define U8_TOO_LARGE_1000 0x40 /* 11110101 1000____ or 1111011_ 1000____ or 11111___ 1000____ */
+#define U8_OVERLONG_4	0x40 /* 11110000 1000____ */
+#define U8_TWO_CONTS	0x80 /* 10______ 10______ */
+#define U8_CARRY	(U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+/* Get the vector of the 32 bytes preceding each byte in v by N, with the end of vPrev */
+#define PREV_BYTES(v, vPrev, N) _mm256_alignr_epi8(v, _mm256_permute2x128_si256(vPrev, v, 0x21), 16 - N)
+
+/* Get an error vector for a block of 32 bytes, given the previous block */
+TARGET_AVX2 static __m256i UTF8ErrorsAVX2(__m256i v, __m256i vPrev) {
+  const __m256i x0F = _mm256_set1_epi8(0x0F);
+  const __m256i x80 = _mm256_set1_epi8((char)0x80);
+  const __m256i tByte1High = _mm256_setr_epi8(
+    /* 0_______ ________ ASCII in byte 1 */
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    /* 10______ ________ Continuation in byte 1 */
+    (char)U8_TWO_CONTS, (char)U8_TWO_CONTS, (char)U8_TWO_CONTS, (char)U8_TWO_CONTS,
+    /* 1100____ ________ and 1101____ ________ Two-bytes lead in byte 1 */
+    U8_TOO_SHORT | U8_OVERLONG_2, U8_TOO_SHORT,
+    /* 1110____ ________ Three-bytes lead in byte 1 */
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+    /* 1111____ ________ Four+-bytes lead in byte 1 */
+    U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+    /* Same table in the high 128-bits lane */
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    (char)U8_TWO_CONTS, (char)U8_TWO_CONTS, (char)U8_TWO_CONTS, (char)U8_TWO_CONTS,
+    U8_TOO_SHORT | U8_OVERLONG_2, U8_TOO_SHORT,
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+    U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4);
+#define U8_LOW_TABLE \
+    /* ____0000 ________ */ \
+    (char)(U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4), \
+    /* ____0001 ________ */ \
+    (char)(U8_CARRY | U8_OVERLONG_2), \
+    /* ____001_ ________ */ \
+    (char)U8_CARRY, (char)U8_CARRY, \
+    /* ____0100 ________ */ \
+    (char)(U8_CARRY | U8_TOO_LARGE), \
+    /* ____0101 ________ to ____1100 ________ */ \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    /* ____1101 ________ */ \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE), \
+    /* ____111_ ________ */ \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000), \
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000)
+  const __m256i tByte1Low = _mm256_setr_epi8(U8_LOW_TABLE, U8_LOW_TABLE);
+#undef U8_LOW_TABLE
+#define U8_HIGH_TABLE \
+    /* ________ 0_______ ASCII in byte 2 */ \
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, \
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, \
+    /* ________ 1000____ */ \
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4), \
+    /* ________ 1001____ */ \
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE), \
+    /* ________ 101_____ */ \
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE), \
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE), \
+    /* ________ 11______ */ \
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT
+  const __m256i tByte2High = _mm256_setr_epi8(U8_HIGH_TABLE, U8_HIGH_TABLE);
+#undef U8_HIGH_TABLE
+  __m256i vPrev1 = PREV_BYTES(v, vPrev, 1);
+  __m256i vErrors = _mm256_and_si256(_mm256_and_si256(
+    _mm256_shuffle_epi8(tByte1High, _mm256_and_si256(_mm256_srli_epi16(vPrev1, 4), x0F)),
+    _mm256_shuffle_epi8(tByte1Low, _mm256_and_si256(vPrev1, x0F))),
+    _mm256_shuffle_epi8(tByte2High, _mm256_and_si256(_mm256_srli_epi16(v, 4), x0F)));
+  /* The third and fourth bytes of 3 and 4-bytes sequences must be continuations */
+  __m256i vMust23 = _mm256_and_si256(_mm256_or_si256(
+    _mm256_subs_epu8(PREV_BYTES(v, vPrev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80))),
+    _mm256_subs_epu8(PREV_BYTES(v, vPrev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)))), x80);
+  return _mm256_xor_si256(vMust23, vErrors);
+}
+
+TARGET_AVX2 static size_t ScanUTF8AVX2(const char *pBuf, size_t nBuf, size_t *pnMulti) {
+  size_t n, k;
+  size_t nMulti = 0;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i xBF = _mm256_set1_epi8((char)0xBF);
+  __m256i vPrev = zero;
+
+  for (n = 0; (n + 32) <= nBuf; n += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(pBuf + n));
+    __m256i vErrors = UTF8ErrorsAVX2(v, vPrev);
+    if (!_mm256_testz_si256(vErrors, vErrors) || _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero))) break;
+    /* Count the lead bytes of multi-byte characters, ie. those >= 0xC0 */
+    nMulti += BitCount((unsigned int)_mm256_movemask_epi8(_mm256_and_si256(v, _mm256_cmpgt_epi8(v, xBF))));
+    vPrev = v;
+  }
+  /* Back up to the beginning of the last character, if it straddles the block boundary */
+  for (k = 1; (k <= 3) && (k <= n); k++) {
+    unsigned char c = (unsigned char)pBuf[n - k];
+    if ((c & 0xC0) != 0x80) { /* This is the last character lead byte */
+      if ((c >= 0xC0) && (((c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : 2) > k)) {
+	n -= k;
+	nMulti -= 1;
+      }
+      break;
+    }
+  }
+  *pnMulti += nMulti;
+  return n + ScanUTF8Scalar(pBuf + n, nBuf - n, pnMulti);
+}
+
+/* Get the best vector instructions set supported by the CPU and the OS */
+static int GetVectorLevel(void) {
+#if defined(_MSC_VER)
+  int aiRegs[4];
+  int iLevel = 0;
+
+  __cpuid(aiRegs, 0);
+  if (aiRegs[0] < 1) return 0;
+  __cpuid(aiRegs, 1);
+  if (aiRegs[3] & (1 << 26)) iLevel = 1;	/* EDX bit 26 = SSE2 */
+  if (   (aiRegs[2] & (1 << 27))		/* ECX bit 27 = OSXSAVE */
+      && ((_xgetbv(0) & 6) == 6)) {		/* The OS saves the XMM and YMM registers */
+    __cpuid(aiRegs, 0);
+    if (aiRegs[0] >= 7) {
+      __cpuidex(aiRegs, 7, 0);
+      if (aiRegs[1] & (1 << 5)) iLevel = 2;	/* EBX bit 5 = AVX2 */
+    }
+  }
+  return iLevel;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return 2;	/* Also checks the OS support */
+  if (__builtin_cpu_supports("sse2")) return 1;
+  return 0;
+#endif
+}
+
+#endif /* HAS_AVX2 */
+
+/* Run-time selection of the best version */
+
+static size_t ScanASCIIInit(const char *pBuf, size_t nBuf);
+static size_t ScanUTF16Init(const char *pBuf, size_t nWords, size_t *pnHiNUL8);
+static size_t ScanUTF32Init(const char *pBuf, size_t nDWords, size_t *pnHiNUL16);
+static size_t ScanUTF8Init(const char *pBuf, size_t nBuf, size_t *pnMulti);
+
+static size_t (*pScanASCII)(const char *, size_t) = ScanASCIIInit;
+static size_t (*pScanUTF16)(const char *, size_t, size_t *) = ScanUTF16Init;
+static size_t (*pScanUTF32)(const char *, size_t, size_t *) = ScanUTF32Init;
+static size_t (*pScanUTF8)(const char *, size_t, size_t *) = ScanUTF8Init;
+
+int EncScanSelect(int iLevel) {
+#if HAS_AVX2
+  int iMaxLevel = GetVectorLevel();
+#else
+  int iMaxLevel = 0;
+#endif
+
+  if ((iLevel < 0) || (iLevel > iMaxLevel)) iLevel = iMaxLevel;
+  switch (iLevel) {
+#if HAS_AVX2
+  case 2:
+    pScanASCII = ScanASCIIAVX2;
+    pScanUTF16 = ScanUTF16AVX2;
+    pScanUTF32 = ScanUTF32AVX2;
+    pScanUTF8 = ScanUTF8AVX2;
+    break;
+  case 1:
+    pScanASCII = ScanASCIISSE2;
+    pScanUTF16 = ScanUTF16SSE2;
+    pScanUTF32 = ScanUTF32SSE2;
+    pScanUTF8 = ScanUTF8SSE2;
+    break;
+#endif
+  default:
+    pScanASCII = ScanASCIIScalar;
+    pScanUTF16 = ScanUTF16Scalar;
+    pScanUTF32 = ScanUTF32Scalar;
+    pScanUTF8 = ScanUTF8Scalar;
+    break;
+  }
+  return iLevel;
+}
+
+/* The first call selects the best version, then calls it. Selecting it twice in parallel threads is harmless */
+static size_t ScanASCIIInit(const char *pBuf, size_t nBuf) {
+  EncScanSelect(-1);
+  return pScanASCII(pBuf, nBuf);
+}
+
+static size_t ScanUTF16Init(const char *pBuf, size_t nWords, size_t *pnHiNUL8) {
+  EncScanSelect(-1);
+  return pScanUTF16(pBuf, nWords, pnHiNUL8);
+}
+
+static size_t ScanUTF32Init(const char *pBuf, size_t nDWords, size_t *pnHiNUL16) {
+  EncScanSelect(-1);
+  return pScanUTF32(pBuf, nDWords, pnHiNUL16);
+}
+
+static size_t ScanUTF8Init(const char *pBuf, size_t nBuf, size_t *pnMulti) {
+  EncScanSelect(-1);
+  return pScanUTF8(pBuf, nBuf, pnMulti);
+}
+
+/* The public routines */
+
+size_t EncScanASCII(const char *pBuf, size_t nBuf) {
+  return pScanASCII(pBuf, nBuf);
+}
+
+size_t EncScanUTF16(const char *pBuf, size_t nWords, size_t *pnHiNUL8) {
+  return pScanUTF16(pBuf, nWords, pnHiNUL8);
+}
+
+size_t EncScanUTF32(const char *pBuf, size_t nDWords, size_t *pnHiNUL16) {
+  return pScanUTF32(pBuf, nDWords, pnHiNUL16);
+}
+
+size_t EncScanUTF8(const char *pBuf, size_t nBuf, size_t *pnMulti) {
+  return pScanUTF8(pBuf, nBuf, pnMulti);
+}
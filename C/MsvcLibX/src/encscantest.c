@@ -0,0 +1,226 @@
+/*****************************************************************************\
+*                                                                             *
+*   Filename	    encscantest.c					      *
+*									      *
+*   Description     Test the encscan.c routines				      *
+*                                                                             *
+*   Notes	    Checks that the scalar, SSE2 and AVX2 versions of each    *
+*		    routine return the same results, for random buffers of    *
+*		    all lengths and byte alignments, including lengths that   *
+*		    are not a multiple of the vector size.		      *
+*		    The UTF-8 results are also checked against a reference    *
+*		    decoder, independent of the encscan.c implementation.     *
+*		    							      *
+*		    Built and run on Linux with `make test`.		      *
+*		    							      *
+*   History								      *
+*    2026-10-18 JFL Created this program.				      *
+*                                                                             *
+*                   (C) Copyright 2026 Jean-Francois Larvoire                 *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "encscan.h"
+
+#define MAXLEN 300	/* Test all lengths up to that, to cover several blocks */
+#define MAXALIGN 8	/* Test all offsets up to that from an aligned address */
+#define NPASSES 200	/* Number of random buffers for each length */
+
+static const char *apszLevel[] = {"Scalar", "SSE2", "AVX2"};
+static unsigned long ulSeed = 1;
+/* Bytes from the ranges that matter for UTF-8 validation */
+static const unsigned char abSpecial[] = {
+  0x00, 0x41, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC1, 0xC2,
+  0xDF, 0xE0, 0xE1, 0xED, 0xEF, 0xF0, 0xF1, 0xF4, 0xF5, 0xF8, 0xFF
+};
+/* Characters at the limits of the UTF-8 encoding ranges */
+static const unsigned long aulLimits[] = {
+  0x7F, 0x80, 0x7FF, 0x800, 0xFFF, 0x1000, 0xD7FF, 0xE000, 0xFFFF,
+  0x10000, 0x3FFFF, 0x40000, 0xFFFFF, 0x100000, 0x10FFFF
+};
+static int nErrors = 0;
+
+static unsigned int Random(void) { /* A portable pseudo-random generator */
+  ulSeed = ulSeed * 1103515245UL + 12345UL;
+  return (unsigned int)((ulSeed >> 16) & 0x7FFF);
+}
+
+/* Append a random Unicode character to a UTF-8 buffer. Returns its length */
+static size_t PutUTF8(unsigned char *p) {
+  unsigned long u;
+  switch (Random() % 5) {
+  case 0: u = Random() % 0x80; if (!u) u = 'A'; break;
+  case 1: u = 0x80 + Random() % 0x780; break;
+  case 2: do u = 0x800 + Random() % 0xF800; while ((u >= 0xD800) && (u < 0xE000)); break;
+  case 3: u = 0x10000 + ((unsigned long)Random() << 5 ^ Random()) % 0x100000; break;
+  default: u = aulLimits[Random() % (sizeof(aulLimits) / sizeof(aulLimits[0]))]; break;
+  }
+  if (u < 0x80) { p[0] = (unsigned char)u; return 1; }
+  if (u < 0x800) { p[0] = (unsigned char)(0xC0 | (u >> 6)); p[1] = (unsigned char)(0x80 | (u & 0x3F)); return 2; }
+  if (u < 0x10000) {
+    p[0] = (unsigned char)(0xE0 | (u >> 12));
+    p[1] = (unsigned char)(0x80 | ((u >> 6) & 0x3F));
+    p[2] = (unsigned char)(0x80 | (u & 0x3F));
+    return 3;
+  }
+  p[0] = (unsigned char)(0xF0 | (u >> 18));
+  p[1] = (unsigned char)(0x80 | ((u >> 12) & 0x3F));
+  p[2] = (unsigned char)(0x80 | ((u >> 6) & 0x3F));
+  p[3] = (unsigned char)(0x80 | (u & 0x3F));
+  return 4;
+}
+
+/* Fill a buffer with random data of a given kind */
+static void FillBuffer(unsigned char *pBuf, size_t nBuf, int iKind) {
+  size_t n, l;
+  unsigned char ab[4];
+
+  switch (iKind) {
+  case 0:	/* Mostly ASCII text, with rare NULs and non-ASCII bytes */
+    for (n = 0; n < nBuf; n++) {
+      pBuf[n] = (unsigned char)(0x20 + Random() % 0x5F);
+      if (!(Random() % 500)) pBuf[n] = (unsigned char)(Random() % 0x100);
+    }
+    break;
+  case 1:	/* Valid UTF-8 text, with rare errors */
+    for (n = 0; n < nBuf; n += l) {
+      l = PutUTF8(ab);
+      if (l > (nBuf - n)) l = nBuf - n;	/* May truncate the last character */
+      memcpy(pBuf + n, ab, l);
+    }
+    if (nBuf && !(Random() % 4)) pBuf[Random() % nBuf] = abSpecial[Random() % sizeof(abSpecial)];
+    break;
+  case 2:	/* Bytes from the ranges that matter for UTF-8 validation */
+    for (n = 0; n < nBuf; n++) {
+      if (Random() % 4) {
+	pBuf[n] = (unsigned char)(0x80 + Random() % 0x40);	/* A tail byte */
+      } else {
+	pBuf[n] = abSpecial[Random() % sizeof(abSpecial)];
+      }
+    }
+    break;
+  case 3:	/* Mostly 16 or 32-bits text with small values, and a few special words */
+    for (n = 0; n < nBuf; n++) {
+      if (n & 1) {
+	pBuf[n] = (unsigned char)((Random() % 4) ? 0 : (Random() % 0x100));
+      } else {
+	pBuf[n] = (unsigned char)(0x20 + Random() % 0x5F);
+      }
+      if (!(Random() % 300)) pBuf[n] = (unsigned char)(0xD8 + Random() % 0x28);
+      if (!(Random() % 300)) pBuf[n] = 0;
+    }
+    break;
+  default:	/* Random bytes */
+    for (n = 0; n < nBuf; n++) pBuf[n] = (unsigned char)(Random() % 0x100);
+    break;
+  }
+}
+
+/* Reference UTF-8 validation, decoding each character to check its value */
+static size_t RefScanUTF8(const unsigned char *pBuf, size_t nBuf, size_t *pnMulti) {
+  size_t n = 0;
+
+  while (n < nBuf) {
+    unsigned long u = pBuf[n];
+    size_t l, i;
+    if (u < 0x80) {
+      if (!u) break;
+      n += 1;
+      continue;
+    }
+    if ((u & 0xE0) == 0xC0) { l = 2; u &= 0x1F; }
+    else if ((u & 0xF0) == 0xE0) { l = 3; u &= 0x0F; }
+    else if ((u & 0xF8) == 0xF0) { l = 4; u &= 0x07; }
+    else break;
+    if ((n + l) > nBuf) break;
+    for (i = 1; i < l; i++) {
+      if ((pBuf[n+i] & 0xC0) != 0x80) break;
+      u = (u << 6) | (pBuf[n+i] & 0x3F);
+    }
+    if (i < l) break;
+    if (   (u < ((l == 2) ? 0x80UL : (l == 3) ? 0x800UL : 0x10000UL))	/* Overlong */
+	|| ((u >= 0xD800) && (u < 0xE000))				/* Surrogate */
+	|| (u > 0x10FFFF)) break;
+    *pnMulti += 1;
+    n += l;
+  }
+  return n;
+}
+
+static void Report(const char *pszName, int iLevel, int iKind, size_t nBuf, size_t nOffset,
+		   size_t nExpected, size_t nResult, size_t nExpCount, size_t nCount) {
+  if ((nResult == nExpected) && (nCount == nExpCount)) return;
+  if (++nErrors <= 10) {
+    printf("%s %s failed for kind %d, length %lu, offset %lu: Returned %lu/%lu, expected %lu/%lu\n",
+	   apszLevel[iLevel], pszName, iKind, (unsigned long)nBuf, (unsigned long)nOffset,
+	   (unsigned long)nResult, (unsigned long)nCount, (unsigned long)nExpected, (unsigned long)nExpCount);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  static double adBuf[(MAXLEN + MAXALIGN) / sizeof(double) + 1]; /* Aligned for all types */
+  unsigned char *pBase = (unsigned char *)adBuf;
+  int iMaxLevel = EncScanSelect(-1);
+  int iLevel, iKind, iPass;
+  size_t nBuf, nOffset;
+  unsigned long nTests = 0;
+
+  if (argc > 1) ulSeed = strtoul(argv[1], NULL, 0);
+  printf("Testing the Scalar");
+  for (iLevel = 1; iLevel <= iMaxLevel; iLevel++) printf(", %s", apszLevel[iLevel]);
+  printf(" versions with seed %lu\n", ulSeed);
+
+  for (nBuf = 0; nBuf <= MAXLEN; nBuf++) {
+    for (iPass = 0; iPass < NPASSES; iPass++) {
+      unsigned char *pBuf;
+      char *pWords;	/* The same buffer, aligned for the 16 and 32-bits words */
+      size_t nExpected[4], nExpCount[4];
+
+      nOffset = (size_t)iPass % MAXALIGN;
+      pBuf = pBase + nOffset;
+      iKind = iPass % 5;
+      FillBuffer(pBuf, nBuf, iKind);
+      pWords = (char *)pBase + (nOffset & ~(size_t)3);
+
+      /* The reference results are those of the scalar version */
+      EncScanSelect(0);
+      nExpected[0] = EncScanASCII((char *)pBuf, nBuf);
+      nExpCount[1] = nExpCount[2] = nExpCount[3] = 0;
+      nExpected[1] = EncScanUTF16(pWords, nBuf / 2, nExpCount+1);
+      nExpected[2] = EncScanUTF32(pWords, nBuf / 4, nExpCount+2);
+      nExpected[3] = EncScanUTF8((char *)pBuf, nBuf, nExpCount+3);
+      { /* Check the scalar UTF-8 validation against the reference decoder */
+	size_t nRefCount = 0;
+	size_t nRef = RefScanUTF8(pBuf, nBuf, &nRefCount);
+	Report("EncScanUTF8 reference", 0, iKind, nBuf, nOffset, nRef, nExpected[3], nRefCount, nExpCount[3]);
+      }
+
+      for (iLevel = 1; iLevel <= iMaxLevel; iLevel++) {
+	size_t nResult, nCount;
+	EncScanSelect(iLevel);
+	nResult = EncScanASCII((char *)pBuf, nBuf);
+	Report("EncScanASCII", iLevel, iKind, nBuf, nOffset, nExpected[0], nResult, 0, 0);
+	nCount = 0;
+	nResult = EncScanUTF16(pWords, nBuf / 2, &nCount);
+	Report("EncScanUTF16", iLevel, iKind, nBuf, nOffset, nExpected[1], nResult, nExpCount[1], nCount);
+	nCount = 0;
+	nResult = EncScanUTF32(pWords, nBuf / 4, &nCount);
+	Report("EncScanUTF32", iLevel, iKind, nBuf, nOffset, nExpected[2], nResult, nExpCount[2], nCount);
+	nCount = 0;
+	nResult = EncScanUTF8((char *)pBuf, nBuf, &nCount);
+	Report("EncScanUTF8", iLevel, iKind, nBuf, nOffset, nExpected[3], nResult, nExpCount[3], nCount);
+      }
+      nTests += 1;
+    }
+  }
+
+  if (nErrors) {
+    printf("%d errors in %lu tests\n", nErrors, nTests);
+    return 1;
+  }
+  printf("All %lu tests passed\n", nTests);
+  return 0;
+}
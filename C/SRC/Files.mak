@@ -74,6 +74,7 @@ UNIX_PROGRAMS = \
   rd              \
   redo            \
   remplace        \
+  Tee             \
   trim            \
   update          \
   Which		  \
@@ -145,7 +146,7 @@ ZIPSOURCES =		 \
   smbios.mak             \
   smbios_defs.c          \
   smbios_lib.c           \
-  tee.c                  \
+  Tee.c                  \
   Tools.lst              \
   trim.c                 \
   truename.c             \
@@ -185,17 +186,17 @@ $(S)/conv.c: footnote.h $(SL)/mainutil.h
 
 $(S)/cpuid.c: footnote.h $(SL)/mainutil.h
 
-$(S)/deffeed.c: footnote.h $(SL)/mainutil.h
+$(S)/deffeed.c: footnote.h $(SL)/mainutil.h $(SL)/textfilt.h
 
-$(S)/detab.c: footnote.h $(SL)/mainutil.h
+$(S)/detab.c: footnote.h $(SL)/mainutil.h $(SL)/rewrite.h $(SL)/textfilt.h
 
 $(S)/dirc.c: footnote.h $(SL)/mainutil.h
 
-$(S)/dirsize.c: footnote.h $(SL)/mainutil.h
+$(S)/dirsize.c: footnote.h $(SL)/mainutil.h $(SL)/metaio.h
 
 $(S)/driver.c: footnote.h $(SL)/mainutil.h
 
-$(S)/dump.c: footnote.h $(SL)/mainutil.h
+$(S)/dump.c: footnote.h $(SL)/mainutil.h $(SL)/textfilt.h
 
 $(S)/encoding.c: footnote.h $(SL)/mainutil.h
 
@@ -217,9 +218,9 @@ $(S)/msgbox.c: footnote.h $(SL)/mainutil.h
 
 $(S)/rd.c: footnote.h $(SL)/mainutil.h
 
-$(S)/redo.c: footnote.h
+$(S)/redo.c: footnote.h $(SL)/mainutil.h $(SL)/textfilt.h $(SL)/zapfile.h
 
-$(S)/remplace.c: footnote.h $(SL)/mainutil.h
+$(S)/remplace.c: footnote.h $(SL)/mainutil.h $(SL)/rewrite.h $(SL)/textfilt.h
 
 $(S)/sector.cpp: footnote.h
 
@@ -227,9 +228,9 @@ $(S)/ShareInfo.c: footnote.h
 
 $(S)/smbios.c: footnote.h $(SL)/mainutil.h
 
-$(S)/tee.c: footnote.h $(SL)/mainutil.h
+$(S)/Tee.c: footnote.h $(SL)/mainutil.h
 
-$(S)/trim.c: footnote.h $(SL)/mainutil.h
+$(S)/trim.c: footnote.h $(SL)/mainutil.h $(SL)/rewrite.h $(SL)/textfilt.h
 
 $(S)/truename.c: footnote.h $(SL)/mainutil.h
 
@@ -243,5 +244,5 @@ $(S)/whichinc.c: footnote.h $(SL)/mainutil.h
 
 $(S)/with.c: footnote.h $(SL)/mainutil.h
 
-$(S)/zap.c: footnote.h $(SL)/mainutil.h
+$(S)/zap.c: footnote.h $(SL)/mainutil.h $(SL)/metaio.h
 
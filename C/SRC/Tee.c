@@ -0,0 +1,817 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename:	    Tee.c						      *
+*									      *
+*   Description:    Duplicate the input from stdout to stdout and other files.*
+*									      *
+*   Notes:	    This is a remake of the Unix tee for DOS and Windows.     *
+*		    							      *
+*		    In Unix, it's built as Tee, to avoid conflicts with the   *
+*		    standard tee, which appends to all files with option -a.  *
+*									      *
+*   History:								      *
+*    2012-10-24 JFL Created this program.				      *
+*    2014-12-04 JFL Added my name and email in the help.                      *
+*    2016-09-23 JFL Minor tweak to avoid a warning.	                      *
+*    2017-03-15 JFL Changed to a UTF-8 app, to support non-ASCII file names.  *
+*    2019-04-19 JFL Use the version strings from the new stversion.h. V.1.1.1.*
+*    2019-06-12 JFL Added PROGRAM_DESCRIPTION definition. Version 1.1.2.      *
+*    2021-01-06 JFL Fixed the exit code for the help screen. Version 1.1.3.   *
+*    2022-10-20 JFL Use IsSwitch() for the arguments parsing. Version 1.1.4.  *
+*    2026-10-18 JFL Added support for Unix.				      *
+*		    In Linux, copy the data with splice() and tee(), without  *
+*		    going through user space, when the input and at least one *
+*		    output allow it. Files in append mode still use write().  *
+*		    Increased the default buffer size to 64 KB. Version 1.2.  *
+*    2026-10-18 JFL In Unix, write every output in its own thread, from a     *
+*		    shared ring buffer. Added options -d, -r, and -s.	      *
+*		    Report write errors for each output. Version 1.3.	      *
+*    2026-10-18 JFL With -d, only drop data for outputs blocked in write()    *
+*		    for more than DROP_DELAY. Ignore SIGPIPE, so that a	      *
+*		    closed pipe only stops that output. Version 1.3.1.	      *
+*                                                                             *
+*         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define PROGRAM_DESCRIPTION "Duplicate the input to several outputs"
+#define PROGRAM_NAME    "tee"
+#define PROGRAM_VERSION "1.3.1"
+#define PROGRAM_DATE    "2026-10-18"
+
+#include "predefine.h" /* Define optional features we need in the C libraries */
+
+#define _UTF8_SOURCE	/* Enable MsvcLibX support for file names with Unicode characters */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+/* SysToolsLib include files */
+#include "mainutil.h"	/* SysLib helper routines for main() */
+#include "stversion.h"	/* SysToolsLib version strings. Include last. */
+
+/************************ Win32-specific definitions *************************/
+
+#ifdef _WIN32	/* Automatically defined when targeting a Win32 application */
+
+#include <io.h>
+
+/* Avoid warnings for names that MSVC thinks deprecated */
+#define read _read
+
+#endif
+
+/************************ MS-DOS-specific definitions ************************/
+
+#ifdef _MSDOS		/* Automatically defined when targeting an MS-DOS app. */
+
+#include <io.h>
+
+#endif
+
+/************************* Unix-specific definitions *************************/
+
+#if defined(__unix__) || defined(__MACH__) /* Automatically defined when targeting Unix or Mach apps. */
+
+#define _UNIX
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <signal.h>
+
+#define HAS_THREADS 1	/* Write every output in its own thread */
+#include <pthread.h>
+
+#ifdef __linux__
+#define HAS_SPLICE 1	/* Linux can copy pipe data without going through user space */
+#endif
+
+#endif /* defined(__unix__) */
+
+/********************** End of OS-specific definitions ***********************/
+
+/* Local definitions */
+
+#ifdef _MSDOS
+#define BUFSIZE 1024
+#else
+#define BUFSIZE 0x10000
+#endif
+
+#define RINGSIZE 0x400000	/* Default ring buffer size for the writer threads */
+#define DROP_DELAY 1.0		/* Seconds an output must be blocked in write() before dropping its data */
+
+#ifndef HAS_THREADS
+#define HAS_THREADS 0
+#endif
+#ifndef HAS_SPLICE
+#define HAS_SPLICE 0
+#endif
+
+typedef struct _outStream {
+  char *name;
+  FILE *f;
+  struct _outStream *next;
+  int iErr;			/* TRUE after a write error on this stream */
+#if HAS_SPLICE
+  int iSplice;			/* TRUE if splice() can write to this stream */
+  int hPipe[2];			/* The pipe with a copy of the data for this stream */
+#endif
+#if HAS_THREADS
+  struct _teeRing *pRing;	/* The ring buffer this stream's thread reads */
+  pthread_t tid;		/* The thread writing this stream */
+  unsigned long long llPos;	/* Number of ring buffer bytes consumed */
+  int iBusy;			/* TRUE while the thread is in write() */
+  double dBusy;			/* The time when that write() started */
+  unsigned long long llBytes;	/* Number of bytes written */
+  unsigned long long llDropped;	/* Number of bytes dropped, as the stream was too slow */
+  double dEnd;			/* The time when the stream was done. 0=Not yet */
+#endif
+} outStream;
+
+#if HAS_THREADS
+typedef struct _teeRing {
+  pthread_mutex_t mutex;	/* Protects all fields, and the streams llPos, iBusy, iErr */
+  pthread_cond_t condData;	/* Signaled when data is added, or at the end of input */
+  pthread_cond_t condSpace;	/* Signaled when a stream frees space in the ring */
+  char *pBuf;			/* The ring buffer */
+  size_t szRing;		/* Its size */
+  size_t szBuf;			/* The max size of every read, and of dropping copies */
+  unsigned long long llIn;	/* Number of bytes read into the ring buffer */
+  int iEOF;			/* TRUE when the input is all read */
+  int iDrop;			/* TRUE=Drop data for slow streams; FALSE=Wait for them */
+} TEERING;
+#endif
+
+/* Forward references */
+
+void usage(void);			/* Display a brief help screen */
+outStream *NewOutStream(char *pszName, char *pszMode, outStream *last);
+size_t GetDefaultBufSize();
+#if HAS_SPLICE
+int TeeSplice(outStream *pFirst, char *pBuf, size_t szBuf);
+#endif
+#if HAS_THREADS
+int TeeThreads(outStream *pFirst, size_t szBuf, size_t szRing, int iDrop);
+double TeeClock(void);
+void TeeTimedWait(pthread_cond_t *pCond, pthread_mutex_t *pMutex, double dDelay);
+void TeeStats(outStream *pFirst, double dStart, int iStats);
+#endif
+
+/******************************************************************************
+*                                                                             *
+*   Function	    main						      *
+*                                                                             *
+*   Description     Main procedure					      *
+*                                                                             *
+*   Arguments                                                                 *
+*                                                                             *
+*	  int argc	Number of command line arguments, including program.  *
+*	  char *argv[]	Array of pointers to the arguments. argv[0]=program.  *
+*                                                                             *
+*   Return value    0=Success; !0=Failure                                     *
+*                                                                             *
+*   Notes                                                                     *
+*                                                                             *
+*   History                                                                   *
+*    2012-10-24 JFL Created this program.				      *
+*                                                                             *
+******************************************************************************/
+
+int main(int argc, char *argv[]) {
+  int i;
+  char *pszMode = "wb";
+  outStream *pFirst;
+  outStream *pLast;
+  outStream *pStream;
+  size_t szBuf = BUFSIZE;
+  char *pBuf;
+  char *pBufSize;
+  ssize_t nRead;
+  int iRet = 0;
+#if HAS_THREADS
+  size_t szRing = 0;		/* Ring buffer size. 0=Default */
+  int iDrop = FALSE;		/* TRUE=Drop data for slow outputs */
+  int iStats = FALSE;		/* TRUE=Report every output's throughput */
+  double dStart;
+#endif
+
+  pFirst = pLast = NewOutStream(NULL, NULL, NULL); /* Always output to stdout */
+
+  pBufSize = getenv("TEE_BUFSIZE");
+  if (pBufSize) szBuf = atoi(pBufSize);
+
+  /* Parse the command line */
+  for (i=1; i<argc; i++) {
+    if (IsSwitch(argv[i])) { /* It's a switch */
+      char *option = argv[i]+1;
+      if (streq(option, "?") || streq(option, "h") || streq(option, "-help")) {
+	usage();
+	exit(0);
+      }
+      if (streq(option, "")) {
+	pLast = NewOutStream(NULL, NULL, pLast);
+	continue;
+      }
+      if (streq(option, "a")) {
+	pszMode = "ab";
+	continue;
+      }
+      if (streq(option, "A")) {
+	pszMode = "wb";
+	continue;
+      }
+      if (streq(option, "b")) {
+	if ((i+1)<argc) szBuf = atoi(argv[++i]);
+	continue;
+      }
+#if HAS_THREADS
+      if (streq(option, "d")) {
+	iDrop = TRUE;
+	continue;
+      }
+      if (streq(option, "r")) {
+	if ((i+1)<argc) szRing = atoi(argv[++i]);
+	continue;
+      }
+      if (streq(option, "s") || streq(option, "-stats")) {
+	iStats = TRUE;
+	continue;
+      }
+#endif
+      if (streq(option, "V") || streq(option, "-version")) { /* -V: Display the version */
+	puts(DETAILED_VERSION);
+	exit(0);
+      }
+      fprintf(stderr, "Unrecognized switch %s. Ignored.\n", argv[i]);
+      continue;
+      }
+    /* This is a file name. Add it to the output streams list */
+    pLast = NewOutStream(argv[i], pszMode, pLast);
+    pszMode = "wb";	/* Reset to the default write mode */
+    continue;
+  }
+
+  pBuf = malloc(szBuf);
+  if (!pBuf) {
+    fprintf(stderr, "Not enough memory\n");
+    exit(1);
+  }
+
+#ifndef _UNIX
+  /* Make sure no translation is done on stdin or stdout */
+  _setmode(_fileno(stdin),  _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  /* Make sure no buffering is used on any output file */
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    int iErr = setvbuf(pStream->f, NULL, _IONBF, 0);
+    if (iErr) {
+      fprintf(stderr, "Cannot unbuffer %s\n", pStream->name);
+    }
+  }
+
+#ifdef _UNIX
+  /* Get EPIPE errors instead, to stop writing to closed pipes, and continue with the others */
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+#if HAS_THREADS
+  dStart = TeeClock();
+#if HAS_SPLICE
+  /* Copy the data from pipe to pipe or file, without reading it.
+     Options -d and -r require the ring buffer, to let outputs progress separately */
+  iRet = -1;
+  if (!szRing && !iDrop) iRet = TeeSplice(pFirst, pBuf, szBuf);
+  if (iRet < 0)
+#endif
+  iRet = TeeThreads(pFirst, szBuf, szRing ? szRing : RINGSIZE, iDrop);
+  TeeStats(pFirst, dStart, iStats);
+  return iRet;
+#endif
+
+  /* Copy all incoming data */
+  while ((nRead = read(0, pBuf, (int)szBuf)) > 0) { /* Use read to avoid buffering the input */ /* Cast (int) as MS version takes an in */
+    /*
+    printf("Read %d bytes: ", nRead);
+    fwrite(pBuf, 1, nRead, stdout);
+    printf("\n");
+    */
+    for (pStream = pFirst; pStream; pStream = pStream->next) {
+      /* printf("Writing to %s\n", pStream->name); */
+      if (pStream->iErr) continue;
+      if (fwrite(pBuf, 1, nRead, pStream->f) != (size_t)nRead) {
+	fprintf(stderr, "Error writing to %s: %s\n", pStream->name, strerror(errno));
+	pStream->iErr = TRUE;
+	iRet = 1;
+      }
+    }
+  }
+
+  return iRet;
+}
+
+void usage(void) {
+  printf(
+PROGRAM_NAME_AND_VERSION " - " PROGRAM_DESCRIPTION "\n\
+\n\
+Usage: tee [OPTIONS] [[-a] FILENAME] ...\n\
+\n\
+Options:\n\
+  -?	    Display this help screen.\n\
+  -a	    Append to the next file. Default: Overwrite it.\n\
+  -b	    Set the buffer size. Default: %lu\n\
+  -V        Display the program version\n\
+\n\
+Note: The buffer size can also be set by environment variable TEE_BUFSIZE.\n\
+"
+#if HAS_THREADS
+"\
+\n\
+Every output is written by a separate thread, reading a shared ring buffer.\n\
+  -d	    Drop data for outputs that fall behind, while blocked for over 1 s.\n\
+	    Default: Wait for them.\n\
+  -r SIZE   Set the ring buffer size. Default: %lu\n\
+  -s	    Report the throughput of every output at exit.\n\
+"
+#endif
+#if HAS_SPLICE
+"\
+\n\
+In Linux, the data is copied without reading it when possible, using pipes of\n\
+the buffer size. Options -d and -r disable this.\n\
+"
+#endif
+#include "footnote.h"
+, (unsigned long)GetDefaultBufSize()
+#if HAS_THREADS
+, (unsigned long)RINGSIZE
+#endif
+);
+  return;
+}
+
+outStream *NewOutStream(char *pszName, char *pszMode, outStream *last) {
+  outStream *pStream = (outStream *)malloc(sizeof(outStream));
+  if (!pStream) {
+    fprintf(stderr, "Not enough memory\n");
+    exit(1);
+  }
+  memset(pStream, 0, sizeof(outStream));
+  pStream->name = pszName;
+  if (pszName) {
+    pStream->f = fopen(pszName, pszMode);
+    if (pStream->f) {
+      if (last) last->next = pStream;
+    } else {
+      fprintf(stderr, "Error. Cannot open file %s\n", pszName);
+      free(pStream);
+      pStream = last;
+    }
+  } else {
+    pStream->name = "stdout";
+    pStream->f = stdout;
+    if (last) last->next = pStream;
+  }
+  /* printf("Allocated %p for file %s\n", pStream, pStream->name); */
+  return pStream;
+}
+
+size_t GetDefaultBufSize() {
+  size_t szBuf = BUFSIZE;
+  char *pBufSize;
+
+  pBufSize = getenv("TEE_BUFSIZE");
+  if (pBufSize) szBuf = atoi(pBufSize);
+  return szBuf;
+}
+
+#if HAS_THREADS
+
+/* Write all data, looping on short writes. Returns 0=Success, -1=Error */
+int WriteAll(int h, char *pBuf, size_t n) {
+  while (n) {
+    ssize_t nDone = write(h, pBuf, n);
+    if ((nDone < 0) && (errno == EINTR)) continue;
+    if (nDone <= 0) return -1;
+    pBuf += nDone;
+    n -= nDone;
+  }
+  return 0;
+}
+
+#endif /* HAS_THREADS */
+
+/******************************************************************************
+*                                                                             *
+*   Function	    TeeSplice						      *
+*                                                                             *
+*   Description     Copy the input to all outputs, with splice() and tee()    *
+*                                                                             *
+*   Arguments                                                                 *
+*                                                                             *
+*	  outStream *pFirst	The list of output streams		      *
+*	  char *pBuf		A buffer for outputs that can't use splice()  *
+*	  size_t szBuf		Its size, and the size of the pipes to use    *
+*                                                                             *
+*   Return value    0=Success; 1=Write errors; -1=Not possible, nothing done  *
+*                                                                             *
+*   Notes                                                                     *
+*		    splice() moves data between a pipe and a file descriptor, *
+*		    and tee() duplicates data from a pipe to another pipe,    *
+*		    both without copying it through user space.		      *
+*		    The input data is moved to a private pipe, so that we     *
+*		    know exactly how much data it contains. It is duplicated  *
+*		    into one private pipe per output with tee(), except for   *
+*		    the first output that supports splice(), which gets the   *
+*		    original pipe data. Then each pipe is drained into its    *
+*		    output.						      *
+*		    tee() always copies from the beginning of the pipe, so it *
+*		    must copy all the data at once: All pipes have the same   *
+*		    size, and the private ones are empty before tee() runs.   *
+*		    splice() refuses files in append mode, and some devices.  *
+*		    These are written with write(), which keeps the append    *
+*		    semantics of every write.				      *
+*                                                                             *
+*   History                                                                   *
+*    2026-10-18 JFL Created this routine.				      *
+*                                                                             *
+******************************************************************************/
+
+#if HAS_SPLICE
+
+int CanSplice(int h) {
+  struct stat st;
+
+  if (fstat(h, &st)) return FALSE;
+  return (S_ISFIFO(st.st_mode) || S_ISREG(st.st_mode) || S_ISSOCK(st.st_mode));
+}
+
+/* Move n bytes from pipe hIn to the output stream. Discard them after errors */
+int TeeDrain(int hIn, outStream *pStream, size_t n, char *pBuf, size_t szBuf) {
+  while (n) {
+    ssize_t nDone;
+    int iErr = 0;
+    if (pStream->iSplice && !pStream->iErr) {
+      nDone = splice(hIn, NULL, fileno(pStream->f), NULL, n, SPLICE_F_MOVE);
+      if ((nDone < 0) && (errno == EINTR)) continue;
+      if ((nDone < 0) && (errno == EINVAL)) { /* This output does not support splice() */
+	pStream->iSplice = FALSE;
+	continue;
+      }
+      if (nDone <= 0) iErr = -1;
+    } else {
+      nDone = read(hIn, pBuf, (n < szBuf) ? n : szBuf);
+      if ((nDone < 0) && (errno == EINTR)) continue;
+      if (nDone <= 0) return -1; /* Our pipe cannot be read. Should never happen */
+      if (!pStream->iErr) iErr = WriteAll(fileno(pStream->f), pBuf, nDone);
+    }
+    if (iErr) { /* Report it, then discard the rest of the data for this stream */
+      fprintf(stderr, "Error writing to %s: %s\n", pStream->name, strerror(errno));
+      pStream->iErr = TRUE;
+      if (nDone <= 0) continue;	/* splice() failed, so the data is still in the pipe */
+    } else if (!pStream->iErr) {
+      pStream->llBytes += nDone;
+    }
+    n -= nDone;
+  }
+  return 0;
+}
+
+int TeeSplice(outStream *pFirst, char *pBuf, size_t szBuf) {
+  outStream *pStream;
+  outStream *pMain = NULL;	/* The output that gets the input pipe data */
+  int hPipe[2];			/* The input data pipe */
+  int iSize = (szBuf > 0x40000000) ? 0x40000000 : (int)szBuf;
+  int iRet = -1;
+  int iFirst = TRUE;
+
+  if (!CanSplice(0)) return -1;
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    int iFlags = fcntl(fileno(pStream->f), F_GETFL);
+    pStream->iSplice = (   CanSplice(fileno(pStream->f))
+			&& (iFlags != -1) && !(iFlags & O_APPEND));
+    pStream->iErr = FALSE;
+    pStream->hPipe[0] = pStream->hPipe[1] = -1;
+    if (pStream->iSplice && !pMain) pMain = pStream;
+  }
+  if (!pMain) return -1;	/* No gain, as all outputs would have to be read */
+
+  /* Create the pipes, with the largest size that they all accept */
+  if (pipe(hPipe)) return -1;
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    if ((pStream != pMain) && pipe(pStream->hPipe)) goto cleanup;
+  }
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    int *ph = (pStream == pMain) ? hPipe : pStream->hPipe;
+    int iNewSize;
+    fcntl(ph[0], F_SETPIPE_SZ, iSize);
+    iNewSize = fcntl(ph[0], F_GETPIPE_SZ);
+    if (iNewSize <= 0) goto cleanup;
+    if (iNewSize < iSize) iSize = iNewSize;
+  }
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    int *ph = (pStream == pMain) ? hPipe : pStream->hPipe;
+    if (fcntl(ph[0], F_SETPIPE_SZ, iSize) != iSize) goto cleanup;
+  }
+
+  /* Copy all incoming data */
+  for (;;) {
+    ssize_t nRead = splice(0, NULL, hPipe[1], NULL, iSize, SPLICE_F_MOVE);
+    if ((nRead < 0) && (errno == EINTR)) continue;
+    if ((nRead < 0) && iFirst) goto cleanup;	/* Let the read() loop try */
+    iRet = 0;
+    if (nRead < 0) {
+      fprintf(stderr, "Error reading the input: %s\n", strerror(errno));
+      iRet = 1;
+    }
+    if (nRead <= 0) break;
+    iFirst = FALSE;
+    for (pStream = pFirst; pStream; pStream = pStream->next) {
+      if ((pStream != pMain) && !pStream->iErr) {
+	if (tee(hPipe[0], pStream->hPipe[1], nRead, 0) != nRead) {
+	  fprintf(stderr, "Error duplicating data for %s: %s\n", pStream->name, strerror(errno));
+	  pStream->iErr = TRUE; /* Its pipe may now be partially filled, so stop using it */
+	}
+      }
+    }
+    for (pStream = pFirst; pStream; pStream = pStream->next) {
+      if ((pStream == pMain) || !pStream->iErr) {
+	int *ph = (pStream == pMain) ? hPipe : pStream->hPipe;
+	if (TeeDrain(ph[0], pStream, nRead, pBuf, szBuf)) {
+	  fprintf(stderr, "Error reading a pipe: %s\n", strerror(errno));
+	  iRet = 1;
+	  goto cleanup;
+	}
+      }
+    }
+  }
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    if (pStream->iErr) iRet = 1;
+  }
+
+cleanup:
+  close(hPipe[0]);
+  close(hPipe[1]);
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    if (pStream->hPipe[0] != -1) close(pStream->hPipe[0]);
+    if (pStream->hPipe[1] != -1) close(pStream->hPipe[1]);
+  }
+  return iRet;
+}
+
+#endif /* HAS_SPLICE */
+
+/******************************************************************************
+*                                                                             *
+*   Function	    TeeThreads						      *
+*                                                                             *
+*   Description     Copy the input to all outputs, each in its own thread     *
+*                                                                             *
+*   Arguments                                                                 *
+*                                                                             *
+*	  outStream *pFirst	The list of output streams		      *
+*	  size_t szBuf		The max size of every input read	      *
+*	  size_t szRing		The ring buffer size			      *
+*	  int iDrop		TRUE=Drop data for slow outputs		      *
+*                                                                             *
+*   Return value    0=Success; 1=Errors                                       *
+*                                                                             *
+*   Notes                                                                     *
+*		    The main thread reads the input into the ring buffer, and *
+*		    every output thread writes the data it has not written    *
+*		    yet. So a slow output only delays the others when the     *
+*		    ring is full.					      *
+*		    By default, the reader then waits for the slowest output. *
+*		    With iDrop, it drops the oldest data for the outputs that *
+*		    are a full ring behind while blocked in write() for more  *
+*		    than DROP_DELAY, and counts it. These outputs copy their  *
+*		    data before writing it, so that the reader does not wait  *
+*		    for a stuck write. It waits for outputs that are about to *
+*		    copy their data, or that are in a write() that has not    *
+*		    lasted DROP_DELAY yet. Ordinary writes to files or to     *
+*		    pipes read in time thus never lose any data.	      *
+*		    An output that fails is reported, and is not written to   *
+*		    anymore, nor waited for.				      *
+*                                                                             *
+*   History                                                                   *
+*    2026-10-18 JFL Created this routine.				      *
+*                                                                             *
+******************************************************************************/
+
+#if HAS_THREADS
+
+void *TeeWriter(void *pArg) {
+  outStream *pStream = pArg;
+  TEERING *pRing = pStream->pRing;
+  char *pCopy = NULL;
+
+  if (pRing->iDrop) pCopy = malloc(pRing->szBuf);
+  pthread_mutex_lock(&pRing->mutex);
+  if (pRing->iDrop && !pCopy) {
+    fprintf(stderr, "Not enough memory for %s\n", pStream->name);
+    pStream->iErr = TRUE;
+  }
+  while (!pStream->iErr) {
+    size_t iOffset;
+    size_t n;
+    char *pData;
+    int iErr;
+
+    while ((pStream->llPos == pRing->llIn) && !pRing->iEOF) {
+      pthread_cond_wait(&pRing->condData, &pRing->mutex);
+    }
+    if (pStream->llPos == pRing->llIn) break;	/* All data written */
+    iOffset = (size_t)(pStream->llPos % pRing->szRing);
+    n = (size_t)(pRing->llIn - pStream->llPos);
+    if (n > (pRing->szRing - iOffset)) n = pRing->szRing - iOffset;
+    if (pRing->iDrop) { /* Copy the data, as the reader may overwrite it anytime */
+      if (n > pRing->szBuf) n = pRing->szBuf;
+      memcpy(pCopy, pRing->pBuf + iOffset, n);
+      pData = pCopy;
+      pStream->llPos += n;
+      pthread_cond_signal(&pRing->condSpace);
+    } else {		/* The reader won't overwrite it until llPos moves */
+      pData = pRing->pBuf + iOffset;
+    }
+    pStream->iBusy = TRUE;
+    pStream->dBusy = TeeClock();
+    pthread_mutex_unlock(&pRing->mutex);
+    iErr = WriteAll(fileno(pStream->f), pData, n);
+    if (iErr) fprintf(stderr, "Error writing to %s: %s\n", pStream->name, strerror(errno));
+    pthread_mutex_lock(&pRing->mutex);
+    pStream->iBusy = FALSE;
+    if (iErr) {
+      pStream->iErr = TRUE;
+    } else {
+      pStream->llBytes += n;
+      if (!pRing->iDrop) pStream->llPos += n;
+    }
+    pthread_cond_signal(&pRing->condSpace);
+  }
+  pthread_cond_signal(&pRing->condSpace);
+  pthread_mutex_unlock(&pRing->mutex);
+  pStream->dEnd = TeeClock();
+  free(pCopy);
+  return NULL;
+}
+
+int TeeThreads(outStream *pFirst, size_t szBuf, size_t szRing, int iDrop) {
+  TEERING ring;
+  outStream *pStream;
+  int iRet = 0;
+
+  ring.pBuf = malloc(szRing);
+  if (!ring.pBuf) {
+    fprintf(stderr, "Not enough memory\n");
+    exit(1);
+  }
+  pthread_mutex_init(&ring.mutex, NULL);
+  pthread_cond_init(&ring.condData, NULL);
+  pthread_cond_init(&ring.condSpace, NULL);
+  ring.szRing = szRing;
+  ring.szBuf = (szBuf < szRing) ? szBuf : szRing;
+  ring.llIn = 0;
+  ring.iEOF = FALSE;
+  ring.iDrop = iDrop;
+
+  /* Start the writer threads */
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    pStream->pRing = &ring;
+    if (pthread_create(&pStream->tid, NULL, TeeWriter, pStream)) {
+      fprintf(stderr, "Cannot create a thread for %s: %s\n", pStream->name, strerror(errno));
+      exit(1);
+    }
+  }
+
+  /* Read all incoming data into the ring buffer */
+  pthread_mutex_lock(&ring.mutex);
+  for (;;) {
+    size_t iOffset = (size_t)(ring.llIn % szRing);
+    size_t n = szRing - iOffset;	/* The space until the end of the ring */
+    ssize_t nRead;
+
+    if (n > ring.szBuf) n = ring.szBuf;
+    if (iDrop) while ((ring.llIn + n) > szRing) { /* Skip the data we'll overwrite for slow streams */
+      unsigned long long llMin = ring.llIn + n - szRing;
+      int iWait = FALSE;
+      double dNow = TeeClock();
+      double dDelay = 0;		/* Time until the first busy stream can be dropped. 0=None */
+      for (pStream = pFirst; pStream; pStream = pStream->next) {
+	if (pStream->llPos >= llMin) continue;
+	if (!pStream->iErr) {
+	  if (!pStream->iBusy) {	/* It's not blocked, just about to copy its data */
+	    iWait = TRUE;
+	    continue;
+	  }
+	  if ((dNow - pStream->dBusy) < DROP_DELAY) { /* It's not stuck, just writing */
+	    double dLeft = pStream->dBusy + DROP_DELAY - dNow;
+	    if (!dDelay || (dLeft < dDelay)) dDelay = dLeft;
+	    iWait = TRUE;
+	    continue;
+	  }
+	  pStream->llDropped += llMin - pStream->llPos;
+	}
+	pStream->llPos = llMin;
+      }
+      if (!iWait) break;
+      if (dDelay) {
+	TeeTimedWait(&ring.condSpace, &ring.mutex, dDelay);
+      } else {
+	pthread_cond_wait(&ring.condSpace, &ring.mutex);
+      }
+    } else for (;;) {			/* Wait until the slowest stream frees space */
+      unsigned long long llMin = ring.llIn;
+      int nActive = 0;
+      for (pStream = pFirst; pStream; pStream = pStream->next) {
+	if (pStream->iErr) continue;
+	if (pStream->llPos < llMin) llMin = pStream->llPos;
+	nActive += 1;
+      }
+      if (!nActive) break;		/* All outputs failed */
+      if ((ring.llIn - llMin) < szRing) {
+	if (n > (szRing - (ring.llIn - llMin))) n = (size_t)(szRing - (ring.llIn - llMin));
+	break;
+      }
+      pthread_cond_wait(&ring.condSpace, &ring.mutex);
+    }
+    pthread_mutex_unlock(&ring.mutex);
+    do {
+      nRead = read(0, ring.pBuf + iOffset, n);
+    } while ((nRead < 0) && (errno == EINTR));
+    if (nRead < 0) fprintf(stderr, "Error reading the input: %s\n", strerror(errno));
+    pthread_mutex_lock(&ring.mutex);
+    if (nRead <= 0) {
+      if (nRead < 0) iRet = 1;
+      break;
+    }
+    ring.llIn += nRead;
+    pthread_cond_broadcast(&ring.condData);
+  }
+  ring.iEOF = TRUE;
+  pthread_cond_broadcast(&ring.condData);
+  pthread_mutex_unlock(&ring.mutex);
+
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    pthread_join(pStream->tid, NULL);
+    if (pStream->iErr) iRet = 1;
+  }
+  pthread_cond_destroy(&ring.condSpace);
+  pthread_cond_destroy(&ring.condData);
+  pthread_mutex_destroy(&ring.mutex);
+  free(ring.pBuf);
+  return iRet;
+}
+
+/* Get the current time, in seconds */
+double TeeClock(void) {
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec / 1E9);
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Wait for a condition for at most dDelay seconds */
+void TeeTimedWait(pthread_cond_t *pCond, pthread_mutex_t *pMutex, double dDelay) {
+  struct timespec ts;	/* pthread_cond_timedwait() uses the real time clock by default */
+  long lNs;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += (time_t)dDelay;
+  lNs = ts.tv_nsec + (long)((dDelay - (double)(time_t)dDelay) * 1E9) + 1;
+  ts.tv_sec += lNs / 1000000000L;
+  ts.tv_nsec = lNs % 1000000000L;
+  pthread_cond_timedwait(pCond, pMutex, &ts);
+}
+
+/* Report the data dropped, and optionally the throughput, of every output */
+void TeeStats(outStream *pFirst, double dStart, int iStats) {
+  outStream *pStream;
+  double dNow = TeeClock();
+
+  for (pStream = pFirst; pStream; pStream = pStream->next) {
+    double dTime = (pStream->dEnd ? pStream->dEnd : dNow) - dStart;
+    if (iStats) {
+      fprintf(stderr, "%s: %llu bytes written in %.3f s, %.3f MB/s",
+	      pStream->name, pStream->llBytes, dTime,
+	      (dTime > 0) ? ((double)pStream->llBytes / dTime / (1024.0*1024.0)) : 0.0);
+      if (pStream->llDropped) fprintf(stderr, ", %llu bytes dropped", pStream->llDropped);
+      if (pStream->iErr) fprintf(stderr, ", failed");
+      fprintf(stderr, "\n");
+    } else if (pStream->llDropped) {
+      fprintf(stderr, "Warning: %llu bytes dropped for %s\n", pStream->llDropped, pStream->name);
+    }
+  }
+}
+
+#endif /* HAS_THREADS */
@@ -60,6 +60,10 @@
 *    2020-11-05 JFL Moved copydate() to SysLib, adding ns resolution.         *
 *                   Version 2.3.					      *
 *    2022-10-19 JFL Moved IsSwitch() to SysLib. Version 2.3.1.		      *
+*    2026-10-18 JFL Added option --durability to sync the backup copy.        *
+*                   Version 2.4.					      *
+*    2026-10-18 JFL Set the backup time before syncing it, sync its name      *
+*		    too, and report the time spent syncing. Version 2.4.1.    *
 *                                                                             *
 *         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -67,8 +71,8 @@
 
 #define PROGRAM_DESCRIPTION "Create a numbered backup copy of a file"
 #define PROGRAM_NAME    "backnum"
-#define PROGRAM_VERSION "2.3.1"
-#define PROGRAM_DATE    "2022-10-19"
+#define PROGRAM_VERSION "2.4.1"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include "predefine.h" /* Define optional features we need in the C libraries */
 
@@ -238,6 +242,22 @@ int main(int argc, char *argv[]) {
 	continue;
       }
 #endif
+      if (   streq(argv[i]+1, "-durability")	/* --durability: Sync policy */
+	  || !strncmp(argv[i]+1, "-durability=", 12)) {
+	char *pszPolicy = strchr(argv[i], '=');
+	if (pszPolicy) {
+	  pszPolicy += 1;
+	} else if ((i+1) < argc) {
+	  pszPolicy = argv[++i];
+	} else {
+	  pszPolicy = "";
+	}
+	if (SetSyncPolicy(pszPolicy)) {
+	  fprintf(stderr, "Error: Invalid durability policy: %s\n", pszPolicy);
+	  exit(1);
+	}
+	continue;
+      }
       if (streq(argv[i]+1, "q")) {		/* -q: Be quiet */
 	iQuiet = TRUE;
 	continue;
@@ -373,6 +393,13 @@ int main(int argc, char *argv[]) {
   /* Backup the file */
   err = 0;
   if (iExec) err = fcopy(szPath, pszMyFile);
+  if ((!err) && syncall()) err = 3;
+  if (iExec && (GetSyncPolicy() != SYNC_NONE) && !iQuiet) {
+    long nSynced;
+    double dSeconds;
+    GetSyncStats(&nSynced, &dSeconds);
+    printf("Durability %s: %ld files synced in %.3f s\n", GetSyncPolicyName(), nSynced, dSeconds);
+  }
   switch (err) {
     case 0: break; /* Success */
     case 1: fprintf(stderr, "Not enough memory.\n"); break;
@@ -450,6 +477,8 @@ Switches:\n\
   -d      Output debug information.\n"
 #endif
 "\
+  --durability none|file|batch|end  Sync the backup copy to the disk. All\n\
+          policies except none (Default) are equivalent for a single file.\n\
   -q      Be quiet\n\
   -v      Display verbose information\n\
   -X      Display the backup file name, but don't create it.\n\
@@ -479,6 +508,7 @@ Switches:\n\
 |    1992/05/20 JFL Adapted to Microsoft C.                                   |
 |    1993/10/19 JFL Cleanup for reuse in other programs                       |
 |    2011/05/12 JFL Use an OS-independant method to copy the file time.       |
+|    2026-10-18 JFL In Unix, copy it before syncing the file, to sync it too. |
 *									      *
 \*---------------------------------------------------------------------------*/
 
@@ -528,13 +558,26 @@ int fcopy(char *name2, char *name1) {
 
   /* Flush buffers into the destination file, */
   fflush(pfd);
-  /* and give the same date than the source file */
+#if !(defined(_MSDOS) || defined(_WIN32))
+  /* give the same date than the source file, before syncing it too, */
+  err = copydate(name2, name1);
+#endif
+  /* make it durable if requested, */
+  if (syncfile(fileno(pfd)) || syncname(name2)) {
+    fclose(pfs);
+    fclose(pfd);
+    DEBUG_LEAVE(("return 3; // Cannot sync the destination file\n"));
+    return 3;
+  }
 
   fclose(pfs);
   fclose(pfd);
 
-  /* 2011-05-12 Use an OS-independant method, _after_ closing the files */
+#if defined(_MSDOS) || defined(_WIN32)
+  /* 2011-05-12 Use an OS-independant method, _after_ closing the files,
+     as closing them changes the time in Windows */
   err = copydate(name2, name1);
+#endif
 
   DEBUG_LEAVE(("return %d; // Copy successful\n", err));
   return err;
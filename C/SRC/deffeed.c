@@ -48,6 +48,17 @@
 *    2022-12-12 JFL Use getline() instead of fgets(). Version 3.0.3.	      *
 *		    This makes the input capable of reading any line size.    *
 *		    TODO: Remove the line size limitation on the output too.  *
+*    2026-10-18 JFL Moved the pagination loop to SysLib's DeffeedStream().    *
+*		    Added options -r, -x, -j, -X, -v to paginate whole	      *
+*		    directory trees in parallel threads.		      *
+*		    Bug fixes: Lines were corrupted by writes beyond the end  *
+*		    of the getline() buffer. Long lines overflowed into the   *
+*		    next columns. Crash with -fp.			      *
+*		    Version 3.1.					      *
+*    2026-10-18 JFL Much faster, using the new block-based DeffeedStream().   *
+*		    Lines of any length are output in full.		      *
+*		    Bug fix: Crash when -fp, -ncol, etc, ended the line.      *
+*		    Version 3.2.					      *
 *		    							      *
 *         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -55,8 +66,8 @@
 
 #define PROGRAM_DESCRIPTION "Remove Form Feeds from a text"
 #define PROGRAM_NAME    "deffeed"
-#define PROGRAM_VERSION "3.0.3"
-#define PROGRAM_DATE    "2022-12-12"
+#define PROGRAM_VERSION "3.2"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include "predefine.h" /* Define optional features we need in the C libraries */
 
@@ -67,7 +78,6 @@
 #include <stdlib.h>
 #include <errno.h>
 
-#define BUFSIZE 256
 #define DEFLPP 60       /* Default number of lines per page */
 
 /************************ Win32-specific definitions *************************/
@@ -130,20 +140,14 @@ char *strlwr(char *psz)    /* Convenient Microsoft library routine not available
 
 #include "debugm.h"	/* SysToolsLib debug macros. Include first. */
 #include "mainutil.h"	/* SysLib helper routines for main() */
+#include "textfilt.h"	/* SysLib text filters */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
-/* Global variables */
-
-int ncols = 1;          /* Number of columns */
-int wcols = 80;         /* Columns width */
-int dcols = 0;          /* Distance between columns */
-char *buffer = NULL;
+DEBUG_GLOBALS			/* Define global variables used by our debugging macros */
 
 /* Forward references */
 
 void usage(void);
-int detab(char *line, int length, int tab);
-int output_line(int np, int nl, char *format, char *text, FILE *fdest);
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
@@ -167,23 +171,16 @@ int output_line(int np, int nl, char *format, char *text, FILE *fdest);
 #endif
 
 int main(int argc, char *argv[]) {
-  int lpp = -1;       /* Lines per page (default: 60) */
-  int tab = -1;       /* Spaces per tab (default: 8) */
-  int nsp = 0;        /* Spaces before each line (default: 0) */
-  int extra = 0;      /* Extra lines after each page (default: 0) */
-  int modnp = 1;      /* Number of logical pages on a physical page */
-  int fptp = 0;       /* Number of logical full pages to print (0 = Off) */
-  int fptp0 = 0;      /* Same for physical pages in multicolumn operation */
-  int length;         /* Length of above buffer */
-  char *pline = NULL; /* Pointer on the line buffer */
-  size_t lSize = 0;   /* Line size */
-  int nl = 0;         /* Current line number (0 to lpp-1) */
-  int np = 0;         /* Current page number, modulo modnp */
-  DEBUG_CODE(
-  int npt = 0;        /* Current page number */
-  )
-  char *format;       /* output format */
-  int top_without_ff = TRUE; /* TRUE if we've reached the top of page without a form-feed */
+  deffeedOpts dfo = { /* The page layout */
+    -1,		      /* lpp: Lines per page (default: 60) */
+    -1,		      /* tab: Spaces per tab (default: 8) */
+    0,		      /* nsp: Spaces before each line (default: 0) */
+    0,		      /* extra: Extra lines after each page (default: 0) */
+    0,		      /* fptp: Number of logical full pages to print (0 = Off) */
+    1,		      /* ncols: Number of columns */
+    80,		      /* wcols: Columns width */
+    0,		      /* dcols: Distance between columns */
+  };
   int i;
   char *source=NULL;  /* Source file name */
   FILE *fsource=stdin;/* Source file pointer */
@@ -194,12 +191,23 @@ int main(int argc, char *argv[]) {
   char *cleanup=NULL; /* Cleanup file name */
   FILE *fcleanup;     /* Cleanup file pointer */
   int nerrors = 0;    /* Number of errors */
-  int buffer_size;    /* Size of the multicolumn buffer */
+  char buffer[4096];  /* Buffer for copying the setup and cleanup files */
   int iSameFile = FALSE; /* If TRUE, output file = input file */
   char szTempFileName[_MAX_PATH] = {0};
   char *pc;
   int isInt;          /* TRUE if the argument is an integer */
   int iValue;         /* If isInt, the value of that integer */
+  char **ppszArgs;    /* Arguments that are not integers */
+  int nArgs = 0;
+  int iRecurse = FALSE; /* Paginate matching files in the current dir tree */
+  filterTreeOpts fto = {0}; /* FilterTree() options */
+
+  ppszArgs = calloc(argc, sizeof(char *));
+  fto.ppszExclude = calloc(argc, sizeof(char *));
+  if ((!ppszArgs) || (!fto.ppszExclude)) {
+    fprintf(stderr, "Not enough memory to run.\n");
+    exit(1);
+  }
 
   for (i=1; i<argc; i++) {        /* Process all command line arguments */
     char *pszArg = argv[i];
@@ -226,11 +234,11 @@ int main(int argc, char *argv[]) {
 	if ( ((i+1) < argc) && (sscanf(argv[i+1], "%d", &temp) == 1) && (temp >= 0)) {
 	  /* If there was indeed a value, and its conversion
 	  succeeded, then store it in the "extra" variable */
-	  extra = temp;
+	  dfo.extra = temp;
 	  i += 1;
 	} else {
 	  /* Else use the default number of extra lines */
-	  extra = 1;
+	  dfo.extra = 1;
 	}
 	continue;
       }
@@ -238,10 +246,10 @@ int main(int argc, char *argv[]) {
 	int temp1, temp2;
 
 	/* Attemp to read the value following -nsp */
-	temp1 = sscanf(argv[i+1], "%d", &temp2);
+	temp1 = ((i+1) < argc) ? sscanf(argv[i+1], "%d", &temp2) : 0;
 	/* If there was a valid value, store it in "nsp" */
 	if ( ((i+1) < argc) && (temp1 == 1)) {
-	  dcols = temp2;
+	  dfo.dcols = temp2;
 	  i += 1;
 	}
 	continue;
@@ -250,14 +258,14 @@ int main(int argc, char *argv[]) {
 	int temp1, temp2;
 
 	/* Attemp to read the value following -page */
-	temp1 = sscanf(argv[i+1], "%d", &temp2);
+	temp1 = ((i+1) < argc) ? sscanf(argv[i+1], "%d", &temp2) : 0;
 	/* If there was a valid value, store it in "fptp" */
 	if ( ((i+1) < argc) && (temp1 == 1)) {
-	  fptp = temp2;
+	  dfo.fptp = temp2;
 	  i += 1;
 	} else {
 	  /* Else use the default number of full pages */
-	  fptp = 1;
+	  dfo.fptp = 1;
 	}
 	continue;
       }
@@ -265,26 +273,34 @@ int main(int argc, char *argv[]) {
 	int temp1, temp2;
 
 	/* Attemp to read the value following -nsp */
-	temp1 = sscanf(argv[i+1], "%d", &temp2);
+	temp1 = ((i+1) < argc) ? sscanf(argv[i+1], "%d", &temp2) : 0;
 	/* If there was a valid value, store it in "nsp" */
 	if ( ((i+1) < argc) && (temp1 == 1)) {
-	  ncols = temp2;
+	  dfo.ncols = temp2;
 	  i += 1;
 	}
 	continue;
       }
+      if (streq(pszOpt, "j") && ((i+1) < argc)) {
+	fto.nThreads = atoi(argv[++i]);
+	continue;
+      }
       if (streq(pszOpt, "nsp")) {
 	int temp1, temp2;
 
 	/* Attemp to read the value following -nsp */
-	temp1 = sscanf(argv[i+1], "%d", &temp2);
+	temp1 = ((i+1) < argc) ? sscanf(argv[i+1], "%d", &temp2) : 0;
 	/* If there was a valid value, store it in "nsp" */
 	if ( ((i+1) < argc) && (temp1 == 1)) {
-	  nsp = temp2;
+	  dfo.nsp = temp2;
 	  i += 1;
 	}
 	continue;
       }
+      if (streq(pszOpt, "r") || streq(pszOpt, "-recurse")) {
+	iRecurse = TRUE;
+	continue;
+      }
       if (   streq(pszOpt, "=")
       	  || streq(pszOpt, "same")
       	  || streq(pszOpt, "self")) {
@@ -300,6 +316,10 @@ int main(int argc, char *argv[]) {
 	}
 	continue;
       }
+      if (streq(pszOpt, "v")) {
+	fto.iFlags |= FT_VERBOSE;
+	continue;
+      }
       if (streq(pszOpt, "V")) {		/* -V: Display version information */
 	puts(DETAILED_VERSION);
 	return 0;
@@ -308,48 +328,60 @@ int main(int argc, char *argv[]) {
 	int temp1, temp2;
 
 	/* Attemp to read the value following -nsp */
-	temp1 = sscanf(argv[i+1], "%d", &temp2);
+	temp1 = ((i+1) < argc) ? sscanf(argv[i+1], "%d", &temp2) : 0;
 	/* If there was a valid value, store it in "nsp" */
 	if ( ((i+1) < argc) && (temp1 == 1)) {
-	  wcols = temp2;
+	  dfo.wcols = temp2;
 	  i += 1;
 	}
 	continue;
       }
+      if (streq(pszOpt, "x") && ((i+1) < argc)) {
+	fto.ppszExclude[fto.nExclude++] = argv[++i];
+	continue;
+      }
+      if (streq(pszOpt, "X")) {
+	fto.iFlags |= FT_NOEXEC;
+	continue;
+      }
       fprintf(stderr, "Invalid switch %s\n", pszArg);
       nerrors += 1;
       continue;
     }
     /* Assign optionnal arguments in their official order (see usage) */
     isInt = sscanf(pszArg, "%d", &iValue);
-    if (lpp == -1) {
+    if (dfo.lpp == -1) {
       if (isInt) {
 	/* If there was a valid value, store it in "lpp" */
-	lpp = iValue;
+	dfo.lpp = iValue;
 	continue;
       } else {
 	/* Else use default, and assume pszArg is a source name */
-	lpp = DEFLPP;
+	dfo.lpp = DEFLPP;
       }
     }
-    if ((!source) && !isInt) {
-      source = pszArg;
+    if (!isInt) {	/* The source and dest names, or the -r patterns */
+      ppszArgs[nArgs++] = pszArg;
       continue;
     }
-    if ((!dest) && !isInt) {
-      int iTemp;
-      if (!sscanf(pszArg, "%d", &iTemp)) {
-	dest = pszArg;
-	continue;
-      }
-    }
-    if ((tab == -1) && isInt) {
-      sscanf(pszArg, "%d", &tab);
+    if (dfo.tab == -1) {
+      dfo.tab = iValue;
       continue;
     }
     fprintf(stderr, "Unexpected argument: %s\n", pszArg);
     nerrors += 1;
   }
+  if (!iRecurse) {
+    if (nArgs > 0) source = ppszArgs[0];
+    if (nArgs > 1) dest = ppszArgs[1];
+    for (i=2; i<nArgs; i++) {
+      fprintf(stderr, "Unexpected argument: %s\n", ppszArgs[i]);
+      nerrors += 1;
+    }
+  } else if (pszSetup || cleanup) {
+    fprintf(stderr, "The setup and cleanup files cannot be used with -r\n");
+    nerrors += 1;
+  }
 
   if (nerrors) {
     fprintf(stderr,
@@ -357,6 +389,19 @@ int main(int argc, char *argv[]) {
     exit(1);
   }
 
+  if (iRecurse) { /* Paginate all matching files in the current directory tree */
+    if (dfo.lpp == -1) dfo.lpp = DEFLPP;
+    if (dfo.tab == -1) dfo.tab = 8;
+    fto.ppszInclude = ppszArgs;
+    fto.nInclude = nArgs;
+    i = FilterTree(".", &fto, DeffeedStream, &dfo);
+    if (!(fto.iFlags & FT_NOEXEC)) {
+      fflush(stdout);		/* Display the list of files changed first */
+      fprintf(stderr, "%ld files changed, out of %ld\n", fto.nChanged, fto.nFiles);
+    }
+    return i ? 1 : 0;
+  }
+
   if (source && !streq(source, "-")) {
     /* If the source file name is provided, try to open the file */
     fsource = fopen(source, "r");
@@ -364,14 +409,14 @@ int main(int argc, char *argv[]) {
       fprintf(stderr, "Can't open input file %s.\n", source);
       exit(1);
     }
-    if (tab == -1) {
+    if (dfo.tab == -1) {
 #if NEEDED
       i = strlen(source);
       if (strieq(source+i-2, ".C") || strieq(source+i-2, ".H")) {
-	tab = 4;
+	dfo.tab = 4;
       } else
 #endif
-	tab = 8;
+	dfo.tab = 8;
     }
   } else {
     /* Else use standard input */
@@ -403,32 +448,17 @@ int main(int argc, char *argv[]) {
   }
 
   /* Make sure defaults are set */
-  if (lpp == -1) lpp = DEFLPP;
-  if (tab == -1) tab = 8;
+  if (dfo.lpp == -1) dfo.lpp = DEFLPP;
+  if (dfo.tab == -1) dfo.tab = 8;
 
-  fprintf(stderr, "%d lines per page, %d lines between pages", lpp, extra);
-  if (fptp) {
-    fprintf(stderr, ", fill a multiple of %d pages", fptp);
+  fprintf(stderr, "%d lines per page, %d lines between pages", dfo.lpp, dfo.extra);
+  if (dfo.fptp) {
+    fprintf(stderr, ", fill a multiple of %d pages", dfo.fptp);
   } else {
     fprintf(stderr, ", do not fill the last page");
   }
   fprintf(stderr, ".\n");
 
-  if (ncols > 1) { /* fptp must be set for multicolumn operation */
-    fptp0 = fptp;           /* Remember the original setting */
-    if (!fptp) fptp = 1;
-    fptp *= ncols;          /* One physical page is ncols logical pages */
-  }
-  if (fptp) modnp = fptp;     /* Else default 1 */
-
-  /* Allocate the output buffer */
-  buffer_size = (wcols + dcols) * ncols * (lpp + extra);
-  buffer = malloc(buffer_size);
-  if (!buffer) {
-    fprintf(stderr, "Not enough memory to run.\n");
-    exit(1);
-  }
-
   /* Copy the setup file */
   if (pszSetup) {
     fsetup = fopen(pszSetup, "rb");
@@ -437,94 +467,24 @@ int main(int argc, char *argv[]) {
       usage();
     }
     setmode(fileno(fdest), O_BINARY);
-    while ((i = (int)fread(buffer, 1, buffer_size, fsetup))) {
+    while ((i = (int)fread(buffer, 1, sizeof(buffer), fsetup))) {
       fwrite(buffer, 1, i, fdest);
     }
     setmode(fileno(fdest), O_TEXT);
     fclose(fsetup);
   }
 
-  format = "          %s\n";		/* 10 spaces then the line then CRLF */
-  format += (10 - nsp);               /* keep only the required spaces */
-
-  while (getline(&pline, &lSize, fsource) >= 0) {
-    if (nl > 0) top_without_ff = FALSE; /* It's not the top line anymore */
-    
-    /* Remove the trailing carrier-return(s) and linefeed */
-    i = (int)strlen(pline);
-    while ((i>0) && ((pline[i-1] == '\n') || (pline[i-1] == '\r'))) {
-      pline[--i]='\0';
-    }
-
-    length = BUFSIZE;
-
-    while (*pline == '\f') {            /* If line begins with a form feed */
-      pline += 1;
-      length -= 1;
-      if (!top_without_ff) { /* Except in the case where we're at top line without a form-feed... */
-	   		     /*  ... fill-up the rest of the page with blank lines.		 */
-	DEBUG_CODE(fprintf(stderr, "Processing form-feed on page %d line %d.\n", npt, nl);)
-	while (nl < lpp+extra) output_line(np, nl++, format, "", fdest);
-	nl = 0;
-	np += 1;
-	np %= modnp;
-	DEBUG_CODE(npt += 1;)
-      } else {
-	DEBUG_CODE(fprintf(stderr, "Skipping form-feed on page %d line %d.\n", npt, nl);)
-      }
-      top_without_ff = FALSE; /* Do this exception only once. (We've had a form-feed now.) */
-    }
-    if ((nl == 0) && (!*pline) && (top_without_ff == FALSE)) continue; /* Ignore CRLF immediately following a FF */
-    if (*pline == '\b') {
-      pline += 1;     /* Remove backspaces at column 0 */
-      length -= 1;
-    }
-    detab(pline, length, tab);
-    output_line(np, nl, format, pline, fdest);
-    nl += 1;
-    if (nl == lpp) {
-      DEBUG_CODE(fprintf(stderr, "Reached end of page %d on line %d. Moving to top of next page.\n", npt, nl);)
-      for (i=0; i<extra; i++) output_line(np, nl+i, format, "", fdest);
-      nl = 0;
-      np += 1;
-      np %= modnp;
-      DEBUG_CODE(npt += 1;)
-      top_without_ff = TRUE;	/* Flag the fact we automatically fed a page. */
-    }
-  }
-  if (ferror(fsource)) {
-    if (!streq(source, "-")) {
+  if (DeffeedStream(fsource, fdest, &dfo) < 0) {
+    if (errno == ENOMEM) {
+      fprintf(stderr, "Not enough memory to run.\n");
+      exit(1);
+    } else if (source && !streq(source, "-")) {
       fprintf(stderr, "Can't read input file %s. %s\n", source, strerror(errno));
     } else {
       fprintf(stderr, "Can't input. %s\n", strerror(errno));
     }
   }
 
-  if (fptp) {
-    if (np || nl) {
-      if (!ncols || fptp0) {
-	while (np < fptp) {
-	  while (nl < lpp+extra) output_line(np, nl++, format, "", fdest);
-	  nl = 0;
-	  np += 1;
-	}
-      } else { /* Do not output the very last line feed in multicolumn mode */
-	while (np < fptp - 1) {
-	  while (nl < lpp+extra) output_line(np, nl++, format, "", fdest);
-	  nl = 0;
-	  np += 1;
-	}
-	while (nl < lpp+extra-1) output_line(np, nl++, format, "", fdest);
-	i = (int)strlen(format);
-	format[i-1] = ' ';      /* Remove the line feed */
-	output_line(np, nl++, format, "", fdest);
-	nl = 0;
-	np += 1;
-      }
-      np = 0;
-    }
-  }
-
   /* Copy the cleanup file */
   if (cleanup) {
     fcleanup = fopen(cleanup, "rb");
@@ -533,7 +493,7 @@ int main(int argc, char *argv[]) {
       usage();
     }
     setmode(fileno(fdest), O_BINARY);
-    while ((i = (int)fread(buffer, 1, buffer_size, fcleanup))) {
+    while ((i = (int)fread(buffer, 1, sizeof(buffer), fcleanup))) {
       fwrite(buffer, 1, i, fdest);
     }
     setmode(fileno(fdest), O_TEXT);
@@ -588,10 +548,13 @@ void usage(void) {
 PROGRAM_NAME_AND_VERSION " - " PROGRAM_DESCRIPTION "\n\
 \n\
 Usage: deffeed [OPTIONS] [LPP] [INFILE] [OUTFILE] [TAB]\n\
+       deffeed [OPTIONS] -r [LPP] [PATTERN ...] [TAB]\n\
 \n\
   LPP              Lines Per Page. Default: 60\n\
   INFILE           Input file. Default or \"-\": stdin\n\
   OUTFILE          Output file. Default or \"-\": stdout\n\
+  PATTERN          Wildcards pattern for the names of the files to paginate.\n\
+                   Default: All files\n\
   TAB              Spaces per tab. Default: 8\n\
 \n\
 Options:\n\
@@ -599,108 +562,19 @@ Options:\n\
   -dcol n          Distance between columns. Default: 0\n\
   -extra [n]       Extra blank lines between pages. Default: 0\n\
   -fp [n]          Fill a multiple of n pages. Default: 1\n\
+  -j n             With -r, use n threads. Default: One per CPU\n\
   -ncol n          Number of columns. Default: 1 (values > 1 are useful for\n\
                    printing multiple pages side-by-side in landscape mode.)\n\
   -nsp n           Add n spaces ahead of every line. Default: 0\n\
+  -r               Paginate in place the matching files in the current dir tree\n\
   -=|-same         Output file = Input file\n\
   -setup {file}    Output the given setup file first. Default: None\n\
+  -v               With -r, display the names of the files changed\n\
   -wcol n          Column width. Default: 80\n\
+  -x PATTERN       With -r, skip the files and directories matching PATTERN\n\
+  -X               With -r, display the names of the files to paginate, and stop\n\
 "
 #include "footnote.h"
 );
   exit(1);
 }
-
-/*---------------------------------------------------------------------------*\
-*                                                                             *
-|   Function:	    detab						      |
-|									      |
-|   Description:							      |
-|									      |
-|   Parameters: 							      |
-|									      |
-|   Returns:								      |
-|                                                                             |
-|   History:								      |
-*									      *
-\*---------------------------------------------------------------------------*/
-
-int detab(char *line, int length, int tab)
-    {
-    char templine[BUFSIZE];
-    int i, j, itab;
-
-    memcpy(templine, line, BUFSIZE);
-
-    for (i=j=itab=0; j<length-tab; i++)
-        {
-        switch(templine[i])
-            {
-            case '\t':
-                while (itab++<tab) line[j++] = ' ';
-                itab = 0;
-                break;
-            default:
-                line[j++] = templine[i];
-                itab += 1;
-                break;
-            }
-        if (itab >= tab) itab = 0;
-        if (!templine[i]) break;
-        }
-    line[length-1] = '\0';
-
-    return 0;
-    }
-
-/*---------------------------------------------------------------------------*\
-*                                                                             *
-|   Function:	    output_line 					      |
-|									      |
-|   Description:							      |
-|									      |
-|   Parameters:	    int np		Current page number modulo fptp	      |
-|		    int nl		Current line number modulo lpp+extra  |
-|		    char *format	String format			      |
-|		    char *text		String to display		      |
-|		    FILE *fdest		Output file			      |
-|									      |
-|   Returns:								      |
-|                                                                             |
-|   History:								      |
-*									      *
-\*---------------------------------------------------------------------------*/
-
-int output_line(int np, int nl, char *format, char *text, FILE *fdest)
-    {
-    char buf[BUFSIZE+20];
-    int i;
-    char format1[10];
-
-    np %= ncols;
-
-    if (ncols == 1)     /* If only one column, do things simply */
-        {
-        return fprintf(fdest, format, text);
-        }
-    else
-        {
-        if (np < ncols - 1)     /* For all but the last column, accumulate */
-            {
-            i = sprintf(buf, format, text);         /* Build line to output */
-            buf[i-1] = '\0';                        /* Remove the trailing \n */
-
-            i = wcols + dcols;                      /* Column total width */
-            sprintf(format1, "%%-%ds", i);          /* Left justify in column */
-
-            i *= (nl * ncols) + np;                 /* Index in buffer */
-            return sprintf(buffer+i, format1, buf); /* Store line in buffer */
-            }
-        else                /* Output accumulated columns and last column */
-            {
-            i = nl * ncols * (wcols + dcols);   /* Index of accumulated lines */
-            fprintf(fdest, "%s", buffer+i);
-            return fprintf(fdest, format, text);
-            }
-        }
-    }
@@ -100,6 +100,9 @@
 *		    Removed global variables that had equivalent WDT_* flags. *
 *		    Changed options -k, -m, -g to -K, -M, -G, and -md -to -m. *
 *                   Version 4.0.					      *
+*    2026-10-18 JFL Get the files stats in batches in Unix, with many requests*
+*		    in flight at once. Added option -Q to set how many.       *
+*		    Version 4.1.					      *
 *		    							      *
 *         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -107,8 +110,8 @@
 
 #define PROGRAM_DESCRIPTION "Display the total size used by a directory"
 #define PROGRAM_NAME    "dirsize"
-#define PROGRAM_VERSION "4.0"
-#define PROGRAM_DATE    "2025-12-23"
+#define PROGRAM_VERSION "4.1"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include <config.h>	/* OS and compiler-specific definitions */
 
@@ -134,6 +137,7 @@
 #include "mainutil.h"	/* SysLib helper routines for main() */
 #include "dirx.h"	/* SysLib Directory access functions eXtensions */
 #include "pathnames.h"	/* SysLib pathname management functions */
+#include "metaio.h"	/* SysLib batched file metadata operations */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
 #ifndef UINTMAX_MAX /* For example Tru64 doesn't define it */
@@ -269,6 +273,9 @@ int main(int argc, char *argv[]) {
 #if OS_HAS_LINKS
   pwt->iFlags |= WDT_ONCE | WDT_FOLLOW;
 #endif
+#if HAS_METAIO
+  pwt->iFlags |= WDT_STAT;	/* Get the files stats in batches, many at a time */
+#endif
 #ifdef _MSDOS
   pwt->iFlags |= WDT_CD;		/* This is more efficient this way in DOS */
   /* In Windows, it's better not to change dirs, to avoid using complex code dealing with paths possibly > 260 bytes */
@@ -378,6 +385,12 @@ int main(int argc, char *argv[]) {
 	pwt->iFlags &= ~WDT_ONCE;
 	continue;
       }
+#endif
+#if HAS_METAIO
+      if (streq(opt, "Q") && ((i+1) < argc)) {
+	SetMetaIoDepth(atoi(argv[++i]));
+	continue;
+      }
 #endif
       if (   streq(opt, "r")
       	  || streq(opt, "s")) {
@@ -582,7 +595,12 @@ Switches:\n\
 "
 #endif
 "\
-  -q          Quiet mode: Do not display minor errors.\n\
+  -q          Quiet mode: Do not display minor errors.\n"
+#if HAS_METAIO
+"\
+  -Q N        Get up to N file stats in parallel. Default: 64. 1=One at a time\n"
+#endif
+"\
   -r|-s       Recursively display the size of every subdirectory.\n\
   -t          Recursively compute the total subdirectory tree size.\n\
   -T          Do not count the size of subdirs. (Default)\n\
@@ -716,7 +734,12 @@ int SelectFilesCB(const char *pszPathname, const struct dirent *pDE, void *p) {
 #if _DIRENT2STAT_DEFINED /* DOS/Windows return stat info in the dirent structure */
       iErr = dirent2stat(pDE, &sStat);
 #else /* Unix has to query it separately */
-      iErr = lstat((pwt->iFlags & WDT_CD) ? pDE->d_name : pszPathname, &sStat);
+      if ((pwt->iFlags & WDT_STAT) && DirentStat(pDE)) { /* WalkDirTree() got it already */
+	sStat = *DirentStat(pDE);
+	iErr = 0;
+      } else {
+	iErr = lstat((pwt->iFlags & WDT_CD) ? pDE->d_name : pszPathname, &sStat);
+      }
 #endif
       if (iErr) { /* Ex: This happens in WSL (Windows Subsystem for Linux) for reserved system files */
       	if (!(pwt->iFlags & WDT_QUIET)) pferror("Can't get file \"%s\" stats: %s", pszPathname, strerror(errno));
@@ -41,6 +41,17 @@
 *    2022-10-19 JFL Moved IsSwitch() to SysLib. Version 1.3.2.		      *
 *    2023-04-19 JFL Moved GetScreenRows() & GetScreenCols() to SysLib.	      *
 *                   Renamed them as GetConRows() & GetConCols(). Ver. 1.3.3.  *
+*    2026-10-18 JFL Use 64-bit offsets, to dump files larger than 4 GB.       *
+*		    Much faster, formatting lines with SysLib's DumpLine(),   *
+*		    and reading and writing large blocks.		      *
+*		    Skip the data before the address in pipes too.	      *
+*		    Version 1.4.					      *
+*    2026-10-18 JFL In Unix, map seekable files in memory, and format large   *
+*		    ranges in parallel threads. Added option -j.	      *
+*		    Added option -s to squeeze runs of identical lines.       *
+*		    Version 1.5.					      *
+*    2026-10-18 JFL Use the same offsets width for the whole range, and       *
+*		    widen the title accordingly beyond 4 GB. Version 1.5.1.   *
 *                                                                             *
 *         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -48,15 +59,15 @@
 
 #define PROGRAM_DESCRIPTION "Dump data as both hexadecimal and text"
 #define PROGRAM_NAME    "dump"
-#define PROGRAM_VERSION "1.3.3"
-#define PROGRAM_DATE    "2023-04-19"
+#define PROGRAM_VERSION "1.5.1"
+#define PROGRAM_DATE    "2026-10-18"
 
-#define _GNU_SOURCE		/* ISO C, POSIX, BSD, and GNU extensions */
-#define _CRT_SECURE_NO_WARNINGS /* Avoid MSVC security warnings */
+#include "predefine.h" /* Define optional features we need in the C libraries */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -78,6 +89,10 @@
 #define USE_TERMCAP 0 /* 1=Use termcap lib; 0=Don't */
 #endif
 
+#define HAS_PARALLEL 1		/* Format large files in parallel threads */
+#include <pthread.h>
+#include <sys/mman.h>
+
 #endif
 
 /************************* OS/2-specific definitions *************************/
@@ -132,25 +147,47 @@
 #error "Unsupported OS"
 #endif
 
+#ifndef HAS_PARALLEL
+#define HAS_PARALLEL 0
+#endif
+#define PARALLEL_MIN_SIZE 0x100000	/* Smaller ranges are dumped sequentially */
+#define PARALLEL_MIN_CHUNK 0x10000	/* Chunk size limits. Multiples of 16 */
+#define PARALLEL_MAX_CHUNK 0x40000
+
 /********************** End of OS-specific definitions ***********************/
 
 /* SysToolsLib include files */
+#include "debugm.h"	/* SysToolsLib debug macros. Include first. */
 #include "mainutil.h"	/* SysLib helper routines for main() */
 #include "console.h"	/* SysLib console management routines */
+#include "textfilt.h"	/* SysLib reusable text filters */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
-typedef unsigned char BYTE;
-typedef unsigned short WORD;
-typedef unsigned long DWORD;
+#ifdef _MSDOS
+#define DUMP_BLOCK_SIZE 0x1000	/* Keep buffers small in the 64KB data segment */
+#else
+#define DUMP_BLOCK_SIZE 0x40000	/* Input and output blocks size */
+#endif
 
 /* Global variables */
 
+DEBUG_GLOBALS			/* Define global variables used by our debugging macros */
+
 int paginate = FALSE;
+int iSqueeze = FALSE;		    /* If true, display runs of identical lines as a * */
+int iDigits = 8;		    /* Number of digits in the offsets */
+#if HAS_PARALLEL
+int iJobs = 0;			    /* Number of formatting threads. 0=All CPUs */
+#endif
 
 /* Forward references */
 
 void usage(void);
-int between(DWORD floor, DWORD u, DWORD ceiling);
+int ParseHex(char *pszArg, off_t *pOffset);
+size_t OutputLine(char *pOut, size_t nOut, size_t nLine);
+#if HAS_PARALLEL
+int DumpParallel(FILE *f, off_t offBase, off_t offEnd, int iLength);
+#endif
 void printflf(void);
 int is_redirected(FILE *f);
 
@@ -174,14 +211,27 @@ int is_redirected(FILE *f);
 int main(int argc, char *argv[])
     {
     int i;
-    DWORD dwBase = 0xFFFFFFFFL;     /* First address to dump */
-    DWORD dwLength = 0xFFFFFFFFL;   /* Number of bytes to dump */
-    BYTE table[16];		    /* 16 bytes table */
-    DWORD ul;
-    WORD u;
+    off_t offBase = 0;		    /* First address to dump */
+    off_t offEnd = 0;		    /* Address after the last byte to dump */
+    int iBase = FALSE;		    /* TRUE if the address was specified */
+    int iLength = FALSE;	    /* TRUE if the length was specified */
+    off_t off;
+    off_t offLine;		    /* Address of the current line */
+    unsigned char *pIn;		    /* Input buffer */
+    size_t nIn = 0;		    /* Number of bytes in the input buffer */
+    size_t iIn = 0;		    /* Index of the next line in the input buffer */
+    char *pOut;			    /* Output buffer */
+    size_t nOut = 0;		    /* Number of bytes in the output buffer */
     char *pszName = NULL;	    /* File name */
     FILE *f;
     int iCtrlZ = FALSE;		/* If true, stop input on a Ctrl-Z */
+    unsigned char abPrev[16];	    /* The previous line data, if it was full */
+    int iPrevFull = FALSE;	    /* TRUE if abPrev contains a full line */
+    long lnSkipped = 0;		    /* Number of identical lines not displayed yet */
+    off_t offSkipped = 0;	    /* Address of the last line not displayed */
+    off_t offLast;		    /* Address of the last byte to dump */
+    struct stat st;
+    char szTitle[DUMP_TITLE_MAX];
 
 #ifndef _UNIX
     /* Force stdin and stdout to untranslated */
@@ -205,6 +255,16 @@ int main(int argc, char *argv[])
 		paginate = GetConRows() - 1;	/* Pause once per screen */
 		continue;
                 }
+#if HAS_PARALLEL
+	    if (streq(pszOpt, "j") && ((i+1) < argc)) { /* -j N: Use N threads */
+		iJobs = atoi(argv[++i]);
+		continue;
+	    }
+#endif
+	    if (streq(pszOpt, "s")) {		/* -s: Squeeze identical lines */
+		iSqueeze = TRUE;
+		continue;
+	    }
 	    if (streq(pszOpt, "V")) {		/* -V: Display the version */
 		puts(DETAILED_VERSION);
 		exit(0);
@@ -221,14 +281,22 @@ int main(int argc, char *argv[])
 	    pszName = pszArg;
 	    continue;
 	    }
-	if (dwBase == 0xFFFFFFFFL)
+	if (!iBase)
             {
-	    if (sscanf(pszArg, "%lX", &ul)) dwBase = ul;
+	    if (ParseHex(pszArg, &off))
+		{
+		offBase = off;
+		iBase = TRUE;
+		}
             continue;
             }
-	if (dwLength == 0xFFFFFFFFL)
+	if (!iLength)
             {
-	    if (sscanf(pszArg, "%lX", &ul)) dwLength = ul;
+	    if (ParseHex(pszArg, &off))
+		{
+		offEnd = offBase + off;
+		iLength = TRUE;
+		}
             continue;
             }
         printf("Unexpected argument: %s\nIgnored.\n", pszArg);
@@ -251,84 +319,99 @@ int main(int argc, char *argv[])
         paginate = FALSE;  /* Avoid waiting forever */
         }
 
-    printf("\n\
-Offset    00           04           08           0C           0   4    8   C   \n\
---------  -----------  -----------  -----------  -----------  -------- --------\n\
-");
+    pIn = malloc(DUMP_BLOCK_SIZE);
+    pOut = malloc(DUMP_BLOCK_SIZE + DUMP_LINE_MAX);
+    if (!pIn || !pOut)
+	{
+	printf("Not enough memory.\n");
+	exit(1);
+	}
 
-    if (dwBase == 0xFFFFFFFFL) dwBase = 0;
-    fseek(f, dwBase & 0xFFFFFFF0L, SEEK_SET);
+    /* Use the offsets width needed for the last line in the title and in all lines */
+    offLast = iLength ? (offEnd - 1) : offBase;
+    if (   !fstat(fileno(f), &st) && S_ISREG(st.st_mode)
+	&& ((!iLength) || (st.st_size < offEnd))) {
+	offLast = st.st_size - 1;   /* Pipes use the width of the first line, then grow */
+    }
+    if (offLast < offBase) offLast = offBase;
+    iDigits = DumpOffsetDigits((dumpOffset_t)offLast);
+    fwrite(szTitle, DumpTitle(szTitle, iDigits), 1, stdout);
 
-    for (ul = dwBase & 0xFFFFFFF0L;
-	 between(dwBase & 0xFFFFFFF0L, ul, dwBase+dwLength);
-         ul += 16)
+#if HAS_PARALLEL
+    /* Map large files in memory, and format them in parallel */
+    if (!paginate && !iCtrlZ && !DumpParallel(f, offBase, offEnd, iLength)) {
+	printflf();
+	return 0;
+    }
+#endif
+
+    /* Go to the first line. Pipes can't seek, so skip their data instead */
+    offLine = offBase & ~(off_t)15;
+    if (offLine && fseeko(f, offLine, SEEK_SET))
+	{
+	for (off = offLine; off > 0; off -= (off_t)nIn)
+	    {
+	    nIn = fread(pIn, 1, (off < DUMP_BLOCK_SIZE) ? (size_t)off : DUMP_BLOCK_SIZE, f);
+	    if (!nIn) break;
+	    }
+	nIn = 0;
+	}
+
+    for ( ; !iLength || (offLine < offEnd); offLine += 16)
 	{
 	size_t nRead;
+	size_t iFirst = 0;	/* Index of the first byte to display */
+	size_t iEnd;		/* Index after the last byte to display */
+	size_t nLine;
+	unsigned char *pLine;
 
 	if (!iCtrlZ) {
-	    nRead = fread(table, 1, 16, f);
+	    if ((nIn - iIn) < 16) { /* Get the next block, after the data left */
+		nIn -= iIn;
+		if (nIn) memmove(pIn, pIn + iIn, nIn);
+		iIn = 0;
+		nIn += fread(pIn + nIn, 1, DUMP_BLOCK_SIZE - nIn, f);
+	    }
+	    nRead = ((nIn - iIn) < 16) ? (nIn - iIn) : 16;
+	    pLine = pIn + iIn;
+	    iIn += nRead;
 	} else { /* Read characters 1 by 1, to avoid blocking if the EOF character is not on a 16-bytes boundary */
+	    pLine = pIn;
 	    for (nRead = 0; nRead < 16; nRead++) {
 	        char c;
 	        if (!fread(&c, 1, 1, f)) break;
 	        if (c == '\x1A') break; /* We got a SUB <==> EOF character */
-	        table[nRead] = c;
+	        pLine[nRead] = c;
 	    }
 	}
 	if (!nRead) break;
 
-	printf("%08lX ", ul);
-
-	/* Display the hex dump */
-
-	for (u=0; u<nRead; u++)
-            {
-	    if (!(u&3)) printf(" ");
-	    if (between(dwBase, ul+u, dwBase+dwLength))
-		printf("%02X ", (WORD)table[u]);
-            else
-		printf("   ");
-            }
-	for ( ; u<16; u++)
-	    {
-	    if (!(u&3)) printf(" ");
-	    printf("   ");
+	if (offLine < offBase) iFirst = (size_t)(offBase - offLine);
+	iEnd = nRead;
+	if (iLength && ((offEnd - offLine) < (off_t)iEnd)) iEnd = (size_t)(offEnd - offLine);
+	if (iSqueeze) {		/* Defer lines identical to the previous one */
+	    int iFull = (!iFirst && (iEnd == 16));
+	    if (iFull && iPrevFull && !memcmp(pLine, abPrev, 16)) {
+		lnSkipped += 1;
+		offSkipped = offLine;
+		continue;
 	    }
-
-	/* Display the character dump */
-
-	for (u=0; u<nRead; u++)
-	    {
-	    if (!(u&7)) printf(" ");
-#ifdef _UNIX
-	    if ( (table[u] & 0x7F) < 0x20) table[u] = ' ';
-#else
-	    switch (table[u])
-		{
-		case '\x07': table[u] = ' '; break;
-		case '\x08': table[u] = ' '; break; /* Backspace	*/
-		case '\x09': table[u] = ' '; break; /* Tab		*/
-		case '\x0A': table[u] = ' '; break; /* Line feed	*/
-		case '\x0D': table[u] = ' '; break; /* Carrier return	*/
-		case '\x1A': table[u] = ' '; break; 
-		default: break;
-		}
-#endif
-	    if (between(dwBase, ul+u, dwBase+dwLength) && (table[u]>' '))
-		printf("%c", table[u]);
-            else
-		printf(" ");
-            }
-	for ( ; u<16; u++)
-	    {
-	    if (!(u&7)) printf(" ");
-	    printf(" ");
+	    if (lnSkipped) {
+		nOut = OutputLine(pOut, nOut, sprintf(pOut + nOut, "*\n"));
+		lnSkipped = 0;
 	    }
-
-	printflf();
-
+	    iPrevFull = iFull;
+	    if (iFull) memcpy(abPrev, pLine, 16);
+	}
+	nLine = DumpLine(pOut + nOut, iDigits, (dumpOffset_t)offLine, pLine, iFirst, iEnd);
+	nOut = OutputLine(pOut, nOut, nLine);
 	if (iCtrlZ && (nRead < 16)) break;
 	}
+    if (lnSkipped) { /* Always display the last line, to show where the data ends */
+	if (lnSkipped > 1) nOut = OutputLine(pOut, nOut, sprintf(pOut + nOut, "*\n"));
+	nOut = OutputLine(pOut, nOut, DumpLine(pOut + nOut, iDigits, (dumpOffset_t)offSkipped, abPrev, 0, 16));
+    }
+    if (nOut) fwrite(pOut, nOut, 1, stdout);
 
 #ifdef _UNIX
     printflf();
@@ -364,20 +447,305 @@ Switches:\n\
 \n\
   -?|-h   Display this help screen\n\
   -p	  Pause for each screen-full of information.\n\
+  -s      Squeeze runs of identical lines, displaying a single * line instead\n\
   -z      Stop input on a Ctrl-Z (aka. SUB or EOF) character\n\
 "
+#if HAS_PARALLEL
+"\
+  -j N    Format large files using N threads. Default: 0 = As many as CPUs\n\
+"
+#endif
 #include "footnote.h"
 );
     exit(1);
     }
 
-int between(DWORD floor, DWORD u, DWORD ceiling)
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    ParseHex						      |
+|                                                                             |
+|   Description:    Parse an hexadecimal number, with an optional 0x prefix   |
+|                                                                             |
+|   Arguments:								      |
+|                                                                             |
+|	char *pszArg	    The string to parse				      |
+|	off_t *pOffset	    Where to store the number			      |
+|                                                                             |
+|   Return value:   TRUE if there was a number, else FALSE		      |
+|                                                                             |
+|   History:								      |
+|    2026-10-18 JFL Created this routine, replacing sscanf("%lX"), which is   |
+|		    limited to 32 bits in Windows.			      |
+*                                                                             *
+\*---------------------------------------------------------------------------*/
+
+int ParseHex(char *pszArg, off_t *pOffset)
+    {
+    off_t off = 0;
+    int nDigits = 0;
+
+    while (isspace((unsigned char)*pszArg)) pszArg++;
+    if ((pszArg[0] == '0') && ((pszArg[1] == 'x') || (pszArg[1] == 'X')) && isxdigit((unsigned char)pszArg[2])) pszArg += 2;
+    for ( ; isxdigit((unsigned char)*pszArg); pszArg++, nDigits++)
+	{
+	int c = toupper((unsigned char)*pszArg);
+	off = (off << 4) + ((c <= '9') ? (c - '0') : (c - 'A' + 10));
+	}
+    if (nDigits) *pOffset = off;
+    return (nDigits > 0);
+    }
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    OutputLine						      |
+|                                                                             |
+|   Description:    Output a line formatted at the end of the output buffer   |
+|                                                                             |
+|   Arguments:								      |
+|                                                                             |
+|	char *pOut	    The output buffer				      |
+|	size_t nOut	    Number of bytes before the new line		      |
+|	size_t nLine	    The new line size, including its final \n	      |
+|                                                                             |
+|   Return value:   The number of bytes now pending in the output buffer      |
+|                                                                             |
+|   Notes:	    When paginating, output every line immediately, and let   |
+|		    printflf() pause at the end of every screen. Else output  |
+|		    large blocks.					      |
+|                                                                             |
+|   History:								      |
+|    2026-10-18 JFL Created this routine, with code from main().	      |
+*                                                                             *
+\*---------------------------------------------------------------------------*/
+
+size_t OutputLine(char *pOut, size_t nOut, size_t nLine)
     {
-    if (ceiling >= floor)
-        return (u >= floor) && (u < ceiling);       /* TRUE if inside */
-    else    /* 32 bits wraparound */
-        return !((u < floor) && (u >= ceiling));    /* TRUE if outside */
+    if (paginate)
+	{
+	fwrite(pOut + nOut, nLine - 1, 1, stdout);
+	printflf();
+	return nOut;
+	}
+    nOut += nLine;
+    if (nOut >= DUMP_BLOCK_SIZE)
+	{
+	fwrite(pOut, nOut, 1, stdout);
+	nOut = 0;
+	}
+    return nOut;
+    }
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    DumpParallel					      |
+|                                                                             |
+|   Description:    Dump a large file range, formatted in parallel threads    |
+|                                                                             |
+|   Arguments:								      |
+|                                                                             |
+|	FILE *f		    The input file				      |
+|	off_t offBase	    First address to dump			      |
+|	off_t offEnd	    Address after the last byte to dump		      |
+|	int iLength	    TRUE if offEnd is valid, else dump until the end  |
+|                                                                             |
+|   Return value:   0=Done, 1=Not possible, nothing done		      |
+|                                                                             |
+|   Notes:	    The file is mapped in memory, and the range is split into |
+|		    chunks of whole lines. The worker threads format the      |
+|		    chunks into separate buffers, which the main thread	      |
+|		    writes in order. Workers may get at most 2 chunks per     |
+|		    thread ahead of the writer, to limit the memory used.     |
+|		    							      |
+|		    Whether a line is squeezed depends only on the data of    |
+|		    that line and the previous one, so all chunks can be      |
+|		    processed independently. The last line is never squeezed, |
+|		    to show where the data ends. main() gives the same output |
+|		    for pipes.						      |
+|                                                                             |
+|   History:								      |
+|    2026-10-18 JFL Created this routine.				      |
+*                                                                             *
+\*---------------------------------------------------------------------------*/
+
+#if HAS_PARALLEL
+
+typedef struct {
+  off_t offFirst;		/* Address of the chunk first line */
+  off_t offStop;		/* Address after the chunk last line */
+  char *pOut;			/* The chunk output data */
+  size_t nOut;			/* The chunk output size */
+  int iDone;			/* TRUE when the output is ready */
+} CHUNK;
+
+typedef struct {
+  pthread_mutex_t mutex;	/* Protects iNext, iWritten, and all iDone */
+  pthread_cond_t cond;		/* Signaled when a chunk is done, or written */
+  CHUNK *pChunks;		/* The list of chunks */
+  int nChunks;			/* Number of chunks */
+  int iNext;			/* Next chunk to process */
+  int iWritten;			/* Number of chunks written so far */
+  int nAhead;			/* Max # of chunks processed ahead of the writer */
+  const unsigned char *pMap;	/* The mapped file data */
+  off_t offMap;			/* The address of pMap[0] in the file */
+  off_t offBase;		/* First address to dump */
+  off_t offStop;		/* Address after the last byte to dump */
+} CHUNKPOOL;
+
+/* Check if the line at address off is identical to the previous one, and not the last one */
+int IsSqueezed(CHUNKPOOL *pPool, off_t off) {
+  return (   ((off - 16) >= pPool->offBase)	/* Both this line and the previous one are full */
+	  && ((off + 16) < pPool->offStop)	/* and this is not the last line */
+	  && !memcmp(pPool->pMap + (size_t)(off - pPool->offMap),
+		     pPool->pMap + (size_t)(off - 16 - pPool->offMap), 16));
+}
+
+void *DumpWorker(void *pArg) {
+  CHUNKPOOL *pPool = pArg;
+
+  for (;;) {
+    CHUNK *pChunk;
+    off_t off;
+    size_t nOut = 0;
+
+    pthread_mutex_lock(&pPool->mutex);
+    while (   (pPool->iNext < pPool->nChunks)
+	   && (pPool->iNext >= (pPool->iWritten + pPool->nAhead))) {
+      pthread_cond_wait(&pPool->cond, &pPool->mutex);
+    }
+    if (pPool->iNext == pPool->nChunks) {
+      pthread_mutex_unlock(&pPool->mutex);
+      break;
     }
+    pChunk = pPool->pChunks + pPool->iNext++;
+    pthread_mutex_unlock(&pPool->mutex);
+
+    /* A squeezed line outputs either nothing or a "*\n", so never more than a full line */
+    pChunk->pOut = malloc((size_t)((pChunk->offStop - pChunk->offFirst + 15) / 16) * DUMP_LINE_MAX);
+    if (!pChunk->pOut) {
+      printf("Not enough memory.\n");
+      exit(1);
+    }
+    for (off = pChunk->offFirst; off < pChunk->offStop; off += 16) {
+      size_t iFirst = 0;
+      size_t iEnd = 16;
+      if (iSqueeze && IsSqueezed(pPool, off)) {
+	if (!IsSqueezed(pPool, off - 16)) {
+	  memcpy(pChunk->pOut + nOut, "*\n", 2);
+	  nOut += 2;
+	}
+	continue;
+      }
+      if (off < pPool->offBase) iFirst = (size_t)(pPool->offBase - off);
+      if ((pPool->offStop - off) < 16) iEnd = (size_t)(pPool->offStop - off);
+      nOut += DumpLine(pChunk->pOut + nOut, iDigits, (dumpOffset_t)off,
+		       pPool->pMap + (size_t)(off - pPool->offMap), iFirst, iEnd);
+    }
+
+    pthread_mutex_lock(&pPool->mutex);
+    pChunk->nOut = nOut;
+    pChunk->iDone = TRUE;
+    pthread_cond_broadcast(&pPool->cond);
+    pthread_mutex_unlock(&pPool->mutex);
+  }
+  return NULL;
+}
+
+int DumpParallel(FILE *f, off_t offBase, off_t offEnd, int iLength) {
+  struct stat st;
+  void *pMap;
+  size_t nMap;
+  off_t offFirst = offBase & ~(off_t)15;
+  off_t offStop;
+  off_t offChunk;
+  off_t off;
+  long lPageSize = sysconf(_SC_PAGESIZE);
+  int i;
+  int nThreads = iJobs;
+  CHUNKPOOL pool;
+  pthread_t *pThreads;
+
+  /* Check if it's possible and worth it */
+  if (fstat(fileno(f), &st) || !S_ISREG(st.st_mode)) return 1;
+  offStop = st.st_size;
+  if (iLength && (offEnd < offStop)) offStop = offEnd;
+  if ((offStop - offBase) < PARALLEL_MIN_SIZE) return 1;
+  if (lPageSize <= 0) lPageSize = 0x1000;
+  pool.offMap = offFirst - (offFirst % lPageSize);
+  if ((unsigned long long)(offStop - pool.offMap) > (size_t)-1) return 1;
+  nMap = (size_t)(offStop - pool.offMap);
+  pMap = mmap(NULL, nMap, PROT_READ, MAP_PRIVATE, fileno(f), pool.offMap);
+  if (pMap == MAP_FAILED) return 1;
+#ifdef MADV_SEQUENTIAL
+  madvise(pMap, nMap, MADV_SEQUENTIAL);
+#endif
+
+  /* Cut the range in chunks of whole lines */
+  if (nThreads < 1) {		/* 0 = Use all CPUs */
+    long nCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+    nThreads = (nCPUs > 0) ? (int)nCPUs : 1;
+  }
+  offChunk = ((offStop - offFirst) / (4 * nThreads)) & ~(off_t)15;
+  if (offChunk < PARALLEL_MIN_CHUNK) offChunk = PARALLEL_MIN_CHUNK;
+  if (offChunk > PARALLEL_MAX_CHUNK) offChunk = PARALLEL_MAX_CHUNK;
+  pool.nChunks = (int)((offStop - offFirst + offChunk - 1) / offChunk);
+  pool.pChunks = calloc(pool.nChunks, sizeof(CHUNK));
+  if (!pool.pChunks) {
+    munmap(pMap, nMap);
+    return 1;
+  }
+  for (i=0, off=offFirst; i<pool.nChunks; i++, off += offChunk) {
+    pool.pChunks[i].offFirst = off;
+    pool.pChunks[i].offStop = ((offStop - off) > offChunk) ? (off + offChunk) : offStop;
+  }
+  if (nThreads > pool.nChunks) nThreads = pool.nChunks;
+
+  /* Start the worker threads */
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+  pool.iNext = 0;
+  pool.iWritten = 0;
+  pool.nAhead = 2 * nThreads;
+  pool.pMap = pMap;
+  pool.offBase = offBase;
+  pool.offStop = offStop;
+  pThreads = malloc(nThreads * sizeof(pthread_t));
+  for (i=0; pThreads && (i<nThreads); i++) {
+    if (pthread_create(pThreads+i, NULL, DumpWorker, &pool)) break;
+  }
+  if (!pThreads || !i) {	/* Nothing done yet, so let main() do it */
+    free(pThreads);
+    free(pool.pChunks);
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&pool.mutex);
+    munmap(pMap, nMap);
+    return 1;
+  }
+  nThreads = i;			/* Continue with fewer threads if needed */
+
+  /* Write the chunks output in order */
+  for (i=0; i<pool.nChunks; i++) {
+    CHUNK *pChunk = pool.pChunks + i;
+    pthread_mutex_lock(&pool.mutex);
+    while (!pChunk->iDone) pthread_cond_wait(&pool.cond, &pool.mutex);
+    pthread_mutex_unlock(&pool.mutex);
+    if (pChunk->nOut) fwrite(pChunk->pOut, pChunk->nOut, 1, stdout);
+    free(pChunk->pOut);
+    pthread_mutex_lock(&pool.mutex);
+    pool.iWritten = i + 1;
+    pthread_cond_broadcast(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+  }
+
+  for (i=0; i<nThreads; i++) pthread_join(pThreads[i], NULL);
+  free(pThreads);
+  free(pool.pChunks);
+  pthread_cond_destroy(&pool.cond);
+  pthread_mutex_destroy(&pool.mutex);
+  munmap(pMap, nMap);
+  return 0;
+}
+
+#endif /* HAS_PARALLEL */
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
@@ -27,6 +27,8 @@
 *                   Version 1.1.3.					      *
 *    2020-04-20 JFL Added support for MacOS. Version 1.2.                     *
 *    2022-10-19 JFL Moved IsSwitch() to SysLib. Version 1.2.1.		      *
+*    2026-10-18 JFL Use SysLib's shared zapFile() and zapDirM(), which delete  *
+*		    subdirectories in parallel in Unix. Version 1.3.	      *
 *		    							      *
 *         © Copyright 2017 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -34,8 +36,8 @@
 
 #define PROGRAM_DESCRIPTION "Remove a directory"
 #define PROGRAM_NAME    "rd"
-#define PROGRAM_VERSION "1.2.1"
-#define PROGRAM_DATE    "2022-10-19"
+#define PROGRAM_VERSION "1.3"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include "predefine.h" /* Define optional features we need in the C libraries */
 
@@ -50,6 +52,7 @@
 #include "debugm.h"	/* SysToolsLib debug macros. Include first. */
 #include "mainutil.h"	/* SysLib helper routines for main() */
 #include "dirx.h"	/* SysLib Directory access functions eXtensions */
+#include "zapfile.h"	/* SysLib File and directory deletion functions */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
 DEBUG_GLOBALS	/* Define global variables used by our debugging macros */
@@ -103,21 +106,7 @@ int printError(char *pszFormat, ...);	/* Print errors in a consistent format */
 
 /* Forward declarations */
 void usage(void);
-/* zap functions options */
-typedef struct zapOpts {
-  int iFlags;
-  char *pszPrefix;
-} zapOpts;
-/* zapOpts iFlags */
-#define FLAG_VERBOSE	0x0001		/* Display the pathname operated on */
-#define FLAG_NOEXEC	0x0002		/* Do not actually execute */
-#define FLAG_RECURSE	0x0004		/* Recursive operation */
-#define FLAG_NOCASE	0x0008		/* Ignore case */
-#define FLAG_FORCE	0x0010		/* Force operation on read-only files */
-int zapFile(const char *path, zapOpts *pzo); /* Delete a file */
-int zapFileM(const char *path, int iMode, zapOpts *pzo); /* Faster */
 int zapDir(const char *path, zapOpts *pzo);  /* Delete a directory */
-int zapDirM(const char *path, int iMode, zapOpts *pzo); /* Faster */
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
@@ -367,36 +356,6 @@ int printError(char *pszFormat, ...) {
   return n;
 }
 
-/*---------------------------------------------------------------------------*\
-*                                                                             *
-|   Function	    NewPathName						      |
-|									      |
-|   Description     Join a directory name and a file name into a new pathname |
-|									      |
-|   Parameters      const char *path		The directory name, or NULL   |
-|		    const char *name		The file name		      |
-|		    							      |
-|   Returns	    0 = Success, else # of failures encountered.	      |
-|		    							      |
-|   Notes	    Wildcards allowed only in the name part of the pathname.  |
-|		    							      |
-|   History								      |
-|    2017-10-05 JFL Created this routine				      |
-|    2017-10-09 JFL Allow the path pointer to be NULL. If so, dup. the name.  |
-*									      *
-\*---------------------------------------------------------------------------*/
-
-char *NewPathName(const char *path, const char *name) {
-  size_t lPath = path ? strlen(path) : 0;
-  size_t lName = strlen(name);
-  char *buf = malloc(lPath + lName + 2);
-  if (!buf) return NULL;
-  if (lPath) strcpy(buf, path);
-  if (lPath && (buf[lPath-1] != DIRSEPARATOR_CHAR)) buf [lPath++] = DIRSEPARATOR_CHAR;
-  strcpy(buf+lPath, name);
-  return buf;
-}
-
 /*---------------------------------------------------------------------------*\
 *                                                                             *
 |   Function	    zapDir						      |
@@ -417,6 +376,7 @@ char *NewPathName(const char *path, const char *name) {
 |		    Split zapFile() off of zapDir().			      |
 |		    Added zapXxxM routines, with an additional iMode argument,|
 |		     to avoid unnecessary slow calls to lstat() in Windows.   |
+|    2026-10-18 JFL Moved zapFile(), zapFileM() and zapDirM() to SysLib.      |
 *									      *
 \*---------------------------------------------------------------------------*/
 
@@ -424,130 +384,6 @@ char *NewPathName(const char *path, const char *name) {
 #pragma warning(disable:4706) /* Ignore the "assignment within conditional expression" warning */
 #endif
 
-int zapFileM(const char *path, int iMode, zapOpts *pzo) {
-  int iFlags = pzo->iFlags;
-  char *pszSuffix = "";
-  int iErr = 0;
-
-  DEBUG_ENTER(("zapFileM(\"%s\", 0x%04X);\n", path, iMode));
-
-  if (S_ISDIR(iMode)) {
-    errno = EISDIR;
-    RETURN_INT(1);
-  }
-#if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
-  if (S_ISLNK(iMode)) {
-    pszSuffix = ">";
-  }
-#endif
-
-  if (iFlags & FLAG_VERBOSE) printf("%s%s%s\n", pzo->pszPrefix, path, pszSuffix);
-  if (iFlags & FLAG_NOEXEC) RETURN_INT(0);
-  if (iFlags & FLAG_FORCE) {
-    if (!(iMode & S_IWRITE)) {
-      iMode |= S_IWRITE;
-      DEBUG_PRINTF(("chmod(%p, 0x%X);\n", path, iMode));
-      iErr = -chmod(path, iMode); /* Try making the target file writable */
-      DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
-    }
-    if (iErr) RETURN_INT(iErr);
-  }
-  iErr = -unlink(path); /* If error, iErr = 1 = # of errors */
-
-  RETURN_INT(iErr);
-}
-
-int zapFile(const char *path, zapOpts *pzo) {
-  int iErr;
-  struct stat sStat;
-
-  DEBUG_ENTER(("zapFile(\"%s\");\n", path));
-
-  iErr = lstat(path, &sStat); /* Use lstat, as stat does not detect SYMLINKDs. */
-  if (iErr && (errno == ENOENT)) RETURN_INT(0); /* Already deleted. Not an error. */
-  if (iErr) RETURN_INT(1);
-  
-  iErr = zapFileM(path, sStat.st_mode, pzo);
-  RETURN_INT(iErr);
-}
-
-int zapDirM(const char *path, int iMode, zapOpts *pzo) {
-  char *pPath;
-  int iErr;
-  struct stat sStat;
-  DIR *pDir;
-  struct dirent *pDE;
-  int nErr = 0;
-  int iFlags = pzo->iFlags;
-  int iVerbose = iFlags & FLAG_VERBOSE;
-  int iNoExec = iFlags & FLAG_NOEXEC;
-  char *pszSuffix;
-
-  DEBUG_ENTER(("zapDirM(\"%s\", 0x%04X);\n", path, iMode));
-
-  if (!S_ISDIR(iMode)) {
-    errno = ENOTDIR;
-    RETURN_INT(1);
-  }
-
-  pDir = opendirx(path);
-  if (!pDir) RETURN_INT(1);
-  while ((pDE = readdirx(pDir))) { /* readdirx() ensures d_type is set */
-    DEBUG_PRINTF(("// Dir Entry \"%s\" d_type=%d\n", pDE->d_name, (int)(pDE->d_type)));
-    pPath = NewPathName(path, pDE->d_name);
-    pszSuffix = "";
-#if _DIRENT2STAT_DEFINED /* MsvcLibX return DOS/Windows stat info in the dirent structure */
-    iErr = dirent2stat(pDE, &sStat);
-#else /* Unix has to query it separately */
-    iErr = -lstat(pPath, &sStat); /* If error, iErr = 1 = # of errors */
-#endif
-    if (!iErr) switch (pDE->d_type) {
-      case DT_DIR:
-      	if (streq(pDE->d_name, ".")) break;	/* Skip the . directory */
-      	if (streq(pDE->d_name, "..")) break;	/* Skip the .. directory */
-      	iErr = zapDirM(pPath, sStat.st_mode, pzo);
-      	pszSuffix = DIRSEPARATOR_STRING;
-      	break;
-#if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
-      case DT_LNK:
-      	pszSuffix = ">";
-      	/* Fall through into the DT_REG case */
-#endif
-      case DT_REG:
-	iErr = zapFileM(pPath, sStat.st_mode, pzo);
-      	break;
-      default:
-      	iErr = 1;		/* We don't support deleting there */
-#if defined(ENOSYS)
-      	errno = ENOSYS;		/* Function not supported */
-#else
-      	errno = EPERM;		/* Operation not permitted */
-#endif
-      	pszSuffix = "?";
-      	break;
-    }
-    if (iErr) {
-      if (pDE->d_type != DT_DIR) printError("Error deleting \"%s%s\": %s", pPath, pszSuffix, strerror(errno));
-      nErr += iErr;
-      /* Continue the directory scan, looking for other files to delete */
-    }
-    free(pPath);
-  }
-  closedirx(pDir);
-
-  iErr = 0;
-  pszSuffix = DIRSEPARATOR_STRING;
-  if (path[strlen(path) - 1] == DIRSEPARATOR_CHAR) pszSuffix = ""; /* There's already a trailing separator */
-  if (iVerbose) printf("%s%s%s\n", pzo->pszPrefix, path, pszSuffix);
-  if (!iNoExec) iErr = rmdir(path);
-  if (iErr) {
-    printError("Error deleting \"%s%s\": %s", path, pszSuffix, strerror(errno));
-    nErr += 1;
-  }
-
-  RETURN_INT_COMMENT(nErr, (nErr ? "%d deletions failed\n" : "Success\n", nErr));
-}
-
 int zapDir(const char *path, zapOpts *pzo) {
   int iErr;
   struct stat sStat;
@@ -82,6 +82,20 @@
 *		    Version 4.0.					      *
 *    2026-02-10 JFL Added a description of option -q in the help screen.      *
 *		    Version 4.0.1.					      *
+*    2026-10-18 JFL Added option -j N to run up to N commands in parallel in  *
+*		    Unix, releasing their output in the traversal order, or   *
+*		    as they finish with option -u. Version 4.1.		      *
+*    2026-10-18 JFL Added option -b to run the command once for a batch of    *
+*		    directories, replacing a {} argument with all their	      *
+*		    paths, like find -exec {} +. Version 4.2.		      *
+*    2026-10-18 JFL Parse the command template once, and expand it for each   *
+*		    directory into a reusable arena, without any allocation.  *
+*		    In Unix, start commands with posix_spawnp(). Version 4.3. *
+*    2026-10-18 JFL Added option -do ACTION, to run the trim, detab, or zap   *
+*		    functions in-process on the matching files, without	      *
+*		    spawning any command. Version 4.4.			      *
+*    2026-10-18 JFL Option -j only uses the next argument as N if it's a      *
+*		    number. Else it's the command to run. Version 4.4.1.      *
 *                                                                             *
 *         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -89,8 +103,8 @@
 
 #define PROGRAM_DESCRIPTION "Execute a command recursively in all subdirectories"
 #define PROGRAM_NAME    "redo"
-#define PROGRAM_VERSION "4.0.1"
-#define PROGRAM_DATE    "2026-02-10"
+#define PROGRAM_VERSION "4.4.1"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include <config.h>	/* OS and compiler-specific definitions */
 
@@ -116,6 +130,8 @@
 #include "dirx.h"		/* Directory access functions eXtensions */
 #include "pathnames.h"		/* Pathname management functions */
 #include "mainutil.h"
+#include "textfilt.h"		/* Text filters */
+#include "zapfile.h"		/* File deletion routines */
 /* SysToolsLib include files */
 #include "debugm.h"	/* SysToolsLib debug macros */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
@@ -210,6 +226,13 @@ intptr_t spawnvp(int iMode, const char *pszCommand, char *const *argv);
 
 #define COMMAND_LINE_MAX 32768
 
+#define HAS_JOBS 1		/* Commands can run in parallel */
+#define FNM_ACTFLAGS 0		/* File names are case-sensitive */
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+extern char **environ;
+
 #endif /* _UNIX */
 
 /*********************************** Other ***********************************/
@@ -218,6 +241,14 @@ intptr_t spawnvp(int iMode, const char *pszCommand, char *const *argv);
 #error "Unidentified OS. Please define OS-specific settings for it."
 #endif
 
+#ifndef HAS_JOBS
+#define HAS_JOBS 0
+#endif
+
+#ifndef FNM_ACTFLAGS		/* fnmatch() flags for the action file patterns */
+#define FNM_ACTFLAGS FNM_CASEFOLD
+#endif
+
 /********************** End of OS-specific definitions ***********************/
 
 /* Local definitions */
@@ -246,6 +277,44 @@ volatile int iCtrlC = FALSE;	    /* If TRUE, a Ctrl-C has been detected */
 
 char **argvCmd = NULL;		    /* Child command and argument list main copy */
 int argcCmd = 0;		    /* Number of items in the command array */
+int iBatch = FALSE;		    /* If TRUE, pass many paths to each command */
+
+typedef struct _CMDSEG {	    /* Command template segment */
+  const char *pcText;		    /* Literal text, or NULL for the path */
+  size_t lText;			    /* Literal text length */
+} CMDSEG;
+CMDSEG *pCmdSegs = NULL;	    /* Segments of all arguments */
+int *piCmdSeg = NULL;		    /* Index of the first segment of each argument */
+char **argvArena = NULL;	    /* Expanded command and argument list */
+char *pArena = NULL;		    /* Expanded arguments buffer */
+size_t lArena = 0;		    /* Expanded arguments buffer size */
+
+/* Built-in actions, run in-process on the files in each directory */
+int ActTrim(const char *pszPath);
+int ActDetab(const char *pszPath);
+int ActZap(const char *pszPath);
+
+typedef struct _REDO_ACTION {
+  char *pszName;		    /* The action name */
+  int (*pAction)(const char *pszPath); /* Returns 1=Changed, 0=Unchanged, -1=Error */
+} REDO_ACTION;
+REDO_ACTION actions[] = {
+  {"detab", ActDetab},
+  {"trim", ActTrim},
+  {"zap", ActZap},
+};
+#define N_ACTIONS (sizeof(actions) / sizeof(REDO_ACTION))
+REDO_ACTION *pAction = NULL;	    /* The selected built-in action */
+char **ppszActPatterns = NULL;	    /* Names of the files to act on */
+int nActPatterns = 0;
+int iActTabSize = 8;		    /* Tab size for the detab action */
+unsigned long nActFiles = 0;	    /* Number of files acted on */
+unsigned long nActChanged = 0;	    /* Number of files changed */
+unsigned long nActErrors = 0;	    /* Number of files that failed */
+#if HAS_JOBS
+int iJobs = 1;			    /* Max # of commands running in parallel */
+int iUnordered = FALSE;		    /* If TRUE, output the results as they finish */
+#endif
 
 #if defined(_MSDOS) || defined(_WIN32) || defined(_OS2)
 
@@ -368,7 +437,21 @@ void finis(int retcode, ...);	    /* Return to the initial drive & exit */
 void OnControlC(int iSignal);
 void usage(int iErr);               /* Display a brief help and exit */
 void DoPerPath(const char *pszPath, void *pRef);
+void DoAction(const char *pszPath, wdt_opts *pwo);
+void ParseCommand(void);
+char **ExpandCommand(const char *pszPath);
 void SortDEList(struct dirent **pDEList, int nDE);
+char *NewCommandEcho(const char *path, char **argv, wdt_opts *pwo);
+void CheckExitStatus(int iStatus, const char *pszName);
+void RunCommand(const char *path, char **command2, wdt_opts *pwo);
+void AddToBatch(const char *path, wdt_opts *pwo);
+void FlushBatch(wdt_opts *pwo);
+int IsPathTag(const char *pszArg);
+#if HAS_JOBS
+void StartJob(char **argv, const char *pszName, char *pszEcho);
+void WaitForJobs(int nMaxRunning);  /* Wait until fewer than nMaxRunning are running */
+void KillJobs(void);
+#endif
 
 int redo(char *from, wdt_opts *);   /* Recurse the directory tree */
 
@@ -421,6 +504,10 @@ int main(int argc, char *argv[]) {
       if (streq(option, "?")) {
 	usage(0);
       }
+      if (streq(option, "b")) {
+	iBatch = TRUE;
+	continue;
+      }
       if (streq(option, "c")) {
 	wdtOpts.iFlags |= WDT_CD;
 	continue;
@@ -435,6 +522,15 @@ int main(int argc, char *argv[]) {
 	  continue;
 	}
       )
+      if (streq(option, "do")) {	/* Run a built-in action */
+	int j;
+	if ((i+1) >= argc) usage(1);
+	arg = argv[++i];
+	for (j=0; j<(int)N_ACTIONS; j++) if (streq(arg, actions[j].pszName)) pAction = actions + j;
+	if (!pAction) finis(RETCODE_SYNTAX, "Unknown action: %s", arg);
+	i += 1;	/* The next arguments are for the action */
+	break;
+      }
 #if OS_HAS_LINKS
       if (streq(option, "f")) {
 	wdtOpts.iFlags |= WDT_FOLLOW;
@@ -453,6 +549,19 @@ int main(int argc, char *argv[]) {
 	}
 	continue;
       }
+#if HAS_JOBS
+      if (streq(option, "j")) { /* Run commands in parallel */
+	char *pszN = ((i+1)<argc) ? argv[i+1] : "";
+	if (pszN[0] && (strspn(pszN, "0123456789") == strlen(pszN))) {
+	  iJobs = atoi(argv[++i]);
+	} else { /* N omitted. The next argument, if any, is the command */
+	  long nCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+	  iJobs = (nCPUs > 0) ? (int)nCPUs : 1;
+	}
+	if (iJobs < 1) iJobs = 1;
+	continue;
+      }
+#endif
       if (streq(option, "l")) { /* List directory pathnames lengths */
 	if (((i+1)<argc) && !IsSwitch(argv[i+1])) {
 	  iMeasure = atoi(argv[++i]);
@@ -494,6 +603,12 @@ int main(int argc, char *argv[]) {
 	iSort = FALSE;
 	continue;
       }
+#if HAS_JOBS
+      if (streq(option, "u")) {
+	iUnordered = TRUE;
+	continue;
+      }
+#endif
       if (streq(option, "v")) {
 	iVerbose = TRUE;
 	continue;
@@ -513,7 +628,28 @@ int main(int argc, char *argv[]) {
   }
   arg1 = i;
 
-  if (argc <= arg1) {   /* If there is no command line, exit immediately */
+  if (pAction) { /* The other arguments are the action options and file names */
+    if (iBatch) finis(RETCODE_SYNTAX, "Option -do cannot be used with -b");
+#if HAS_JOBS
+    if (iJobs > 1) finis(RETCODE_SYNTAX, "Option -do cannot be used with -j");
+#endif
+    for ( ; (i < argc) && IsSwitch(argv[i]); i++) {
+      if (streq(pAction->pszName, "detab") && streq(argv[i]+1, "t") && ((i+1) < argc)) {
+	iActTabSize = atoi(argv[++i]);
+	if ((iActTabSize < 1) || (iActTabSize > 32)) finis(RETCODE_SYNTAX, "Tabs < 1 or > 32");
+	continue;
+      }
+      finis(RETCODE_SYNTAX, "Invalid %s option: %s", pAction->pszName, argv[i]);
+    }
+    ppszActPatterns = argv + i;
+    nActPatterns = argc - i;
+    if (!nActPatterns) { /* Default: All files */
+      static char *pszAll[] = {"*"};
+      ppszActPatterns = pszAll;
+      nActPatterns = 1;
+    }
+    argc = arg1 = 0; /* There's no command to build */
+  } else if (argc <= arg1) {   /* If there is no command line, exit immediately */
     usage(1);
   }
 
@@ -541,6 +677,15 @@ int main(int argc, char *argv[]) {
     argvCmd[cmd1+i] = argv[arg1+i];
   }
   argvCmd[cmd1+i] = NULL;
+  if (!pAction) ParseCommand();
+
+  if (iBatch) {
+    int nTags = 0;
+    for (i=0; argvCmd[i]; i++) if (IsPathTag(argvCmd[i])) nTags += 1;
+    if (nTags != 1) finis(RETCODE_SYNTAX, "Option -b requires exactly one {} argument");
+    /* The batched commands run in the initial directory, with paths relative to it */
+    wdtOpts.iFlags &= ~WDT_CD;
+  }
 
   /* Save the initial drive and directory */
 
@@ -587,10 +732,18 @@ int main(int argc, char *argv[]) {
 
   /* Recurse */
   redo(pszFrom, &wdtOpts);
+  if (iBatch && !iCtrlC) FlushBatch(&wdtOpts); /* Run the command for the last batch */
+#if HAS_JOBS
+  WaitForJobs(1);	/* Wait for the last commands, and output their results */
+#endif
 
   if (iCtrlC) finis(RETCODE_ABORT, "Ctrl-C detected");
 
   if (iVerbose) printf("# Scanned %lu directories\n", (unsigned long)wdtOpts.nDir);
+  if (pAction && (iVerbose || nActErrors)) {
+    printf("# %s: %lu files, %lu changed, %lu failed\n", pAction->pszName, nActFiles, nActChanged, nActErrors);
+  }
+  if (nActErrors) finis(RETCODE_EXEC_ERROR, "Failed to %s %lu files", pAction->pszName, nActErrors);
 
   /* Report if some errors were ignored */
   if (wdtOpts.nErr) {
@@ -621,9 +774,13 @@ void usage(int iErr) {
 PROGRAM_NAME_AND_VERSION " - " PROGRAM_DESCRIPTION "\n\
 \n\
 Usage: redo [SWITCHES] COMMAND_LINE\n\
+       redo [SWITCHES] -do ACTION [ACTION_OPTIONS] [FILE_PATTERN ...]\n\
 \n\
 Switches:\n\
   -?              Display this help screen and exit\n\
+  -b              Batch mode: Run the command once for as many directories as\n\
+                  possible, replacing a {} argument by all their paths.\n\
+                  Implies -C.\n\
   -c              Change directories while recursing (Default)\n\
   -C              Do not change directories while recursing\n\
 "
@@ -639,7 +796,13 @@ DEBUG_CODE(
 "
 #endif
 "\
-  -i PATH         Start recursion in the given directory. Default: \".\"\n\
+  -i PATH         Start recursion in the given directory. Default: \".\"\n"
+#if HAS_JOBS
+"\
+  -j [N]          Run up to N commands in parallel. Default N: # of CPUs\n\
+                  Their output is buffered, and displayed in the usual order.\n"
+#endif
+"\
   -l [MIN_LENGTH] List all sub-directories with their paths length. No command\n\
                   executed. Min length: List only longer paths. Default min: 1\n\
   -m MAX_DEPTH    Limit the recursion depth to N levels. Default: 0=no limit\n\
@@ -671,6 +834,10 @@ DEBUG_CODE(
   -S              Don't sort directories\n\
 "
 #endif
+#if HAS_JOBS
+"\
+  -u              With -j, display each command output as soon as it's done\n"
+#endif
 "\
   -v              Verbose mode. Display the paths, and the commands executed.\n\
   -V              Display the program version and exit\n\
@@ -679,6 +846,12 @@ DEBUG_CODE(
 Command line:     Any valid command and arguments.\n\
                   The special sequence \"{}\" is replaced by the current\n\
                   directory name, relative to the initial directory.\n\
+\n\
+Actions:          Built-in actions, run without starting any command, on the\n\
+                  files matching the patterns in each directory. Default: *\n\
+  detab [-t N]    Convert tabs to spaces, with tab stops every N columns\n\
+  trim            Remove blanks at the end of lines\n\
+  zap             Delete the files\n\
 "
 #ifdef _MSDOS
 "\n\
@@ -748,6 +921,10 @@ void finis(int retcode, ...) {
     va_end(vl);
   }
 
+#if HAS_JOBS
+  KillJobs();		/* Don't leave orphan commands running behind us */
+#endif
+
   chdir(pszInitDir);	/* Don't test errors, as we're likely to be here due to another error */
 #if HAS_DRIVES
   _chdrive(iInitDrive);
@@ -861,18 +1038,14 @@ int redo(char *from, wdt_opts *pwo) {
 |		    							      |
 |   History								      |
 |    1994-05-27 JFL Updated for REDO.					      |
+|    2026-10-18 JFL Use the preparsed command template.			      |
 *									      *
 \*---------------------------------------------------------------------------*/
 
 void DoPerPath(const char *path, void *pRef) {
   wdt_opts *pwo = (wdt_opts *)pRef;
-  int err;
-  int i;
   char *pc;
-  char **command2 = NULL;	/* Command and argument list secondary copy */
-#ifdef _MSDOS
-  int iTailSize = 1;		/* The command-line tail size */
-#endif				/* DOS limits it to 128 bytes, including the final NUL */
+  char **command2;		/* Expanded command and argument list */
 
   DEBUG_ENTER(("DoPerPath(\"%s\");\n", path));
 
@@ -885,49 +1058,278 @@ void DoPerPath(const char *path, void *pRef) {
     goto cleanup_and_return;
   }
 
-  command2 = malloc((argcCmd+1) * sizeof(char *));
-  if (!command2) finis(RETCODE_NO_MEMORY, "Not enough memory for expanded command list");
+  if (pAction) {
+    DoAction(path, pwo);
+    goto cleanup_and_return;
+  }
+
+  if (iBatch) {
+    AddToBatch(path, pwo);
+    goto cleanup_and_return;
+  }
+
+  command2 = ExpandCommand(path);
+  RunCommand(path, command2, pwo);
+
+cleanup_and_return:
+  RETURN();
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    DoAction						      |
+|		    							      |
+|   Description	    Run the built-in action on the files in a directory      |
+|		    							      |
+|   Arguments	    const char *path	The directory			      |
+|		    wdt_opts *pwo	The walk options		      |
+|		    							      |
+|   Return value    None						      |
+|		    							      |
+|   Notes	    Acts on the regular files matching any of the patterns.  |
+|		    If WalkDirTree() changed directory, it's the current      |
+|		    directory, and the names can be used as they are.	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void DoAction(const char *path, wdt_opts *pwo) {
+  const char *pszDir = (pwo->iFlags & WDT_CD) ? "." : path;
+  const char *pszRelDir = path;	/* The directory relative to the initial one */
+  DIR *pDir;
+  struct dirent *pDE;
+
+  if ((pszRelDir[0] == '.') && (pszRelDir[1] == DIRSEPARATOR_CHAR)) pszRelDir += 2; /* Skip the initial ./ */
+  pDir = opendir(pszDir);
+  if (!pDir) {
+    pfcerror("Can't open directory %s", path);
+    nActErrors += 1;
+    return;
+  }
+  while ((pDE = readdir(pDir)) != NULL) {
+    char *pszPath;
+    int i, iResult;
+
+    if (iCtrlC) break;
+    if ((pDE->d_type != DT_REG) && (pDE->d_type != DT_UNKNOWN)) continue;
+    for (i=0; i<nActPatterns; i++) {
+      if (fnmatch(ppszActPatterns[i], pDE->d_name, FNM_ACTFLAGS) == FNM_MATCH) break;
+    }
+    if (i == nActPatterns) continue;
+
+    if (pwo->iFlags & WDT_CD) {
+      pszPath = strdup(pDE->d_name);
+    } else {
+      pszPath = NewJoinedPath(path, pDE->d_name);
+    }
+    if (!pszPath) finis(RETCODE_NO_MEMORY, "Not enough memory for pathname");
+    if (pDE->d_type == DT_UNKNOWN) { /* The file system did not tell */
+      struct stat st;
+      if (lstat(pszPath, &st) || !S_ISREG(st.st_mode)) {
+	free(pszPath);
+	continue;
+      }
+    }
+    if (iVerbose || iNoExec) {
+      if (streq(pszRelDir, ".")) {
+	printf("%s %s\n", pAction->pszName, pDE->d_name);
+      } else {
+	printf("%s %s" DIRSEPARATOR_STRING "%s\n", pAction->pszName, pszRelDir, pDE->d_name);
+      }
+    }
+    nActFiles += 1;
+    if (!iNoExec) {
+      iResult = pAction->pAction(pszPath);
+      if (iResult > 0) nActChanged += 1;
+      if (iResult < 0) nActErrors += 1;
+    }
+    free(pszPath);
+  }
+  closedir(pDir);
+}
+
+/* The built-in actions. Return 1=Changed, 0=Unchanged, -1=Error */
+
+int ActTrim(const char *pszPath) {
+  long l = FilterFileInPlace(pszPath, TrimStream, NULL);
+  if (l < 0) pfcerror("Can't trim %s", pszPath);
+  return (l > 0) ? 1 : (int)l;
+}
+
+int ActDetab(const char *pszPath) {
+  long l = FilterFileInPlace(pszPath, DetabStream, &iActTabSize);
+  if (l < 0) pfcerror("Can't detab %s", pszPath);
+  return (l > 0) ? 1 : (int)l;
+}
+
+int ActZap(const char *pszPath) {
+  zapOpts zo = {0};
+  return zapFile(pszPath, &zo) ? -1 : 1; /* zapFile() reports its own errors */
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    ParseCommand					      |
+|		    							      |
+|   Description	    Split the command arguments into literal and path segments|
+|		    							      |
+|   Arguments	    None. Uses the global argvCmd.			      |
+|		    							      |
+|   Return value    None. Aborts if out of memory.			      |
+|		    							      |
+|   Notes	    The path tags are "{}", and the older "%.".		      |
+|		    Done once, so that ExpandCommand() does not need to scan  |
+|		    the arguments again for each directory.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void ParseCommand(void) {
+  int i;
+  int nSegs = 0;
+  size_t l = 0;
+
+  for (i=0; argvCmd[i]; i++) l += strlen(argvCmd[i]) + 1;
+  /* Each tag splits a literal in two, so there are at most l segments */
+  pCmdSegs = malloc((l + 1) * sizeof(CMDSEG));
+  piCmdSeg = malloc((argcCmd + 1) * sizeof(int));
+  argvArena = malloc((argcCmd + 1) * sizeof(char *));
+  if (!pCmdSegs || !piCmdSeg || !argvArena) finis(RETCODE_NO_MEMORY, "Not enough memory for command");
+
+  for (i=0; argvCmd[i]; i++) {
+    const char *pc = argvCmd[i];
+    const char *pcText = pc;
+    piCmdSeg[i] = nSegs;
+    for ( ; *pc; pc++) {
+      if (   ((pc[0] == '%') && (pc[1] == '.'))    /* Initial redo-specific tag */
+	  || ((pc[0] == '{') && (pc[1] == '}'))) { /* New find-specific tag */
+	if (pc > pcText) {
+	  pCmdSegs[nSegs].pcText = pcText;
+	  pCmdSegs[nSegs++].lText = pc - pcText;
+	}
+	pCmdSegs[nSegs].pcText = NULL;
+	pCmdSegs[nSegs++].lText = 0;
+	pcText = ++pc + 1;
+      }
+    }
+    if ((pc > pcText) || (piCmdSeg[i] == nSegs)) { /* Last literal, or empty arg */
+      pCmdSegs[nSegs].pcText = pcText;
+      pCmdSegs[nSegs++].lText = pc - pcText;
+    }
+  }
+  piCmdSeg[i] = nSegs;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    ExpandCommand					      |
+|		    							      |
+|   Description	    Build the command for a directory			      |
+|		    							      |
+|   Arguments	    const char *pszPath	The directory path		      |
+|		    							      |
+|   Return value    The expanded argument list.				      |
+|		    							      |
+|   Notes	    Arguments without path tags are used as is. The others    |
+|		    are built in a single arena, reused for all directories,  |
+|		    so there's no allocation once it has grown large enough.  |
+|		    The list remains valid until the next call.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine, replacing the per argument	      |
+|		    COMMAND_LINE_MAX buffers in DoPerPath().		      |
+*									      *
+\*---------------------------------------------------------------------------*/
 
-  for (i=0; i<argcCmd; i++) {
-    char *pc2;
-    char c;
-
-    pc = argvCmd[i];
-    if (!pc) break;
-    pc2 = malloc(COMMAND_LINE_MAX);
-    if (!pc2) finis(RETCODE_NO_MEMORY, "Not enough memory for command");
-    command2[i] = pc2;
-    do {
-      c = *(pc++);
-      *(pc2++) = c;
-      if (   ((c == '%') && (*pc == '.'))    /* Initial redo-specific tag */
-	  || ((c == '{') && (*pc == '}'))) { /* New find-specific tag */
-        const char *pc3 = path;
-	pc2 -= 1;   /* Back up over the % sign */
-	/* Copy the part of the path relative to the initial path */
-	if ((pc3[0] == '.') && (pc3[1] == DIRSEPARATOR_CHAR)) pc3 += 2; /* Skip the initial ./ */
-	strcpy(pc2, pc3);
-	pc2 += strlen(pc2);	// Move to the end of string
-	pc += 1;		// Skip the end of the tag ('.' or '}')
+char **ExpandCommand(const char *pszPath) {
+  size_t lPath, l;
+  int i, j;
+  char *pc;
+
+  if ((pszPath[0] == '.') && (pszPath[1] == DIRSEPARATOR_CHAR)) pszPath += 2; /* Skip the initial ./ */
+  lPath = strlen(pszPath);
+
+  /* Compute the space needed */
+  for (i=0, l=0; i<argcCmd; i++) {
+    if ((piCmdSeg[i+1] - piCmdSeg[i]) == 1 && pCmdSegs[piCmdSeg[i]].pcText) continue; /* Pure literal */
+    for (j=piCmdSeg[i]; j<piCmdSeg[i+1]; j++) l += pCmdSegs[j].pcText ? pCmdSegs[j].lText : lPath;
+    l += 1;
+  }
+  if (l > lArena) {
+    free(pArena);
+    lArena = l + (l / 2) + 64; /* Leave room for longer paths */
+    pArena = malloc(lArena);
+    if (!pArena) finis(RETCODE_NO_MEMORY, "Not enough memory for command");
+  }
+
+  /* Build the arguments */
+  for (i=0, pc=pArena; i<argcCmd; i++) {
+    if ((piCmdSeg[i+1] - piCmdSeg[i]) == 1 && pCmdSegs[piCmdSeg[i]].pcText) {
+      argvArena[i] = argvCmd[i];
+      continue;
+    }
+    argvArena[i] = pc;
+    for (j=piCmdSeg[i]; j<piCmdSeg[i+1]; j++) {
+      if (pCmdSegs[j].pcText) {
+	memcpy(pc, pCmdSegs[j].pcText, pCmdSegs[j].lText);
+	pc += pCmdSegs[j].lText;
+      } else {
+	memcpy(pc, pszPath, lPath);
+	pc += lPath;
       }
-    } while (c);
-    // Free the end of string
-    command2[i] = ShrinkBuf(command2[i], ++pc2 - command2[i]);
-    DEBUG_PRINTF(("arg[%d] = \"%s\";\n", i, command2[i]));
+    }
+    *(pc++) = '\0';
+    DEBUG_PRINTF(("arg[%d] = \"%s\";\n", i, argvArena[i]));
+  }
+  argvArena[i] = NULL;
+  return argvArena;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    RunCommand						      |
+|		    							      |
+|   Description	    Run a fully expanded command			      |
+|		    							      |
+|   Arguments	    const char *path	The directory where it runs	      |
+|		    char **command2	The command and its arguments	      |
+|		    wdt_opts *pwo	The walk options		      |
+|		    							      |
+|   Return value    None. Aborts if the command cannot be run.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Extracted from DoPerPath().				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void RunCommand(const char *path, char **command2, wdt_opts *pwo) {
+  int err;
+  char *pc;
+  char *pszEcho = NULL;		/* The command line displayed in verbose mode */
 #ifdef _MSDOS
-    if (i > 0) iTailSize += strlen(command2[i]) + 1;
+  int i;
+  int iTailSize = 1;		/* The command-line tail size */
+				/* DOS limits it to 128 bytes, including the final NUL */
+  for (i=1; command2[i]; i++) iTailSize += strlen(command2[i]) + 1;
 #endif
-  }
-  command2[i] = NULL;
 
   if (iVerbose || iNoExec) {
-    if (pwo->iFlags & WDT_CD) {
-      const char *pcc = path;
-      if ((pcc[0] == '.') && (pcc[1] == DIRSEPARATOR_CHAR)) pcc += 2;
-      printf("[%s] ", pcc);
+    pszEcho = NewCommandEcho(path, command2, pwo);
+    if (!pszEcho) finis(RETCODE_NO_MEMORY, "Not enough memory for command");
+#if HAS_JOBS
+    if ((iJobs > 1) && !iNoExec) {
+      /* StartJob() will output it with the command output */
+    } else
+#endif
+    {
+      fputs(pszEcho, stdout);
+      free(pszEcho);
+      pszEcho = NULL;
     }
-    for (i=0; ((pc=command2[i]) != NULL); i++) printf("%s ", pc);
-    printf("\n");
   }
 #ifdef _MSDOS
   if (iTailSize > 128) finis(RETCODE_EXEC_ERROR, "Command too long"); /* else spawnv() crashes below! */
@@ -937,39 +1339,213 @@ void DoPerPath(const char *path, void *pRef) {
     if (pc) pc += 1; else pc = command2[0]; /* The node name of the child command */
 #if HAS_DRIVES
     if (pc[0] && (pc[1] == ':')) pc += 2;
+#endif
+#if HAS_JOBS
+    if (iJobs > 1) {
+      StartJob(command2, pc, pszEcho); /* Takes ownership of pszEcho */
+      return;
+    }
 #endif
     err = (int)spawnvp(P_WAIT, command2[0], command2);
     DEBUG_PRINTF(("Child exit code 0x%02X\n", err));
     if (err == -1) finis(RETCODE_EXEC_ERROR, "Cannot execute %s. %s", command2[0], strerror(errno));
-    if (WIFEXITED(err)) {
-      err = WEXITSTATUS(err); /* Pass-on the actual child exit code */
-    } else if (WIFSIGNALED(err) && (WTERMSIG(err) == SIGINT)) {
-      /* This happens if the child does _not_ intercept the SIGINT signal.
-	 In this case, the child is terminated by the system */
-      fputs("\n", stderr); /* The child output ends with a "^C" string with no \n */
-      DEBUG_CODE(
-	if (getenv("NOCTRLC2")) {
-	  /* Experimental code: See what happens if not calling finis() now */
-	  printf("redo: NOCTRLC2, %s interrupted by a Ctrl-C, continuing\n", pc);
-	} else
-      )
-      finis(RETCODE_ABORT, "%s interrupted by a Ctrl-C", pc);
+    CheckExitStatus(err, pc);
+  }
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    AddToBatch						      |
+|		    							      |
+|   Description	    Add a path to the batch for the next command in mode -b   |
+|		    							      |
+|   Arguments	    const char *path	The directory to add		      |
+|		    wdt_opts *pwo	The walk options		      |
+|		    							      |
+|   Return value    None						      |
+|		    							      |
+|   Notes	    If the path does not fit in the remaining argument space, |
+|		    first run the command for the current batch. This keeps   |
+|		    the memory used bounded, even for huge trees.	      |
+|		    							      |
+|		    The argument space is the system ARG_MAX in Unix, minus   |
+|		    the size of the environment and some slack, like find.   |
+|		    Elsewhere, it's the max command line length.	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+char **ppszBatch = NULL;	/* Paths in the current batch */
+int nBatch = 0;			/* Number of paths in the current batch */
+int nBatchMax = 0;		/* Size of the ppszBatch array */
+size_t lBatch = 0;		/* Argument space used by the current batch */
+size_t lBatchMax = 0;		/* Argument space available for the batch */
+
+static size_t GetBatchSpace(void) {
+  size_t l = 0;
+  int i;
+#ifdef _UNIX
+  long lArgMax = sysconf(_SC_ARG_MAX);
+  if (lArgMax <= 0) lArgMax = _POSIX_ARG_MAX;
+  for (i=0; environ[i]; i++) l += strlen(environ[i]) + 1 + sizeof(char *);
+  l += 2048;		/* Leave some slack, like find and xargs */
+  if ((size_t)lArgMax <= l) return 0;
+  l = (size_t)lArgMax - l;
+#else
+  l = COMMAND_LINE_MAX;
+#endif
+  for (i=0; argvCmd[i]; i++) l -= strlen(argvCmd[i]) + 1 + sizeof(char *);
+  return l;
+}
+
+void AddToBatch(const char *path, wdt_opts *pwo) {
+  size_t l;
+  char *pszPath;
+
+  if ((path[0] == '.') && (path[1] == DIRSEPARATOR_CHAR)) path += 2; /* Skip the initial ./ */
+  if (!lBatchMax) lBatchMax = GetBatchSpace();
+  l = strlen(path) + 1 + sizeof(char *);
+  if (nBatch && ((lBatch + l) > lBatchMax)) FlushBatch(pwo);
+  if (l > lBatchMax) finis(RETCODE_EXEC_ERROR, "Path too long for the command line: %s", path);
+
+  if (nBatch == nBatchMax) {
+    nBatchMax = nBatchMax ? (2 * nBatchMax) : 256;
+    ppszBatch = realloc(ppszBatch, nBatchMax * sizeof(char *));
+    if (!ppszBatch) finis(RETCODE_NO_MEMORY, "Not enough memory for command");
+  }
+  pszPath = strdup(path);
+  if (!pszPath) finis(RETCODE_NO_MEMORY, "Not enough memory for command");
+  ppszBatch[nBatch++] = pszPath;
+  lBatch += l;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    FlushBatch						      |
+|		    							      |
+|   Description	    Run the command for the current batch of paths	      |
+|		    							      |
+|   Arguments	    wdt_opts *pwo	The walk options		      |
+|		    							      |
+|   Return value    None						      |
+|		    							      |
+|   Notes	    Replaces the {} argument by all paths in the batch.       |
+|		    The command runs in the initial directory.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void FlushBatch(wdt_opts *pwo) {
+  char **command2;
+  int i, j, n;
+
+  if (!nBatch) return;
+  DEBUG_ENTER(("FlushBatch(); // %d paths\n", nBatch));
+
+  command2 = malloc((argcCmd + nBatch + 1) * sizeof(char *));
+  if (!command2) finis(RETCODE_NO_MEMORY, "Not enough memory for expanded command list");
+  for (i=n=0; argvCmd[i]; i++) {
+    if (IsPathTag(argvCmd[i])) {
+      for (j=0; j<nBatch; j++) command2[n++] = ppszBatch[j];
     } else {
-      /* The child got killed for various other reasons */
-      finis(RETCODE_ABORT, "%s aborted", pc);
-    }
-    if (err) {
-      pfnotice(NULL, "%s exited with error # %d", pc, err);
+      command2[n++] = argvCmd[i];
     }
   }
+  command2[n] = NULL;
 
-  for (i=0; command2[i]; i++) free(command2[i]); // Free the copy of the command.
-  free(command2); /* Free the array of pointers */
+  RunCommand(".", command2, pwo);
 
-cleanup_and_return:
+  free(command2);
+  for (j=0; j<nBatch; j++) free(ppszBatch[j]);
+  nBatch = 0;
+  lBatch = 0;
   RETURN();
 }
 
+/* Check if a command argument is the path placeholder */
+int IsPathTag(const char *pszArg) {
+  return streq(pszArg, "{}") || streq(pszArg, "%.");
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    NewCommandEcho					      |
+|		    							      |
+|   Description	    Format the command line displayed in verbose mode	      |
+|		    							      |
+|   Arguments	    const char *path	The directory where it runs	      |
+|		    char **argv		The command and its arguments	      |
+|		    wdt_opts *pwo	The walk options		      |
+|		    							      |
+|   Return value    A new string, ending with a \n. NULL if out of memory.    |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Extracted from DoPerPath().				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+char *NewCommandEcho(const char *path, char **argv, wdt_opts *pwo) {
+  size_t l = strlen(path) + 5;
+  int i;
+  char *pszEcho;
+  char *pc;
+
+  for (i=0; argv[i]; i++) l += strlen(argv[i]) + 1;
+  pc = pszEcho = malloc(l);
+  if (!pszEcho) return NULL;
+  if (pwo->iFlags & WDT_CD) {
+    const char *pcc = path;
+    if ((pcc[0] == '.') && (pcc[1] == DIRSEPARATOR_CHAR)) pcc += 2;
+    pc += sprintf(pc, "[%s] ", pcc);
+  }
+  for (i=0; argv[i]; i++) pc += sprintf(pc, "%s ", argv[i]);
+  strcpy(pc, "\n");
+  return pszEcho;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    CheckExitStatus					      |
+|		    							      |
+|   Description	    Report a child command failure			      |
+|		    							      |
+|   Arguments	    int iStatus		The child status from waitpid()	      |
+|		    const char *pszName	The child command node name	      |
+|		    							      |
+|   Return value    None. Aborts if the command was interrupted.	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Extracted from DoPerPath().				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void CheckExitStatus(int err, const char *pc) {
+  if (WIFEXITED(err)) {
+    err = WEXITSTATUS(err); /* Pass-on the actual child exit code */
+  } else if (WIFSIGNALED(err) && (WTERMSIG(err) == SIGINT)) {
+    /* This happens if the child does _not_ intercept the SIGINT signal.
+	 In this case, the child is terminated by the system */
+    fputs("\n", stderr); /* The child output ends with a "^C" string with no \n */
+    DEBUG_CODE(
+	if (getenv("NOCTRLC2")) {
+	  /* Experimental code: See what happens if not calling finis() now */
+	  printf("redo: NOCTRLC2, %s interrupted by a Ctrl-C, continuing\n", pc);
+	} else
+    )
+    finis(RETCODE_ABORT, "%s interrupted by a Ctrl-C", pc);
+  } else {
+    /* The child got killed for various other reasons */
+    finis(RETCODE_ABORT, "%s aborted", pc);
+  }
+  if (err) {
+    pfnotice(NULL, "%s exited with error # %d", pc, err);
+  }
+}
+
 /*---------------------------------------------------------------------------*\
 *                                                                             *
 |   Function	    CompareDirent	                                      |
@@ -1059,13 +1635,14 @@ void SortDEList(struct dirent **pDEList, int nDE) {
 |    2014-03-27 JFL Created this routine				      |
 |    2025-12-16 JFL Do not display an error message here.		      |
 |    2025-12-18 JFL Specify the pid number to wait for.			      |
+|    2026-10-18 JFL Use posix_spawnp(), instead of fork() and execvp().       |
 *									      *
 \*---------------------------------------------------------------------------*/
 
 #ifdef _UNIX
 
 intptr_t spawnvp(int iMode, const char *pszCommand, char *const *argv) {
-  pid_t pid = fork();
+  pid_t pid;
   int iRet = 0;
   DEBUG_CODE({
     int i;
@@ -1075,25 +1652,312 @@ intptr_t spawnvp(int iMode, const char *pszCommand, char *const *argv) {
       printf("\n");
     }
   })
-  if (pid < 0) {		// Failed to fork
-    return -1;
-  } else if (pid == 0) {	// We're the child instance
-    execvp(pszCommand, argv);
-    // We only get here if the exec fails
+  /* posix_spawnp() avoids duplicating our address space, like vfork(),
+     and reports exec failures, which fork() + execvp() can't do easily. */
+  iRet = posix_spawnp(&pid, pszCommand, NULL, NULL, argv, environ);
+  if (iRet) {			// Failed to start the program
+    errno = iRet;
     return -1;
-  } else {			// We're the parent instance
-    switch(iMode) {
-      case P_WAIT:
-      	waitpid(pid, &iRet, 0);
-	break;
-      case P_NOWAIT:
-      default:
-	iRet = (intptr_t)pid;
-	break;
-    }
+  }
+  switch(iMode) {
+    case P_WAIT:
+      while ((waitpid(pid, &iRet, 0) == -1) && (errno == EINTR)) ;
+      break;
+    case P_NOWAIT:
+    default:
+      iRet = (intptr_t)pid;
+      break;
   }
   return iRet;
 }
 
 #endif /* defined(_UNIX) */
 
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    StartJob						      |
+|									      |
+|   Description	    Start a command in the background, capturing its output   |
+|									      |
+|   Arguments	    char **argv		The command and its arguments	      |
+|		    const char *pszName	The command node name, for messages   |
+|		    char *pszEcho	The verbose mode command line, or NULL|
+|									      |
+|   Return value    None. Aborts if the command cannot be started.	      |
+|									      |
+|   Notes	    At most iJobs commands run simultaneously. If that many   |
+|		    are already running, wait for one to finish first.	      |
+|									      |
+|		    The commands stdout and stderr are read through pipes,    |
+|		    and accumulated in memory until ReleaseJobs() writes them |
+|		    in the order the commands were started, or in the order   |
+|		    they finished with option -u.			      |
+|									      |
+|		    posix_spawnp() redirects the child stdin to /dev/null,    |
+|		    and its stdout and stderr to the pipes.		      |
+|									      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#if HAS_JOBS
+
+typedef struct _JOBBUF {	/* Growable output buffer */
+  char *pBuf;
+  size_t nUsed;
+  size_t nSize;
+} JOBBUF;
+
+typedef struct _JOB {		/* Command running in the background */
+  struct _JOB *pNext;		/* Next job started after this one */
+  pid_t pid;			/* Child process ID. 0 once reaped */
+  int iFD[2];			/* stdout and stderr pipes. -1 once at EOF */
+  JOBBUF buf[2];		/* stdout and stderr contents */
+  int iStatus;			/* The waitpid() status */
+  char *pszName;		/* The command node name */
+} JOB;
+
+JOB *pFirstJob = NULL;		/* Jobs list, in the order they were started */
+JOB *pLastJob = NULL;
+int nRunningJobs = 0;		/* Number of jobs not reaped yet */
+
+static int JobBufAppend(JOBBUF *pJB, const char *pData, size_t nData) {
+  if ((pJB->nUsed + nData) > pJB->nSize) {
+    size_t nSize = pJB->nSize ? (2 * pJB->nSize) : 4096;
+    char *pBuf;
+    while (nSize < (pJB->nUsed + nData)) nSize *= 2;
+    pBuf = realloc(pJB->pBuf, nSize);
+    if (!pBuf) return -1;
+    pJB->pBuf = pBuf;
+    pJB->nSize = nSize;
+  }
+  memcpy(pJB->pBuf + pJB->nUsed, pData, nData);
+  pJB->nUsed += nData;
+  return 0;
+}
+
+static void FreeJob(JOB *pJob) {
+  int i;
+  for (i=0; i<2; i++) {
+    if (pJob->iFD[i] != -1) close(pJob->iFD[i]);
+    free(pJob->buf[i].pBuf);
+  }
+  free(pJob->pszName);
+  free(pJob);
+}
+
+static void CloseJobPipes(int iPipes[2][2]) {
+  int i, j;
+  for (i=0; i<2; i++) for (j=0; j<2; j++) if (iPipes[i][j] != -1) close(iPipes[i][j]);
+}
+
+void StartJob(char **argv, const char *pszName, char *pszEcho) {
+  JOB *pJob;
+  int iPipes[2][2] = {{-1, -1}, {-1, -1}}; /* stdout, stderr */
+  int i;
+  int iErr;
+  posix_spawn_file_actions_t fa;
+
+  WaitForJobs(iJobs);	/* Wait until there's room for one more */
+  if (iCtrlC) finis(RETCODE_ABORT, "Interrupted by a Ctrl-C");
+
+  pJob = calloc(1, sizeof(JOB));
+  if (pJob) pJob->pszName = strdup(pszName);
+  if (!pJob || !pJob->pszName) finis(RETCODE_NO_MEMORY, "Not enough memory for command");
+  pJob->iFD[0] = pJob->iFD[1] = -1;
+  if (pszEcho) { /* In verbose mode, output the command line before its output */
+    pJob->buf[0].pBuf = pszEcho;
+    pJob->buf[0].nSize = pJob->buf[0].nUsed = strlen(pszEcho);
+  }
+
+  for (i=0; i<2; i++) {
+    if (pipe2(iPipes[i], O_CLOEXEC) == -1) {
+      iErr = errno;
+      CloseJobPipes(iPipes);
+      FreeJob(pJob);
+      finis(RETCODE_EXEC_ERROR, "Cannot create a pipe. %s", strerror(iErr));
+    }
+  }
+
+  iErr = posix_spawn_file_actions_init(&fa);
+  /* Don't let parallel commands compete for the console input */
+  if (!iErr) iErr = posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDONLY, 0);
+  /* dup2() clears the close-on-exec flag */
+  if (!iErr) iErr = posix_spawn_file_actions_adddup2(&fa, iPipes[0][1], 1);
+  if (!iErr) iErr = posix_spawn_file_actions_adddup2(&fa, iPipes[1][1], 2);
+  if (!iErr) iErr = posix_spawnp(&(pJob->pid), argv[0], &fa, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&fa);
+  if (iErr) {
+    CloseJobPipes(iPipes);
+    FreeJob(pJob);
+    finis(RETCODE_EXEC_ERROR, "Cannot execute %s. %s", argv[0], strerror(iErr));
+  }
+  /* We're the parent instance */
+  close(iPipes[0][1]);
+  close(iPipes[1][1]);
+  pJob->iFD[0] = iPipes[0][0];
+  pJob->iFD[1] = iPipes[1][0];
+  nRunningJobs += 1;
+  if (pLastJob) pLastJob->pNext = pJob; else pFirstJob = pJob;
+  pLastJob = pJob;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    ReleaseJobs						      |
+|									      |
+|   Description	    Output the results of the completed jobs		      |
+|									      |
+|   Arguments	    None						      |
+|									      |
+|   Return value    None						      |
+|									      |
+|   Notes	    By default, release only the completed jobs at the head   |
+|		    of the list, so that the output order is the same as      |
+|		    that of sequential runs. With option -u, release all      |
+|		    completed jobs.					      |
+|									      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+static void ReleaseJobs(void) {
+  JOB **ppJob = &pFirstJob;
+  JOB *pPrev = NULL;
+
+  while (*ppJob) {
+    JOB *pJob = *ppJob;
+    if (pJob->pid) {	/* Still running */
+      if (!iUnordered) break;
+      pPrev = pJob;
+      ppJob = &(pJob->pNext);
+      continue;
+    }
+    /* Unlink it before calling CheckExitStatus(), as it may call finis() */
+    *ppJob = pJob->pNext;
+    if (pLastJob == pJob) pLastJob = pPrev;
+    fflush(stdout);
+    if (pJob->buf[0].nUsed) fwrite(pJob->buf[0].pBuf, 1, pJob->buf[0].nUsed, stdout);
+    fflush(stdout);
+    if (pJob->buf[1].nUsed) fwrite(pJob->buf[1].pBuf, 1, pJob->buf[1].nUsed, stderr);
+    CheckExitStatus(pJob->iStatus, pJob->pszName);
+    FreeJob(pJob);
+  }
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    WaitForJobs						      |
+|									      |
+|   Description	    Collect the jobs output until few enough are left running |
+|									      |
+|   Arguments	    int nMaxRunning	Return when fewer jobs are running.   |
+|					1 = Wait for all jobs to complete.    |
+|									      |
+|   Return value    None						      |
+|									      |
+|   Notes	    A job is complete when both its output pipes are at EOF,  |
+|		    and its process has been reaped.			      |
+|									      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void WaitForJobs(int nMaxRunning) {
+  struct pollfd *pPoll = NULL;
+  JOB **ppPolled = NULL;
+  int nPollMax = 0;
+
+  ReleaseJobs();
+  while (nRunningJobs && (nRunningJobs >= nMaxRunning)) {
+    JOB *pJob;
+    int nPoll = 0;
+    int i, n;
+
+    if (nPollMax < (2 * nRunningJobs)) {
+      nPollMax = 2 * nRunningJobs;
+      pPoll = realloc(pPoll, nPollMax * sizeof(struct pollfd));
+      ppPolled = realloc(ppPolled, nPollMax * sizeof(JOB *));
+      if (!pPoll || !ppPolled) finis(RETCODE_NO_MEMORY, "Not enough memory for jobs");
+    }
+    for (pJob = pFirstJob; pJob; pJob = pJob->pNext) {
+      for (i=0; i<2; i++) {
+	if (pJob->iFD[i] == -1) continue;
+	pPoll[nPoll].fd = pJob->iFD[i];
+	pPoll[nPoll].events = POLLIN;
+	pPoll[nPoll].revents = 0;
+	ppPolled[nPoll++] = pJob;
+      }
+    }
+
+    if (nPoll) {
+      n = poll(pPoll, nPoll, -1);
+      if ((n == -1) && (errno != EINTR)) finis(RETCODE_EXEC_ERROR, "Cannot poll jobs. %s", strerror(errno));
+      for (i=0; (n > 0) && (i < nPoll); i++) {
+	char buf[8192];
+	ssize_t nRead;
+	int iOut;
+	if (!pPoll[i].revents) continue;
+	pJob = ppPolled[i];
+	iOut = (pJob->iFD[0] == pPoll[i].fd) ? 0 : 1;
+	nRead = read(pPoll[i].fd, buf, sizeof(buf));
+	if (nRead > 0) {
+	  if (JobBufAppend(&(pJob->buf[iOut]), buf, nRead)) finis(RETCODE_NO_MEMORY, "Not enough memory for %s output", pJob->pszName);
+	} else if ((nRead == 0) || (errno != EINTR)) { /* EOF or error */
+	  close(pJob->iFD[iOut]);
+	  pJob->iFD[iOut] = -1;
+	}
+      }
+    }
+
+    /* Reap the jobs that closed both their outputs */
+    for (pJob = pFirstJob; pJob; pJob = pJob->pNext) {
+      if (pJob->pid && (pJob->iFD[0] == -1) && (pJob->iFD[1] == -1)) {
+	while ((waitpid(pJob->pid, &(pJob->iStatus), 0) == -1) && (errno == EINTR)) ;
+	pJob->pid = 0;
+	nRunningJobs -= 1;
+      }
+    }
+    ReleaseJobs();
+  }
+  free(pPoll);
+  free(ppPolled);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    KillJobs						      |
+|									      |
+|   Description	    Terminate the jobs still running			      |
+|									      |
+|   Arguments	    None						      |
+|									      |
+|   Return value    None						      |
+|									      |
+|   Notes	    Called by finis() when aborting. Their output is lost.    |
+|									      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void KillJobs(void) {
+  JOB *pJob;
+
+  while ((pJob = pFirstJob) != NULL) {
+    pFirstJob = pJob->pNext;
+    if (pJob->pid) {
+      kill(pJob->pid, SIGTERM);
+      while ((waitpid(pJob->pid, NULL, 0) == -1) && (errno == EINTR)) ;
+    }
+    FreeJob(pJob);
+  }
+  pLastJob = NULL;
+  nRunningJobs = 0;
+}
+
+#endif /* HAS_JOBS */
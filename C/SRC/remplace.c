@@ -160,6 +160,28 @@
 *    2022-10-16 JFL Removed an unused variable.                               *
 *		    Version 3.2.3.					      *
 *    2022-10-19 JFL Moved IsSwitch() to SysLib. Version 3.2.4.		      *
+*    2026-10-18 JFL Process the input in large blocks, with a precompiled     *
+*		    pattern, instead of one character at a time through a     *
+*		    back buffer. Unmatched runs are now written in bulk.      *
+*		    Added option -u to flush the output after each read.      *
+*		    Output is no longer flushed at every end of line.	      *
+*		    Bug fix: -@ and -% deleted NUL characters.		      *
+*		    Bug fix: -i failed in Unix without an input file.	      *
+*		    Version 3.3.					      *
+*    2026-10-18 JFL Added options -a and -rules, to replace several strings   *
+*		    in a single pass, with one automaton for all of them.     *
+*		    Version 3.4.					      *
+*    2026-10-18 JFL Added option -j N, to process large input files in        *
+*		    chunks in parallel threads in Unix. Version 3.5.	      *
+*    2026-10-18 JFL Use SysLib's rewrite routines for in-place updates.	      *
+*		    Unchanged files are now only read. Version 3.5.1.	      *
+*    2026-10-18 JFL Added options -r, -x, -X to process whole directory       *
+*		    trees, with -j N files in parallel. Version 3.6.	      *
+*    2026-10-18 JFL Added option --pipe to chain other filters in-process.    *
+*		    Version 3.7.					      *
+*    2026-10-18 JFL Match every -a and -rules old string with the same rules  *
+*		    as a single old string: Greedy repeats that never give    *
+*		    back, and empty matches replaced. Version 3.7.1.	      *
 *		    							      *
 *         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -167,8 +189,8 @@
 
 #define PROGRAM_DESCRIPTION "Replace substrings in a stream"
 #define PROGRAM_NAME    "remplace"
-#define PROGRAM_VERSION "3.2.4"
-#define PROGRAM_DATE    "2022-10-19"
+#define PROGRAM_VERSION "3.7.1"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include "predefine.h" /* Define optional features we need in the C libraries */
 
@@ -187,6 +209,8 @@
 /* SysToolsLib include files */
 #include "debugm.h"	/* SysToolsLib debug macros. Include first. */
 #include "mainutil.h"	/* SysLib helper routines for main() */
+#include "rewrite.h"	/* SysLib safe in-place file rewrite */
+#include "textfilt.h"	/* SysLib text filters */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
 #define SZ 255               /* Strings size */
@@ -235,12 +259,8 @@ DEBUG_GLOBALS			/* Define global variables used by our debugging macros */
 
 #define SAMENAME strieq		/* File name comparison routine */
 
-/* Workaround for a linker bug in DOS, which is case independant.
-   So for DOS, FGetC is the same as fgetc. */
-#define FGetC FGetC1
-#define FPutC FOutC1
-#define FSeek FSeek1
-#define FWrite FWrite1
+#define BLOCK_SIZE 0x4000	/* Keep buffers small in the 64KB data segment */
+#define DFA_MAX_STATES 24	/* Idem for the multiple strings automaton */
 
 #endif /* defined(_MSDOS) */
 
@@ -262,10 +282,14 @@ DEBUG_GLOBALS			/* Define global variables used by our debugging macros */
 #define DIRSEPARATOR_CHAR '/'
 #define DIRSEPARATOR_STRING "/"
 
-#define DEVNUL "/dev/nul"
+#define DEVNUL "/dev/null"
 
 #define SAMENAME streq		/* File name comparison routine */
 
+#define HAS_PARALLEL 1		/* Process large files in parallel threads */
+#include <pthread.h>
+#include <sys/mman.h>
+
 #endif /* defined(__unix__) */
 
 /************************* MinGW-specific definitions ************************/
@@ -280,6 +304,20 @@ DEBUG_GLOBALS			/* Define global variables used by our debugging macros */
 
 /********************** End of OS-specific definitions ***********************/
 
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 0x40000	/* Input block size */
+#endif
+#ifndef DFA_MAX_STATES
+#define DFA_MAX_STATES 2048	/* Max # of states cached in the multiple strings automaton */
+#endif
+
+#ifndef HAS_PARALLEL
+#define HAS_PARALLEL 0
+#endif
+#define PARALLEL_MIN_SIZE 0x400000	/* Smaller files are processed sequentially */
+#define PARALLEL_MIN_CHUNK 0x100000	/* Chunk size limits */
+#define PARALLEL_MAX_CHUNK 0x4000000
+
 #ifdef _MSC_VER
 #pragma warning(disable:4001) /* Ignore the "nonstandard extension 'single line comment' was used" warning */
 #endif
@@ -300,8 +338,78 @@ void fail(char *pszFormat, ...) {
 /* Global variables */
 
 int iVerbose = FALSE;
+int iUnbuffered = FALSE;	    /* TRUE = Process data as soon as it's read */
+int iJobs = 0;			    /* Number of threads for large files, or -r files. 0=Default */
 FILE *mf;			    /* Message output file */
 
+/* Compiled old string */
+
+typedef struct {
+  char abSet[256];		    /* abSet[c] = TRUE if c is in the set */
+  char cRepeat;			    /* Either '?', '+', '*', or NUL */
+} RXSET;
+
+typedef struct {
+  int nSets;			    /* Number of sets. 0 = Copy the input as is */
+  RXSET *pSets;			    /* Array of sets to match in sequence */
+  int iFirstSize;		    /* Number of characters in the first set */
+  char cFirst;			    /* The first set character if it's alone */
+} RXPAT;
+
+/* MatchAt() results */
+#define RX_NOMATCH 0		    /* No match at this position */
+#define RX_MATCH 1		    /* A match of *pnMatch characters */
+#define RX_MATCH_SKIP 2		    /* Idem, and the next character is not to be matched */
+#define RX_MATCH_EOF 3		    /* A final match at the end of the input */
+#define RX_PARTIAL 4		    /* A partial match at the end of the input */
+#define RX_MORE 5		    /* More data is needed to decide */
+
+/* Multiple old_string new_string pairs, compiled into a single automaton */
+
+typedef struct {
+  char szOld[SZ];		    /* The old string */
+  char szNew[SZ];		    /* The new string, with \ sequences converted */
+  int iNewSize;			    /* The new string size */
+} RXRULE;
+
+typedef struct {
+  int nRules;			    /* Number of rules */
+  RXRULE *pRules;		    /* The rules, in the priority order */
+  int nNfa;			    /* Number of NFA states */
+  RXSET *pNfa;			    /* NFA states. cRepeat is NUL, '?', or '*' */
+  int *piRule;			    /* Rule # for the accepting NFA states, else -1 */
+  int nWords;			    /* Number of words in a bitmap of NFA states */
+  unsigned int *puStart;	    /* Bitmap of the initial NFA states */
+  int nDfa;			    /* Number of DFA states built so far */
+  int nResets;			    /* Number of times the DFA was reset */
+  unsigned int *puSets;		    /* Bitmap of NFA states for each DFA state */
+  int *piNext;			    /* 256 transitions per DFA state. -1 = Unknown yet */
+  int *piSkip;			    /* Rule # whose match ends before each transition char */
+  int *piAccept;		    /* Rule # accepted in each DFA state, else -1 */
+  int *piEOF;			    /* Rule # accepted if the input ends in each state, else -1 */
+  char *pbLive;			    /* TRUE if a rule may still match more in each state */
+  int *piHash;			    /* Hash table of the DFA states. -1 = Free */
+  unsigned int *puTemp;		    /* Work areas */
+  unsigned int *puSave;
+  char abFirst[256];		    /* abFirst[c] = TRUE if c can begin a match */
+  int iFirstSize;		    /* Number of characters that can begin a match */
+  char cFirst;			    /* The first character if it's alone */
+} RXMULTI;
+
+#define DFA_DEAD 0		    /* The state that matches nothing more */
+#define DFA_START 1		    /* The initial state */
+
+/* The operation to do on every file, for ReplaceStream() */
+
+typedef struct {
+  RXPAT *pPat;			    /* The compiled old string, or */
+  RXMULTI *pM;			    /* the rules if any. Each thread compiles its own DFA */
+  char cRepeat;
+  char *new;
+  int iNewSize;
+  int demime;			    /* '=' or '%' = Decode Mime or URL codes first */
+} REPLOPTS;
+
 /* Forward references */
 
 void usage(int err);		    /* Display a brief help and exit */
@@ -309,16 +417,34 @@ int is_redirected(FILE *f);	    /* Check if a file handle is the console */
 int GetEscChar(char *pszIn, char *pc); /* Get one escaped character */
 int GetRxCharSet(char *pszOld, char cSet[256], int *piSetSize, char *pcRepeat);
 int GetEscChars(char *pBuf, char *pszFrom, size_t iSize);
-int InitBackBuf(char *psz0);
-int FGetC(FILE *f);
-int FSeek(FILE *f, long lOffset, int iOrigin);
-int FPutC(int c, FILE *f);
-size_t FWrite(const void *buf, size_t size, size_t count, FILE *f);
 char *EscapeChar(char *pBuf, char c);
 int PrintEscapeChar(FILE *f, char c);
 int PrintEscapeString(FILE *f, char *pc);
-void MakeRoom(char **ppOut, int *piSize, int iNeeded);
-int MergeMatches(char *new, int iNewSize, char *match, int nMatch, char **ppOut);
+int CompileRx(char *pszOld, char cRepeat, RXPAT *pPat);
+int MatchAt(RXPAT *pPat, char *pBuf, size_t nBuf, int bEOF, size_t *pnMatch);
+size_t ReplaceBlock(RXPAT *pPat, char *pBuf, size_t nBuf, int bEOF,
+		    char *new, int iNewSize, FILE *df, long *plnChanges);
+size_t DemimeBlock(char *pBuf, size_t nDone, size_t *pnBuf, int bEOF,
+		   char cMime, long *plnChanges);
+size_t ReadBlock(FILE *sf, char *pBuf, size_t nSize, int *pbEOF);
+void WriteMerged(char *new, int iNewSize, char *match, size_t nMatch, FILE *df);
+int AddRule(RXMULTI *pM, char *pszOld, char *pNew, int iNewSize);
+int LoadRules(RXMULTI *pM, char *pszName);
+int CompileMulti(RXMULTI *pM, char cRepeat);
+unsigned int DfaHash(unsigned int *puSet, int nWords);
+int DfaAdd(RXMULTI *pM, unsigned int *puSet);
+void DfaReset(RXMULTI *pM);
+int DfaNext(RXMULTI *pM, int iState, unsigned char c, int *piSkip);
+size_t ReplaceMultiBlock(RXMULTI *pM, char *pBuf, size_t nBuf, int bEOF,
+			 FILE *df, long *plnChanges);
+void FreeMulti(RXMULTI *pM);
+int ReplaceLoop(FILE *sf, FILE *df, REPLOPTS *pro, RXMULTI *pM, char *pBuf,
+		size_t lBuf, size_t nBuf, int bEOF, long *plnChanges);
+long ReplaceStream(FILE *sf, FILE *df, void *pRef);
+#if HAS_PARALLEL
+int ReplaceParallel(FILE *sf, off_t offStart, FILE *df, RXPAT *pPat, RXMULTI *pM,
+		    char cRepeat, char *new, int iNewSize, long *plnChanges);
+#endif
 int IsSameFile(char *pszPathname1, char *pszPathname2);
 int file_exists(const char *); 	/* Does this file exist? (TRUE/FALSE) */
 
@@ -342,22 +468,26 @@ int file_exists(const char *); 	/* Does this file exist? (TRUE/FALSE) */
 \*---------------------------------------------------------------------------*/
 
 int main(int argc, char *argv[]) {
-  int c;		    /* Current character */
   char old[SZ] = "";	    /* old string, to be replaced by the new string */
   char new[SZ] = "";	    /* New string, to replace the old string */
-  char *maybe=malloc(SZ);   /* Possible matching input */
-  int iMaybeSize = SZ;
   int oldDone = FALSE;
   int newDone = FALSE;
   int iNewSize = 0;	    /* length of the new string */
-  int ixOld;		    /* Index in the old string */
-  int ixMaybe = 0;	    /* Index in the maybe string */
+  RXPAT pat;		    /* The compiled old string */
+  RXMULTI multi = {0};	    /* The compiled -a and -rules strings */
+  char *pBuf;		    /* Input buffer */
+  size_t lBuf;		    /* Size of the input buffer */
+  size_t nBuf = 0;	    /* Number of bytes in the input buffer */
+  int bEOF = FALSE;	    /* TRUE = The end of the input has been reached */
+  int bDone = FALSE;	    /* TRUE = All the input has been processed */
+  char *pszInitText = NULL; /* The -i option text */
   FILE *sf = NULL;	    /* Source file handle */
   FILE *df = NULL;	    /* Destination file handle */
   int i;
   char *pszInName = NULL;
   char *pszOutName = NULL;
-  char *pszTmpName = NULL;
+  REWRITE *pRw = NULL;		/* Safe in-place rewrite context */
+  int iWritten = TRUE;		/* FALSE if the out file was left unchanged */
   char szBakName[FILENAME_MAX+1];
   int iSameFile = FALSE;    /*  Backup the input file, and modify it in place. */
   int iCopyTime = FALSE;    /*  If true, set the out file time = in file time. */
@@ -366,9 +496,7 @@ int main(int argc, char *argv[]) {
   long lnChanges = 0;	    /*  Number of changes done */
   int iQuiet = FALSE;
   int iBackup = FALSE;
-  char cSet[256];	    /*  Character set to match */
-  int iSetSize;		    /*  Number of valid characters in the set. */
-  char cRepeat = '\0';	    /*  Repeat character. Either '?', '+', '*', or NUL. */
+  char cRepeat = '\0';	    /*  '\xFF' = Fixed string. NUL = Regular expression */
   int iOptionI = FALSE;	    /*  TRUE = -i option specified */
   int iEOS = FALSE;	    /*  TRUE = End Of Switches */
   char *pszPathCopy = NULL;
@@ -376,6 +504,14 @@ int main(int argc, char *argv[]) {
   char *pszOld8 = old;
   char *pszNew8 = new;
   int iErr;
+  REPLOPTS ro;		    /* The operation to do */
+  char **ppszArgs;	    /* Arguments that are not switches nor strings */
+  int nArgs = 0;
+  int iRecurse = FALSE;	    /* Process matching files in the current dir tree */
+  filterTreeOpts fto = {0}; /* FilterTree() options */
+  TEXTPIPE *pPipe = NULL;   /* In-process pipeline of other filters */
+  int iPipe = FALSE;	    /* TRUE if the output goes through pPipe */
+  FILE *pfOut = NULL;	    /* The actual output, when df feeds pPipe */
 
   /* Open a new message file stream for debug and verbose messages */
   if (is_redirected(stdout)) {	/* If stdout is redirected to a file or a pipe */
@@ -394,6 +530,10 @@ int main(int argc, char *argv[]) {
 
   /* Process arguments */
 
+  ppszArgs = calloc(argc, sizeof(char *));
+  fto.ppszExclude = calloc(argc, sizeof(char *));
+  if ((!ppszArgs) || (!fto.ppszExclude)) goto fail_no_mem;
+
   for (i=1; i<argc; i++) {
     char *pszArg = argv[i];
     if ((!iEOS) && IsSwitch(pszArg)) {          /* Process switches first */
@@ -428,6 +568,19 @@ int main(int argc, char *argv[]) {
 	/* Useful for adding comments in a Windows pipe */
 	break;
       }
+      if (strieq(pszOpt, "a")) {	/* Add another old_string new_string pair */
+	char szNew[SZ];
+	if ((i+2) >= argc) usage(2);
+	if (oldDone && !newDone) usage(2);
+	if (oldDone && !multi.nRules) {	/* Then this was the first pair */
+	  if (AddRule(&multi, old, new, iNewSize)) goto fail_no_mem;
+	}
+	if (AddRule(&multi, argv[i+1], szNew, GetEscChars(szNew, argv[i+2], sizeof(szNew)))) goto fail_no_mem;
+	i += 2;
+	oldDone = TRUE;
+	newDone = TRUE;
+	continue;
+      }
       if (   strieq(pszOpt, "b")
 	  || strieq(pszOpt, "bak")
 	  || strieq(pszOpt, "-bak")) {
@@ -446,14 +599,28 @@ int main(int argc, char *argv[]) {
 	continue;
       }
       if (strieq(pszOpt, "i")) {
-	iErr = InitBackBuf(argv[++i]);
-	if (iErr) {
-fail_no_mem:
-	  FAIL("Not enough memory");
-	}
+	if ((i+1) >= argc) usage(2);
+	pszInitText = argv[++i];
 	iOptionI = TRUE;
 	continue;
       }
+#if HAS_PARALLEL
+      if (strieq(pszOpt, "j")) {	/* Process large files, or -r files, in parallel */
+	if ((i+1) >= argc) usage(2);
+	iJobs = atoi(argv[++i]);
+	if (iJobs < 1) {		/* 0 = Use all CPUs */
+	  long nCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+	  iJobs = (nCPUs > 0) ? (int)nCPUs : 1;
+	}
+	continue;
+      }
+#endif
+      if (streq(pszOpt, "-pipe")) {	/* The rest of the line is the pipeline */
+	pPipe = TextPipeNew(argc-i, argv+i);
+	if (!pPipe) return 2;
+	iPipe = TRUE;
+	break;
+      }
       if (strieq(pszOpt, "nb")) {
 	iBackup = FALSE;
 	continue;
@@ -467,6 +634,22 @@ fail_no_mem:
 	iQuiet = TRUE;
 	continue;
       }
+      if (streq(pszOpt, "r") || strieq(pszOpt, "-recurse")) {
+	iRecurse = TRUE;
+	continue;
+      }
+      if (   strieq(pszOpt, "rules")
+	  || strieq(pszOpt, "-rules")) {	/* Read old_string new_string pairs from a file */
+	if ((i+1) >= argc) usage(2);
+	if (oldDone && !newDone) usage(2);
+	if (oldDone && !multi.nRules) {	/* Then this was the first pair */
+	  if (AddRule(&multi, old, new, iNewSize)) goto fail_no_mem;
+	}
+	if (LoadRules(&multi, argv[++i])) goto fail_no_mem;
+	oldDone = TRUE;
+	newDone = TRUE;
+	continue;
+      }
       if (   streq(pszOpt, "=")
 	  || strieq(pszOpt, "same")
 	  || strieq(pszOpt, "-same")) {
@@ -477,6 +660,10 @@ fail_no_mem:
 	iCopyTime = TRUE;
 	continue;
       }
+      if (strieq(pszOpt, "u")) {
+	iUnbuffered = TRUE;
+	continue;
+      }
       if (streq(pszOpt, "v")) {
 	iVerbose = TRUE;
 	continue;
@@ -485,6 +672,15 @@ fail_no_mem:
 	puts(DETAILED_VERSION);
 	exit(0);
       }
+      if (streq(pszOpt, "x")) {
+	if ((i+1) >= argc) usage(2);
+	fto.ppszExclude[fto.nExclude++] = argv[++i];
+	continue;
+      }
+      if (streq(pszOpt, "X")) {
+	fto.iFlags |= FT_NOEXEC;
+	continue;
+      }
       /* Default: Assume it's not a switch, but a string to replace */
     }
     if (!oldDone) {
@@ -497,19 +693,20 @@ fail_no_mem:
       newDone = TRUE;
       continue;
     }
-    /* It's not a switch, it's an argument */
-    if (!pszInName) {
-      pszInName = pszArg;
-      continue;
-    }
-    if (!pszOutName) {
-      pszOutName = pszArg;
-      continue;
-    }
-    usage(2);		    /* Error: Too many arguments */
+    /* It's not a switch, it's an argument. Or a file name pattern with -r */
+    ppszArgs[nArgs++] = pszArg;
   }
 
   if (!oldDone && !demime) usage(2);
+  if (!iRecurse) {
+    if (nArgs > 2) usage(2);	    /* Error: Too many arguments */
+    if (nArgs > 0) pszInName = ppszArgs[0];
+    if (nArgs > 1) pszOutName = ppszArgs[1];
+  } else if (pszInitText) {
+    fail("Option -i cannot be used with -r");
+  } else if (iPipe) {
+    fail("Options -r and --pipe are incompatible");
+  }
 
   /* Report what the message stream is */
   DEBUG_CODE(
@@ -520,6 +717,29 @@ fail_no_mem:
     }
   )
 
+  ro.pPat = &pat;
+  ro.pM = &multi;
+  ro.cRepeat = cRepeat;
+  ro.new = new;
+  ro.iNewSize = iNewSize;
+  ro.demime = demime;
+
+  if (iRecurse) { /* Process all matching files in the current directory tree */
+    if ((!multi.nRules) && CompileRx(old, cRepeat, &pat)) goto fail_no_mem;
+    if (iVerbose && !iQuiet) fto.iFlags |= FT_VERBOSE;
+    fto.nThreads = iJobs;
+    fto.ppszInclude = ppszArgs;
+    fto.nInclude = nArgs;
+    iErr = FilterTree(".", &fto, ReplaceStream, &ro);
+    if (!(fto.iFlags & FT_NOEXEC) && !iQuiet) {
+      fflush(stdout);		/* Display the list of files changed first */
+      fprintf(mf, "%ld files changed, out of %ld", fto.nChanged, fto.nFiles);
+      if (iVerbose) fprintf(mf, ". %ld changes done", fto.lnChanges);
+      fprintf(mf, "\n");
+    }
+    return iErr ? 2 : ((fto.nChanged > 0) ? 0 : 1);
+  }
+
   /* Force stdin and stdout to untranslated */
 #if defined(_MSDOS) || defined(_WIN32)
   _setmode( _fileno( stdin ), _O_BINARY );
@@ -550,8 +770,7 @@ fail_no_mem:
     iSameFile = IsSameFile(pszInName, pszOutName);
     if (iBackup && !file_exists(pszOutName)) iBackup = FALSE; /* There's nothing to backup */
   }
-  if (iSameFile || iBackup) { /* Then write to a temporary file */
-    int iFile;
+  if (iSameFile || iBackup) { /* Then rewrite it safely, only if it changes */
     /* But do as if we were writing directly to the target file.
        Test the write rights before wasting time on the conversion */
     df = fopen(pszOutName, "r+");
@@ -559,18 +778,10 @@ fail_no_mem:
     fclose(df);
     df = NULL;
     /* OK, we have write rights, so go ahead with the conversion */
-    DEBUG_FPRINTF((mf, "// %s. Writing to a temp file.\n", iSameFile ? "In and out files are the same" : "Backup requested"));
+    DEBUG_FPRINTF((mf, "// %s. Rewriting the out file.\n", iSameFile ? "In and out files are the same" : "Backup requested"));
     pszPathCopy = strdup(pszOutName);
     if (!pszPathCopy) goto fail_no_mem;
     pszDirName = dirname(pszPathCopy);
-    pszTmpName = strdup(pszDirName);
-    if (pszTmpName) pszTmpName = realloc(pszTmpName, strlen(pszTmpName)+10);
-    if (!pszTmpName) goto fail_no_mem;
-    strcat(pszTmpName, DIRSEPARATOR_STRING "dtXXXXXX");
-    iFile = mkstemp(pszTmpName);
-    if (iFile == -1) fail("Can't create temporary file %s. %s\n", pszTmpName, strerror(errno));
-    df = fdopen(iFile, "wb+");
-    if (!df) goto open_df_failed;
     if (iBackup) { /* Create the name of an *.bak file in the same directory */
       char *pszNameCopy = strdup(pszOutName);
       char *pszBaseName = basename(pszNameCopy);
@@ -589,6 +800,9 @@ fail_no_mem:
       strcat(szBakName, ".bak");	/* Set extension to .bak */
       free(pszNameCopy);		/* We don't need that copy anymore */
     }
+    pRw = RewriteOpen(pszOutName, iBackup ? szBakName : NULL);
+    if (!pRw) goto open_df_failed;
+    df = RewriteStream(pRw);
   } else {
     DEBUG_FPRINTF((mf, "// Writing directly to the out file.\n"));
   }
@@ -600,6 +814,25 @@ open_df_failed:
       fail("Can't write to file %s. %s\n", pszOutName, strerror(errno));
     }
   }
+  if (pPipe) {			/* Pass the output through the other filters */
+    pfOut = df;
+    df = TextPipeOpen(pPipe, pfOut);
+    if (!df) fail("Can't start the pipeline. %s", strerror(errno));
+  }
+
+  /* Read the first block, after the optional -i text */
+  lBuf = BLOCK_SIZE;
+  if (pszInitText) {
+    nBuf = strlen(pszInitText);
+    lBuf += nBuf;
+  }
+  pBuf = malloc(lBuf);
+  if (!pBuf) {
+fail_no_mem:
+    FAIL("Not enough memory");
+  }
+  if (nBuf) memcpy(pBuf, pszInitText, nBuf);
+  nBuf += ReadBlock(sf, pBuf+nBuf, lBuf-nBuf, &bEOF);
 
   /* Identify the input encoding, and change the arguments encoding to match it */
 #ifdef _WIN32
@@ -613,10 +846,8 @@ open_df_failed:
     err = fstat(h, &buf);		/* Get information on that handle */
     if (err) fail("Can't stat the input file.\n");
     if (buf.st_mode & S_IFREG) {	/* It's a regular file */
-      for (nc=0; nc<3; nc++) {
-        int c1 = FGetC(sf);
-        if (c1 == EOF) break;
-        ((BYTE *)&dwBOM)[nc] = (BYTE)c1;
+      for (nc=0; (nc<3) && ((size_t)nc<nBuf); nc++) {
+        ((BYTE *)&dwBOM)[nc] = (BYTE)pBuf[nc];
       }
       if (dwBOM == 0xBFBBEF) {		/* If this is an UTF-8 BOM */
       	inputCP = CP_UTF8;
@@ -627,7 +858,6 @@ open_df_failed:
       	inputCP = CP_ACP;
       }
     }
-    FSeek(sf, -nc, SEEK_CUR); /* Return to the beginning of the input file */
     DEBUG_FPRINTF((mf, "// The input encoding is #%d\n", inputCP));
     /* Now we need to convert the old and new strings to the input encoding */
     pszOld8 = strdup(old);
@@ -635,6 +865,13 @@ open_df_failed:
     ConvertString(old, sizeof(old), CP_UTF8, inputCP);
     ConvertString(new, sizeof(new), CP_UTF8, inputCP);
     iNewSize = (int)strlen(new);
+    ro.iNewSize = iNewSize;
+    for (i=0; i<multi.nRules; i++) {
+      RXRULE *pRule = multi.pRules + i;
+      ConvertString(pRule->szOld, sizeof(pRule->szOld), CP_UTF8, inputCP);
+      ConvertString(pRule->szNew, sizeof(pRule->szNew), CP_UTF8, inputCP);
+      pRule->iNewSize = (int)strlen(pRule->szNew);
+    }
   }
 #endif
 
@@ -647,180 +884,61 @@ open_df_failed:
       PrintEscapeString(mf, new);
       fprintf(mf, "\").\n");
     }
-  }
-
-  ixOld = 0;
-  ixOld += GetRxCharSet(old+ixOld, cSet, &iSetSize, &cRepeat);
-  ixMaybe = 0;
-
-  while ((c = FGetC(sf)) != EOF) {	 /* Read chars until End of file */
-    if (demime && (c == demime)) {
-      char c0, c1, sz[3];
-      int ic;
-
-      if ((c0 = (char)FGetC(sf)) == EOF) {
-	FPutC(c, df);
-	break;
-      }
-      /* At the end of a line, it signals a broken line. Merge halves. */
-      if (c0 == 0x0A) {
-	/*  ~~jfl 2003-09-23 Added support for Unix-style files. Don't output anything. */
-	lnChanges += 1;
-	continue;
-      }
-      if ((c1 = (char)FGetC(sf)) == EOF) {
-	FPutC(c, df);
-	FPutC((char)c0, df);
-	break;
-      }
-      /* At the end of a line, it signals a broken line. Merge halves. */
-      if ((c0 == 0x0D) && (c1 == 0x0A)) {
-	/*  ~~jfl 1999-08-02 Don't output anything. */
-	lnChanges += 1;
-	continue;
-      }
-      /* Else it's an ASCII code */
-      sz[0] = (char)c0;
-      sz[1] = (char)c1;
-      sz[2] = '\0';
-      DEBUG_FPRINTF((mf, "// Found code %s: ", sz));
-      if (sscanf(sz, "%X", &ic)) {
-	DEBUG_FPRINTF((mf, "Changed to char %c.\n", ic));
-	FPutC((char)ic, df);
-	lnChanges += 1;
-      } else {
-	DEBUG_FPRINTF((mf, "Not a valid code.\n"));
-	FPutC('=', df);
-	FWrite(sz, 2, 1, df);
-      }
-      continue;
+    for (i=0; (i<multi.nRules) && !iQuiet; i++) {
+      fprintf(mf, "// Rule #%d: Replacing \"", i+1);
+      PrintEscapeString(mf, multi.pRules[i].szOld);
+      fprintf(mf, "\" with \"");
+      PrintEscapeString(mf, multi.pRules[i].szNew);
+      fprintf(mf, "\".\n");
     }
+  }
 
-try_next_set:
-    DEBUG_CODE_IF_ON(
-      char cBuf[8];
-      fprintf(mf, "// Trying to match '%s' in set [", EscapeChar(cBuf, (char)c));
-      for (i=0; i<iSetSize; i++) PrintEscapeChar(mf, cSet[i]);
-      fprintf(mf, "]%s ... ", cRepeat ? EscapeChar(cBuf, cRepeat) : "");
-    );
+  if (multi.nRules) {
+    if (CompileMulti(&multi, cRepeat)) goto fail_no_mem;
+  } else {
+    if (CompileRx(old, cRepeat, &pat)) goto fail_no_mem;
+  }
 
-    if (memchr(cSet, c, iSetSize)) {	/* If c belongs to the old string */
-      DEBUG_CODE_IF_ON(
-	char cBuf[8];
-	fprintf(mf, "Match! Next is old[%d]='%s'\n", ixOld, EscapeChar(cBuf, old[ixOld]));
-      )
+#if HAS_PARALLEL
+  if ((iJobs > 1) && !demime && !pszInitText) { /* The input file offset before the first block */
+    off_t offStart = ftello(sf) - (off_t)nBuf;
+    bDone = !ReplaceParallel(sf, offStart, df, &pat, &multi, cRepeat, new, iNewSize, &lnChanges);
+  }
+#endif
 
-      MakeRoom(&maybe, &iMaybeSize, ixMaybe+1); /*  If needed, extend the buffer */
-      maybe[ixMaybe++] = (char)c;		/* Save the matching character */
-      if (cRepeat == '?') cRepeat = '\0'; /* We've found it. No more expected. */
-      if (cRepeat == '+') cRepeat = '*';  /* We've found it. More possible. */
-      if (cRepeat == '*') continue;
-      if (!old[ixOld]) {                  /* and if it is the last char. of the string to replace */
-	char *new2;
-	int iNewSize2 = MergeMatches(new, iNewSize, maybe, ixMaybe, &new2);
-	FWrite(new2, iNewSize2, 1, df);       /* then write new string */
-	free(new2);
-	lnChanges += 1;
-	ixOld = 0;                      /* and start over again. */
-	ixMaybe = 0;
-      }
-    } else {              /* Else it is an unexpected char. */
-      DEBUG_CODE_IF_ON(
-	char cBuf[8];
-	fprintf(mf, "No match. Next is old[%d]='%s'\n", ixOld, EscapeChar(cBuf, old[ixOld]));
-      )
-
-      if ((cRepeat == '?') || (cRepeat == '*')) {
-	if (old[ixOld]) {
-	  ixOld += GetRxCharSet(old+ixOld, cSet, &iSetSize, &cRepeat);
-	  goto try_next_set;
-	} else {		    /* The set was complete. Write the new string */
-	  char *new2;
-	  int iNewSize2 = MergeMatches(new, iNewSize, maybe, ixMaybe, &new2);
-	  FWrite(new2, iNewSize2, 1, df);       /* then write new string */
-	  free(new2);
-	  lnChanges += 1;
-	}
-	ixMaybe = 0;
-      }
-      if (ixMaybe) {                  /* If there were pending characters */
-	/*  ~~jfl 2002-11-28 In case of a partial match, output 1 character only, and look for another match starting on the next. */
-	FSeek(sf, -ixMaybe, SEEK_CUR); /*  Backtrack to the 2nd input character */
-	MakeRoom(&maybe, &iMaybeSize, ixMaybe+1); /*  If needed, extend the buffer */
-	maybe[ixMaybe++] = (char)c;
-	c = maybe[0];
-      }
-      ixOld = 0;
-      ixMaybe = 0;
-      FPutC(c, df);	    /* Then output the given character. */
-    }
-    ixOld += GetRxCharSet(old+ixOld, cSet, &iSetSize, &cRepeat);
+  if (bDone) {
+    free(pBuf);
+  } else {
+    if (ReplaceLoop(sf, df, &ro, &multi, pBuf, lBuf, nBuf, bEOF, &lnChanges)) goto fail_no_mem;
   }
-  DEBUG_FPRINTF((mf, "// End of file. Flushing remainders.\n"));
-  if (((cRepeat == '?') || (cRepeat == '*')) && !old[ixOld]) {
-    /* The set was complete. Write the new string */
-    char *new2;
-    int iNewSize2 = MergeMatches(new, iNewSize, maybe, ixMaybe, &new2);
-    FWrite(new2, iNewSize2, 1, df);       /* then write new string */
-    free(new2);
-    lnChanges += 1;
-  } else if (ixOld) {
-    FWrite(maybe, ixMaybe, 1, df); /* Flush an uncompleted old string */
+  DEBUG_FPRINTF((mf, "// End of file.\n"));
+  if (pPipe) {
+    if (TextPipeClose(pPipe)) fail("Pipeline failed. %s", strerror(errno));
+    df = pfOut;
   }
 
   if (sf != stdin) fclose(sf);
-  if (df != stdout) fclose(df);
-  DEBUG_FPRINTF((mf, "// Writing done\n"));
-
-  if (iSameFile && !lnChanges) { /* Nothing changed */
-    iErr = unlink(pszTmpName); 	/* Remove the temporary output file */
-  } else {
-    if (iSameFile || iBackup) {
-      if (iBackup) {	/* Create an *.bak file in the same directory */
-#if !defined(_MSVCLIBX_H_)
-        DEBUG_FPRINTF((mf, "unlink(\"%s\");\n", szBakName));
-#endif
-	iErr = unlink(szBakName); 	/* Remove the .bak if already there */
-	if ((iErr == -1) && (errno != ENOENT)) {
-	  fail("Can't delete file %s. %s\n", szBakName, strerror(errno));
-	}
-	DEBUG_FPRINTF((mf, "rename(\"%s\", \"%s\");\n", pszOutName, szBakName));
-	iErr = rename(pszOutName, szBakName);	/* Rename the source as .bak */
-	if (iErr == -1) {
-	  fail("Can't backup %s. %s\n", pszOutName, strerror(errno));
-	}
-      } else {		/* iSameFile==TRUE && iBackup==FALSE. Don't keep a backup of the input file */
-#if !defined(_MSVCLIBX_H_)
-	DEBUG_FPRINTF((mf, "unlink(\"%s\");\n", pszInName));
-#endif
-	iErr = unlink(pszInName); 	/* Remove the original file */
-	if (iErr == -1) {
-	  fail("Can't delete file %s. %s\n", pszInName, strerror(errno));
-	}
-      }
-      DEBUG_FPRINTF((mf, "rename(\"%s\", \"%s\");\n", pszTmpName, pszOutName));
-      iErr = rename(pszTmpName, pszOutName); /* Rename the temporary file as the destination */
-      if (iErr == -1) {
-	fail("Can't create %s. %s\n", pszOutName, strerror(errno));
-      }
-    }
-
+  if (pRw) {	/* Replace the out file, if its content changed */
+    iErr = RewriteClose(pRw, lnChanges || iPipe || !iSameFile);
+    if (iErr == -1) fail("Can't update %s. %s\n", pszOutName, strerror(errno));
+    iWritten = iErr;
+  } else if (df != stdout) {
+    int iMode = sInTime.st_mode;
+    fclose(df);
     /* Copy the file mode flags */
-    if (df != stdout) {
-      int iMode = sInTime.st_mode;
-      DEBUG_PRINTF(("chmod(\"%s\", 0x%X);\n", pszOutName, iMode));
-      iErr = chmod(pszOutName, iMode); /* Try making the target file writable */
-      DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
-    }
+    DEBUG_PRINTF(("chmod(\"%s\", 0x%X);\n", pszOutName, iMode));
+    iErr = chmod(pszOutName, iMode); /* Try making the target file writable */
+    DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
+  }
+  DEBUG_FPRINTF((mf, "// Writing done\n"));
 
-    /* Optionally copy the timestamp */
-    if (!lnChanges) iCopyTime = TRUE; /* Always set the same time if there was no data change */
-    if ((sf != stdin) && (df != stdout) && iCopyTime) {
-      struct utimbuf sOutTime = {0};
-      sOutTime.actime = sInTime.st_atime;
-      sOutTime.modtime = sInTime.st_mtime;
-      utime(pszOutName, &sOutTime);
-    }
+  /* Optionally copy the timestamp */
+  if (!lnChanges && !iPipe) iCopyTime = TRUE; /* Always set the same time if there was no data change */
+  if ((sf != stdin) && (df != stdout) && iCopyTime && iWritten) {
+    struct utimbuf sOutTime = {0};
+    sOutTime.actime = sInTime.st_atime;
+    sOutTime.modtime = sInTime.st_mtime;
+    utime(pszOutName, &sOutTime);
   }
 
   if (iVerbose) fprintf(mf, "// Remplace: %ld changes done.\n", lnChanges);
@@ -886,11 +1004,14 @@ void usage(int err) {
   fprintf(f,
 PROGRAM_NAME_AND_VERSION " - " PROGRAM_DESCRIPTION "\n\
 \n\
-Usage: remplace [SWITCHES] OPERATIONS [FILES_SPEC]\n\
+Usage: remplace [SWITCHES] OPERATIONS [FILES_SPEC] [--pipe STAGE [ARGS]]...\n\
+       remplace [SWITCHES] -r OPERATIONS [PATTERN ...]\n\
 \n\
 files_spec: [INFILE [OUTFILE|-same]]\n\
   INFILE   Input file pathname. Default or \"-\": stdin\n\
-  OUTFILE  Output file pathname. Default or \"-\": stdout\n");
+  OUTFILE  Output file pathname. Default or \"-\": stdout\n\
+  PATTERN  With -r, wildcards pattern for the names of the files to process.\n\
+           Default: All files\n");
     fprintf(f, "%s", "\
 \n\
 operation: {old_string new_string}|-@|-%|-.\n\
@@ -898,6 +1019,15 @@ operation: {old_string new_string}|-@|-%|-.\n\
   -%       Decode URL %XX codes.\n\
   -.       No change.\n\
 \n\
+Repeated characters are matched greedily, and never given back: a*ab never\n\
+matches. When a match ending with c? or c* stops on a character that is not c,\n\
+that character is not tested again as the beginning of another match.\n\
+Empty matches, like [ab]* before other characters, are replaced too.\n\
+Several pairs can be replaced in a single pass, using switches -a or -rules.\n\
+Each old string matches with the same rules as alone. At the first position\n\
+where any old string matches, the longest match is replaced. If several old\n\
+strings match the same length, the first one wins.\n\
+\n\
 Note that the input is byte-oriented, not line oriented. So both the old\n\
 string and new string can span multiple lines.\n\
 \n\
@@ -905,6 +1035,7 @@ switches:\n\
   -#       Ignore all further arguments.\n\
   -?|-h    Display this brief help screen.\n\
   --       End of switches.\n\
+  -a OLD NEW  Add another old_string new_string pair\n\
   -b|-bak  Create an *.bak backup file of existing output files\n"
 #ifdef _DEBUG
 "\
@@ -912,12 +1043,28 @@ switches:\n\
 #endif
 "\
   -f       Fixed old string = Disable the regular expression subset supported.\n\
-  -i TEXT  Input text to use before input file, if any. (Use - for force stdin)\n\
+  -i TEXT  Input text to use before input file, if any. (Use - for force stdin)\n"
+#if HAS_PARALLEL
+"\
+  -j N     Process large input files in N parallel threads. 0=One per CPU.\n\
+           Only if no old string can match a \\n, else this is ignored.\n\
+           With -r, process N files in parallel. Default: One per CPU.\n"
+#endif
+"\
   -q       Quiet mode. No status message.\n\
+  -r       Modify in place the matching files in the current directory tree\n\
+  -rules FILE  Add old_string<Tab>new_string pairs from FILE, one per line.\n\
+           Use the same \\ escape sequences as on the command line.\n\
   -=|-same Modify the input file in place. (Default: Automatically detected)\n\
   -st      Set the output file time to the same time as the input file.\n\
-  -v       Verbose mode.\n\
+  -u       Unbuffered. Output the data processed after every input read.\n\
+  -v       Verbose mode. With -r, display the names of the files changed.\n\
   -V       Display this program version\n\
+  -x PATTERN  With -r, skip the files and directories matching PATTERN\n\
+  -X       With -r, display the names of the files to process, and stop\n\
+  --pipe STAGE [ARGS]  Pass the output through another filter, in-process.\n\
+           Must be last. May be repeated. STAGE [ARGS] = trim | detab [N]\n\
+           | deffeed [LINES_PER_PAGE [TAB_SIZE]] | dump\n\
 \n\
 Examples:\n"
 );
@@ -1263,224 +1410,1130 @@ int PrintEscapeString(FILE *f, char *pc)
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
-|   Function:	    FGetC	         				      |
+|   Function:	    ReadBlock	         				      |
 |									      |
-|   Description:    Get a character from a file stream.			      |
+|   Description:    Read a block of input data				      |
 |									      |
-|   Parameters:     FILE *f		    The stream handle		      |
+|   Parameters:     FILE *sf		    The input stream		      |
+|		    char *pBuf		    Where to store the data	      |
+|		    size_t nSize	    The buffer size		      |
+|		    int *pbEOF		    Set to TRUE at the end of input   |
 |									      |
-|   Returns:	    The character read, or EOF.				      |
+|   Returns:	    The number of bytes read.				      |
 |									      |
-|   Notes:	    This is a front end to the standard C library fgetc().    |
-|		    The goal is to allow limited backtracking even on the     |
-|		     standard input stream.				      |
+|   Notes:	    By default, fill the whole buffer, to minimize the number |
+|		    of passes on the data.				      |
+|		    In unbuffered mode, return whatever the pipe or console   |
+|		    has available, so that output appears in real time.       |
 |									      |
 |   History:								      |
-|    2005-06-10 JFL Created this routine.				      |
-|    2008-12-02 JFL Fixed a bug in FSeek, which would not detect seek errors. |
-|    2008-12-10 JFL Updated the fix, which was buggy.                         |
+|    2026-10-18 JFL Created this routine.				      |
 *									      *
 \*---------------------------------------------------------------------------*/
 
+size_t ReadBlock(FILE *sf, char *pBuf, size_t nSize, int *pbEOF) {
+  size_t nRead;
+
+  if (*pbEOF) return 0;
+  if (iUnbuffered) {
+    int iRead;
+    do {
+      iRead = (int)read(fileno(sf), pBuf, (unsigned int)((nSize > BLOCK_SIZE) ? BLOCK_SIZE : nSize));
+    } while ((iRead == -1) && (errno == EINTR));
+    if (iRead == -1) fail("Can't read the input. %s\n", strerror(errno));
+    nRead = (size_t)iRead;
+    if (!nRead) *pbEOF = TRUE;
+  } else {
+    nRead = fread(pBuf, 1, nSize, sf);
+    if (nRead < nSize) {
+      if (ferror(sf)) fail("Can't read the input. %s\n", strerror(errno));
+      *pbEOF = TRUE;
+    }
+  }
+  return nRead;
+}
 
-char *pszBackBuf = NULL;/* Address of a circular back buffer */
-char *pszBBEnd;		/* Back buffer end = First address beyond the last character */
-char *pszBBHead;	/* Where to store the next chatacter that will be read */
-char *pszBBTail;	/* Oldest character in the back buffer */
-size_t lBB = 0;		/* Length of back buffer */
-size_t nBB;		/* Number of characters stored in the back buffer */
-size_t ixBB;		/* Current position relative to (backwards from) the head */
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    CompileRx	         				      |
+|									      |
+|   Description:    Convert the old string into a list of character sets      |
+|									      |
+|   Parameters:     char *pszOld	    The old string		      |
+|		    char cRepeat	    '\xFF' = Fixed string	      |
+|		    RXPAT *pPat		    Where to store the sets	      |
+|									      |
+|   Returns:	    0=Success, else error				      |
+|									      |
+|   Notes:	    Parse the old string once, instead of calling	      |
+|		    GetRxCharSet() again for every input character.	      |
+|		    An empty old string compiles to 0 sets, which copies the  |
+|		    input unchanged.					      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
 
-char *BBWrap(char *p) {	/* Wrap the pointer, to make sure it remains in the circular buffer */
-  while (p < pszBackBuf) p += lBB;
-  while (p >= pszBBEnd) p -= lBB;
-  return p;
-}
+int CompileRx(char *pszOld, char cRepeat, RXPAT *pPat) {
+  char cSet[256];
+  int iSetSize;
+  int ix = 0;
+  int i;
 
-int InitBackBuf(char *psz0) { /* Returns 0=Success, else error */
-  ixBB = nBB = strlen(psz0);
-  lBB = max(nBB, 1024);
-  if (!pszBackBuf) {
-    pszBackBuf = malloc(lBB);
-    if (!pszBackBuf) return 1;
+  pPat->nSets = 0;
+  pPat->pSets = malloc((strlen(pszOld)+1) * sizeof(RXSET));
+  if (!pPat->pSets) return 1;
+  while (pszOld[ix]) {
+    RXSET *pSet = pPat->pSets + pPat->nSets++;
+    ix += GetRxCharSet(pszOld+ix, cSet, &iSetSize, &cRepeat);
+    memset(pSet->abSet, 0, sizeof(pSet->abSet));
+    for (i=0; i<iSetSize; i++) pSet->abSet[(unsigned char)cSet[i]] = TRUE;
+    pSet->cRepeat = (cRepeat == '\xFF') ? '\0' : cRepeat;
+    if (pPat->nSets == 1) {
+      pPat->iFirstSize = iSetSize;
+      pPat->cFirst = cSet[0];
+    }
+    DEBUG_CODE_IF_ON(
+      char cBuf[8];
+      fprintf(mf, "// Set #%d [", pPat->nSets);
+      for (i=0; i<iSetSize; i++) PrintEscapeChar(mf, cSet[i]);
+      fprintf(mf, "]%s\n", pSet->cRepeat ? EscapeChar(cBuf, pSet->cRepeat) : "");
+    );
   }
-  pszBBEnd = pszBackBuf + lBB;
-  strncpy(pszBackBuf, psz0, nBB);
-  pszBBTail = pszBackBuf;
-  pszBBHead = BBWrap(pszBackBuf + nBB);
   return 0;
 }
 
-int FGetC(FILE *f) {
-  if (!pszBackBuf) InitBackBuf("");
-  if (!pszBackBuf) return EOF;
-  if (!ixBB) {
-    int iRet = fgetc(f);
-    if (iRet == EOF) return iRet;
-    if (nBB == lBB) pszBBTail = BBWrap(pszBBTail + 1); /*  Drop one from the tail. */
-    *pszBBHead = (char)iRet;
-    pszBBHead = BBWrap(pszBBHead + 1);
-    if (nBB < lBB) nBB += 1;
-    return iRet;
-  } else {
-    return *BBWrap(pszBBHead-(ixBB--));
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    MatchAt	         				      |
+|									      |
+|   Description:    Match the compiled old string at a given position	      |
+|									      |
+|   Parameters:     RXPAT *pPat		    The compiled old string	      |
+|		    char *pBuf		    The data to match		      |
+|		    size_t nBuf		    The number of bytes available     |
+|		    int bEOF		    TRUE if no more data will follow  |
+|		    size_t *pnMatch	    Where to store the match length   |
+|									      |
+|   Returns:	    One of the RX_XXX results.				      |
+|									      |
+|   Notes:	    Follows exactly the same rules as the character by	      |
+|		    character algorithm used up to version 3.2:		      |
+|		    - Repeated sets are greedy, and never give back.	      |
+|		    - A match that ends because a character did not match a   |
+|		      trailing ?|* set does not try matching that character.  |
+|		    - At the end of the input, a partial match is output as   |
+|		      is, unless the current set is the last and optional.    |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine, based on the old main loop.	      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int MatchAt(RXPAT *pPat, char *pBuf, size_t nBuf, int bEOF, size_t *pnMatch) {
+  int iSet = 0;
+  int iLast = pPat->nSets - 1;
+  RXSET *pSet = pPat->pSets;
+  char cRepeat = pSet->cRepeat;
+  size_t n = 0;
+
+  for (;;) {
+    if (n == nBuf) {
+      if (!bEOF) return RX_MORE;
+      *pnMatch = n;
+      if ((iSet == iLast) && ((cRepeat == '?') || (cRepeat == '*'))) return RX_MATCH_EOF;
+      return RX_PARTIAL;
+    }
+    if (pSet->abSet[(unsigned char)pBuf[n]]) { /* This character belongs to the set */
+      n += 1;
+      if (cRepeat == '?') cRepeat = '\0'; /* We've found it. No more expected. */
+      if (cRepeat == '+') cRepeat = '*';  /* We've found it. More possible. */
+      if (cRepeat == '*') continue;
+      if (iSet == iLast) {
+	*pnMatch = n;
+	return RX_MATCH;
+      }
+    } else {				/* Else it is an unexpected character */
+      if ((cRepeat != '?') && (cRepeat != '*')) return RX_NOMATCH;
+      if (iSet == iLast) {		/* The set was complete */
+	*pnMatch = n;
+	return RX_MATCH_SKIP;
+      }
+      /* Else try the same character with the next set */
+    }
+    pSet = pPat->pSets + (++iSet);
+    cRepeat = pSet->cRepeat;
   }
 }
 
-int FSeek(FILE *f, long lOffset, int iOrigin) {
-  if (iOrigin == SEEK_CUR) {
-    if (lOffset >= 0) {
-      long l;
-      for (l=0; l<lOffset; l++) FGetC(f);
-      return fseek(f, 0, SEEK_CUR);
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    ReplaceBlock         				      |
+|									      |
+|   Description:    Replace all matches of the old string in a block of data  |
+|									      |
+|   Parameters:     RXPAT *pPat		    The compiled old string	      |
+|		    char *pBuf		    The data to process		      |
+|		    size_t nBuf		    The number of bytes available     |
+|		    int bEOF		    TRUE if no more data will follow  |
+|		    char *new		    The new string		      |
+|		    int iNewSize	    The new string size		      |
+|		    FILE *df		    The output stream		      |
+|		    long *plnChanges	    Incremented for every change      |
+|									      |
+|   Returns:	    The number of bytes processed. The rest must be passed    |
+|		    again with the next block, as it may begin a match.       |
+|									      |
+|   Notes:	    When the first set is mandatory, candidate positions are  |
+|		    found with memchr() or a table lookup, and the runs of    |
+|		    data in between are written with a single fwrite().       |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+size_t ReplaceBlock(RXPAT *pPat, char *pBuf, size_t nBuf, int bEOF,
+		    char *new, int iNewSize, FILE *df, long *plnChanges) {
+  size_t n = 0;
+  size_t nMatch = 0;
+  int iSkip;
+  char *abFirst;
+
+  if (!pPat->nSets) {			/* Nothing to match */
+    if (nBuf) fwrite(pBuf, nBuf, 1, df);
+    return nBuf;
+  }
+
+  abFirst = pPat->pSets[0].abSet;
+  iSkip = (pPat->pSets[0].cRepeat != '?') && (pPat->pSets[0].cRepeat != '*');
+  for (;;) {
+    if (iSkip) { /* Skip the characters that cannot begin a match */
+      size_t n0 = n;
+      if (pPat->iFirstSize == 1) {
+	char *pc = memchr(pBuf+n, pPat->cFirst, nBuf-n);
+	n = pc ? (size_t)(pc - pBuf) : nBuf;
+      } else {
+	while ((n < nBuf) && !abFirst[(unsigned char)pBuf[n]]) n++;
+      }
+      if (n > n0) fwrite(pBuf+n0, n-n0, 1, df);
+    }
+    if ((n == nBuf) && !bEOF) return n;
+    switch (MatchAt(pPat, pBuf+n, nBuf-n, bEOF, &nMatch)) {
+    case RX_MORE:
+      return n;
+    case RX_PARTIAL:			/* Flush an uncompleted old string */
+      if (nMatch) fwrite(pBuf+n, nMatch, 1, df);
+      return nBuf;
+    case RX_MATCH_EOF:
+      WriteMerged(new, iNewSize, pBuf+n, nMatch, df);
+      *plnChanges += 1;
+      return nBuf;
+    case RX_MATCH:
+      WriteMerged(new, iNewSize, pBuf+n, nMatch, df);
+      *plnChanges += 1;
+      n += nMatch;
+      break;
+    case RX_MATCH_SKIP:
+      WriteMerged(new, iNewSize, pBuf+n, nMatch, df);
+      *plnChanges += 1;
+      n += nMatch;
+      fputc(pBuf[n++], df);
+      break;
+    default: /* RX_NOMATCH */
+      fputc(pBuf[n++], df);
+      break;
     }
-    ixBB += (size_t)-lOffset;
-    if (ixBB <= nBB) return 0; /* Success */
-    /* Else error, not enough data recorded for this move. */
   }
-  InitBackBuf(""); /* Clear the whole back buffer */
-  return 1; /* Error, unsupported */
 }
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
-|   Function:	    FPutC	         				      |
+|   Function:	    AddRule	         				      |
+|									      |
+|   Description:    Add an old_string new_string pair to the rules list       |
+|									      |
+|   Parameters:     RXMULTI *pM		    The rules list		      |
+|		    char *pszOld	    The old string		      |
+|		    char *pNew		    The new string, already unescaped |
+|		    int iNewSize	    The new string size		      |
+|									      |
+|   Returns:	    0=Success, else error				      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int AddRule(RXMULTI *pM, char *pszOld, char *pNew, int iNewSize) {
+  RXRULE *pRule;
+
+  if (!pszOld[0]) return 0;		/* An empty old string never matches */
+  pRule = realloc(pM->pRules, (pM->nRules + 1) * sizeof(RXRULE));
+  if (!pRule) return 1;
+  pM->pRules = pRule;
+  pRule += pM->nRules++;
+  strncpy(pRule->szOld, pszOld, SZ-1);
+  pRule->szOld[SZ-1] = '\0';
+  memcpy(pRule->szNew, pNew, iNewSize);
+  if (iNewSize < SZ) pRule->szNew[iNewSize] = '\0';
+  pRule->iNewSize = iNewSize;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    LoadRules	         				      |
 |									      |
-|   Description:    Output a character to a file stream.		      |
+|   Description:    Read old_string new_string pairs from a rules file	      |
 |									      |
-|   Parameters:     char c		    The character to output	      |
-|		    FILE *f		    The output stream handle	      |
+|   Parameters:     RXMULTI *pM		    The rules list		      |
+|		    char *pszName	    The rules file pathname	      |
 |									      |
-|   Returns:	    The character written, or EOF.			      |
+|   Returns:	    0=Success, else error				      |
 |									      |
-|   Notes:	    This is a front end to the standard C library fputc().    |
-|		    The difference is that this one flushes the output at     |
-|		    the end of every line for the console and pipes.	      |
-|		    Useful to see output in real time in long complex cmds.   |
-|		    Output to stdout is assumed to be to a console or pipe.   |
+|   Notes:	    One OLD<Tab>NEW pair per line, with the same \ escape     |
+|		    sequences as on the command line. Empty lines, and lines  |
+|		    beginning with a #, are ignored. Use \# for a leading #.  |
 |									      |
 |   History:								      |
-|    2010-12-19 JFL Created this routine.				      |
+|    2026-10-18 JFL Created this routine.				      |
 *									      *
 \*---------------------------------------------------------------------------*/
 
-int FPutC(int c, FILE *f) {
-  int ret = fputc(c, f);
-  if ((f == stdout) && (ret != EOF) && (c == '\n')) {
-    fflush(f);
+int LoadRules(RXMULTI *pM, char *pszName) {
+  FILE *f;
+  char szLine[4*SZ];
+  char new[SZ];
+  int iLine = 0;
+
+  f = fopen(pszName, "r");
+  if (!f) fail("Can't open file %s. %s\n", pszName, strerror(errno));
+  while (fgets(szLine, sizeof(szLine), f)) {
+    char *pc;
+    iLine += 1;
+    szLine[strcspn(szLine, "\r\n")] = '\0';
+    if ((!szLine[0]) || (szLine[0] == '#')) continue;
+    pc = strchr(szLine, '\t');
+    if (!pc) fail("No tab in %s line %d\n", pszName, iLine);
+    *(pc++) = '\0';
+    while (*pc == '\t') pc++;
+    if (AddRule(pM, szLine, new, GetEscChars(new, pc, sizeof(new)))) {
+      fclose(f);
+      return 1;
+    }
   }
-  return ret;
+  fclose(f);
+  return 0;
 }
 
-size_t FWrite(const void *buf, size_t size, size_t count, FILE *f) {
-  size_t ret = fwrite(buf, size, count, f);
-  size *= ret; /* The total size actually written */
-  if ((f == stdout) && size && memchr(buf, '\n', size)) {
-    fflush(f);
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    CompileMulti         				      |
+|									      |
+|   Description:    Compile all rules into a single automaton		      |
+|									      |
+|   Parameters:     RXMULTI *pM		    The rules list		      |
+|		    char cRepeat	    '\xFF' = Fixed strings	      |
+|									      |
+|   Returns:	    0=Success, else error				      |
+|									      |
+|   Notes:	    All rules are first converted to a single NFA, with one   |
+|		    state per character set, plus one accepting state per     |
+|		    rule. c+ sets are expanded as c c*.			      |
+|		    Every rule follows the same rules as MatchAt(), so it     |
+|		    has at most one active NFA state: A * state only stays on |
+|		    its set, and ? and * states are only skipped, to the next |
+|		    state, for characters that do not belong to them.	      |
+|		    The DFA states are then built lazily while matching, by   |
+|		    DfaNext(). Each DFA state is a bitmap of NFA states.      |
+|		    If the DFA grows too large, it is reset and built again.  |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#define UBITS (8 * sizeof(unsigned int))
+#define BITSET(pu, i) ((pu)[(i) / UBITS] |= 1U << ((i) % UBITS))
+#define BITTEST(pu, i) ((pu)[(i) / UBITS] & (1U << ((i) % UBITS)))
+
+int CompileMulti(RXMULTI *pM, char cRepeat) {
+  int iRule;
+  int i, n;
+  RXPAT pat;
+  unsigned int *puStart;
+
+  /* Count the NFA states */
+  for (iRule=0, n=0; iRule<pM->nRules; iRule++) {
+    if (CompileRx(pM->pRules[iRule].szOld, cRepeat, &pat)) return 1;
+    for (i=0; i<pat.nSets; i++) n += (pat.pSets[i].cRepeat == '+') ? 2 : 1;
+    n += 1;				/* The accepting state */
+    free(pat.pSets);
   }
-  return ret;
+  pM->nNfa = n;
+  pM->pNfa = calloc(n, sizeof(RXSET));
+  pM->piRule = malloc(n * sizeof(int));
+  if (!pM->pNfa || !pM->piRule) return 1;
+
+  /* Build the NFA */
+  pM->nWords = (int)((n + UBITS - 1) / UBITS);
+  puStart = calloc(pM->nWords, sizeof(unsigned int));
+  if (!puStart) return 1;
+  for (iRule=0, n=0; iRule<pM->nRules; iRule++) {
+    if (CompileRx(pM->pRules[iRule].szOld, cRepeat, &pat)) return 1;
+    BITSET(puStart, n);
+    for (i=0; i<pat.nSets; i++) {
+      pM->pNfa[n] = pat.pSets[i];
+      pM->piRule[n++] = -1;
+      if (pat.pSets[i].cRepeat == '+') { /* c+ = c c* */
+	pM->pNfa[n-1].cRepeat = '\0';
+	pM->pNfa[n] = pat.pSets[i];
+	pM->pNfa[n].cRepeat = '*';
+	pM->piRule[n++] = -1;
+      }
+    }
+    pM->piRule[n++] = iRule;		/* The accepting state. Its set is empty. */
+    free(pat.pSets);
+  }
+
+  /* Allocate the DFA tables */
+  pM->puSets = malloc(DFA_MAX_STATES * pM->nWords * sizeof(unsigned int));
+  pM->piNext = malloc(DFA_MAX_STATES * 256 * sizeof(int));
+  pM->piSkip = malloc(DFA_MAX_STATES * 256 * sizeof(int));
+  pM->piAccept = malloc(DFA_MAX_STATES * sizeof(int));
+  pM->piEOF = malloc(DFA_MAX_STATES * sizeof(int));
+  pM->pbLive = malloc(DFA_MAX_STATES);
+  pM->piHash = malloc(2 * DFA_MAX_STATES * sizeof(int));
+  pM->puTemp = malloc(pM->nWords * sizeof(unsigned int));
+  pM->puSave = malloc(pM->nWords * sizeof(unsigned int));
+  if (   !pM->puSets || !pM->piNext || !pM->piSkip || !pM->piAccept || !pM->piEOF
+      || !pM->pbLive || !pM->piHash || !pM->puTemp || !pM->puSave) return 1;
+  memset(pM->puTemp, 0, pM->nWords * sizeof(unsigned int));
+  pM->puStart = puStart;
+  DfaReset(pM);
+
+  /* Find the characters that can begin a match, possibly an empty one */
+  for (i=0, n=0; i<256; i++) {
+    int iSkip;
+    pM->abFirst[i] = (char)(DfaNext(pM, DFA_START, (unsigned char)i, &iSkip) != DFA_DEAD);
+    if (iSkip >= 0) pM->abFirst[i] = TRUE;
+    if (pM->abFirst[i]) {
+      n += 1;
+      pM->cFirst = (char)i;
+    }
+  }
+  pM->iFirstSize = n;
+
+  DEBUG_FPRINTF((mf, "// Compiled %d rules into %d NFA states\n", pM->nRules, pM->nNfa));
+  return 0;
 }
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
-|   Function:	    MakeRoom	         				      |
+|   Function:	    FreeMulti	         				      |
 |									      |
-|   Description:    Make sure a buffer is larger than a minimal size	      |
+|   Description:    Free the automaton built by CompileMulti()		      |
 |									      |
-|   Parameters:     							      |
+|   Parameters:     RXMULTI *pM		    The compiled rules		      |
 |									      |
 |   Returns:	    Nothing						      |
 |									      |
-|   Notes:	    							      |
+|   Notes:	    The rules list itself is not freed.			      |
 |									      |
 |   History:								      |
-|    2012-02-29 JFL Created this routine.				      |
+|    2026-10-18 JFL Created this routine.				      |
 *									      *
 \*---------------------------------------------------------------------------*/
 
-void MakeRoom(char **ppOut, int *piSize, int iNeeded) {
-  if (iNeeded > *piSize) {
-    *piSize = iNeeded+80;
-    DEBUG_FPRINTF((mf, "// Reallocing buffer 0x%p to size %u\n", *ppOut, *piSize));
-    *ppOut = realloc(*ppOut, *piSize);
-    if (!*ppOut) {
-      fprintf(stderr, "Error: not enough memory.\n");
-      exit(1);
+void FreeMulti(RXMULTI *pM) {
+  free(pM->pNfa);
+  free(pM->piRule);
+  free(pM->puStart);
+  free(pM->puSets);
+  free(pM->piNext);
+  free(pM->piSkip);
+  free(pM->piAccept);
+  free(pM->piEOF);
+  free(pM->pbLive);
+  free(pM->piHash);
+  free(pM->puTemp);
+  free(pM->puSave);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    DfaReset, DfaAdd, DfaNext				      |
+|									      |
+|   Description:    Manage the lazily built DFA				      |
+|									      |
+|   Notes:	    DfaAdd() returns the DFA state for a bitmap of NFA states.|
+|		    DfaNext() returns the DFA state after a given character,  |
+|		    and the first rule whose match ends just before it, if    |
+|		    reaching its accepting state required skipping ? or *     |
+|		    states that this character does not belong to.	      |
+|		    State 0 is the dead state, and state 1 the start state.   |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created these routines.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+unsigned int DfaHash(unsigned int *puSet, int nWords) {
+  unsigned int h = 2166136261U;
+  while (nWords--) h = (h ^ *(puSet++)) * 16777619U;
+  return h;
+}
+
+int DfaAdd(RXMULTI *pM, unsigned int *puSet) {
+  int i, iState;
+  unsigned int h;
+  size_t lSet = pM->nWords * sizeof(unsigned int);
+  unsigned int *pu;
+
+  /* Look for an existing DFA state with the same NFA states */
+  h = DfaHash(puSet, pM->nWords) % (2 * DFA_MAX_STATES);
+  for ( ; (iState = pM->piHash[h]) != -1; h = (h + 1) % (2 * DFA_MAX_STATES)) {
+    if (!memcmp(pM->puSets + iState * pM->nWords, puSet, lSet)) return iState;
+  }
+  if (pM->nDfa == DFA_MAX_STATES) {	/* The DFA is full. Start over. */
+    DEBUG_FPRINTF((mf, "// The DFA is full. Resetting it.\n"));
+    memcpy(pM->puSave, puSet, lSet);	/* puSet may be the work area */
+    DfaReset(pM);
+    return DfaAdd(pM, pM->puSave);
+  }
+  /* Create a new DFA state */
+  iState = pM->nDfa++;
+  pM->piHash[h] = iState;
+  pu = pM->puSets + iState * pM->nWords;
+  memcpy(pu, puSet, lSet);
+  for (i=0; i<256; i++) pM->piNext[iState * 256 + i] = -1;
+  pM->piAccept[iState] = -1;
+  pM->piEOF[iState] = -1;
+  pM->pbLive[iState] = FALSE;
+  for (i=0; i<pM->nNfa; i++) {
+    char c = pM->pNfa[i].cRepeat;
+    if (!BITTEST(pu, i)) continue;
+    if (pM->piRule[i] >= 0) {		/* An accepting state */
+      if (pM->piAccept[iState] < 0) pM->piAccept[iState] = pM->piRule[i]; /* The first rule wins ties */
+      continue;
+    }
+    pM->pbLive[iState] = TRUE;
+    /* Like MatchAt(), the input may only end in the last set if it's optional */
+    if (((c == '?') || (c == '*')) && (pM->piRule[i+1] >= 0) && (pM->piEOF[iState] < 0)) {
+      pM->piEOF[iState] = pM->piRule[i+1];
     }
   }
-  return;
+  return iState;
+}
+
+void DfaReset(RXMULTI *pM) {
+  int i;
+
+  pM->nDfa = 0;
+  pM->nResets += 1;
+  for (i=0; i<(2 * DFA_MAX_STATES); i++) pM->piHash[i] = -1;
+  memset(pM->puTemp, 0, pM->nWords * sizeof(unsigned int));
+  DfaAdd(pM, pM->puTemp);		/* State 0 = DFA_DEAD */
+  for (i=0; i<256; i++) pM->piNext[DFA_DEAD * 256 + i] = DFA_DEAD;
+  memcpy(pM->puTemp, pM->puStart, pM->nWords * sizeof(unsigned int));
+  DfaAdd(pM, pM->puTemp);		/* State 1 = DFA_START */
 }
-  
+
+int DfaNext(RXMULTI *pM, int iState, unsigned char c, int *piSkip) {
+  int iNext = pM->piNext[iState * 256 + c];
+  int iSkip = -1;
+  int nResets;
+  int i, j;
+  unsigned int *puSet;
+  unsigned int *puNext;
+
+  if (iNext >= 0) {
+    *piSkip = pM->piSkip[iState * 256 + c];
+    return iNext;
+  }
+
+  puSet = pM->puSets + iState * pM->nWords;
+  puNext = pM->puTemp;
+  memset(puNext, 0, pM->nWords * sizeof(unsigned int));
+  for (i=0; i<pM->nNfa; i++) {
+    if ((!BITTEST(puSet, i)) || (pM->piRule[i] >= 0)) continue; /* Accepting states end there */
+    for (j=i; ; j++) {
+      char cRepeat = pM->pNfa[j].cRepeat;
+      if (pM->pNfa[j].abSet[c]) {	/* Greedy: Stay on a * set, else go to the next */
+	BITSET(puNext, (cRepeat == '*') ? j : j+1);
+	break;
+      }
+      if ((cRepeat != '?') && (cRepeat != '*')) break; /* This rule does not match */
+      if (pM->piRule[j+1] >= 0) {	/* The optional last set is complete */
+	if ((iSkip < 0) || (pM->piRule[j+1] < iSkip)) iSkip = pM->piRule[j+1];
+	break;
+      }					/* Else try c with the next set */
+    }
+  }
+  nResets = pM->nResets;
+  iNext = DfaAdd(pM, puNext);
+  if (pM->nResets == nResets) {
+    pM->piNext[iState * 256 + c] = iNext;
+    pM->piSkip[iState * 256 + c] = iSkip;
+  }
+  *piSkip = iSkip;
+  return iNext;
+}
+
 /*---------------------------------------------------------------------------*\
 *                                                                             *
-|   Function:	    MergeMatches         				      |
+|   Function:	    ReplaceMultiBlock         				      |
 |									      |
-|   Description:    Build the output string based on regex and matches	      |
+|   Description:    Replace all matches of several rules in a block of data   |
 |									      |
-|   Parameters:     							      |
+|   Parameters:     RXMULTI *pM		    The compiled rules		      |
+|		    char *pBuf		    The data to process		      |
+|		    size_t nBuf		    The number of bytes available     |
+|		    int bEOF		    TRUE if no more data will follow  |
+|		    FILE *df		    The output stream		      |
+|		    long *plnChanges	    Incremented for every change      |
 |									      |
-|   Returns:	    The size of the output string			      |
+|   Returns:	    The number of bytes processed. The rest must be passed    |
+|		    again with the next block, as it may begin a match.       |
 |									      |
-|   Notes:	    							      |
+|   Notes:	    Every rule matches like a single old string in MatchAt(). |
+|		    At the first position where any rule matches, the longest |
+|		    match wins. If several rules match the same length, the   |
+|		    first one wins. Like in ReplaceBlock(), if that match     |
+|		    ended on a character that did not belong to its optional  |
+|		    last set, that character is output as is.		      |
 |									      |
 |   History:								      |
-|    2012-02-29 JFL Created this routine.				      |
+|    2026-10-18 JFL Created this routine.				      |
 *									      *
 \*---------------------------------------------------------------------------*/
 
-int MergeMatches(char *new, int iNewSize, char *match, int nMatch, char **ppOut) {
-  char *pOut = malloc(SZ);
-  int nOutSize = SZ;
-  char *pc;
-  int ixOut = 0;
-  int n;
-  
-  DEBUG_ENTER(("MergeMatches(\"%s\", %d, \"%.*s\", %d, 0x%p);\n", new, iNewSize, nMatch, match, nMatch, ppOut));
-
-  while (iNewSize) {
-    pc = memchr(new, '\\', iNewSize);
-    if (pc) {
-      n = (int)(pc - new);
+size_t ReplaceMultiBlock(RXMULTI *pM, char *pBuf, size_t nBuf, int bEOF,
+			 FILE *df, long *plnChanges) {
+  size_t n = 0;
+
+  for (;;) {
+    size_t n0 = n;
+    size_t nMatch = 0;
+    size_t m;
+    int iState = DFA_START;
+    int iRule = -1;
+    int iSkip;
+    int bSkip = FALSE;			/* TRUE if the match ended before pBuf[n+nMatch] */
+
+    /* Skip the characters that cannot begin a match */
+    if (pM->iFirstSize == 1) {
+      char *pc = memchr(pBuf+n, pM->cFirst, nBuf-n);
+      n = pc ? (size_t)(pc - pBuf) : nBuf;
     } else {
-      n = iNewSize;
+      while ((n < nBuf) && !pM->abFirst[(unsigned char)pBuf[n]]) n++;
     }
-    if (n) {
-      MakeRoom(&pOut, &nOutSize, ixOut+n);
-      memcpy(pOut + ixOut, new, n);
-      ixOut += n;
-      new += n;
-      iNewSize -= n;
-    }
-    if (pc) {
-      MakeRoom(&pOut, &nOutSize, ixOut+2);
-      switch (*(pc+1)) {
-      case '0': { /* Replace \0 by the full matching string */
-	memcpy(pOut + ixOut, match, nMatch);
-	ixOut += nMatch;
-	new = pc+2;
-	iNewSize -= 2;
-	break;
+    if (n > n0) fwrite(pBuf+n0, n-n0, 1, df);
+    if ((n == nBuf) && !bEOF) return n;
+
+    /* Run the DFA until no rule can match more, and remember the longest match */
+    for (m=n; m<nBuf; m++) {
+      iState = DfaNext(pM, iState, (unsigned char)pBuf[m], &iSkip);
+      if (   (iSkip >= 0)
+	  && ((iRule < 0) || (nMatch < (m - n)) || ((nMatch == (m - n)) && (iSkip < iRule)))) {
+	iRule = iSkip;
+	nMatch = m - n;
+	bSkip = TRUE;
       }
-      case '\\': /* Replace \\ by a single \ */
-      	pOut[ixOut++] = '\\';
-      	new += 2;
-	iNewSize -= 2;
-      	break;
-      default: /* Let any other \? sequence fall through unchanged */
-      	pOut[ixOut++] = *(new++);
-      	iNewSize -= 1;
-      	if (iNewSize) {
-	  pOut[ixOut++] = *(new++);
-	  iNewSize -= 1;
+      if (   (pM->piAccept[iState] >= 0)
+	  && ((iRule < 0) || (nMatch < (m + 1 - n)) || (pM->piAccept[iState] < iRule))) {
+	iRule = pM->piAccept[iState];
+	nMatch = m + 1 - n;
+	bSkip = FALSE;
+      }
+      if (!pM->pbLive[iState]) break;
+    }
+    if (m == nBuf) {			/* Some rules were still matching */
+      if (!bEOF) return n;		/* Need more data */
+      if (pM->piEOF[iState] >= 0) {	/* A rule matches up to the end of the input */
+	RXRULE *pRule = pM->pRules + pM->piEOF[iState];
+	if ((iRule < 0) || (nMatch < (nBuf - n)) || (pM->piEOF[iState] < iRule)) {
+	  WriteMerged(pRule->szNew, pRule->iNewSize, pBuf+n, nBuf-n, df);
+	  *plnChanges += 1;
+	  return nBuf;
 	}
+      }
+      if (n == nBuf) return n;		/* All done */
+    }
+
+    if (iRule >= 0) {
+      RXRULE *pRule = pM->pRules + iRule;
+      WriteMerged(pRule->szNew, pRule->iNewSize, pBuf+n, nMatch, df);
+      *plnChanges += 1;
+      n += nMatch;
+      if (bSkip) fputc(pBuf[n++], df);	/* This character can't begin a new match */
+    } else {
+      fputc(pBuf[n++], df);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    ReplaceParallel         				      |
+|									      |
+|   Description:    Process a large input file in chunks, in parallel threads |
+|									      |
+|   Parameters:     FILE *sf		    The input stream		      |
+|		    off_t offStart	    Where to start in the input file  |
+|		    FILE *df		    The output stream		      |
+|		    RXPAT *pPat		    The compiled old string, or	      |
+|		    RXMULTI *pM		    the compiled rules if any	      |
+|		    char cRepeat	    '\xFF' = Fixed strings	      |
+|		    char *new		    The new string		      |
+|		    int iNewSize	    The new string size		      |
+|		    long *plnChanges	    Incremented for every change      |
+|									      |
+|   Returns:	    0=Done; 1=Not possible, use the sequential mode instead.  |
+|									      |
+|   Notes:	    The input file is mapped in memory, and cut into chunks   |
+|		    ending with a \n. If no old string can match a \n, then   |
+|		    the sequential algorithms always begin a new match attempt|
+|		    right after every \n. So each chunk can be processed      |
+|		    independently, with exactly the same results.	      |
+|		    Otherwise, or for small files, return 1.		      |
+|		    Each chunk output goes to a memory stream, and the main   |
+|		    thread writes them in order. Workers only run a few chunks|
+|		    ahead of the writer, to limit the memory used.	      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#if HAS_PARALLEL
+
+typedef struct {
+  char *pData;			/* The chunk input data */
+  size_t nData;			/* The chunk input size */
+  char *pOut;			/* The chunk output data */
+  size_t nOut;			/* The chunk output size */
+  long lnChanges;		/* The number of changes in this chunk */
+  int iDone;			/* TRUE when the output is ready */
+} CHUNK;
+
+typedef struct {
+  pthread_mutex_t mutex;	/* Protects iNext, iWritten, and all iDone */
+  pthread_cond_t cond;		/* Signaled when a chunk is done, or written */
+  CHUNK *pChunks;		/* The list of chunks */
+  int nChunks;			/* Number of chunks */
+  int iNext;			/* Next chunk to process */
+  int iWritten;			/* Number of chunks written so far */
+  int nAhead;			/* Max # of chunks processed ahead of the writer */
+  RXPAT *pPat;			/* The compiled old string, or */
+  RXMULTI *pM;			/* the compiled rules if any */
+  char cRepeat;
+  char *new;
+  int iNewSize;
+} CHUNKPOOL;
+
+void *ReplaceWorker(void *pArg) {
+  CHUNKPOOL *pPool = pArg;
+  RXMULTI multi = {0};		/* Each thread needs its own lazy DFA */
+
+  if (pPool->pM->nRules) {
+    multi.nRules = pPool->pM->nRules;
+    multi.pRules = pPool->pM->pRules;
+    if (CompileMulti(&multi, pPool->cRepeat)) fail("Not enough memory");
+  }
+  for (;;) {
+    CHUNK *pChunk;
+    FILE *f;
+    size_t nDone;
+    int iLast;
+
+    pthread_mutex_lock(&pPool->mutex);
+    while (   (pPool->iNext < pPool->nChunks)
+	   && (pPool->iNext >= (pPool->iWritten + pPool->nAhead))) {
+      pthread_cond_wait(&pPool->cond, &pPool->mutex);
+    }
+    if (pPool->iNext == pPool->nChunks) {
+      pthread_mutex_unlock(&pPool->mutex);
+      break;
+    }
+    pChunk = pPool->pChunks + pPool->iNext++;
+    iLast = (pPool->iNext == pPool->nChunks);
+    pthread_mutex_unlock(&pPool->mutex);
+
+    f = open_memstream(&pChunk->pOut, &pChunk->nOut);
+    if (!f) fail("Not enough memory");
+    if (multi.nRules) {
+      nDone = ReplaceMultiBlock(&multi, pChunk->pData, pChunk->nData, iLast, f, &pChunk->lnChanges);
+    } else {
+      nDone = ReplaceBlock(pPool->pPat, pChunk->pData, pChunk->nData, iLast,
+			   pPool->new, pPool->iNewSize, f, &pChunk->lnChanges);
+    }
+    if (fclose(f)) fail("Not enough memory");
+    if (nDone != pChunk->nData) fail("Chunk #%d was not fully processed", (int)(pChunk - pPool->pChunks));
+
+    pthread_mutex_lock(&pPool->mutex);
+    pChunk->iDone = TRUE;
+    pthread_cond_broadcast(&pPool->cond);
+    pthread_mutex_unlock(&pPool->mutex);
+  }
+  if (multi.nRules) FreeMulti(&multi);
+  return NULL;
+}
+
+int ReplaceParallel(FILE *sf, off_t offStart, FILE *df, RXPAT *pPat, RXMULTI *pM,
+		    char cRepeat, char *new, int iNewSize, long *plnChanges) {
+  struct stat st;
+  char *pMap;
+  size_t nMap;
+  size_t nChunk;
+  size_t n;
+  int i;
+  int nThreads = iJobs;
+  CHUNKPOOL pool;
+  pthread_t *pThreads;
+
+  /* Check if it's possible and worth it */
+  if (fstat(fileno(sf), &st) || !S_ISREG(st.st_mode)) return 1;
+  if ((offStart < 0) || ((st.st_size - offStart) < PARALLEL_MIN_SIZE)) return 1;
+  if ((unsigned long long)st.st_size > (size_t)-1) return 1;
+  if (pM->nRules) {
+    for (i=0; i<pM->nNfa; i++) if (pM->pNfa[i].abSet['\n']) return 1;
+  } else {
+    for (i=0; i<pPat->nSets; i++) if (pPat->pSets[i].abSet['\n']) return 1;
+  }
+  nMap = (size_t)st.st_size;
+  pMap = mmap(NULL, nMap, PROT_READ, MAP_PRIVATE, fileno(sf), 0);
+  if (pMap == MAP_FAILED) return 1;
+#ifdef MADV_SEQUENTIAL
+  madvise(pMap, nMap, MADV_SEQUENTIAL);
+#endif
+
+  /* Cut the data in chunks ending with a \n */
+  nChunk = (nMap - (size_t)offStart) / (4 * nThreads);
+  if (nChunk < PARALLEL_MIN_CHUNK) nChunk = PARALLEL_MIN_CHUNK;
+  if (nChunk > PARALLEL_MAX_CHUNK) nChunk = PARALLEL_MAX_CHUNK;
+  pool.pChunks = NULL;
+  pool.nChunks = 0;
+  for (n=(size_t)offStart; n<nMap; ) {
+    size_t nEnd = n + nChunk;
+    CHUNK *pChunk;
+    if (nEnd >= nMap) {
+      nEnd = nMap;
+    } else {
+      char *pc = memchr(pMap+nEnd, '\n', nMap-nEnd);
+      nEnd = pc ? (size_t)(pc + 1 - pMap) : nMap;
+    }
+    pChunk = realloc(pool.pChunks, (pool.nChunks + 1) * sizeof(CHUNK));
+    if (!pChunk) fail("Not enough memory");
+    pool.pChunks = pChunk;
+    pChunk += pool.nChunks++;
+    memset(pChunk, 0, sizeof(CHUNK));
+    pChunk->pData = pMap + n;
+    pChunk->nData = nEnd - n;
+    n = nEnd;
+  }
+  if (nThreads > pool.nChunks) nThreads = pool.nChunks;
+  if (iVerbose) fprintf(mf, "// Processing %d chunks in %d threads\n", pool.nChunks, nThreads);
+
+  /* Start the worker threads */
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+  pool.iNext = 0;
+  pool.iWritten = 0;
+  pool.nAhead = 2 * nThreads;
+  pool.pPat = pPat;
+  pool.pM = pM;
+  pool.cRepeat = cRepeat;
+  pool.new = new;
+  pool.iNewSize = iNewSize;
+  pThreads = malloc(nThreads * sizeof(pthread_t));
+  if (!pThreads) fail("Not enough memory");
+  for (i=0; i<nThreads; i++) {
+    if (pthread_create(pThreads+i, NULL, ReplaceWorker, &pool)) {
+      if (!i) fail("Can't create threads. %s", strerror(errno));
+      nThreads = i;			/* Continue with fewer threads */
+      break;
+    }
+  }
+
+  /* Write the chunks output in order */
+  for (i=0; i<pool.nChunks; i++) {
+    CHUNK *pChunk = pool.pChunks + i;
+    pthread_mutex_lock(&pool.mutex);
+    while (!pChunk->iDone) pthread_cond_wait(&pool.cond, &pool.mutex);
+    pthread_mutex_unlock(&pool.mutex);
+    if (pChunk->nOut) fwrite(pChunk->pOut, pChunk->nOut, 1, df);
+    free(pChunk->pOut);
+    *plnChanges += pChunk->lnChanges;
+    pthread_mutex_lock(&pool.mutex);
+    pool.iWritten = i + 1;
+    pthread_cond_broadcast(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+  }
+
+  for (i=0; i<nThreads; i++) pthread_join(pThreads[i], NULL);
+  free(pThreads);
+  free(pool.pChunks);
+  pthread_cond_destroy(&pool.cond);
+  pthread_mutex_destroy(&pool.mutex);
+  munmap(pMap, nMap);
+  return 0;
+}
+
+#endif /* HAS_PARALLEL */
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    ReplaceLoop	         				      |
+|									      |
+|   Description:    Process the input stream block by block		      |
+|									      |
+|   Parameters:     FILE *sf		    The input stream		      |
+|		    FILE *df		    The output stream		      |
+|		    REPLOPTS *pro	    The operation to do		      |
+|		    RXMULTI *pM		    The compiled rules to use, if any |
+|		    char *pBuf		    The input buffer. Freed on exit.  |
+|		    size_t lBuf		    The input buffer size	      |
+|		    size_t nBuf		    Number of bytes already read      |
+|		    int bEOF		    TRUE if the input is all read     |
+|		    long *plnChanges	    Incremented for every change      |
+|									      |
+|   Returns:	    0=Success, else not enough memory			      |
+|									      |
+|   Notes:	    The main thread passes pro->pM. Other threads must pass   |
+|		    their own copy, as the lazy DFA is modified as it runs.   |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine, with the main loop of main().       |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int ReplaceLoop(FILE *sf, FILE *df, REPLOPTS *pro, RXMULTI *pM, char *pBuf,
+		size_t lBuf, size_t nBuf, int bEOF, long *plnChanges) {
+  size_t nDec = 0;	    /* Number of bytes ready for matching */
+  size_t nDone;		    /* Number of bytes processed */
+  int iErr = 0;
+
+  for (;;) {
+    /* Decode Mime or URL codes in place, then replace strings in the result */
+    if (pro->demime) {
+      nDec = DemimeBlock(pBuf, nDec, &nBuf, bEOF, (char)pro->demime, plnChanges);
+    } else {
+      nDec = nBuf;
+    }
+    if (pM->nRules) {
+      nDone = ReplaceMultiBlock(pM, pBuf, nDec, bEOF && (nDec == nBuf), df, plnChanges);
+    } else {
+      nDone = ReplaceBlock(pro->pPat, pBuf, nDec, bEOF && (nDec == nBuf), pro->new, pro->iNewSize, df, plnChanges);
+    }
+    if (bEOF && (nDec == nBuf)) break;
+    /* Keep the undecided tail, and append the next block */
+    nBuf -= nDone;
+    nDec -= nDone;
+    if (nDone && nBuf) memmove(pBuf, pBuf+nDone, nBuf);
+    if (iUnbuffered) fflush(df);
+    if (nBuf == lBuf) { /* A long partial match filled the whole buffer */
+      char *pBuf2 = NULL;
+      if (lBuf <= ((size_t)-1 / 2)) {
+	lBuf *= 2;
+	DEBUG_FPRINTF((mf, "// Extending the input buffer to %lu bytes\n", (unsigned long)lBuf));
+	pBuf2 = realloc(pBuf, lBuf);
+      }
+      if (!pBuf2) {
+	iErr = 1;
 	break;
       }
+      pBuf = pBuf2;
     }
+    nBuf += ReadBlock(sf, pBuf+nBuf, lBuf-nBuf, &bEOF);
   }
-  *ppOut = pOut;
+  free(pBuf);
+  return iErr;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    ReplaceStream        				      |
+|									      |
+|   Description:    Text filter doing the replacements in a whole stream      |
+|									      |
+|   Parameters:     FILE *sf		    The input stream		      |
+|		    FILE *df		    The output stream		      |
+|		    void *pRef		    REPLOPTS *pro. The operation      |
+|									      |
+|   Returns:	    The number of changes done, or -1 if error.		      |
+|									      |
+|   Notes:	    A SysLib pTextFilter_t, for FilterTree(), which may call  |
+|		    it in several threads at the same time.		      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
 
-  DEBUG_LEAVE(("return %d; // \"%.*s\"\n", ixOut, ixOut, pOut));
-  return ixOut;
+long ReplaceStream(FILE *sf, FILE *df, void *pRef) {
+  REPLOPTS *pro = pRef;
+  RXMULTI multi = {0};		/* Each thread needs its own lazy DFA */
+  long lnChanges = 0;
+  char *pBuf;
+  size_t nBuf;
+  int bEOF = FALSE;
+  int iErr = 1;
+
+  if (pro->pM->nRules) {
+    multi.nRules = pro->pM->nRules;
+    multi.pRules = pro->pM->pRules;
+    if (CompileMulti(&multi, pro->cRepeat)) goto cleanup;
+  }
+  pBuf = malloc(BLOCK_SIZE);
+  if (pBuf) {
+    nBuf = ReadBlock(sf, pBuf, BLOCK_SIZE, &bEOF);
+    iErr = ReplaceLoop(sf, df, pro, &multi, pBuf, BLOCK_SIZE, nBuf, bEOF, &lnChanges);
+  }
+cleanup:
+  if (multi.nRules) FreeMulti(&multi);
+  if (iErr) {
+    errno = ENOMEM;
+    return -1;
+  }
+  return lnChanges;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    DemimeBlock         				      |
+|									      |
+|   Description:    Decode Mime =XX or URL %XX codes in place		      |
+|									      |
+|   Parameters:     char *pBuf		    The data buffer		      |
+|		    size_t nDone	    Number of bytes already decoded   |
+|		    size_t *pnBuf	    Number of bytes in the buffer     |
+|		    int bEOF		    TRUE if no more data will follow  |
+|		    char cMime		    The code prefix. '=' or '%'	      |
+|		    long *plnChanges	    Incremented for every change      |
+|									      |
+|   Returns:	    The number of decoded bytes at the head of the buffer.    |
+|		    *pnBuf is updated, as the decoded data is shorter.	      |
+|									      |
+|   Notes:	    An incomplete code at the end of the buffer is left	      |
+|		    undecoded, until the next block is read.		      |
+|		    A code prefix at the end of a line joins the two lines.   |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine, based on the old main loop.	      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+size_t DemimeBlock(char *pBuf, size_t nDone, size_t *pnBuf, int bEOF,
+		   char cMime, long *plnChanges) {
+  char *pIn = pBuf + nDone;
+  char *pOut = pIn;
+  char *pEnd = pBuf + *pnBuf;
+  size_t n;
+
+  while (pIn < pEnd) {
+    char *pc = memchr(pIn, cMime, pEnd-pIn);
+    char sz[3];
+    int ic;
+
+    n = pc ? (size_t)(pc - pIn) : (size_t)(pEnd - pIn);
+    if (n && (pOut != pIn)) memmove(pOut, pIn, n);
+    pOut += n;
+    pIn += n;
+    if (!pc) break;
+    n = pEnd - pIn;
+    /* At the end of a line, it signals a broken line. Merge halves. */
+    if ((n >= 2) && (pIn[1] == '\n')) {
+      pIn += 2;
+      *plnChanges += 1;
+      continue;
+    }
+    if (n < 3) {
+      if (!bEOF) break;		/* Wait for the rest of the code */
+      while (pIn < pEnd) *(pOut++) = *(pIn++);
+      break;
+    }
+    if ((pIn[1] == '\r') && (pIn[2] == '\n')) {
+      pIn += 3;
+      *plnChanges += 1;
+      continue;
+    }
+    /* Else it's an ASCII code */
+    sz[0] = pIn[1];
+    sz[1] = pIn[2];
+    sz[2] = '\0';
+    if (sscanf(sz, "%X", &ic) == 1) {
+      *(pOut++) = (char)ic;
+      *plnChanges += 1;
+    } else {
+      DEBUG_FPRINTF((mf, "// Not a valid code: %c%s\n", cMime, sz));
+      *(pOut++) = pIn[0];
+      *(pOut++) = pIn[1];
+      *(pOut++) = pIn[2];
+    }
+    pIn += 3;
+  }
+  /* Move the undecoded tail behind the decoded data */
+  n = pEnd - pIn;
+  if (n && (pOut != pIn)) memmove(pOut, pIn, n);
+  *pnBuf = (size_t)(pOut - pBuf) + n;
+  return (size_t)(pOut - pBuf);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    WriteMerged         				      |
+|									      |
+|   Description:    Output the new string, with the matching input merged in  |
+|									      |
+|   Parameters:     char *new		    The new string		      |
+|		    int iNewSize	    The new string size		      |
+|		    char *match		    The matching input		      |
+|		    size_t nMatch	    The matching input size	      |
+|		    FILE *df		    The output stream		      |
+|									      |
+|   Returns:	    Nothing						      |
+|									      |
+|   Notes:	    \0 is replaced by the matching input, and \\ by a single \.|
+|		    Any other \ sequence is output unchanged.		      |
+|									      |
+|   History:								      |
+|    2012-02-29 JFL Created routine MergeMatches.			      |
+|    2026-10-18 JFL Renamed as WriteMerged, and write directly to the output, |
+|		    instead of building a copy in a new buffer.		      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void WriteMerged(char *new, int iNewSize, char *match, size_t nMatch, FILE *df) {
+  while (iNewSize > 0) {
+    char *pc = memchr(new, '\\', iNewSize);
+    int n = pc ? (int)(pc - new) : iNewSize;
+    if (n) {
+      fwrite(new, n, 1, df);
+      new += n;
+      iNewSize -= n;
+    }
+    if (!pc) break;
+    if (iNewSize < 2) { /* A trailing \ */
+      fputc('\\', df);
+      break;
+    }
+    switch (pc[1]) {
+    case '0': /* Replace \0 by the full matching string */
+      if (nMatch) fwrite(match, nMatch, 1, df);
+      break;
+    case '\\': /* Replace \\ by a single \ */
+      fputc('\\', df);
+      break;
+    default: /* Let any other \? sequence fall through unchanged */
+      fwrite(pc, 2, 1, df);
+      break;
+    }
+    new += 2;
+    iNewSize -= 2;
+  }
 }
 
 /*---------------------------------------------------------------------------*\
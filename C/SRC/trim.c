@@ -53,6 +53,17 @@
 *		    Version 2.1.2.					      *
 *    2022-10-19 JFL Moved IsSwitch() to SysLib. Version 2.1.3.		      *
 *    2022-12-12 JFL Removed the line size limitation. Version 2.1.4.	      *
+*    2026-10-18 JFL Moved the trimming loop to SysLib's TrimStream(), so that *
+*		    other programs can use it. Version 2.1.5.		      *
+*    2026-10-18 JFL Much faster, using the new block-based TrimStream().      *
+*		    Bug fix: The end of lines after a NUL byte was lost.      *
+*		    Version 2.2.					      *
+*    2026-10-18 JFL Use SysLib's rewrite routines for in-place updates.	      *
+*		    Unchanged files are now only read. Version 2.2.1.	      *
+*    2026-10-18 JFL Added options -r, -x, -j, -X to trim whole directory      *
+*		    trees in parallel threads. Version 2.3.		      *
+*    2026-10-18 JFL Added option --pipe to chain other filters in-process.    *
+*		    Version 2.4.					      *
 *		                                                              *
 *         © Copyright 2016 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -60,8 +71,8 @@
 
 #define PROGRAM_DESCRIPTION "Remove blanks at the end of lines"
 #define PROGRAM_NAME    "trim"
-#define PROGRAM_VERSION "2.1.4"
-#define PROGRAM_DATE    "2022-12-12"
+#define PROGRAM_VERSION "2.4"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include "predefine.h" /* Define optional features we need in the C libraries */
 
@@ -80,6 +91,8 @@
 /* SysToolsLib include files */
 #include "debugm.h"	/* SysToolsLib debug macros. Include first. */
 #include "mainutil.h"	/* SysLib helper routines for main() */
+#include "textfilt.h"	/* SysLib text filters */
+#include "rewrite.h"	/* SysLib safe in-place file rewrite */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
 DEBUG_GLOBALS			/* Define global variables used by our debugging macros */
@@ -191,10 +204,9 @@ int main(int argc, char *argv[]) {
   FILE *sf = NULL;		/* Source file pointer */
   char *pszOutName = NULL;	/* Destination file name */
   FILE *df = NULL;		/* Destination file pointer */
-  char *pszTmpName = NULL;	/* Temporary file name */
+  REWRITE *pRw = NULL;		/* Safe in-place rewrite context */
+  int iWritten = TRUE;		/* FALSE if the out file was left unchanged */
   long lnChanges = 0;		/* Number of lines changed */
-  char *line = NULL;		/* The line buffer */
-  size_t lSize = 0;		/* The line buffer size */
   char szBakName[FILENAME_MAX+1];
   int iBackup = FALSE;
   int iSameFile = FALSE;	/* Backup the input file, and modify it in place. */
@@ -203,6 +215,13 @@ int main(int argc, char *argv[]) {
   char *pszPathCopy = NULL;
   char *pszDirName = NULL;	/* Output file directory */
   int iErr;
+  char **ppszArgs;		/* Arguments that are not switches */
+  int nArgs = 0;
+  int iRecurse = FALSE;		/* Trim matching files in the current dir tree */
+  filterTreeOpts fto = {0};	/* FilterTree() options */
+  TEXTPIPE *pPipe = NULL;	/* In-process pipeline of other filters */
+  int iPipe = FALSE;		/* TRUE if the output goes through pPipe */
+  FILE *pf;			/* Where to write the trimmed data */
 
   /* Open a new message file stream for debug and verbose messages */
   if (is_redirected(stdout)) {	/* If stdout is redirected to a file or a pipe */
@@ -221,6 +240,10 @@ int main(int argc, char *argv[]) {
 
   /* Process arguments */
 
+  ppszArgs = calloc(argc, sizeof(char *));
+  fto.ppszExclude = calloc(argc, sizeof(char *));
+  if ((!ppszArgs) || (!fto.ppszExclude)) goto fail_no_mem;
+
   for (i=1; i<argc; i++) {
     char *pszArg = argv[i];
     if (IsSwitch(pszArg)) {		/* It's a switch */
@@ -241,6 +264,20 @@ int main(int argc, char *argv[]) {
 	continue;
       }
 #endif
+      if (streq(pszOpt, "j") && ((i+1) < argc)) {
+	fto.nThreads = atoi(argv[++i]);
+	continue;
+      }
+      if (streq(pszOpt, "-pipe")) {	/* The rest of the line is the pipeline */
+	pPipe = TextPipeNew(argc-i, argv+i);
+	if (!pPipe) return 1;
+	iPipe = TRUE;
+	break;
+      }
+      if (streq(pszOpt, "r") || strieq(pszOpt, "-recurse")) {
+	iRecurse = TRUE;
+	continue;
+      }
       if (   streq(pszOpt, "=")
 	  || strieq(pszOpt, "same")
 	  || strieq(pszOpt, "-same")) {
@@ -259,22 +296,40 @@ int main(int argc, char *argv[]) {
 	puts(DETAILED_VERSION);
 	exit(0);
       }
+      if (streq(pszOpt, "x") && ((i+1) < argc)) {
+	fto.ppszExclude[fto.nExclude++] = argv[++i];
+	continue;
+      }
+      if (streq(pszOpt, "X")) {
+	fto.iFlags |= FT_NOEXEC;
+	continue;
+      }
       printf("Unrecognized switch %s. Ignored.\n", argv[i]);
       continue;
     }
-    /* It's not a switch, it's an argument */
-    if (!pszInName) {
-      pszInName = pszArg;
-      continue;
-    }
-    if (!pszOutName) {
-      pszOutName = pszArg;
-      continue;
+    /* It's not a switch, it's an argument. Or a file name pattern with -r */
+    ppszArgs[nArgs++] = pszArg;
+  }
+
+  if (iRecurse && iPipe) fail("Options -r and --pipe are incompatible");
+  if (iRecurse) { /* Trim all matching files in the current directory tree */
+    if (iVerbose) fto.iFlags |= FT_VERBOSE;
+    fto.ppszInclude = ppszArgs;
+    fto.nInclude = nArgs;
+    iErr = FilterTree(".", &fto, TrimStream, NULL);
+    if (!(fto.iFlags & FT_NOEXEC)) {
+      fflush(stdout);		/* Display the list of files changed first */
+      fprintf(mf, "%ld files changed, out of %ld", fto.nChanged, fto.nFiles);
+      if (iVerbose) fprintf(mf, ". %ld lines trimmed", fto.lnChanges);
+      fprintf(mf, "\n");
     }
-    printf("Unexpected argument: %s\nIgnored.\n", argv[i]);
-    break;  /* Ignore other arguments */
+    return iErr ? 1 : 0;
   }
 
+  if (nArgs > 0) pszInName = ppszArgs[0];
+  if (nArgs > 1) pszOutName = ppszArgs[1];
+  if (nArgs > 2) printf("Unexpected argument: %s\nIgnored.\n", ppszArgs[2]);
+
   /* Force stdin and stdout to untranslated */
 #if defined(_MSDOS) || defined(_WIN32)
   _setmode( _fileno( stdin ), _O_BINARY );
@@ -301,8 +356,7 @@ int main(int argc, char *argv[]) {
     iSameFile = IsSameFile(pszInName, pszOutName);
     if (iBackup && !file_exists(pszOutName)) iBackup = FALSE; /* There's nothing to backup */
   }
-  if (iSameFile || iBackup) { /* Then write to a temporary file */
-    int iFile;
+  if (iSameFile || iBackup) { /* Then rewrite it safely, only if it changes */
     /* But do as if we were writing directly to the target file.
        Test the write rights before wasting time on the conversion */
     df = fopen(pszOutName, "r+");
@@ -310,18 +364,10 @@ int main(int argc, char *argv[]) {
     fclose(df);
     df = NULL;
     /* OK, we have write rights, so go ahead with the conversion */
-    DEBUG_FPRINTF((mf, "// %s. Writing to a temp file.\n", iSameFile ? "In and out files are the same" : "Backup requested"));
+    DEBUG_FPRINTF((mf, "// %s. Rewriting the out file.\n", iSameFile ? "In and out files are the same" : "Backup requested"));
     pszPathCopy = strdup(pszOutName);
     if (!pszPathCopy) goto fail_no_mem;
     pszDirName = dirname(pszPathCopy);
-    pszTmpName = strdup(pszDirName);
-    if (pszTmpName) pszTmpName = realloc(pszTmpName, strlen(pszTmpName)+10);
-    if (!pszTmpName) goto fail_no_mem;
-    strcat(pszTmpName, DIRSEPARATOR_STRING "dtXXXXXX");
-    iFile = mkstemp(pszTmpName);
-    if (iFile == -1) fail("Can't create temporary file %s. %s\n", pszTmpName, strerror(errno));
-    df = fdopen(iFile, "wb+");
-    if (!df) goto open_df_failed;
     if (iBackup) { /* Create the name of an *.bak file in the same directory */
       char *pszNameCopy = strdup(pszOutName);
       char *pszBaseName = basename(pszNameCopy);
@@ -340,6 +386,9 @@ int main(int argc, char *argv[]) {
       strcat(szBakName, ".bak");	/* Set extension to .bak */
       free(pszNameCopy);		/* We don't need that copy anymore */
     }
+    pRw = RewriteOpen(pszOutName, iBackup ? szBakName : NULL);
+    if (!pRw) goto open_df_failed;
+    df = RewriteStream(pRw);
   } else {
     DEBUG_FPRINTF((mf, "// Writing directly to the out file.\n"));
   }
@@ -352,92 +401,37 @@ open_df_failed:
     }
   }
 
-  while (getline(&line, &lSize, sf) >= 0) {
-    int l;
-    int hasCR, hasLF;
-    i = l = (int)strlen(line);
-    /* Is there an \n at the end of the line? */
-    hasLF = ((i) && (line[i-1] == '\n'));
-    if (hasLF) i -= 1;
-    /* Is there an \r at the end of the line? */
-    hasCR = ((i) && (line[i-1] == '\r'));
-    if (hasCR) i -= 1;
-    /* Remove all trailing spaces, tabs, \r and \n */
-    while (i) {
-      i -= 1;             /* Offset of last character in line */
-      if (line[i] == '\r') continue;          /* Return */
-      if (line[i] == '\n') continue;          /* Newline */
-      if (line[i] == ' ') continue;           /* Space */
-      if (line[i] == '\x09') continue;        /* Tab */
-      i += 1;             /* Length of string to preserve */
-      break;
-    }
-    /* Restore the final \r, if initially present */
-    if (hasCR) line[i++] = '\r';
-    /* Restore the final \n, if initially present */
-    if (hasLF) line[i++] = '\n';
-    /* Make sure there's a final NUL */
-    line[i] = '\0';
-    /* Count lines changed */
-    if (i != l) lnChanges += 1;
-
-    fputs(line, df);
+  pf = df;
+  if (pPipe) {			/* Pass the output through the other filters */
+    pf = TextPipeOpen(pPipe, df);
+    if (!pf) fail("Can't start the pipeline. %s", strerror(errno));
   }
-  if (ferror(sf)) fail("Failed to read %s. %s", strerror(errno));
+  lnChanges = TrimStream(sf, pf, NULL);
+  if (lnChanges < 0) fail("Failed to trim %s. %s", pszInName ? pszInName : "stdin", strerror(errno));
+  if (pPipe && TextPipeClose(pPipe)) fail("Pipeline failed. %s", strerror(errno));
 
   if (sf != stdin) fclose(sf);
-  if (df != stdout) fclose(df);
-  DEBUG_FPRINTF((mf, "// Writing done\n"));
-
-  if (iSameFile && !lnChanges) { /* Nothing changed */
-    iErr = unlink(pszTmpName); 	/* Remove the temporary output file */
-  } else {
-    if (iSameFile || iBackup) {
-      if (iBackup) {	/* Create an *.bak file in the same directory */
-#if !defined(_MSVCLIBX_H_)
-        DEBUG_FPRINTF((mf, "unlink(\"%s\");\n", szBakName));
-#endif
-	iErr = unlink(szBakName); 	/* Remove the .bak if already there */
-	if ((iErr == -1) && (errno != ENOENT)) {
-	  fail("Can't delete file %s. %s\n", szBakName, strerror(errno));
-	}
-	DEBUG_FPRINTF((mf, "rename(\"%s\", \"%s\");\n", pszOutName, szBakName));
-	iErr = rename(pszOutName, szBakName);	/* Rename the source as .bak */
-	if (iErr == -1) {
-	  fail("Can't backup %s. %s\n", pszOutName, strerror(errno));
-	}
-      } else {		/* iSameFile==TRUE && iBackup==FALSE. Don't keep a backup of the input file */
-#if !defined(_MSVCLIBX_H_)
-	DEBUG_FPRINTF((mf, "unlink(\"%s\");\n", pszInName));
-#endif
-	iErr = unlink(pszInName); 	/* Remove the original file */
-	if (iErr == -1) {
-	  fail("Can't delete file %s. %s\n", pszInName, strerror(errno));
-	}
-      }
-      DEBUG_FPRINTF((mf, "rename(\"%s\", \"%s\");\n", pszTmpName, pszOutName));
-      iErr = rename(pszTmpName, pszOutName); /* Rename the temporary file as the destination */
-      if (iErr == -1) {
-	fail("Can't create %s. %s\n", pszOutName, strerror(errno));
-      }
-    }
-
+  if (pRw) {	/* Replace the out file, if its content changed */
+    iErr = RewriteClose(pRw, lnChanges || iPipe || !iSameFile);
+    if (iErr == -1) fail("Can't update %s. %s\n", pszOutName, strerror(errno));
+    iWritten = iErr;
+  } else if (df != stdout) {
+    int iMode = sInTime.st_mode;
+    fclose(df);
     /* Copy the file mode flags */
-    if (df != stdout) {
-      int iMode = sInTime.st_mode;
-      DEBUG_PRINTF(("chmod(\"%s\", 0x%X);\n", pszOutName, iMode));
-      iErr = chmod(pszOutName, iMode); /* Try making the target file writable */
-      DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
-    }
+    DEBUG_PRINTF(("chmod(\"%s\", 0x%X);\n", pszOutName, iMode));
+    iErr = chmod(pszOutName, iMode); /* Try making the target file writable */
+    DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
+  }
+  DEBUG_FPRINTF((mf, "// Writing done\n"));
 
-    /* Optionally copy the timestamp */
-    if (!lnChanges) iCopyTime = TRUE; /* Always set the same time if there was no data change */
-    if ((sf != stdin) && (df != stdout) && iCopyTime) {
-      struct utimbuf sOutTime = {0};
-      sOutTime.actime = sInTime.st_atime;
-      sOutTime.modtime = sInTime.st_mtime;
-      utime(pszOutName, &sOutTime);
-    }
+  /* Optionally copy the timestamp */
+  if (!lnChanges && !iPipe) iCopyTime = TRUE; /* Always set the same time if there was no data change */
+  if ((sf != stdin) && (df != stdout) && iCopyTime && iWritten) {
+    struct utimbuf sOutTime = {0};
+    sOutTime.actime = sInTime.st_atime;
+    sOutTime.modtime = sInTime.st_mtime;
+    utime(pszOutName, &sOutTime);
   }
 
   if (iVerbose) fprintf(mf, "%ld lines trimmed\n", lnChanges);
@@ -471,7 +465,8 @@ void usage(void) {
     printf(
 PROGRAM_NAME_AND_VERSION " - " PROGRAM_DESCRIPTION "\n\
 \n\
-Usage: trim [SWITCHES] [INFILE [OUTFILE|-=]]\n\
+Usage: trim [SWITCHES] [INFILE [OUTFILE|-=]] [--pipe STAGE [ARGS]]...\n\
+       trim [SWITCHES] -r [PATTERN ...]\n\
 \n\
 Switches:\n\
   -b|-bak  Create an *.bak backup file of existing output files\n"
@@ -480,13 +475,21 @@ Switches:\n\
   -d       Output debug information\n"
 #endif
 "\
+  -j N     With -r, use N threads. Default: One per CPU\n\
+  -r       Trim in place the matching files in the current directory tree\n\
   -=|-same Modify the input file in place. Default: Automatically detected\n\
   -st      Set the output file time to the same time as the input file\n\
-  -v       Verbose mode\n\
+  -v       Verbose mode. With -r, display the names of the files changed\n\
+  -x PATTERN  With -r, skip the files and directories matching PATTERN\n\
+  -X       With -r, display the names of the files to trim, but don't trim\n\
+  --pipe STAGE [ARGS]  Pass the output through another filter, in-process.\n\
+           Must be last. May be repeated. STAGE [ARGS] = trim | detab [N]\n\
+           | deffeed [LINES_PER_PAGE [TAB_SIZE]] | dump\n\
 \n\
 Arguments:\n\
   INFILE   Input file pathname. Default or \"-\": stdin\n\
   OUTFILE  Output file pathname. Default or \"-\": stdout\n\
+  PATTERN  Wildcards pattern for the names of the files to trim. Default: All\n\
 "
 #include "footnote.h"
 );
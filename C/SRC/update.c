@@ -186,6 +186,37 @@
 *    2023-01-09 JFL Fixed debug builds in MacOS. No change in any other OS.   *
 *    2023-01-10 JFL Changed -R to always display the modification done.       *
 *                   Version 3.14.1.					      *
+*    2026-10-18 JFL Added option -M|--manifest to record the files copied in  *
+*		    a manifest in the target root, and skip unchanged files   *
+*		    on the next run without accessing the target.	      *
+*                   Version 3.15.					      *
+*    2026-10-18 JFL In clean mode, find the target files to delete by         *
+*		    difference with the set of source names recorded during   *
+*		    the source scan, instead of testing every source pathname.*
+*		    Then delete them all in one batch, without any lstat() in *
+*		    Unix unless in force mode. Version 3.15.1.		      *
+*    2026-10-18 JFL Added option --durability to select a file sync policy.  *
+*                   Version 3.16.					      *
+*    2026-10-18 JFL Added options -s|--stats and --json to report statistics  *
+*		    at the end: File counts, copy throughput, copy latency    *
+*		    histogram, and time spent in each phase. Version 3.17.    *
+*    2026-10-18 JFL Use SysLib's shared zapFile(), zapFileM() and zapDirM(),  *
+*		    which delete subdirectories in parallel in Unix.	      *
+*		    Version 3.17.1.					      *
+*    2026-10-18 JFL Also record in the manifest the target files found up to  *
+*		    date, so that existing mirrors benefit from it too.	      *
+*		    Removed the unused CRC-32 from the manifest, now v2.      *
+*		    Version 3.17.2.					      *
+*    2026-10-18 JFL Sync the target files before saving the manifest, and     *
+*		    the manifest before renaming it. Sync the directories     *
+*		    containing the new names. Set the file times before       *
+*		    syncing the files in Unix. Version 3.17.3.		      *
+*    2026-10-18 JFL Record again the CRC-32 of the files copied in the	      *
+*		    manifest, now v3. Use it to only copy the time of the     *
+*		    source files touched without changing their data.	      *
+*		    Version 3.17.4.					      *
+*    2026-10-18 JFL Also count in the statistics the target directories and   *
+*		    links deleted for replacing them. Version 3.17.5.	      *
 *                                                                             *
 *       © Copyright 2016-2018 Hewlett Packard Enterprise Development LP       *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -193,8 +224,8 @@
 
 #define PROGRAM_DESCRIPTION "Update files based on their time stamps"
 #define PROGRAM_NAME    "update"
-#define PROGRAM_VERSION "3.14.1"
-#define PROGRAM_DATE    "2023-01-10"
+#define PROGRAM_VERSION "3.17.5"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include "predefine.h" /* Define optional features we need in the C libraries */
 
@@ -218,6 +249,8 @@
 #include "mainutil.h"	/* SysLib helper routines for main() */
 #include "dirx.h"	/* SysLib Directory access functions eXtensions */
 #include "copyfile.h"	/* SysLib Copy file, and related functions */
+#include "dict.h"	/* SysToolsLib dictionary management */
+#include "zapfile.h"	/* SysLib File and directory deletion functions */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
 DEBUG_GLOBALS	/* Define global variables used by debugging macros. (Necessary for Unix builds) */
@@ -315,6 +348,10 @@ char *fullpath(char *absPath, const char *relPath, size_t maxLength);
 
 #define _stricmp strcasecmp
 
+#ifndef DTTOIF /* Convert a dirent d_type to a stat st_mode file type */
+#define DTTOIF(dirtype) ((dirtype) << 12)
+#endif
+
 /* Redefine Microsoft-specific routines */
 off_t _filelength(int hFile);
 // Don't use realpath(), as it resolves links, which we do not want.
@@ -378,6 +415,47 @@ static int iRecur = 0;			/* Recursive update */
 static int iClean = 0;			/* Flag indicating Clean mode */
 static int iResetTime = 0;		/* Reset time of identical files */
 static int nobak = FALSE;		/* Flag for skipping backup files */
+static int iManifest = FALSE;		/* Flag for using a manifest in the target root */
+
+/* Manifest of the files written or found up to date by previous runs in the target tree */
+#define MANIFEST_NAME ".update.manifest"
+#define MANIFEST_HEADER "# update manifest v3"
+typedef struct manifestEntry {
+  off_t size;				/* Size of the file written */
+  time_t mtime;				/* Its modification time, copied from the source */
+  DWORD crc;				/* The CRC-32 of its data */
+  int iCRC;				/* TRUE if crc is known, ie. if we wrote the file */
+} manifestEntry;
+static dict_t *pManifest = NULL;	/* Entries indexed by pathname relative to the root */
+static char *pszManifestRoot = NULL;	/* The target root directory */
+static int iManifestChanged = FALSE;	/* TRUE if the manifest must be saved */
+
+/* Statistics reported at the end */
+#define STATS_NONE 0
+#define STATS_TEXT 1
+#define STATS_JSON 2
+static int iStats = STATS_NONE;		/* Statistics report format */
+enum {					/* Phases timed separately */
+  PHASE_SCAN, PHASE_COMPARE, PHASE_COPY, PHASE_COPYDATE, PHASE_DELETE, N_PHASES
+};
+static char *pszPhaseNames[N_PHASES] = {"scan", "compare", "copy", "copydate", "delete"};
+#define N_LATENCIES 7			/* Copy latency histogram buckets */
+static char *pszLatencyNames[N_LATENCIES] = {"<100us", "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s"};
+#define PEAK_WINDOW 0.1			/* Min copy time for measuring the peak throughput */
+typedef struct updStats {
+  long nScanned;			/* Source files and links matching the pattern */
+  long nCompared;			/* Files compared with an existing target */
+  long nCopied;				/* Files copied */
+  long nFailed;				/* Files that failed to be updated */
+  long nDeleted;			/* Target files, links, or directories deleted */
+  uintmax_t nBytes;			/* Bytes copied */
+  double adPhase[N_PHASES];		/* Time spent in each phase, in seconds */
+  long anLatency[N_LATENCIES];		/* Per-file copy latency histogram */
+  double dPeakRate;			/* Peak copy throughput, in bytes/s */
+  uintmax_t nWindowBytes;		/* Bytes copied in the current peak window */
+  double dWindowTime;			/* Copy time spent in that window */
+} updStats;
+static updStats stats = {0};
 
 /* update() and update_link() functions options */
 typedef struct updOpts {
@@ -393,8 +471,8 @@ int update(char *, char *, updOpts *);	/* Copy a file if newer */
 #if defined(S_ISLNK) && S_ISLNK(S_IFLNK)/* In DOS it's defined, but always returns 0 */
 int update_link(char *, char *, updOpts *);	/* Copy a link if newer */
 #endif
-int copyf(char *, char *);		/* Copy a file silently */
-int copy(char *, char *);		/* Copy a file and display messages */
+int copyf(char *, char *, DWORD *);	/* Copy a file silently */
+int copy(char *, char *, DWORD *);	/* Copy a file and display messages */
 int mkdirp(const char *path, mode_t mode); /* Same as mkdir -p */
 
 int exists(char *name);			/* Does this pathname exist? (TRUE/FALSE) */
@@ -406,6 +484,19 @@ int is_effective_directory(char *name); /* Is name a directory, or a link to a d
 int older(char *, char *);		/* Is file 1 older than file 2? */
 time_t getmodified(char *);		/* Get time of file modification */
 int filecompare(char *, char *);	/* Compare two files */
+DWORD UpdateCRC32(DWORD crc, const void *pBuf, size_t len); /* Running CRC-32 */
+int FileCRC32(char *name, DWORD *pdwCRC); /* Compute the CRC-32 of a file */
+
+int LoadManifest(char *pszRoot);	/* Load the manifest from the target root */
+int SaveManifest(void);			/* Save it back if it changed */
+char *ManifestKey(char *path);		/* Get the manifest key for a target pathname */
+void RecordManifestEntry(char *pszKey, struct stat *pStat, DWORD *pdwCRC); /* Record a target file up to date */
+void ForgetManifestEntry(char *path);	/* Remove a target pathname from the manifest */
+void FreeDict(dict_t *dict);		/* Delete a dictionary and all its entries */
+
+double StatsClock(void);		/* Get the current time, if collecting stats */
+void StatsRecordCopy(uintmax_t nBytes, double dCopy, double dCopyDate);
+void ShowStats(double dTotal);		/* Display the statistics report */
 
 char *strgfn(const char *);		/* Get file name position */
 void stcgfn(char *, const char *);	/* Get file name */
@@ -413,22 +504,6 @@ void stcgfp(char *, const char *);	/* Get file path */
 void strmfp(char *, const char *, const char *);    /* Make file pathname */
 void strsfp(const char *, char *, char *);          /* Split file pathname */
 char *NewPathName(const char *path, const char *name); /* Create a new pathname */
-/* zap functions options */
-typedef struct zapOpts {
-  int iFlags;
-  char *pszPrefix;
-} zapOpts;
-/* zapOpts iFlags */
-#define FLAG_VERBOSE	0x0001		/* Display the pathname operated on */
-#define FLAG_NOEXEC	0x0002		/* Do not actually execute */
-#define FLAG_RECURSE	0x0004		/* Recursive operation */
-#define FLAG_NOCASE	0x0008		/* Ignore case */
-#define FLAG_FORCE	0x0010		/* Force operation on read-only files */
-#define FLAG_COMMAND	0x0020		/* Display the equivalent shell commands */
-int zapFile(const char *path, zapOpts *pzo); /* Delete a file */
-int zapFileM(const char *path, int iMode, zapOpts *pzo); /* Faster */
-int zapDir(const char *path, zapOpts *pzo);  /* Delete a directory */
-int zapDirM(const char *path, int iMode, zapOpts *pzo); /* Faster */
 
 /* Global program name variables */
 char *program;	/* This program basename, with extension in Windows */
@@ -474,6 +549,7 @@ int main(int argc, char *argv[]) {
   int nErrors = 0;
   int iExit = 0;
   int iProcessSwitches = TRUE;
+  double dStart;
 
   /* Extract the program names from argv[0] */
   GetProgramNames(argv[0]);
@@ -533,6 +609,23 @@ int main(int argc, char *argv[]) {
 	if (iVerbose) printf(COMMENT "Show mode = Destination files names\n");
 	continue;
       }
+      if (   streq(opt, "-durability")     /* Durability policy */
+	  || !strncmp(opt, "-durability=", 12)) {
+	char *pszPolicy = strchr(opt, '=');
+	if (pszPolicy) {
+	  pszPolicy += 1;
+	} else if ((iArg+1) < argc) {
+	  pszPolicy = argv[++iArg];
+	} else {
+	  pszPolicy = "";
+	}
+	if (SetSyncPolicy(pszPolicy)) {
+	  printError("Error: Invalid durability policy: %s", pszPolicy);
+	  do_exit(1);
+	}
+	if (iVerbose) printf(COMMENT "Durability policy = %s\n", pszPolicy);
+	continue;
+      }
       if (   streq(opt, "E")	    /* NoEmpty files mode on */
 	  || streq(opt, "noempty")    /* The historical name of that switch */
 	  || streq(opt, "-noempty")) {
@@ -564,6 +657,12 @@ int main(int argc, char *argv[]) {
 	if (iVerbose) printf(COMMENT "Pattern matching = Case-sensitive\n");
 	continue;
       }
+      if (   streq(opt, "M")	    /* Use a manifest in the target root */
+	  || streq(opt, "-manifest")) {
+	iManifest = TRUE;
+	if (iVerbose) printf(COMMENT "Manifest mode = on\n");
+	continue;
+      }
 #ifdef _WIN32
       if (   streq(opt, "O")
 	  || streq(opt, "-oem")) {    /* Force encoding output with the OEM code page */
@@ -603,6 +702,15 @@ int main(int argc, char *argv[]) {
 	if (iVerbose) printf(COMMENT "Reset time of equal files\n");
 	continue;
       }
+      if (   streq(opt, "s")	    /* Statistics report */
+	  || streq(opt, "-stats")) {
+	iStats = STATS_TEXT;
+	continue;
+      }
+      if (   streq(opt, "-json")) {	/* Statistics report in JSON */
+	iStats = STATS_JSON;
+	continue;
+      }
       if (   streq(opt, "S")     /* Show source files */
 	  || streq(opt, "-source")) {
 	show = SHOW_SOURCE;
@@ -738,11 +846,37 @@ int main(int argc, char *argv[]) {
   }
 #endif
 
+  dStart = StatsClock();
+
+  if (iManifest) nErrors += LoadManifest(target);
+
   for ( ; iArg < argc; iArg++) { /* For every source file before that */
     arg = argv[iArg];
     nErrors += updateall(arg, target);
   }
 
+  if (iManifest && (GetSyncPolicy() == SYNC_NONE)) nErrors += SaveManifest();
+
+  if (GetSyncPolicy() != SYNC_NONE) {
+    long nSynced;
+    double dSeconds;
+    /* Make the files durable before the manifest that describes them */
+    int iErr = syncall();
+    if (iManifest) {
+      nErrors += SaveManifest();
+      if (syncall()) iErr = -1; /* Its directory entry */
+    }
+    if (iErr) {
+      printError("Error: Failed to sync the target files: %s", strerror(errno));
+      nErrors += 1;
+    }
+    GetSyncStats(&nSynced, &dSeconds);
+    if (show != SHOW_NONE) printf(COMMENT "Durability %s: %ld files synced in %.3f s\n",
+			GetSyncPolicyName(), nSynced, dSeconds);
+  }
+
+  if (iStats) ShowStats(StatsClock() - dStart);
+
   if (nErrors) { /* Display a final summary, as the errors may have scrolled up beyond view */
     printError("Error: %d file(s) failed to be updated", nErrors);
     iExit = 1;
@@ -784,6 +918,10 @@ Switches:\n\
 #endif
 "\
   -D|--dest     Display destination files copied\n\
+  --durability none|file|batch|end  Make the files copied durable: Not at all\n\
+                (Default), by syncing every file, by syncing batches of\n\
+                files written back in the background, or by syncing the\n\
+                whole target file system at the end\n\
   -E|--noempty  Don't copy empty files\n\
 ");
 
@@ -792,7 +930,11 @@ Switches:\n\
   -F|--force    Overwrite read-only files\n\
   -h|--help|-?  Display this help screen and exit\n\
   -i|--ignorecase    Case-insensitive pattern matching. Default for DOS/Windows\n\
-  -k|--casesensitive Case-sensitive pattern matching. Default for Unix\n"
+  -k|--casesensitive Case-sensitive pattern matching. Default for Unix\n\
+  -M|--manifest Record the files copied or found up to date in\n\
+                DIRECTORY" DIRSEPARATOR_STRING MANIFEST_NAME ", and skip those still unchanged in\n\
+                the source, without accessing them in the target. Use only if\n\
+                nothing else writes to the target\n"
 #ifdef _WIN32
 "\
   -O|--oem      Force encoding the output using the OEM character set\n"
@@ -803,6 +945,9 @@ Switches:\n\
   -q|--quiet    Don't display anything\n\
   -r|--recurse  Recursively update all subdirectories\n\
   -R|--resettime Reset time of identical files\n\
+  -s|--stats    Display statistics at the end: File counts, copy throughput,\n\
+                copy latency histogram, and time spent in each phase\n\
+  --json        Same, in JSON format. Use with -q to get just the JSON object\n\
   -S|--source   Display source files copied (Default)\n\
 "
 #ifdef _WIN32
@@ -884,10 +1029,12 @@ int updateall(char *p1,             /* Wildcard * and ? are interpreted */
     int err;
     int nErrors = 0;
     int iTargetDirExisted;
-    zapOpts zo = {FLAG_VERBOSE, "- "};
+    zapOpts zo = {FLAG_VERBOSE | FLAG_RECURSE, "- "}; /* Extra target dirs are deleted completely */
     int iFlags = 0;
     int mdDone = FALSE;
     updOpts uo = {0};
+    dict_t *pSrcNames = NULL;	/* Set of source names, for the clean mode */
+    double t0, dOther;		/* Statistics timers */
 
     if (iRecur) iFlags |= FLAG_RECURSE;
     if (test) iFlags |= FLAG_NOEXEC;
@@ -979,14 +1126,31 @@ int updateall(char *p1,             /* Wildcard * and ? are interpreted */
        the source, even if the command-line argument has a different case. */
 
     /* Scan all files that match the wild cards */
+    t0 = StatsClock();
     pDir = opendirx(path0);
+    stats.adPhase[PHASE_SCAN] += StatsClock() - t0;
     if (!pDir) {
       printError("Error: can't open directory \"%s\": %s", path0, strerror(errno));
       nErrors += 1;
       goto cleanup_and_return;
     }
-    while ((pDE = readdirx(pDir)) != NULL) {
+    if (iClean) {
+#if defined(_MSDOS) || defined(_WIN32)
+      pSrcNames = NewIDict(NULL);	/* File names are case-independent */
+#else
+      pSrcNames = NewDict(NULL);
+#endif
+      if (!pSrcNames) {
+	printError("Error: Not enough memory");
+	nErrors += 1;
+	closedirx(pDir);
+	goto cleanup_and_return;
+      }
+    }
+    for (t0 = StatsClock(); (pDE = readdirx(pDir)) != NULL; t0 = StatsClock()) {
+      stats.adPhase[PHASE_SCAN] += StatsClock() - t0;
       DEBUG_PRINTF(("// Dir Entry \"%s\" d_type=%d\n", pDE->d_name, (int)(pDE->d_type)));
+      if (pSrcNames) NewDictValue(pSrcNames, pDE->d_name, ""); /* Any non-NULL value */
       if (   (pDE->d_type != DT_REG)
 #if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
       	  && (pDE->d_type != DT_LNK)
@@ -1014,6 +1178,9 @@ int updateall(char *p1,             /* Wildcard * and ? are interpreted */
       strmfp(path1, path0, pDE->d_name);  /* Compute source path */
       DEBUG_PRINTF(("// Found %s\n", path1));
       strmfp(path2, ppath, pname?pname:pDE->d_name); /* Append it to directory p2 too */
+      stats.nScanned += 1;
+      t0 = StatsClock();
+      dOther = stats.adPhase[PHASE_COPY] + stats.adPhase[PHASE_COPYDATE] + stats.adPhase[PHASE_DELETE];
 #if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
       if (pDE->d_type == DT_LNK) {
 	err = update_link(path1, path2, &uo); /* Displays error messages on stderr */
@@ -1026,65 +1193,99 @@ int updateall(char *p1,             /* Wildcard * and ? are interpreted */
 	  printError("Error: Failed to create \"%s\". %s", path2, strerror(errno));
 	}
       }
+      /* The rest of the time spent in update() is for deciding what to do */
+      stats.adPhase[PHASE_COMPARE] += (StatsClock() - t0)
+	- (stats.adPhase[PHASE_COPY] + stats.adPhase[PHASE_COPYDATE] + stats.adPhase[PHASE_DELETE] - dOther);
       if (err) {
       	nErrors += 1;
+	stats.nFailed += 1;
       	/* Continue the directory scan, looking for other files to update */
       }
     }
+    stats.adPhase[PHASE_SCAN] += StatsClock() - t0;
     closedirx(pDir);
 
     /* Scan target files that might be erased */
     if (iClean) {
-      fullpath(path2, p2, PATHNAME_SIZE); /* Build absolute pathname of source */
-      pDir = opendirx(p2);
+      dict_t *pZapList = NewDict(free); /* Target names missing in the source, and their modes */
+      dictnode *pNode;
+      fullpath(path2, p2, PATHNAME_SIZE); /* Build absolute pathname of target */
+      /* First list deletion candidates, by difference with the set of source names */
+      pDir = pZapList ? opendirx(p2) : NULL;
       if (pDir) {
 	while ((pDE = readdirx(pDir)) != NULL) {
-	  struct stat sStat;
+	  mode_t *pMode;
 	  if (streq(pDE->d_name, ".")) continue;    /* Skip the . directory */
 	  if (streq(pDE->d_name, "..")) continue;   /* Skip the .. directory */
 	  DEBUG_PRINTF(("// Dir Entry \"%s\" d_type=%d\n", pDE->d_name, (int)(pDE->d_type)));
 	  if (fnmatch(pattern, pDE->d_name, iFnmFlag) == FNM_NOMATCH) continue;
+	  if (pManifest && streq(pDE->d_name, MANIFEST_NAME)) continue; /* Our own manifest */
+	  if (DictValue(pSrcNames, pDE->d_name)) continue; /* That source file exists */
+	  pMode = malloc(sizeof(mode_t));
+	  if (!pMode) {
+	    printError("Error: Not enough memory");
+	    nErrors += 1;
+	    break;
+	  }
 	  strmfp(path3, path2, pDE->d_name);  /* Compute the target file pathname */
-	  DEBUG_PRINTF(("// Found %s\n", path3));
-	  strmfp(path1, path0, pDE->d_name); /* Compute the corresponding source file pathname */
-	  if (access(path1, F_OK) == -1) { /* If that source file does not exist */
-	    char *pszType = "file";
 #if _DIRENT2STAT_DEFINED /* MsvcLibX return DOS/Windows stat info in the dirent structure */
+	  {
+	    struct stat sStat;
 	    err = dirent2stat(pDE, &sStat);
-#else /* Unix has to query it separately */
+	    *pMode = sStat.st_mode;
+	  }
+#else /* Unix only needs to query it to get the permissions in force mode */
+	  err = 0;
+	  *pMode = DTTOIF(pDE->d_type);
+	  if (force) {
+	    struct stat sStat;
 	    err = -lstat(path3, &sStat); /* If error, iErr = 1 = # of errors */
+	    *pMode = sStat.st_mode;
+	  }
 #endif
-	    if (err) {
-	      printError("Error: Can't stat \"%s\"", path1);
-	      nErrors += 1;
-	      continue;
-	    }
-	    switch (pDE->d_type) {
-	      case DT_DIR:
-		err = zapDirM(path3, sStat.st_mode, &zo);
-		nErrors += err;
-		break;
+	  if (err) {
+	    printError("Error: Can't stat \"%s\"", path3);
+	    nErrors += 1;
+	    free(pMode);
+	    continue;
+	  }
+	  NewDictValue(pZapList, pDE->d_name, pMode);
+	}
+	closedirx(pDir);
+      }
+      /* Then delete them all in one batch */
+      t0 = StatsClock();
+      for (pNode = pZapList ? FirstDictValue(pZapList) : NULL; pNode; pNode = NextDictValue(pZapList, pNode)) {
+	mode_t iMode = *(mode_t *)(pNode->pData);
+	strmfp(path3, path2, pNode->pszKey);  /* Compute the target file pathname */
+	DEBUG_PRINTF(("// Found %s\n", path3));
+	if (pManifest && !test) { /* path3 is absolute, so rebuild the pathname relative to p2 */
+	  char *pszPath = NewPathName(p2, pNode->pszKey);
+	  if (pszPath) ForgetManifestEntry(pszPath);
+	  free(pszPath);
+	}
+	if (S_ISDIR(iMode)) {
+	  err = zapDirM(path3, iMode, &zo);
+	  nErrors += err;
+	  if (!err) stats.nDeleted += 1;
+	} else if (S_ISREG(iMode)
 #if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
-	      case (DT_LNK):
-	      	pszType = "link";
-		// Fall through
+		   || S_ISLNK(iMode)
 #endif
-	      case DT_REG:
-	      	err = zapFileM(path3, sStat.st_mode, &zo);
-		if (err) {
-		  printError("Error: Can't delete %s \"%s\"", pszType, path3);
-		  nErrors += 1;
-		}
-		break;
-	      default:
-		printError("Error: Can't delete \"%s\"", path3);
-		nErrors += 1;
-		break;
-	    }
+		  ) {
+	  err = zapFileM(path3, iMode, &zo); /* Reports errors */
+	  if (err) {
+	    nErrors += 1;
+	  } else {
+	    stats.nDeleted += 1;
 	  }
+	} else {
+	  printError("Error: Can't delete \"%s\"", path3);
+	  nErrors += 1;
 	}
       }
-      closedirx(pDir);
+      stats.adPhase[PHASE_DELETE] += StatsClock() - t0;
+      if (pZapList) FreeDict(pZapList);
     }
 
     if (iRecur) { /* Parse the directory again, looking for actual directories (not junctions nor symlinkds) */
@@ -1111,9 +1312,9 @@ int updateall(char *p1,             /* Wildcard * and ? are interpreted */
 	p2_is_dir = is_directory(path2);
 	if ((!p2_exists) || (!p2_is_dir)) {
 	  if (p2_exists && !p2_is_dir) {
-	    err = zapFile(path2, &zo); /* Delete the conflicting file/link */
+	    if (!test) ForgetManifestEntry(path2);
+	    err = zapFile(path2, &zo); /* Delete the conflicting file/link. Reports errors. */
 	    if (err) {
-	      printError("Error: Failed to remove \"%s\"", path2);
 	      nErrors += 1;
 	      continue;	/* Try updating something else */
 	    }
@@ -1158,6 +1359,7 @@ cleanup_and_return:
 #ifndef _MSDOS
     free(path0); free(path1); free(path2); free(path3); free(path); free(name); free(fullpathname);
 #endif
+    if (pSrcNames) FreeDict(pSrcNames);
     RETURN_INT(nErrors);
     }
 
@@ -1189,6 +1391,8 @@ int update(char *p1,	/* Both names must be complete, without wildcards */
     char *p;
     int iCheckOlder = TRUE;
     char path[PATHNAME_SIZE];
+    char *pszKey = NULL;		/* Manifest key for p2 */
+    DWORD dwCRC = 0;
 
     DEBUG_ENTER(("update(\"%s\", \"%s\");\n", p1, p2));
 
@@ -1196,6 +1400,31 @@ int update(char *p1,	/* Both names must be complete, without wildcards */
     p = p1;				/* By default, show the source file name */
     if (show == SHOW_DEST) p = p2;	/* But in showdest mode, show the destination file name */
 
+    /* In manifest mode, trust the manifest for files we wrote ourselves.
+       If the source still has the same size and time, there's nothing to do. */
+    if (pManifest && !iResetTime) pszKey = ManifestKey(p2);
+    if (pszKey) {
+      manifestEntry *pEntry = DictValue(pManifest, pszKey);
+      struct stat sP1stat;
+      if (pEntry && lstat(p1, &sP1stat)) pEntry = NULL; /* The source will be reported missing later */
+      if (   pEntry
+	  && (pEntry->size == sP1stat.st_size) && (pEntry->mtime == sP1stat.st_mtime)) {
+	RETURN_CONST_COMMENT(0, ("File %s is unchanged since it was copied\n", p1));
+      }
+      /* If the source is newer, but has the same size, check lazily if its data changed.
+         If its CRC-32 is still the one we wrote, only its time needs to be copied. */
+      if (   pEntry && pEntry->iCRC && S_ISREG(sP1stat.st_mode)
+	  && (pEntry->size == sP1stat.st_size) && (pEntry->mtime < sP1stat.st_mtime)
+	  && !FileCRC32(p1, &dwCRC) && (dwCRC == pEntry->crc)) {
+	if (iVerbose) printf(COMMENT "Data unchanged. Copying only the time to %s\n", p2);
+	if (test) RETURN_CONST(0);
+	if (!copydate(p2, p1)) {
+	  RecordManifestEntry(pszKey, &sP1stat, &dwCRC);
+	  RETURN_CONST_COMMENT(0, ("File %s data is unchanged since it was copied\n", p1));
+	} /* Else copy the file, as the target may not be what the manifest says */
+      }
+    }
+
     /* In freshen mode, don't copy if the destination does not exist. */
     if (fresh && !exist_file(p2)) RETURN_CONST(0);
 
@@ -1204,8 +1433,10 @@ int update(char *p1,	/* Both names must be complete, without wildcards */
 
     /* If the target exists, make sure it's a file */
     err = lstat(p2, &sP2stat); /* Use lstat to avoid following links */
+    if ((err == 0) && S_ISREG(sP2stat.st_mode)) stats.nCompared += 1;
     if (err == 0) {
       zapOpts zo = {FLAG_VERBOSE | FLAG_RECURSE, "- "};
+      double t0 = StatsClock();
       if (test) zo.iFlags |= FLAG_NOEXEC;
       if (force) zo.iFlags |= FLAG_FORCE;
       if (show == SHOW_COMMAND) zo.iFlags |= FLAG_COMMAND;
@@ -1223,10 +1454,9 @@ int update(char *p1,	/* Both names must be complete, without wildcards */
       	printError("Can't replace \"%s\" with a file", p2);
       	RETURN_INT(EBADF);
       } /* Else the target is a plain file */
-      if (err) {
-      	printError("Failed to remove \"%s\"", p2);
-      	RETURN_INT(err);
-      }
+      stats.adPhase[PHASE_DELETE] += StatsClock() - t0;
+      if (err) RETURN_INT(err); /* The error is already reported */
+      if (!S_ISREG(sP2stat.st_mode)) stats.nDeleted += 1; /* A file is overwritten, not deleted */
     }
 
     /* In ResetTime mode, check if the files are identical, but dates have changed */
@@ -1262,7 +1492,17 @@ int update(char *p1,	/* Both names must be complete, without wildcards */
     }
 
     /* In any mode, don't copy if the destination is newer than the source. */
-    if (iCheckOlder && older(p1, p2)) RETURN_CONST(0);
+    if (iCheckOlder && older(p1, p2)) {
+      /* In manifest mode, record the targets found up to date, to trust them next time */
+      if (pszKey && S_ISREG(sP2stat.st_mode)) {
+	struct stat sP1stat;
+	if (   !lstat(p1, &sP1stat) && S_ISREG(sP1stat.st_mode)
+	    && (sP1stat.st_size == sP2stat.st_size) && (sP1stat.st_mtime == sP2stat.st_mtime)) {
+	  RecordManifestEntry(pszKey, &sP1stat, NULL); /* Don't read it just for the CRC */
+	}
+      }
+      RETURN_CONST(0);
+    }
 
     /* Create the destination directory if needed */
     strsfp(p2, path, NULL);
@@ -1305,7 +1545,12 @@ int update(char *p1,	/* Both names must be complete, without wildcards */
 
     if (test == 1) RETURN_CONST(0);
 
-    err = copy(p1, p2);
+    err = copy(p1, p2, pszKey ? &dwCRC : NULL);
+
+    if ((!err) && pszKey) { /* Record what we wrote in the manifest */
+      struct stat sP1stat;
+      if (!lstat(p1, &sP1stat)) RecordManifestEntry(pszKey, &sP1stat, &dwCRC); /* copyf() copied its time to p2 */
+    }
 
     RETURN_INT_COMMENT(err, (err?"Error\n":"Success\n"));
     }
@@ -1396,15 +1641,16 @@ int update_link(char *p1,	/* Both names must be complete, without wildcards */
       	err = chmod(p2, iMode); /* Try making the target file writable */
       	DEBUG_PRINTF(("  return %d; // errno = %d\n", err, errno));
       }
+      if (!test) ForgetManifestEntry(p2); /* It won't be a file we wrote anymore */
       if (S_ISDIR(sP2stat.st_mode)) {
       	zo.iFlags |= FLAG_VERBOSE; /* Show what's deleted, beyond the obvious target itself */
 	err = zapDirM(p2, sP2stat.st_mode, &zo);	/* Then remove it */
       } else { // It's a file or a link
       	zo.iFlags &= ~FLAG_VERBOSE; /* No need to show that that target is deleted */
 	err = zapFileM(p2, sP2stat.st_mode, &zo);	/* Then remove it */
-      	if (err) printError("Error: Failed to remove \"%s\"", p2);
       }
       if (err) RETURN_INT(err);
+      stats.nDeleted += 1;
     }
 
     /* Create the destination directory if needed */
@@ -1477,6 +1723,7 @@ int update_link(char *p1,	/* Both names must be complete, without wildcards */
 |                                                                             |
 |   Parameters:     char *name1	    Source file pathname                      |
 |                   char *name2	    Destination file pathname		      |
+|                   DWORD *pdwCRC   Optional: Where to store the CRC-32       |
 |                                                                             |
 |   Return value:   0 = Success						      |
 |                   1 = Read error					      |
@@ -1489,11 +1736,15 @@ int update_link(char *p1,	/* Both names must be complete, without wildcards */
 |                   When reading fails to start, avoid deleting the target.   |
 |                   In case of error later on, delete incomplete copies.      |
 |    2016-05-10 JFL Added support for the --force option.                     |
+|    2026-10-18 JFL Record the copy statistics.				      |
+|    2026-10-18 JFL Sync the file time too, and the name of new files.	      |
+|    2026-10-18 JFL Optionally compute the CRC-32 of the data copied.         |
 *                                                                             *
 \*---------------------------------------------------------------------------*/
 
 int copyf(char *name1,		    /* Source file to copy from */
-          char *name2)		    /* Destination file to copy to */
+          char *name2,		    /* Destination file to copy to */
+          DWORD *pdwCRC)	    /* Optional: Where to store the data CRC-32 */
     {
     FILE *pfs, *pfd;	    /* Source & destination file pointers */
     int hsource;	    /* Source handle */
@@ -1505,8 +1756,12 @@ int copyf(char *name1,		    /* Source file to copy from */
     int iWidth = 0;	    /* Number of characters in the iProgress output */
     char *pszUnit = "B";    /* Unit used for iProgress output */
     long lUnit = 1;	    /* Number of bytes for 1 iProgress unit */
+    double t0 = StatsClock(), t1;
+    int iNewName = FALSE;   /* TRUE if the target directory entry must be synced */
 
     DEBUG_ENTER(("copyf(\"%s\", \"%s\");\n", name1, name2));
+
+    if (GetSyncPolicy() != SYNC_NONE) iNewName = !exists(name2);
     if (iVerbose
 #ifdef _DEBUG
         && !iDebug
@@ -1531,6 +1786,7 @@ int copyf(char *name1,		    /* Source file to copy from */
       RETURN_INT_COMMENT(1, ("Can't read the input file\n"));
     }
     fseek(pfs, 0, SEEK_SET);
+    if (pdwCRC) *pdwCRC = 0;
 retry_open_targetfile:
     pfd = fopen(name2, "wb");
     if (!pfd) {
@@ -1581,6 +1837,7 @@ retry_open_targetfile:
 	unlink(name2); /* Avoid leaving an incomplete file on the target */
         RETURN_INT_COMMENT(1, ("Can't read the input file. Deleted the partial copy.\n"));
       }
+      if (pdwCRC) *pdwCRC = UpdateCRC32(*pdwCRC, buffer, tocopy);
       if (!fwrite(buffer, tocopy, 1, pfd)) {
 	if (iProgress && iWidth) printf("\n");
 	fclose(pfs);
@@ -1592,9 +1849,33 @@ retry_open_targetfile:
     if (iProgress && iWidth) printf("%*s\r", iWidth, "");
 
     fclose(pfs);
+    fflush(pfd);
+#if defined(_MSDOS) || defined(_WIN32)
+    /* Closing the file would change its time. So set it afterwards, and it's not covered by the sync */
+    if (syncfile(fileno(pfd))) {
+      fclose(pfd);
+      RETURN_INT_COMMENT(2, ("Can't sync the output file\n"));
+    }
     fclose(pfd);
 
+    t1 = StatsClock();
     copydate(name2, name1);	/* & give the same date than the source file */
+    StatsRecordCopy((uintmax_t)filelen, t1 - t0, StatsClock() - t1);
+#else
+    /* Set the time first, so that the sync makes it durable too */
+    t1 = StatsClock();
+    copydate(name2, name1);	/* & give the same date than the source file */
+    t1 = StatsClock() - t1;	/* The time spent setting it */
+    if (syncfile(fileno(pfd))) {
+      fclose(pfd);
+      RETURN_INT_COMMENT(2, ("Can't sync the output file\n"));
+    }
+    fclose(pfd);
+    StatsRecordCopy((uintmax_t)filelen, StatsClock() - t0 - t1, t1);
+#endif
+    if (iNewName && syncname(name2)) {
+      RETURN_INT_COMMENT(2, ("Can't sync the output directory\n"));
+    }
 
     DEBUG_PRINTF(("// File %s mode is read%s\n", name2,
 			access(name2, 6) ? "-only" : "/write"));
@@ -1610,6 +1891,7 @@ retry_open_targetfile:
 |                                                                             |
 |   Parameters:     char *name1	    Source file pathname                      |
 |                   char *name2	    Destination file pathname		      |
+|                   DWORD *pdwCRC   Optional: Where to store the CRC-32       |
 |                                                                             |
 |   Return value:   0 = Success, else error and errno set		      |
 |                                                                             |
@@ -1623,7 +1905,7 @@ retry_open_targetfile:
 *                                                                             *
 \*---------------------------------------------------------------------------*/
 
-int copy(char *name1, char *name2) {
+int copy(char *name1, char *name2, DWORD *pdwCRC) {
   int e;
   char path[PATHNAME_SIZE];
 
@@ -1636,7 +1918,7 @@ int copy(char *name1, char *name2) {
     }
   }
 
-  e = copyf(name1, name2);
+  e = copyf(name1, name2, pdwCRC);
 #if NEEDED
   switch (e) {
     case 0:
@@ -1816,7 +2098,9 @@ int mkdir1(const char *pszPath, mode_t pszMode) {
 #ifndef HAS_MSVCLIBX
   DEBUG_PRINTF(("mkdir(\"%s\", 0x%X);\n", pszPath, pszMode));
 #endif
-  return mkdir(pszPath, pszMode);
+  if (mkdir(pszPath, pszMode)) return -1;
+  if (syncname(pszPath)) return -1; /* Make its name durable as required */
+  return 0;
 }
 
 /* Create all parent directories */
@@ -2249,185 +2533,6 @@ char *NewPathName(const char *path, const char *name) {
   return buf;
 }
 
-/*---------------------------------------------------------------------------*\
-*                                                                             *
-|   Function	    zapDir						      |
-|									      |
-|   Description     Remove a directory, and all its files and subdirectories. |
-|									      |
-|   Parameters      const char *path		The directory pathname	      |
-|		    int iFlags			Verbose & NoExec flags	      |
-|		    							      |
-|   Returns	    0 = Success, else # of failures encountered.	      |
-|		    							      |
-|   Notes	    							      |
-|		    							      |
-|   History								      |
-|    2017-10-05 JFL Created this routine				      |
-|    2018-05-31 JFL Changed the iFlags argument to zapOpts *pzo.	      |
-|		    The FLAG_FORCE flag now deletes read-only files.	      |
-|		    Split zapFile() off of zapDir().			      |
-|		    Added zapXxxM routines, with an additional iMode argument,|
-|		     to avoid unnecessary slow calls to lstat() in Windows.   |
-*									      *
-\*---------------------------------------------------------------------------*/
-
-#ifdef _MSC_VER
-#pragma warning(disable:4459) /* Ignore the "declaration of 'VARIABLE' hides global declaration" warning */
-#endif
-
-int zapFileM(const char *path, int iMode, zapOpts *pzo) {
-  int iFlags = pzo->iFlags;
-  char *pszSuffix = "";
-  int iErr = 0;
-
-  DEBUG_ENTER(("zapFileM(\"%s\", 0x%04X);\n", path, iMode));
-
-  if (S_ISDIR(iMode)) {
-    errno = EISDIR;
-    RETURN_INT(1);
-  }
-#if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
-  if (S_ISLNK(iMode)) {
-    pszSuffix = ">";
-  }
-#endif
-
-  if (iFlags & FLAG_COMMAND) {
-    printf(DEL_FILE " \"%s\"\n", path);
-  } else if (iFlags & FLAG_VERBOSE) {
-    printf("%s%s%s\n", pzo->pszPrefix, path, pszSuffix);
-  }
-  if (iFlags & FLAG_NOEXEC) RETURN_INT(0);
-  if (iFlags & FLAG_FORCE) {
-    if (!(iMode & S_IWRITE)) {
-      iMode |= S_IWRITE;
-      DEBUG_PRINTF(("chmod(%p, 0x%X);\n", path, iMode));
-      iErr = -chmod(path, iMode); /* Try making the target file writable */
-      DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
-    }
-    if (iErr) RETURN_INT(iErr);
-  }
-  iErr = -unlink(path); /* If error, iErr = 1 = # of errors */
-
-  RETURN_INT(iErr);
-}
-
-int zapFile(const char *path, zapOpts *pzo) {
-  int iErr;
-  struct stat sStat;
-
-  DEBUG_ENTER(("zapFile(\"%s\");\n", path));
-
-  iErr = lstat(path, &sStat); /* Use lstat, as stat does not detect SYMLINKDs. */
-  if (iErr && (errno == ENOENT)) RETURN_INT(0); /* Already deleted. Not an error. */
-  if (iErr) RETURN_INT(1);
-  
-  iErr = zapFileM(path, sStat.st_mode, pzo);
-  RETURN_INT(iErr);
-}
-
-int zapDirM(const char *path, int iMode, zapOpts *pzo) {
-  char *pPath;
-  int iErr;
-  struct stat sStat;
-  DIR *pDir;
-  struct dirent *pDE;
-  int nErr = 0;
-  int iFlags = pzo->iFlags;
-  int iNoExec = iFlags & FLAG_NOEXEC;
-  char *pszSuffix;
-
-  DEBUG_ENTER(("zapDirM(\"%s\", 0x%04X);\n", path, iMode));
-
-  if (!S_ISDIR(iMode)) {
-    errno = ENOTDIR;
-    RETURN_INT(1);
-  }
-
-  pDir = opendirx(path);
-  if (!pDir) RETURN_INT(1);
-  while ((pDE = readdirx(pDir)) != NULL) {
-    DEBUG_PRINTF(("// Dir Entry \"%s\" d_type=%d\n", pDE->d_name, (int)(pDE->d_type)));
-    pPath = NewPathName(path, pDE->d_name);
-    pszSuffix = "";
-#if _DIRENT2STAT_DEFINED /* MsvcLibX return DOS/Windows stat info in the dirent structure */
-    iErr = dirent2stat(pDE, &sStat);
-#else /* Unix has to query it separately */
-    iErr = -lstat(pPath, &sStat); /* If error, iErr = 1 = # of errors */
-#endif
-    if (!iErr) switch (pDE->d_type) {
-      case DT_DIR:
-      	if (streq(pDE->d_name, ".")) break;	/* Skip the . directory */
-      	if (streq(pDE->d_name, "..")) break;	/* Skip the .. directory */
-      	iErr = zapDirM(pPath, sStat.st_mode, pzo);
-      	pszSuffix = DIRSEPARATOR_STRING;
-      	break;
-#if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
-      case DT_LNK:
-      	pszSuffix = ">";
-      	/* Fall through into the DT_REG case */
-#endif
-      case DT_REG:
-	iErr = zapFileM(pPath, sStat.st_mode, pzo);
-      	break;
-      default:
-      	iErr = 1;		/* We don't support deleting there */
-#if defined(ENOSYS)
-      	errno = ENOSYS;		/* Function not supported */
-#else
-      	errno = EPERM;		/* Operation not permitted */
-#endif
-      	pszSuffix = "?";
-      	break;
-    }
-    if (iErr) {
-      if (pDE->d_type != DT_DIR) printError("Error deleting \"%s%s\": %s", pPath, pszSuffix, strerror(errno));
-      nErr += iErr;
-      /* Continue the directory scan, looking for other files to delete */
-    }
-    free(pPath);
-  }
-  closedirx(pDir);
-
-  iErr = 0;
-  pszSuffix = DIRSEPARATOR_STRING;
-  if (path[strlen(path) - 1] == DIRSEPARATOR_CHAR) pszSuffix = ""; /* There's already a trailing separator */
-  if (iFlags & FLAG_COMMAND) {
-    printf(DEL_FILE " \"%s\"\n", path);
-  } else if (iFlags & FLAG_VERBOSE){
-    printf("%s%s%s\n", pzo->pszPrefix, path, pszSuffix);
-  }
-  if (!iNoExec) iErr = rmdir(path);
-  if (iErr) {
-    printError("Error deleting \"%s%s\": %s", path, pszSuffix, strerror(errno));
-    nErr += 1;
-  }
-
-  RETURN_INT_COMMENT(nErr, (nErr ? "%d deletions failed\n" : "Success\n", nErr));
-}
-
-int zapDir(const char *path, zapOpts *pzo) {
-  int iErr;
-  struct stat sStat;
-
-  DEBUG_ENTER(("zapDir(\"%s\");\n", path));
-
-  iErr = lstat(path, &sStat); /* Use lstat, as stat does not detect SYMLINKDs. */
-  if (iErr && (errno == ENOENT)) RETURN_INT(0); /* Already deleted. Not an error. */
-  if (iErr) {
-    printError("Error: Can't stat \"%s\": %s", path, strerror(errno));
-    RETURN_INT(1);
-  }
-  
-  iErr = zapDirM(path, sStat.st_mode, pzo);
-  RETURN_INT(iErr);
-}
-
-#ifdef _MSC_VER
-#pragma warning(default:4459)
-#endif
-
 /******************************************************************************
 *                                                                             *
 *       Function:       filecompare                                           *
@@ -2543,3 +2648,442 @@ int filecompare(char *name1, char *name2) { /* Compare two files */
   RETURN_INT_COMMENT(dif, ("Files are %s\n", dif ? "different" : "identical"));
 }
 
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    FreeDict						      |
+|									      |
+|   Description:    Delete a dictionary and all its entries		      |
+|									      |
+|   Parameters:     dict_t *dict	The dictionary			      |
+|									      |
+|   Returns:	    Nothing						      |
+|									      |
+|   Notes:	    The values are freed by the dictionary destructor, if any.|
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void FreeDict(dict_t *dict) {
+  dictnode *pNode;
+  while ((pNode = FirstDictValue(dict)) != NULL) {
+    DeleteDictValue(dict, pNode->pszKey);
+  }
+  free(dict);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    UpdateCRC32						      |
+|									      |
+|   Description:    Update a running CRC-32 with the data in a buffer	      |
+|									      |
+|   Parameters:     DWORD crc		The CRC so far. 0 for the first block |
+|		    const void *pBuf	The data buffer			      |
+|		    size_t len		The data size			      |
+|									      |
+|   Returns:	    The updated standard CRC-32				      |
+|									      |
+|   Notes:	    Table-driven, with the table built on the first call.     |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+DWORD UpdateCRC32(DWORD crc, const void *pBuf, size_t len) {
+  static DWORD dwTable[256];
+  static int iTableDone = FALSE;
+  const BYTE *pb = (const BYTE *)pBuf;
+
+  if (!iTableDone) {
+    DWORD n, c;
+    int k;
+    for (n = 0; n < 256; n++) {
+      for (c = n, k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+      dwTable[n] = c;
+    }
+    iTableDone = TRUE;
+  }
+
+  crc = ~crc & 0xFFFFFFFFUL;
+  while (len--) crc = dwTable[(crc ^ *(pb++)) & 0xFF] ^ (crc >> 8);
+  return ~crc & 0xFFFFFFFFUL;
+}
+
+/* Compute the CRC-32 of a whole file. Returns 0=Success, else -1 */
+int FileCRC32(char *name, DWORD *pdwCRC) {
+  FILE *pf = fopen(name, "rb");
+  size_t n;
+  int iErr;
+
+  if (!pf) return -1;
+  *pdwCRC = 0;
+  while ((n = fread(buffer, 1, BUFFERSIZE, pf)) > 0) *pdwCRC = UpdateCRC32(*pdwCRC, buffer, n);
+  iErr = ferror(pf) ? -1 : 0;
+  fclose(pf);
+  return iErr;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    LoadManifest					      |
+|									      |
+|   Description:    Load the manifest of files written by the previous runs   |
+|									      |
+|   Parameters:     char *pszRoot	The target root directory	      |
+|									      |
+|   Returns:	    The number of errors encountered. 0=Success		      |
+|									      |
+|   Notes:	    The manifest is a text file in the target root, with a    |
+|		    header line, then one line per file written:	      |
+|		    SIZE MTIME CRC32 RELATIVE_PATHNAME			      |
+|		    CRC32 is - for the target files found up to date, to      |
+|		    avoid reading them. It's computed when copying a file.    |
+|		    A missing manifest is not an error. It means that all     |
+|		    target files must be checked, as without a manifest.      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#define MANIFEST_LINE_SIZE (PATHNAME_SIZE + 64)
+
+int LoadManifest(char *pszRoot) {
+  FILE *pf;
+  char *pszName;
+  char *pszLine;
+  int nEntries = 0;
+
+  DEBUG_ENTER(("LoadManifest(\"%s\");\n", pszRoot));
+
+  pManifest = NewDict(free);
+  pszManifestRoot = strdup(pszRoot);
+  pszName = NewPathName(pszRoot, MANIFEST_NAME);
+  pszLine = malloc(MANIFEST_LINE_SIZE);
+  if ((!pManifest) || (!pszManifestRoot) || (!pszName) || (!pszLine)) {
+    printError("Error: Not enough memory");
+    pManifest = NULL; /* Disable the manifest mode */
+    free(pszName);
+    free(pszLine);
+    RETURN_INT(1);
+  }
+
+  pf = fopen(pszName, "r");
+  if (pf) {
+    if ((!fgets(pszLine, MANIFEST_LINE_SIZE, pf)) || strncmp(pszLine, MANIFEST_HEADER, strlen(MANIFEST_HEADER))) {
+      printError("Warning: Ignoring invalid manifest \"%s\"", pszName);
+    } else while (fgets(pszLine, MANIFEST_LINE_SIZE, pf)) {
+      uintmax_t uSize;
+      intmax_t iTime;
+      char szCRC[16];
+      int n = -1;
+      char *pc;
+      manifestEntry *pEntry;
+      if ((sscanf(pszLine, "%" SCNuMAX " %" SCNdMAX " %15s %n", &uSize, &iTime, szCRC, &n) < 3) || (n < 0)) continue;
+      pc = strchr(pszLine+n, '\n');
+      if (pc) *pc = '\0';
+      if (!pszLine[n]) continue;
+      pEntry = malloc(sizeof(manifestEntry));
+      if (!pEntry) break;
+      pEntry->size = (off_t)uSize;
+      pEntry->mtime = (time_t)iTime;
+      pEntry->iCRC = strcmp(szCRC, "-");
+      pEntry->crc = pEntry->iCRC ? (DWORD)strtoul(szCRC, NULL, 16) : 0;
+      SetDictValue(pManifest, pszLine+n, pEntry);
+      nEntries += 1;
+    }
+    fclose(pf);
+  }
+  if (iVerbose) printf(COMMENT "Loaded %d entries from manifest %s\n", nEntries, pszName);
+
+  free(pszName);
+  free(pszLine);
+  RETURN_INT_COMMENT(0, ("%d entries\n", nEntries));
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    SaveManifest					      |
+|									      |
+|   Description:    Save the updated manifest into the target root	      |
+|									      |
+|   Parameters:     None						      |
+|									      |
+|   Returns:	    The number of errors encountered. 0=Success		      |
+|									      |
+|   Notes:	    Written into a temporary file first, then renamed, so     |
+|		    that an interrupted run leaves the old manifest intact.   |
+|		    With a durability policy, call syncall() first, so that   |
+|		    the files are durable before the manifest describing      |
+|		    them. Then the temporary file is synced before renaming   |
+|		    it, and the rename is synced with the next syncall().     |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+|    2026-10-18 JFL Sync the temporary file before renaming it.		      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int SaveManifest(void) {
+  FILE *pf;
+  char *pszName;
+  char *pszTemp;
+  dictnode *pNode;
+  int iErr = 0;
+
+  DEBUG_ENTER(("SaveManifest();\n"));
+
+  if ((!pManifest) || (!iManifestChanged) || test) RETURN_CONST_COMMENT(0, ("Nothing to save\n"));
+  if (!is_directory(pszManifestRoot)) { /* The target was a file, or nothing was copied */
+    RETURN_CONST_COMMENT(0, ("No target directory\n"));
+  }
+
+  pszName = NewPathName(pszManifestRoot, MANIFEST_NAME);
+  pszTemp = pszName ? malloc(strlen(pszName) + 5) : NULL;
+  if (!pszTemp) {
+    printError("Error: Not enough memory");
+    free(pszName);
+    RETURN_INT(1);
+  }
+  sprintf(pszTemp, "%s.tmp", pszName);
+
+  pf = fopen(pszTemp, "w");
+  if (!pf) {
+    printError("Error: Can't create \"%s\": %s", pszTemp, strerror(errno));
+    free(pszName);
+    free(pszTemp);
+    RETURN_INT(1);
+  }
+  fprintf(pf, "%s\n", MANIFEST_HEADER);
+  for (pNode = FirstDictValue(pManifest); pNode; pNode = NextDictValue(pManifest, pNode)) {
+    manifestEntry *pEntry = pNode->pData;
+    char szCRC[16] = "-";
+    if (strchr(pNode->pszKey, '\n')) continue; /* Can't be recorded in a line-based file */
+    if (pEntry->iCRC) sprintf(szCRC, "%08lX", (unsigned long)(pEntry->crc));
+    fprintf(pf, "%" PRIuMAX " %" PRIdMAX " %s %s\n", (uintmax_t)(pEntry->size),
+	    (intmax_t)(pEntry->mtime), szCRC, pNode->pszKey);
+  }
+  if (fflush(pf) || ferror(pf)) iErr = 1;
+  if ((!iErr) && syncfilenow(fileno(pf))) iErr = 1;
+  if (fclose(pf)) iErr = 1;
+#if defined(_MSDOS) || defined(_WIN32)
+  if (!iErr) unlink(pszName); /* rename() fails if the target exists */
+#endif
+  if ((!iErr) && rename(pszTemp, pszName)) iErr = 1;
+  if ((!iErr) && syncname(pszName)) iErr = 1;
+  if (iErr) {
+    printError("Error: Can't write manifest \"%s\": %s", pszName, strerror(errno));
+    unlink(pszTemp);
+  } else if (iVerbose) {
+    printf(COMMENT "Saved %d entries into manifest %s\n", GetDictSize(pManifest), pszName);
+  }
+
+  free(pszName);
+  free(pszTemp);
+  RETURN_INT(iErr);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    ManifestKey						      |
+|									      |
+|   Description:    Get the manifest key for a target pathname		      |
+|									      |
+|   Parameters:     char *path		The target pathname		      |
+|									      |
+|   Returns:	    A pointer to the part of path relative to the target      |
+|		    root, or NULL if it's not in the target root.	      |
+|									      |
+|   Notes:	    All target pathnames are built by appending names to the  |
+|		    target root argument, so a simple prefix test suffices.   |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+char *ManifestKey(char *path) {
+  size_t lRoot;
+
+  if (!pszManifestRoot) return NULL;
+  lRoot = strlen(pszManifestRoot);
+  if (strncmp(path, pszManifestRoot, lRoot)) return NULL;
+  path += lRoot;
+  if (   (*path != DIRSEPARATOR_CHAR)
+      && ((!lRoot) || (pszManifestRoot[lRoot-1] != DIRSEPARATOR_CHAR))) {
+    return NULL; /* This is another name beginning like the root */
+  }
+  while (*path == DIRSEPARATOR_CHAR) path++;
+  if (!*path) return NULL; /* This is the root itself */
+  return path;
+}
+
+void ForgetManifestEntry(char *path) {
+  char *pszKey = pManifest ? ManifestKey(path) : NULL;
+  if (pszKey && DictValue(pManifest, pszKey)) {
+    DEBUG_PRINTF(("// Removing %s from the manifest\n", pszKey));
+    DeleteDictValue(pManifest, pszKey);
+    iManifestChanged = TRUE;
+  }
+}
+
+void RecordManifestEntry(char *pszKey, struct stat *pStat, DWORD *pdwCRC) {
+  manifestEntry *pEntry = malloc(sizeof(manifestEntry));
+  if (!pEntry) return; /* Not fatal. The file will just be checked again next time */
+  pEntry->size = pStat->st_size;
+  pEntry->mtime = pStat->st_mtime;
+  pEntry->iCRC = (pdwCRC != NULL);
+  pEntry->crc = pdwCRC ? *pdwCRC : 0;
+  DEBUG_PRINTF(("// Recording %s in the manifest\n", pszKey));
+  SetDictValue(pManifest, pszKey, pEntry);
+  iManifestChanged = TRUE;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    StatsClock						      |
+|									      |
+|   Description:    Get the current time, for the statistics		      |
+|									      |
+|   Parameters:     None						      |
+|									      |
+|   Returns:	    A monotonic time in seconds, or 0 if not collecting stats |
+|									      |
+|   Notes:	    Returning 0 makes all time differences 0, so that the     |
+|		    callers don't need to test the iStats flag.		      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+double StatsClock(void) {
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+#endif
+
+  if (!iStats) return 0;
+#if defined(CLOCK_MONOTONIC)
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec / 1E9);
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    StatsRecordCopy					      |
+|									      |
+|   Description:    Record the statistics for one file copied		      |
+|									      |
+|   Parameters:     uintmax_t nBytes	The file size			      |
+|		    double dCopy	The time spent copying the data	      |
+|		    double dCopyDate	The time spent copying the date	      |
+|									      |
+|   Returns:	    Nothing						      |
+|									      |
+|   Notes:	    The peak throughput is measured over windows of at least  |
+|		    PEAK_WINDOW seconds of copy time, as the time taken by    |
+|		    small files is too short to be significant.		      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void StatsRecordCopy(uintmax_t nBytes, double dCopy, double dCopyDate) {
+  double dLatency = dCopy + dCopyDate;
+  double dLimit = 100E-6;
+  int i;
+
+  stats.nCopied += 1;
+  stats.nBytes += nBytes;
+  stats.adPhase[PHASE_COPY] += dCopy;
+  stats.adPhase[PHASE_COPYDATE] += dCopyDate;
+
+  for (i = 0; (i < (N_LATENCIES-1)) && (dLatency >= dLimit); i++) dLimit *= 10;
+  stats.anLatency[i] += 1;
+
+  stats.nWindowBytes += nBytes;
+  stats.dWindowTime += dCopy;
+  if (stats.dWindowTime >= PEAK_WINDOW) {
+    double dRate = (double)stats.nWindowBytes / stats.dWindowTime;
+    if (dRate > stats.dPeakRate) stats.dPeakRate = dRate;
+    stats.nWindowBytes = 0;
+    stats.dWindowTime = 0;
+  }
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function:	    ShowStats						      |
+|									      |
+|   Description:    Display the statistics report			      |
+|									      |
+|   Parameters:     double dTotal	The total run time		      |
+|									      |
+|   Returns:	    Nothing						      |
+|									      |
+|   Notes:	    Throughputs are computed over the copy phase time only.   |
+|		    If no peak window was ever complete, the peak throughput  |
+|		    is the average throughput.				      |
+|									      |
+|   History:								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#define MB (1024.0*1024.0)
+
+void ShowStats(double dTotal) {
+  long nSkipped = stats.nScanned - stats.nCopied - stats.nFailed;
+  double dCopy = stats.adPhase[PHASE_COPY];
+  double dRate = dCopy ? ((double)stats.nBytes / dCopy) : 0;
+  double dPeak = stats.dPeakRate ? stats.dPeakRate : dRate;
+  long nSynced;
+  double dSync;
+  int i;
+
+  if (nSkipped < 0) nSkipped = 0; /* In test mode, nothing is copied */
+  GetSyncStats(&nSynced, &dSync);
+
+  if (iStats == STATS_JSON) {
+    printf("{\n");
+    printf("  \"files\": {\"scanned\": %ld, \"compared\": %ld, \"copied\": %ld, \"skipped\": %ld, \"failed\": %ld, \"deleted\": %ld},\n",
+	   stats.nScanned, stats.nCompared, stats.nCopied, nSkipped, stats.nFailed, stats.nDeleted);
+    printf("  \"bytes_copied\": %"PRIuMAX",\n", stats.nBytes);
+    printf("  \"mb_per_s\": {\"average\": %.3f, \"peak\": %.3f},\n", dRate / MB, dPeak / MB);
+    printf("  \"latency_histogram\": {");
+    for (i = 0; i < N_LATENCIES; i++) {
+      printf("%s\"%s\": %ld", i ? ", " : "", pszLatencyNames[i], stats.anLatency[i]);
+    }
+    printf("},\n");
+    printf("  \"seconds\": {");
+    for (i = 0; i < N_PHASES; i++) {
+      printf("\"%s\": %.6f, ", pszPhaseNames[i], stats.adPhase[i]);
+    }
+    printf("\"sync\": %.6f, \"total\": %.6f},\n", dSync, dTotal);
+    printf("  \"durability\": {\"policy\": \"%s\", \"files_synced\": %ld}\n", GetSyncPolicyName(), nSynced);
+    printf("}\n");
+    return;
+  }
+
+  printf(COMMENT "Files: %ld scanned, %ld compared, %ld copied, %ld skipped, %ld failed, %ld deleted\n",
+	 stats.nScanned, stats.nCompared, stats.nCopied, nSkipped, stats.nFailed, stats.nDeleted);
+  printf(COMMENT "Data: %"PRIuMAX" bytes copied, %.3f MB/s average, %.3f MB/s peak\n",
+	 stats.nBytes, dRate / MB, dPeak / MB);
+  printf(COMMENT "Copy latency:");
+  for (i = 0; i < N_LATENCIES; i++) {
+    printf(" %s=%ld", pszLatencyNames[i], stats.anLatency[i]);
+  }
+  printf("\n");
+  printf(COMMENT "Time:");
+  for (i = 0; i < N_PHASES; i++) {
+    printf(" %s=%.3fs", pszPhaseNames[i], stats.adPhase[i]);
+  }
+  printf(" sync=%.3fs total=%.3fs\n", dSync, dTotal);
+}
@@ -39,13 +39,25 @@
 *    2022-11-27 JFL Added PATHNAME - to get the list of pathnames from stdin. *
 *                   Version 1.6.					      *
 *    2022-12-12 JFL Removed the piped input line size limit. Version 1.6.1.   *
+*    2026-10-18 JFL Moved zapFile(), zapFileM() and zapDirM() to SysLib, where *
+*		    zapDirM() now deletes subdirectories in parallel, relative *
+*		    to their parent directory handle in Unix. Version 1.7.     *
+*    2026-10-18 JFL Added option -m to move directories aside into a trash    *
+*		    directory, and purge it in a detached background process. *
+*		    Added option -P to resume unfinished purges. Version 1.8.  *
+*    2026-10-18 JFL Added option -Q to set the number of files deletions kept *
+*		    in flight by each thread. Version 1.9.		      *
+*    2026-10-18 JFL Option -m now refuses non-empty directories without -r    *
+*		    or -f, like the normal mode. Remove the trash directory   *
+*		    after purging it, if it's in the parent directory.	      *
+*		    Version 1.9.1.					      *
 *		    							      *
 \*****************************************************************************/
 
 #define PROGRAM_DESCRIPTION "Delete files and/or directories visibly"
 #define PROGRAM_NAME    "zap"
-#define PROGRAM_VERSION "1.6.1"
-#define PROGRAM_DATE    "2022-12-12"
+#define PROGRAM_VERSION "1.9.1"
+#define PROGRAM_DATE    "2026-10-18"
 
 #include "predefine.h" /* Define optional features we need in the C libraries */
 
@@ -61,6 +73,8 @@
 #include "debugm.h"	/* SysToolsLib debug macros. Include first. */
 #include "mainutil.h"	/* SysLib helper routines for main() */
 #include "dirx.h"	/* SysLib Directory access functions eXtensions */
+#include "zapfile.h"	/* SysLib File and directory deletion functions */
+#include "metaio.h"	/* SysLib batched file metadata operations */
 #include "stversion.h"	/* SysToolsLib version strings. Include last. */
 
 DEBUG_GLOBALS	/* Define global variables used by our debugging macros */
@@ -77,6 +91,19 @@ DEBUG_GLOBALS	/* Define global variables used by our debugging macros */
 
 #define OS_HAS_DRIVES FALSE
 
+#define HAS_ASIDE 1	/* Directories can be moved aside, and purged in the background */
+
+#include <fcntl.h>
+#include <sys/file.h>		/* For flock() */
+#include <sys/resource.h>	/* For setpriority() */
+#include <sys/wait.h>
+#if defined(__linux__)
+#include <sys/syscall.h>	/* For SYS_ioprio_set */
+#endif
+
+#define TRASH_NAME ".zap-trash"	/* Followed by -UID, to be private to each user */
+#define TRASH_LOCK ".lock"	/* Lock file held by the background purger */
+
 #endif
 
 /************************ Win32-specific definitions *************************/
@@ -126,28 +153,20 @@ char *szHalRefusal = "I'm sorry Dave, I'm afraid I can't do that";
 void usage(void);
 int isEffectiveDir(const char *pszPath);
 char *NewPathName(const char *path, const char *name);
-/* zap functions options */
-typedef struct zapOpts {
-  int iFlags;
-  char *pszPrefix;
-  unsigned long *pNDeleted;
-} zapOpts;
-/* zapOpts iFlags */
-#define FLAG_VERBOSE	0x0001		/* Display the pathname operated on */
-#define FLAG_NOEXEC	0x0002		/* Do not actually execute */
-#define FLAG_RECURSE	0x0004		/* Recursive operation */
-#define FLAG_NOCASE	0x0008		/* Ignore case */
-#define FLAG_FORCE	0x0010		/* Force operation on read-only files */
-#define FLAG_ZAPBAK	0x0020		/* Zap backup files */
+/* zap functions options, in addition to the FLAG_XXX in zapfile.h */
+#define FLAG_ZAPBAK	FLAG_USER_FLAG	/* Zap backup files */
+#define FLAG_ASIDE	(FLAG_USER_FLAG << 1) /* Move directories aside, and purge them in the background */
 int zap(char *arg, zapOpts *pzo); /* Remove whatever the argument refers to */
 int zapFiles(const char *pathname, zapOpts *pzo); /* Remove files in a directory */
 int zapBaks(const char *path, zapOpts *pzo); /* Remove backup files in a dir */
-int zapFile(const char *path, zapOpts *pzo); /* Delete a file */
-int zapFileM(const char *path, int iMode, zapOpts *pzo); /* Faster */
 int zapDir(const char *path, zapOpts *pzo);  /* Delete a directory */
-int zapDirM(const char *path, int iMode, zapOpts *pzo); /* Faster */
 int zapDirs(const char *path, zapOpts *pzo); /* Delete multiple directories */
 int isRootDir(const char *dir);		/* Check if dir is a root directory */
+#if HAS_ASIDE
+int zapAside(const char *path, zapOpts *pzo); /* Move a directory into the trash */
+int ResumePurge(const char *path);	/* Purge the trash on path's file system */
+int StartPurges(void);			/* Start the background purge of all trashes used */
+#endif
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
@@ -173,6 +192,7 @@ int main(int argc, char *argv[]) {
   zapOpts zo = {FLAG_VERBOSE | (IGNORECASE ? FLAG_NOCASE : 0), "", NULL};
   int nZaps = 0;
   int iProcessSwitches = TRUE;
+  int iPurge = FALSE;
 
   zo.pNDeleted = &nDeleted;
   
@@ -215,14 +235,32 @@ int main(int argc, char *argv[]) {
 	zo.iFlags &= ~FLAG_NOCASE;
 	continue;
       }
+#if HAS_ASIDE
+      if (streq(opt, "m")) {	/* Move directories aside, and purge them in the background */
+	zo.iFlags |= FLAG_ASIDE;
+	continue;
+      }
+#endif
       if (streq(opt, "p")) {	/* Prefix string */
 	if (((i+1) < argc) && !IsSwitch(argv[i+1])) zo.pszPrefix = argv[++i];
 	continue;
       }
+#if HAS_ASIDE
+      if (streq(opt, "P")) {	/* Resume purging the trash */
+	iPurge = TRUE;
+	continue;
+      }
+#endif
       if (streq(opt, "q")) {	/* Quiet mode */
 	zo.iFlags &= ~FLAG_VERBOSE;
 	continue;
       }
+#if HAS_METAIO
+      if (streq(opt, "Q")) {	/* Max # of metadata requests in flight */
+	if (((i+1) < argc) && !IsSwitch(argv[i+1])) SetMetaIoDepth(atoi(argv[++i]));
+	continue;
+      }
+#endif
       if (streq(opt, "r")) {	/* Deleting files recursively in all subdirectories */
 	zo.iFlags |= FLAG_RECURSE;
 	continue;
@@ -248,6 +286,12 @@ int main(int argc, char *argv[]) {
     } /* End if it's a switch */
     /* If it's an argument */
     nZaps += 1;
+#if HAS_ASIDE
+    if (iPurge) {
+      nErr += ResumePurge(arg);
+      continue;
+    }
+#endif
     if (streq(arg, "-")) {
       nErr += zap(NULL, &zo); /* Get the list of files to erase from stdin */
     } else {
@@ -260,6 +304,14 @@ int main(int argc, char *argv[]) {
     nErr += zapBaks(NULL, &zo);
   }
 
+#if HAS_ASIDE
+  if (iPurge && !nZaps) {
+    nZaps += 1;
+    nErr += ResumePurge(".");
+  }
+  if (!(zo.iFlags & FLAG_NOEXEC)) nErr += StartPurges();
+#endif
+
   if (!nZaps) {
     if (!isatty(fileno(stdin))) nErr += zap(NULL, &zo);
     /* But if stdin is the console, don't block as there's nothing to do */
@@ -312,9 +364,24 @@ Switches:\n\
   -b          Delete backup files: *.bak, *~, #*#    Default path: .\n\
   -f          Force deleting read-only files, and non-empty directories\n\
   -i          Ignore case. Default in Windows\n\
-  -I          Do not ignore case. Default in Unix\n\
-  -p PREFIX   Prefix string to insert ahead of output file names\n\
-  -q          Quiet mode. Do not output the deleted files names\n\
+  -I          Do not ignore case. Default in Unix\n"
+#if HAS_ASIDE
+"\
+  -m          Move directories aside, and purge them in the background\n"
+#endif
+"\
+  -p PREFIX   Prefix string to insert ahead of output file names\n"
+#if HAS_ASIDE
+"\
+  -P          Resume the purge of the trash on the PATHNAMEs file systems\n"
+#endif
+"\
+  -q          Quiet mode. Do not output the deleted files names\n"
+#if HAS_METAIO
+"\
+  -Q N        Delete up to N files in parallel per thread. Default: 64. 1=Sync.\n"
+#endif
+"\
   -r          Delete files recursively in all subdirectories\n\
   -V          Display this program version and exit\n\
   -X          NoExec mode: Display what would be deleted, but don't do it\n\
@@ -333,8 +400,14 @@ Notes:\n\
 * Deleting a non-existent file or directory is not an error. Nothing's output.\n\
 * If pathname is . then all . contents will be deleted, but not . itself.\n\
 * Deleting a non-empty directory (including .) requires using option -r or -f.\n\
-* For your own safety, the program will refuse to delete root directories.\n\
-"
+* For your own safety, the program will refuse to delete root directories.\n"
+#if HAS_ASIDE
+"\
+* With -m, directories are renamed into a " TRASH_NAME "-UID directory at the\n\
+  root of their file system, or else in their parent directory. This returns\n\
+  immediately, and a low priority background process then deletes them.\n\
+  If it is interrupted, the next zap -m or zap -P on that file system resumes it.\n"
+#endif
 #include "footnote.h"
 , progcmd, progcmd);
   exit(0);
@@ -698,6 +771,10 @@ int zapBaks(const char *path, zapOpts *pzo) {
 |		    Split zapFile() off of zapDir().			      |
 |		    Added zapXxxM routines, with an additional iMode argument,|
 |		     to avoid unnecessary slow calls to lstat() in Windows.   |
+|    2026-10-18 JFL Moved zapFile(), zapFileM() and zapDirM() to SysLib.      |
+|    2026-10-18 JFL Move the directory aside if FLAG_ASIDE is set.	      |
+|    2026-10-18 JFL But only if FLAG_RECURSE is set, else zapDirM() refuses   |
+|		    to delete non-empty directories.			      |
 *		    							      *
 \*---------------------------------------------------------------------------*/
 
@@ -705,161 +782,6 @@ int zapBaks(const char *path, zapOpts *pzo) {
 #pragma warning(disable:4706) /* Ignore the "assignment within conditional expression" warning */
 #endif
 
-/* Delete one file or link - Internal method */
-int zapFileM(const char *path, int iMode, zapOpts *pzo) {
-  int iFlags = pzo->iFlags;
-  char *pszSuffix = "";
-  int iErr = 0;
-
-  DEBUG_ENTER(("zapFileM(\"%s\", 0x%04X);\n", path, iMode));
-
-  if (S_ISDIR(iMode)) {
-    errno = EISDIR;
-    iErr = 1;
-    goto cleanup_and_return;
-  }
-#if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
-  if (S_ISLNK(iMode)) {
-    pszSuffix = ">";
-  }
-#endif
-
-  if (iFlags & FLAG_VERBOSE) printf("%s%s%s\n", pzo->pszPrefix, path, pszSuffix);
-  if (iFlags & FLAG_NOEXEC) RETURN_INT(0);
-  if (iFlags & FLAG_FORCE) {
-    if (!(iMode & S_IWRITE)) {
-      iMode |= S_IWRITE;
-      DEBUG_PRINTF(("chmod(%p, 0x%X);\n", path, iMode));
-      iErr = -chmod(path, iMode); /* Try making the target file writable */
-      DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
-    }
-    if (iErr) goto cleanup_and_return;
-  }
-  iErr = -unlink(path); /* If error, iErr = 1 = # of errors */
-
-cleanup_and_return:
-  if (iErr) {
-    printError("Error deleting \"%s\": %s", path, strerror(errno));
-  } else {
-    if (pzo->pNDeleted) *(pzo->pNDeleted) += 1; /* Number of files successfully deleted */
-  }
-
-  RETURN_INT(iErr);
-}
-
-/* Delete one file or link */
-int zapFile(const char *path, zapOpts *pzo) {
-  int iErr;
-  struct stat sStat;
-  size_t len;
-
-  DEBUG_ENTER(("zapFile(\"%s\");\n", path));
-
-  if ((!path) || !(len = strlen(path))) RETURN_INT_COMMENT(1, ("path is empty\n"));
-
-  iErr = lstat(path, &sStat); /* Use lstat, as stat does not detect SYMLINKDs. */
-  if (iErr && (errno == ENOENT)) RETURN_INT(0); /* Already deleted. Not an error. */
-  if (iErr) {
-    printError("Error: Can't delete \"%s\": %s", path, strerror(errno));
-    RETURN_INT(1);
-  }
-  
-  iErr = zapFileM(path, sStat.st_mode, pzo);
-  RETURN_INT(iErr);
-}
-
-/* Delete one directory - Internal method */
-int zapDirM(const char *path, int iMode, zapOpts *pzo) {
-  char *pPath;
-  int iErr;
-  struct stat sStat;
-  DIR *pDir;
-  struct dirent *pDE;
-  int nErr = 0;
-  int iFlags = pzo->iFlags;
-  int iVerbose = iFlags & FLAG_VERBOSE;
-  int iNoExec = iFlags & FLAG_NOEXEC;
-  char *pszSuffix = DIRSEPARATOR_STRING;
-
-  DEBUG_ENTER(("zapDirM(\"%s\", 0x%04X);\n", path, iMode));
-
-  if (!S_ISDIR(iMode)) {
-    errno = ENOTDIR;
-    goto fail;
-  }
-
-  if (iFlags & FLAG_RECURSE) { /* If in recursive mode, delete everything inside */
-    pDir = opendirx(path);
-    if (!pDir) goto fail;
-    while ((pDE = readdirx(pDir))) { /* readdirx() ensures d_type is set */
-      DEBUG_PRINTF(("// Dir Entry \"%s\" d_type=%d\n", pDE->d_name, (int)(pDE->d_type)));
-      pPath = NewPathName(path, pDE->d_name);
-      if (!pPath) {
-      	closedirx(pDir);
-      	goto fail; /* Will report out of memory */
-      }
-      pszSuffix = "";
-#if _DIRENT2STAT_DEFINED /* MsvcLibX return DOS/Windows stat info in the dirent structure */
-      iErr = dirent2stat(pDE, &sStat);
-#else /* Unix has to query it separately */
-      iErr = -lstat(pPath, &sStat); /* If error, iErr = 1 = # of errors */
-#endif
-      if (!iErr) switch (pDE->d_type) {
-	case DT_DIR:
-	  if (streq(pDE->d_name, ".")) break;	/* Skip the . directory */
-	  if (streq(pDE->d_name, "..")) break;	/* Skip the .. directory */
-	  /* Do not update iErr, as the error is already reported by the subroutine */
-	  nErr += zapDirM(pPath, sStat.st_mode, pzo);
-	  pszSuffix = DIRSEPARATOR_STRING;
-	  break;
-#if defined(S_ISLNK) && S_ISLNK(S_IFLNK) /* In DOS it's defined, but always returns 0 */
-	case DT_LNK:
-	  pszSuffix = ">";
-	  /* Fall through into the DT_REG case */
-#endif
-	case DT_REG:
-	  /* Do not update iErr, as the error is already reported by the subroutine */
-	  nErr += zapFileM(pPath, sStat.st_mode, pzo);
-	  break;
-	default:
-	  iErr = 1;		/* We don't support deleting there */
-#if defined(ENOSYS)
-	  errno = ENOSYS;		/* Function not supported */
-#else
-	  errno = EPERM;		/* Operation not permitted */
-#endif
-	  pszSuffix = "?";
-	  break;
-      }
-      if (iErr) {
-	if (pDE->d_type != DT_DIR) printError("Error deleting \"%s%s\": %s", pPath, pszSuffix, strerror(errno));
-	nErr += iErr;
-	/* Continue the directory scan, looking for other files to delete */
-      }
-      free(pPath);
-    }
-    closedirx(pDir);
-  }
-
-  /* Skip the directory deletion if the directory is . or PATH\. or  D:. */
-  if (!streq(GetFileName(path), ".")) {
-    iErr = 0;
-    pszSuffix = DIRSEPARATOR_STRING;
-    if (path[strlen(path) - 1] == DIRSEPARATOR_CHAR) pszSuffix = ""; /* There's already a trailing separator */
-    if (iVerbose) printf("%s%s%s\n", pzo->pszPrefix, path, pszSuffix);
-    if (!iNoExec) iErr = rmdir(path);
-    if (iErr) {
-fail:
-      printError("Error deleting \"%s%s\": %s", path, pszSuffix, strerror(errno));
-      nErr += 1;
-    } else {
-      if (pzo->pNDeleted) *(pzo->pNDeleted) += 1; /* Number of files successfully deleted */
-    }
-  }
-
-  RETURN_INT_COMMENT(nErr, (nErr ? "%d deletions failed\n" : "Success\n", nErr));
-}
-
 /* Delete one directory */
 int zapDir(const char *path, zapOpts *pzo) {
   int iErr;
@@ -887,6 +809,15 @@ int zapDir(const char *path, zapOpts *pzo) {
     RETURN_INT(1);
   }
 
+#if HAS_ASIDE
+  if (   (zo.iFlags & FLAG_ASIDE) && (zo.iFlags & FLAG_RECURSE)
+      && S_ISDIR(sStat.st_mode) && !streq(GetFileName(path), ".")) {
+    iErr = zapAside(path, &zo);
+    if (iErr >= 0) RETURN_INT(iErr);
+    /* Else it could not be moved aside. Delete it immediately instead. */
+  }
+#endif
+
   iErr = zapDirM(path, sStat.st_mode, &zo);
   RETURN_INT(iErr);
 }
@@ -1046,3 +977,393 @@ int zap(char *arg, zapOpts *pzo) {
   RETURN_INT(zapFiles(arg, pzo));
 }
 
+
+#if HAS_ASIDE
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    NewTrashDirName					      |
+|									      |
+|   Description     Find the trash directory for a given file system	      |
+|									      |
+|   Parameters      const char *dir		A directory on that file system|
+|		    int iCreate			TRUE=Create it if needed      |
+|		    int *piLocal		Set to TRUE if it's in dir    |
+|		    							      |
+|   Returns	    Pointer to the new trash pathname, or NULL if none.	      |
+|		    							      |
+|   Notes	    The trash is at the root of the file system if possible,  |
+|		    else in the directory itself. In both cases, it's on the  |
+|		    same device, so that rename() can move things into it.    |
+|		    It's named after the user ID, and it must be owned by the |
+|		    user, to prevent other users from tampering with it.      |
+|		    A trash in the directory itself must be removed when it's |
+|		    purged, to avoid leaving it behind in the user's tree.    |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+|    2026-10-18 JFL Added the piLocal argument.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+/* Check if a pathname is a usable trash directory on a given device */
+static int isTrashDir(const char *path, dev_t dev) {
+  struct stat sStat;
+  if (lstat(path, &sStat)) return FALSE;
+  return S_ISDIR(sStat.st_mode) && (sStat.st_uid == getuid()) && (sStat.st_dev == dev);
+}
+
+char *NewTrashDirName(const char *dir, int iCreate, int *piLocal) {
+  char szName[32];
+  char *pszReal;
+  char *pszRoot = NULL;
+  char *pszTrash = NULL;
+  struct stat sDir, sUp;
+
+  DEBUG_ENTER(("NewTrashDirName(\"%s\", %d);\n", dir, iCreate));
+
+  *piLocal = FALSE;
+  sprintf(szName, TRASH_NAME "-%lu", (unsigned long)getuid());
+  pszReal = realpath(dir, NULL);
+  if ((!pszReal) || stat(pszReal, &sDir)) goto cleanup_and_return;
+
+  /* Find the file system mount point, walking up while the device is the same */
+  pszRoot = strdup(pszReal);
+  if (!pszRoot) goto cleanup_and_return;
+  for (;;) {
+    char *pSlash = strrchr(pszRoot, '/');
+    char *pEnd;
+    char cSave;
+    if ((!pSlash) || !pSlash[1]) break;		/* We've reached the / root */
+    pEnd = (pSlash == pszRoot) ? pSlash + 1 : pSlash; /* Keep the / if it's the root */
+    cSave = *pEnd;
+    *pEnd = '\0';
+    if (stat(pszRoot, &sUp) || (sUp.st_dev != sDir.st_dev)) {
+      *pEnd = cSave; /* The parent is on another file system. Stay here. */
+      break;
+    }
+  }
+
+  /* Try the root of the file system first, then the directory itself */
+  pszTrash = NewPathName(pszRoot, szName);
+  if (!pszTrash) goto cleanup_and_return;
+  if (iCreate) mkdir(pszTrash, 0700);
+  if (isTrashDir(pszTrash, sDir.st_dev)) goto cleanup_and_return;
+  free(pszTrash);
+  pszTrash = NewPathName(pszReal, szName);
+  if (!pszTrash) goto cleanup_and_return;
+  if (iCreate) mkdir(pszTrash, 0700);
+  *piLocal = !streq(pszReal, pszRoot);
+  if (isTrashDir(pszTrash, sDir.st_dev)) goto cleanup_and_return;
+  free(pszTrash);
+  pszTrash = NULL;
+
+cleanup_and_return:
+  free(pszReal);
+  free(pszRoot);
+  DEBUG_LEAVE(("return \"%s\";\n", pszTrash ? pszTrash : "(null)"));
+  return pszTrash;
+}
+
+/* List of the trash directories that need purging */
+typedef struct {
+  char *pszTrash;	/* The trash pathname */
+  int iLocal;		/* TRUE if it's not at the file system root, and must be removed */
+} trash;
+static trash *pTrashes = NULL;
+static int nTrashes = 0;
+
+static void AddTrash(char *pszTrash, int iLocal) { /* Takes ownership of pszTrash */
+  int i;
+  trash *pt;
+  for (i = 0; i < nTrashes; i++) {
+    if (streq(pTrashes[i].pszTrash, pszTrash)) {
+      free(pszTrash);
+      return;
+    }
+  }
+  pt = realloc(pTrashes, (nTrashes + 1) * sizeof(trash));
+  if (!pt) {
+    free(pszTrash);
+    return;
+  }
+  pTrashes = pt;
+  pTrashes[nTrashes].pszTrash = pszTrash;
+  pTrashes[nTrashes++].iLocal = iLocal;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    zapAside						      |
+|									      |
+|   Description     Move a directory into the trash, to be purged later       |
+|									      |
+|   Parameters      const char *path		The directory pathname	      |
+|		    zapOpts *pzo		Zap options		      |
+|		    							      |
+|   Returns	    0 = Success, or -1 if it can't be moved aside.	      |
+|		    							      |
+|   Notes	    The rename is atomic: The directory is either entirely    |
+|		    there, or entirely gone from the caller's point of view.  |
+|		    If it fails, the caller deletes the directory directly.   |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int zapAside(const char *path, zapOpts *pzo) {
+  static unsigned long nMoved = 0;
+  char *pszPath;
+  char *pszParent;
+  const char *pszName;
+  char *pszTrash = NULL;
+  char *pszTarget = NULL;
+  size_t len;
+  int iErr = -1;
+  int iLocal;
+
+  DEBUG_ENTER(("zapAside(\"%s\");\n", path));
+
+  pszPath = strdup(path);
+  if (!pszPath) RETURN_INT(-1);
+  len = strlen(pszPath);
+  while ((len > 1) && (pszPath[len-1] == DIRSEPARATOR_CHAR)) pszPath[--len] = '\0';
+  pszName = GetFileName(pszPath);
+
+  if (pzo->iFlags & FLAG_NOEXEC) {
+    if (pzo->iFlags & FLAG_VERBOSE) printf("%s%s%s\n", pzo->pszPrefix, pszPath, DIRSEPARATOR_STRING);
+    iErr = 0;
+    goto cleanup_and_return;
+  }
+
+  pszParent = NewPathName(pszPath, ".."); /* Don't use dirname(), which may modify its argument */
+  if (!pszParent) goto cleanup_and_return;
+  pszTrash = NewTrashDirName(pszParent, TRUE, &iLocal);
+  free(pszParent);
+  if (!pszTrash) goto cleanup_and_return;
+  pszTarget = malloc(strlen(pszTrash) + strlen(pszName) + 48);
+  if (!pszTarget) goto cleanup_and_return;
+  sprintf(pszTarget, "%s/%ld-%lu-%s", pszTrash, (long)getpid(), nMoved++, pszName);
+  DEBUG_PRINTF(("rename(\"%s\", \"%s\");\n", pszPath, pszTarget));
+  if (rename(pszPath, pszTarget)) {
+    DEBUG_PRINTF(("// Can't move it aside: %s\n", strerror(errno)));
+    goto cleanup_and_return;
+  }
+  if (pzo->iFlags & FLAG_VERBOSE) printf("%s%s%s\n", pzo->pszPrefix, pszPath, DIRSEPARATOR_STRING);
+  if (pzo->pNDeleted) *(pzo->pNDeleted) += 1;
+  AddTrash(pszTrash, iLocal);	/* Schedule its purge when we exit */
+  pszTrash = NULL;
+  iErr = 0;
+
+cleanup_and_return:
+  free(pszTarget);
+  free(pszTrash);
+  free(pszPath);
+  RETURN_INT(iErr);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    ResumePurge						      |
+|									      |
+|   Description     Schedule the purge of the trash on a given file system    |
+|									      |
+|   Parameters      const char *path		A path on that file system    |
+|		    							      |
+|   Returns	    0 = Success, else 1					      |
+|		    							      |
+|   Notes	    Not finding any trash is not an error.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int ResumePurge(const char *path) {
+  char *pszTrash;
+  char *pszDir = NULL;
+  int iLocal;
+
+  DEBUG_ENTER(("ResumePurge(\"%s\");\n", path));
+
+  if (!isEffectiveDir(path)) { /* Use the directory containing that file */
+    pszDir = strdup(path);
+    if (!pszDir) {
+      printError("Out of memory");
+      RETURN_INT(1);
+    }
+    path = dirname(pszDir);
+  }
+  pszTrash = NewTrashDirName(path, FALSE, &iLocal);
+  if (pszTrash) {
+    printf("%s\n", pszTrash);
+    AddTrash(pszTrash, iLocal);
+  }
+  free(pszDir);
+  RETURN_INT(0);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    PurgeTrash						      |
+|									      |
+|   Description     Delete everything in a trash directory		      |
+|									      |
+|   Parameters      const char *pszTrash	The trash directory	      |
+|		    int iRemove			TRUE=Remove the trash too     |
+|		    							      |
+|   Returns	    0 = Success, else the number of items left		      |
+|		    							      |
+|   Notes	    Runs in the detached background process.		      |
+|		    Only one purger runs per trash, serialized by a lock file.|
+|		    A purger that finds the lock taken exits immediately, as  |
+|		    the active one rescans the trash until it's empty. After  |
+|		    releasing the lock, it checks for late additions again,   |
+|		    so that nothing added meanwhile gets forgotten.	      |
+|		    If another zap moves something in while the trash is      |
+|		    being removed, rmdir() fails and the trash is kept, or    |
+|		    its rename() fails and it deletes the directory itself.   |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+|    2026-10-18 JFL Added the iRemove argument.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#ifdef _MSC_VER
+#pragma warning(disable:4706) /* Ignore the "assignment within conditional expression" warning */
+#endif
+
+/* Delete the trash contents once, if pnLeft is set. Returns the number of items found */
+static int PurgeTrashOnce(const char *pszTrash, int *pnLeft) {
+  zapOpts zo = {FLAG_RECURSE | FLAG_FORCE, "", NULL};
+  DIR *pDir;
+  struct dirent *pDE;
+  int nFound = 0;
+
+  if (pnLeft) *pnLeft = 0;
+  pDir = opendir(pszTrash);
+  if (!pDir) return 0;
+  while ((pDE = readdir(pDir))) {
+    char *pszPathname;
+    struct stat sStat;
+    int iErr;
+    if (streq(pDE->d_name, ".") || streq(pDE->d_name, "..") || streq(pDE->d_name, TRASH_LOCK)) continue;
+    nFound += 1;
+    if (!pnLeft) continue; /* Just count them */
+    pszPathname = NewPathName(pszTrash, pDE->d_name);
+    if (!pszPathname) break;
+    iErr = lstat(pszPathname, &sStat);
+    if (!iErr) iErr = S_ISDIR(sStat.st_mode) ? zapDirM(pszPathname, sStat.st_mode, &zo)
+					     : zapFileM(pszPathname, sStat.st_mode, &zo);
+    if (iErr) *pnLeft += 1;
+    free(pszPathname);
+  }
+  closedir(pDir);
+  return nFound;
+}
+
+#ifdef _MSC_VER
+#pragma warning(default:4706)
+#endif
+
+int PurgeTrash(const char *pszTrash, int iRemove) {
+  char *pszLock = NewPathName(pszTrash, TRASH_LOCK);
+  int fdLock;
+  int nFound;
+  int nLeft = 0;
+
+  if (!pszLock) return 1;
+  fdLock = open(pszLock, O_RDWR | O_CREAT | O_NOFOLLOW, 0600);
+  if (fdLock == -1) {
+    free(pszLock);
+    return 1;
+  }
+  for (;;) {
+    if (flock(fdLock, LOCK_EX | LOCK_NB)) break; /* Another purger is at work */
+    do { /* Rescan until it's empty, or we can't delete anything more */
+      nFound = PurgeTrashOnce(pszTrash, &nLeft);
+    } while (nLeft && (nLeft < nFound));
+    if (iRemove && !nLeft && !PurgeTrashOnce(pszTrash, NULL)) {
+      /* Still holding the lock, so no other purger can be using it */
+      unlink(pszLock);
+      if (rmdir(pszTrash)) {
+	DEBUG_PRINTF(("// Can't remove %s: %s\n", pszTrash, strerror(errno)));
+      }
+    }
+    flock(fdLock, LOCK_UN);
+    /* Check if something was added while we were releasing the lock */
+    if (PurgeTrashOnce(pszTrash, NULL) <= nLeft) break;
+  }
+  close(fdLock);
+  free(pszLock);
+  return nLeft;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    StartPurges						      |
+|									      |
+|   Description     Start a detached background process purging the trashes  |
+|									      |
+|   Parameters      None						      |
+|		    							      |
+|   Returns	    0 = Success, else 1					      |
+|		    							      |
+|   Notes	    Uses a double fork, so that the purger is adopted by init,|
+|		    and survives the end of the calling shell or CI step.     |
+|		    The purger is throttled by running at the lowest CPU      |
+|		    priority, in the idle I/O class in Linux, and with a      |
+|		    single deletion thread, so that it only uses the disk     |
+|		    bandwidth that nobody else wants.			      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int StartPurges(void) {
+  pid_t pid;
+  int i;
+  int fd;
+
+  DEBUG_ENTER(("StartPurges(); // %d trashes\n", nTrashes));
+
+  if (!nTrashes) RETURN_INT(0);
+  fflush(stdout);	/* Else the child would output the buffered data again */
+  fflush(stderr);
+  pid = fork();
+  if (pid == -1) {
+    printError("Error: Can't start the background purge: %s", strerror(errno));
+    RETURN_INT(1);
+  }
+  if (pid) { /* The parent process */
+    waitpid(pid, NULL, 0);	/* Wait for the intermediate child, which exits immediately */
+    RETURN_INT(0);
+  }
+
+  /* The intermediate child process */
+  setsid();			/* Detach from the controlling terminal */
+  pid = fork();
+  if (pid) _exit(pid == -1);
+
+  /* The background purger process */
+  fd = open("/dev/null", O_RDWR);
+  if (fd != -1) {
+    dup2(fd, 0);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    if (fd > 2) close(fd);
+  }
+  if (chdir("/")) {}		/* Don't keep any mount point busy */
+  setpriority(PRIO_PROCESS, 0, 19);
+#if defined(__linux__) && defined(SYS_ioprio_set)
+  syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0, 3 << 13 /* IOPRIO_CLASS_IDLE */);
+#endif
+  SetZapThreads(1);
+  for (i = 0; i < nTrashes; i++) PurgeTrash(pTrashes[i].pszTrash, pTrashes[i].iLocal);
+  _exit(0);
+}
+
+#endif /* HAS_ASIDE */
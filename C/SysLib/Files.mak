@@ -13,6 +13,13 @@
 #    2016-10-11 JFL moved debugm.h to SysToolsLib global C include dir.       #
 #    2020-03-11 JFL Added Unix-specific object modules.                       #
 #    2024-01-07 JFL Define both NMINCLUDE and STINCLUDE.		      #
+#    2026-10-18 JFL Added syncfile.c.					      #
+#    2026-10-18 JFL Added zapfile.c.					      #
+#    2026-10-18 JFL Added metaio.c.					      #
+#    2026-10-18 JFL Added textfilt.c.					      #
+#    2026-10-18 JFL Added rewrite.c.					      #
+#    2026-10-18 JFL Added filttree.c.					      #
+#    2026-10-18 JFL Added textpipe.c.					      #
 #									      #
 #          Copyright 2016 Hewlett Packard Enterprise Development LP          #
 # Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 #
@@ -49,11 +56,18 @@ COMMON_OBJECTS = \
     $(BASE_OBJECTS)		\
     +$(O)/CondQuoteShellArg.obj	\
     +$(O)/dict.obj		\
+    +$(O)/filttree.obj		\
     +$(O)/DupArgLineTail.obj	\
     +$(O)/copydate.obj		\
     +$(O)/JoinPaths.obj		\
+    +$(O)/metaio.obj		\
     +$(O)/pferror.obj		\
+    +$(O)/rewrite.obj		\
+    +$(O)/syncfile.obj		\
+    +$(O)/textfilt.obj		\
+    +$(O)/textpipe.obj		\
     +$(O)/WalkDirTree.obj	\
+    +$(O)/zapfile.obj		\
 
 # Microsoft-OS-specific objects are defined conditionally in SysLib.mak
 # MS_OBJECTS = \
@@ -215,6 +229,20 @@ $(S)/stringx.c: $(S)/stringx.h
 
 $(S)/stringx.h: $(S)/SysLib.h
 
+$(S)/filttree.c: $(MI)/debugm.h $(S)/SysLib.h $(S)/dirx.h $(S)/pathnames.h $(S)/mainutil.h $(S)/textfilt.h
+
+$(S)/metaio.c: $(MI)/debugm.h $(S)/SysLib.h $(S)/metaio.h
+
+$(S)/rewrite.c: $(MI)/debugm.h $(S)/SysLib.h $(S)/rewrite.h
+
+$(S)/syncfile.c: $(MI)/debugm.h $(S)/SysLib.h $(S)/copyfile.h
+
+$(S)/textfilt.c: $(MI)/debugm.h $(S)/SysLib.h $(S)/rewrite.h $(S)/textfilt.h
+
+$(S)/textpipe.c: $(MI)/debugm.h $(S)/SysLib.h $(S)/mainutil.h $(S)/textfilt.h
+
+$(S)/zapfile.c: $(MI)/debugm.h $(S)/SysLib.h $(S)/dirx.h $(S)/pathnames.h $(S)/mainutil.h $(S)/metaio.h $(S)/zapfile.h
+
 $(S)/SysLib.h:
 
 $(S)/Uuid.c: $(S)/Uuid.h $(S)/macaddr.h
@@ -227,5 +255,5 @@ $(S)/VxDCall.c: $(S)/VxDCall.h
 
 $(S)/VxDCall.h: $(S)/SysLib.h
 
-$(S)/WalkDirTree.c: $(CI)/dict.h $(CI)/tree.h $(S)/dirx.h $(S)/mainutil.h $(S)/pathnames.h
+$(S)/WalkDirTree.c: $(CI)/dict.h $(CI)/tree.h $(S)/dirx.h $(S)/mainutil.h $(S)/metaio.h $(S)/pathnames.h
 
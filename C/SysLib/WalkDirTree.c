@@ -32,6 +32,9 @@
 *		    read a (possibly linked) directory, give it a second      *
 *		    chance to be read through another pathname.		      *
 *		    Bugfix: The callback was sometimes called twice for dirs. *
+*    2026-10-18 JFL Added WDT_STAT, getting the lstat() of the entries in     *
+*		    batches, with many requests in flight using metaio.c.     *
+*    2026-10-18 JFL Callbacks can return WDT_SKIPDIR to prune a directory.    *
 *                                                                             *
 \*****************************************************************************/
 
@@ -44,7 +47,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h>
@@ -62,6 +67,7 @@
 #include "dirx.h"		/* Directory access functions eXtensions */
 #include "pathnames.h"		/* Pathname management definitions and functions */
 #include "mainutil.h"		/* Print errors, streq, etc */
+#include "metaio.h"		/* Batched file metadata operations */
 
 /*---------------------------------------------------------------------------*\
 *                                                                             *
@@ -210,25 +216,52 @@ typedef struct _NAMELIST {
   const char *path;
 } NAMELIST;
 
-/* For the sorting list, we allocate an extra int flags behind the dirent copy */
+/* For the sorting and WDT_STAT lists, we allocate extra data behind the dirent copy */
+typedef struct {
+  int iFlags;			/* DEF_XXX flags */
+  int iStatErr;			/* WDT_STAT: 0 if sStat is valid, else the lstat() errno */
+  struct stat sStat;		/* WDT_STAT: The entry lstat() */
+} DIRENT_EXTRA;
+
+/* The extra data is aligned on the next 8-bytes boundary */
+#define DIRENT_EXTRA_OFFSET(pDE) ((DirentRecLen(pDE) + 7) & ~7)
+
+static DIRENT_EXTRA *GetDirentExtra(const struct dirent *pDE) {
+  return (DIRENT_EXTRA *)((char *)pDE + DIRENT_EXTRA_OFFSET(pDE));
+}
+
 int *DirentExtraFlags(struct dirent *pDE) {
-  return AfterDirent(pDE);
+  return &(GetDirentExtra(pDE)->iFlags);
+}
+
+struct stat *DirentStat(const struct dirent *pDE) {
+  DIRENT_EXTRA *pExtra = GetDirentExtra(pDE);
+  if (pExtra->iStatErr) {
+    errno = pExtra->iStatErr;
+    return NULL;
+  }
+  return &(pExtra->sStat);
 }
 
-struct dirent *DupDirent(struct dirent *pDE, int iExtra) {
+/* Duplicate a dirent, with its extra data if bCopyExtra, else with cleared extra data */
+struct dirent *DupDirent(struct dirent *pDE, int bCopyExtra) {
   int lDE = DirentRecLen(pDE);
-  char *pDE2 = malloc(lDE + iExtra);
+  int lCopy = DIRENT_EXTRA_OFFSET(pDE);
+  int lTotal = lCopy + (int)sizeof(DIRENT_EXTRA);
+  char *pDE2 = malloc(lTotal);
   if (pDE2) {
-    memcpy(pDE2, pDE, lDE);
-    memset(pDE2+lDE, 0, iExtra); /* Clear the extra bytes */
+    if (bCopyExtra) lCopy = lTotal;
+    else lCopy = lDE;
+    memcpy(pDE2, pDE, lCopy);
+    memset(pDE2+lCopy, 0, lTotal - lCopy); /* Clear the extra bytes */
   }
   return (struct dirent *)pDE2;
 }
 
-struct dirent **AppendDirentList(struct dirent **pDEList, struct dirent *pDE, int *pnDEListSize, int *pnDE) {
+struct dirent **AppendDirentList(struct dirent **pDEList, struct dirent *pDE, int *pnDEListSize, int *pnDE, int bCopyExtra) {
   int nDE = *pnDE;
   int nDEListSize = *pnDEListSize;
-  struct dirent *pDE2 = DupDirent(pDE, sizeof(int)); /* Allocate an extended structure with an extra tail int */
+  struct dirent *pDE2 = DupDirent(pDE, bCopyExtra); /* Allocate an extended structure with extra tail data */
   if (!pDE2) return NULL;
   if (nDE >= nDEListSize) { /* Overcautious, as == should be sufficient */
     pDEList = (struct dirent **)realloc(pDEList, (nDEListSize += 16) * sizeof(struct dirent *));
@@ -243,6 +276,98 @@ struct dirent **AppendDirentList(struct dirent **pDEList, struct dirent *pDE, in
   return pDEList;
 }
 
+/* WDT_STAT: A batch of directory entries read ahead, with their lstat() */
+#define WDT_STAT_BATCH 256
+
+typedef struct {
+  struct dirent **pList;	/* Entries read ahead */
+  int nSize;			/* Size of the pList array */
+  int n;			/* Number of entries in pList */
+  int iNext;			/* Index of the next entry to return */
+  int iEOF;			/* TRUE when readdirx() has returned NULL */
+  int iErrno;			/* The errno when readdirx() returned NULL */
+  int fd;			/* Directory handle for the relative lstat()s. -1 if not open */
+} DIRENT_BATCH;
+
+static void FreeDirentBatch(DIRENT_BATCH *pBatch) {
+  int i;
+  for (i=0; i<pBatch->n; i++) free(pBatch->pList[i]);
+  pBatch->n = pBatch->iNext = 0;
+}
+
+#if HAS_METAIO
+static void StatDirentDone(void *pRef, int iResult) {
+  DIRENT_EXTRA *pExtra = pRef;
+  pExtra->iStatErr = (iResult < 0) ? -iResult : 0;
+}
+#endif
+
+/* Get the lstat() of all entries in the batch, with many requests in flight */
+static void StatDirentBatch(const char *pszDir, DIRENT_BATCH *pBatch, wdt_opts *pOpts) {
+  int i;
+#if HAS_METAIO
+  METAIO *pMio = pOpts->pMetaIo;
+  if (pBatch->fd == -1) pBatch->fd = open(pszDir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+  for (i=0; i<pBatch->n; i++) {
+    struct dirent *pDE = pBatch->pList[i];
+    DIRENT_EXTRA *pExtra = GetDirentExtra(pDE);
+    int iErr;
+#if HAS_METAIO
+    if (pBatch->fd != -1) {
+      if (pMio && !MetaIoLstatAt(pMio, pBatch->fd, pDE->d_name, &(pExtra->sStat), StatDirentDone, pExtra)) continue;
+      iErr = fstatat(pBatch->fd, pDE->d_name, &(pExtra->sStat), AT_SYMLINK_NOFOLLOW);
+      pExtra->iStatErr = iErr ? errno : 0;
+      continue;
+    }
+#endif
+    { /* Else use the full pathname */
+      char *pszPathname = NewJoinedPath(pszDir, pDE->d_name);
+      if (pszPathname) {
+	iErr = lstat(pszPathname, &(pExtra->sStat));
+	pExtra->iStatErr = iErr ? errno : 0;
+	free(pszPathname);
+      } else {
+	pExtra->iStatErr = ENOMEM;
+      }
+    }
+  }
+#if HAS_METAIO
+  if (pMio) MetaIoWait(pMio);
+#endif
+}
+
+/* WDT_STAT replacement for readdirx(), reading entries ahead in batches */
+static struct dirent *ReadDirentBatch(DIR *pDir, const char *pszDir, DIRENT_BATCH *pBatch, wdt_opts *pOpts) {
+  struct dirent *pDE;
+  if (pBatch->iNext >= pBatch->n) { /* The current batch is exhausted. Read the next one. */
+    FreeDirentBatch(pBatch);
+    while ((!pBatch->iEOF) && (pBatch->n < WDT_STAT_BATCH)) {
+      errno = 0;
+      pDE = readdirx(pDir);
+      if (!pDE) {
+	pBatch->iEOF = TRUE;
+	pBatch->iErrno = errno;
+	break;
+      }
+      if (streq(pDE->d_name, ".") || streq(pDE->d_name, "..")) continue;
+      pBatch->pList = AppendDirentList(pBatch->pList, pDE, &(pBatch->nSize), &(pBatch->n), FALSE);
+      if (!pBatch->pList) {
+	pBatch->n = pBatch->nSize = 0;
+	pBatch->iEOF = TRUE;
+	pBatch->iErrno = ENOMEM;
+	break;
+      }
+    }
+    StatDirentBatch(pszDir, pBatch, pOpts);
+    if (!pBatch->n) {
+      errno = pBatch->iErrno;
+      return NULL;
+    }
+  }
+  return pBatch->pList[pBatch->iNext++];
+}
+
 #if _DEBUG
 char *DumpOpts(wdt_opts *po) {
   static char szBuf[16];
@@ -292,6 +417,10 @@ static int WalkDirTree1(const char *path, wdt_opts *pOpts, pWalkDirTreeCB_t pWal
   int nDEListSize = 0;
   int nDE = 0;
   int i;
+  DIRENT_BATCH batch = {0};
+  int bCreatedMetaIo = FALSE;
+
+  batch.fd = -1;
 
   DEBUG_ENTER(("WalkDirTree(\"%s\", {%s}, ..., %d);\n", path, DumpOpts(pOpts), iDepth));
 
@@ -343,6 +472,13 @@ static int WalkDirTree1(const char *path, wdt_opts *pOpts, pWalkDirTreeCB_t pWal
 
   pOpts->nDir += 1;	/* One more directory scanned */
 
+#if HAS_METAIO
+  if ((pOpts->iFlags & WDT_STAT) && !pOpts->pMetaIo) { /* Share a queue for lstat() requests with the whole walk */
+    pOpts->pMetaIo = NewMetaIo(0); /* If NULL, StatDirentBatch() does synchronous calls */
+    bCreatedMetaIo = TRUE;
+  }
+#endif
+
   if (!prev) { /* Record the true name of the directory tree root to search from */
 #if OS_HAS_LINKS
     iErr = stat(path_to_read, &sStat);
@@ -390,12 +526,14 @@ static int WalkDirTree1(const char *path, wdt_opts *pOpts, pWalkDirTreeCB_t pWal
   if (  (pOpts->iFlags & WDT_INONLY)
       && pOpts->iMaxDepth && (iDepth >= pOpts->iMaxDepth)) goto cleanup_and_return;
 
-  while ((pDE = readdirx(pDir)) != NULL) { /* readdirx() ensures d_type is set */
+  while ((pDE = ((pOpts->iFlags & WDT_STAT) ? ReadDirentBatch(pDir, path_to_read, &batch, pOpts)
+					    : readdirx(pDir))) != NULL) { /* readdirx() ensures d_type is set */
 #if OS_HAS_LINKS
     int bIsDir;		 /* TRUE if this is a link pointing to a directory */
     char *pszBadLinkMsg; /* Flag bad links, pointing at a description of the problem */
 #endif /* OS_HAS_LINKS */
     int *piFlags = NULL;
+    int bSkipDir = FALSE; /* TRUE if the callback asked not to recurse in this dir */
 
     DEBUG_PRINTF(("// Dir Entry \"%s\" d_type=%d\n", pDE->d_name, (int)(pDE->d_type)));
 
@@ -416,7 +554,12 @@ static int WalkDirTree1(const char *path, wdt_opts *pOpts, pWalkDirTreeCB_t pWal
     if (   ((pDE->d_type == DT_DIR) || (pDE->d_type == DT_LNK))
         && ((pOpts->iFlags & WDT_FOLLOW) || (pOpts->iFlags & WDT_ONCE))) {
       errno = 0;
-      iErr = stat(pRelatName, &sStat); /* This may fail, even if d_type == DT_DIR */
+      if ((pDE->d_type == DT_DIR) && (pOpts->iFlags & WDT_STAT) && DirentStat(pDE)) {
+	sStat = *DirentStat(pDE); /* lstat() and stat() are the same for a real directory */
+	iErr = 0;
+      } else {
+	iErr = stat(pRelatName, &sStat); /* This may fail, even if d_type == DT_DIR */
+      }
       if (!iErr) bIsDir = S_ISDIR(sStat.st_mode);
       if (bIsDir && ((pUniqueID = GetUniqueIdString(&sStat)) != NULL)) {
 	if (pOpts->iFlags & WDT_FOLLOW) {
@@ -459,9 +602,13 @@ static int WalkDirTree1(const char *path, wdt_opts *pOpts, pWalkDirTreeCB_t pWal
       if (!(pOpts->pSortProc)) {
 	XDEBUG_PRINTF(("// Callback on valid dirent, if !DIRONLY && !sort\n"));
 	iRet = pWalkDirTreeCB(pPathname, pDE, pRef);
+	if (iRet == WDT_SKIPDIR) { /* Don't recurse in this directory */
+	  bSkipDir = TRUE;
+	  iRet = 0;
+	}
 	if (iRet) break;	/* -1 = Error, abort; 1 = Success, stop */
       } else { /* Sorted list requested */
-      	pDEList = AppendDirentList(pDEList, pDE, &nDEListSize, &nDE);
+      	pDEList = AppendDirentList(pDEList, pDE, &nDEListSize, &nDE, (pOpts->iFlags & WDT_STAT));
       	if (!pDEList) goto out_of_memory;
       }
     }
@@ -507,15 +654,19 @@ static int WalkDirTree1(const char *path, wdt_opts *pOpts, pWalkDirTreeCB_t pWal
 	  if (!(pOpts->pSortProc)) {
 	    XDEBUG_PRINTF(("// Callback on valid dirent, if DIRONLY && !sort\n"));
 	    iRet = pWalkDirTreeCB(pPathname, pDE, pRef);
+	    if (iRet == WDT_SKIPDIR) { /* Don't recurse in this directory */
+	      bSkipDir = TRUE;
+	      iRet = 0;
+	    }
 	    if (iRet) break;	/* -1 = Error, abort; 1 = Success, stop */
 	  } else { /* Sorted list requested */
-	    pDEList = AppendDirentList(pDEList, pDE, &nDEListSize, &nDE);
+	    pDEList = AppendDirentList(pDEList, pDE, &nDEListSize, &nDE, (pOpts->iFlags & WDT_STAT));
 	    if (!pDEList) goto out_of_memory;
 	    piFlags = DirentExtraFlags(pDEList[nDE-1]);
 	    *piFlags = DEF_ISDIR;
 	  }
 	}
-	if (!(pOpts->iFlags & WDT_NORECURSE)) {
+	if (!(pOpts->iFlags & WDT_NORECURSE) && !bSkipDir) {
 	  if ((!pOpts->iMaxDepth) || (iDepth < pOpts->iMaxDepth)) {
 	    if (!(pOpts->pSortProc)) {
 #if OS_HAS_LINKS
@@ -587,6 +738,10 @@ print_dir_op_error:
       if (!pPathname) goto out_of_memory;
       XDEBUG_PRINTF(("// Callback on valid dirent, if sort\n"));
       iRet = pWalkDirTreeCB(pPathname, pDE, pRef);
+      if (iRet == WDT_SKIPDIR) { /* Don't recurse in this directory */
+	*DirentExtraFlags(pDE) &= ~DEF_RECURSE;
+	iRet = 0;
+      }
       if (iRet) break;	/* -1 = Error, abort; 1 = Success, stop */
       if (*DirentExtraFlags(pDE) & DEF_RECURSE) { /* A recursive call to WalkDirTree1() is requested */
 	/* if (!list.path) list.path = pPathname; */
@@ -633,6 +788,15 @@ cleanup_and_return:
   }
 #endif /* OS_HAS_LINKS */
   if (pDEList) for (i=0; i<nDE; i++) free(pDEList[i]);
+  FreeDirentBatch(&batch);
+  free(batch.pList);
+  if (batch.fd != -1) close(batch.fd);
+#if HAS_METAIO
+  if (bCreatedMetaIo) {
+    FreeMetaIo(pOpts->pMetaIo);
+    pOpts->pMetaIo = NULL;
+  }
+#endif
   free(pFakeInOutDE);
   if (pOpts->iFlags & WDT_CD) {
     if (iChdirDone) {
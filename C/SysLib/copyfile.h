@@ -8,6 +8,8 @@
 *                                                                             *
 *   History                                                                   *
 *    2020-11-05 JFL Created this file.                                        *
+*    2026-10-18 JFL Added the file durability policy routines.                *
+*    2026-10-18 JFL Added syncfilenow() and syncname().			      *
 *                                                                             *
 *         © Copyright 2020 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -20,4 +22,19 @@
 
 int copydate(const char *pszToFile, const char *pszFromFile); /* Copy the file dates */
 
+/* Durability policies for the files written, in syncfile.c */
+#define SYNC_NONE	0	/* Don't sync anything. Fast, but unsafe */
+#define SYNC_FILE	1	/* fsync() every file before closing it */
+#define SYNC_BATCH	2	/* Start every file write-back, and wait for batches */
+#define SYNC_END	3	/* Sync the whole file system once at the end */
+
+int SetSyncPolicy(const char *pszPolicy); /* Select "none", "file", "batch", or "end" */
+int GetSyncPolicy(void);		/* Get the current SYNC_XXX policy */
+const char *GetSyncPolicyName(void);	/* Get its name */
+int syncfile(int fd);			/* Sync a file according to the policy. Call before closing it */
+int syncfilenow(int fd);		/* Sync a file immediately, unless the policy is none */
+int syncname(const char *pszPath);	/* Sync the directory entry of a new file or directory */
+int syncall(void);			/* Complete all pending syncs */
+void GetSyncStats(long *pnFiles, double *pdSeconds); /* Get the # of files synced and the time spent */
+
 #endif /* _COPYFILE_H_ */
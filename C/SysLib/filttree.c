@@ -0,0 +1,280 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        filttree.c                                                *
+*                                                                             *
+*   Description     Apply a text filter to all files in a directory tree      *
+*                                                                             *
+*   Notes           Used by the -r option of trim, detab, deffeed, and        *
+*		    remplace.						      *
+*		    							      *
+*		    The tree is scanned by WalkDirTree() in the main thread,  *
+*		    which queues the pathnames of the matching files. In      *
+*		    Unix, a pool of worker threads filters them in parallel.  *
+*		    The queue length is bounded, so that the scan does not    *
+*		    run far ahead of the workers in huge trees.		      *
+*		    Symbolic links are not followed, and never replaced by    *
+*		    regular files.					      *
+*		    							      *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.                                        *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define _CRT_SECURE_NO_WARNINGS /* Prevent warnings about using fopen, etc */
+
+#define _GNU_SOURCE		/* Include as many extensions as possible */
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fnmatch.h>
+
+#include "debugm.h"		/* SysToolsLib debug macros */
+
+#include "dirx.h"		/* Directory access functions eXtensions */
+#include "pathnames.h"		/* Pathname management definitions and functions */
+#include "mainutil.h"		/* Print errors, streq, etc */
+#include "textfilt.h"		/* Public definitions for this file */
+
+/************************* Unix-specific definitions *************************/
+
+#ifdef _UNIX		/* Defined in SysLib.h for Unix flavors we support */
+
+#include <unistd.h>
+#include <pthread.h>
+
+#define HAS_THREADS 1		/* Files can be filtered in parallel */
+#define FNM_FTFLAGS 0		/* File names are case-sensitive */
+
+#endif /* _UNIX */
+
+/*********************** End of OS-specific definitions **********************/
+
+#ifndef HAS_THREADS
+#define HAS_THREADS 0
+#endif
+
+#ifndef FNM_FTFLAGS		/* fnmatch() flags for the include and exclude patterns */
+#define FNM_FTFLAGS FNM_CASEFOLD
+#endif
+
+#ifndef FNM_MATCH
+#define FNM_MATCH	0	/* Simpler than testing != FNM_NO_MATCH */
+#endif
+
+#define FT_MAX_THREADS 64	/* Beyond this, the disk is the bottleneck anyway */
+#define FT_MAX_QUEUE 1024	/* Max # of pathnames queued ahead of the workers */
+
+typedef struct ftItem {		/* A queued pathname */
+  struct ftItem *pNext;
+  char szPath[1];
+} ftItem;
+
+typedef struct {		/* The state shared by the scan and the workers */
+  filterTreeOpts *pfto;
+  pTextFilter_t pFilter;
+  void *pRef;
+  int nThreads;			/* Number of worker threads running */
+#if HAS_THREADS
+  pthread_mutex_t mutex;	/* Protects everything below, and the pfto counters */
+  pthread_cond_t cond;		/* Signaled when a pathname is queued or dequeued */
+  ftItem *pFirst;		/* The queue of pathnames to filter */
+  ftItem *pLast;
+  int nQueued;			/* Number of pathnames in the queue */
+  int iDone;			/* TRUE when the scan is complete */
+#endif
+} ftPool;
+
+#if HAS_THREADS
+#define ftLock(pPool) pthread_mutex_lock(&(pPool)->mutex)
+#define ftUnlock(pPool) pthread_mutex_unlock(&(pPool)->mutex)
+#else
+#define ftLock(pPool) (void)0
+#define ftUnlock(pPool) (void)0
+#endif
+
+/* Filter one file, and record the result */
+static void ftFilterFile(ftPool *pPool, const char *pszPath) {
+  filterTreeOpts *pfto = pPool->pfto;
+  long lnChanges;
+
+  DEBUG_PRINTF(("// Filtering %s\n", pszPath));
+  lnChanges = FilterFileInPlace(pszPath, pPool->pFilter, pPool->pRef);
+  ftLock(pPool);
+  if (lnChanges < 0) {
+    pfcerror("Can't update %s", pszPath);
+    pfto->nErrors += 1;
+  } else if (lnChanges > 0) {
+    pfto->nChanged += 1;
+    pfto->lnChanges += lnChanges;
+    if (pfto->iFlags & FT_VERBOSE) printf("%s\n", pszPath);
+  }
+  ftUnlock(pPool);
+}
+
+#if HAS_THREADS
+
+/* Queue a pathname for the workers. Returns 0 if done, or -1 if error */
+static int ftQueue(ftPool *pPool, const char *pszPath) {
+  size_t l = strlen(pszPath);
+  ftItem *pItem = malloc(sizeof(ftItem) + l);
+
+  if (!pItem) return -1;
+  memcpy(pItem->szPath, pszPath, l+1);
+  pItem->pNext = NULL;
+  pthread_mutex_lock(&pPool->mutex);
+  while (pPool->nQueued >= FT_MAX_QUEUE) pthread_cond_wait(&pPool->cond, &pPool->mutex);
+  if (pPool->pLast) {
+    pPool->pLast->pNext = pItem;
+  } else {
+    pPool->pFirst = pItem;
+  }
+  pPool->pLast = pItem;
+  pPool->nQueued += 1;
+  pthread_cond_broadcast(&pPool->cond);
+  pthread_mutex_unlock(&pPool->mutex);
+  return 0;
+}
+
+/* Filter the queued files, until the scan is complete and the queue empty */
+static void *ftWorker(void *pArg) {
+  ftPool *pPool = pArg;
+  ftItem *pItem;
+
+  pthread_mutex_lock(&pPool->mutex);
+  for (;;) {
+    while ((!pPool->pFirst) && (!pPool->iDone)) pthread_cond_wait(&pPool->cond, &pPool->mutex);
+    pItem = pPool->pFirst;
+    if (!pItem) break;		/* The scan is complete, and the queue empty */
+    pPool->pFirst = pItem->pNext;
+    if (!pPool->pFirst) pPool->pLast = NULL;
+    pPool->nQueued -= 1;
+    pthread_cond_broadcast(&pPool->cond); /* Unblock the scan if the queue was full */
+    pthread_mutex_unlock(&pPool->mutex);
+    ftFilterFile(pPool, pItem->szPath);
+    free(pItem);
+    pthread_mutex_lock(&pPool->mutex);
+  }
+  pthread_mutex_unlock(&pPool->mutex);
+  return NULL;
+}
+
+#endif /* HAS_THREADS */
+
+/* WalkDirTree() callback: Select the files to filter */
+static int ftWalkCB(const char *pszPath, const struct dirent *pDE, void *pRef) {
+  ftPool *pPool = pRef;
+  filterTreeOpts *pfto = pPool->pfto;
+  int i;
+
+  if ((pDE->d_type != DT_REG) && (pDE->d_type != DT_DIR)) return 0; /* Ignore links, devices, etc */
+  for (i=0; i<pfto->nExclude; i++) {
+    if (fnmatch(pfto->ppszExclude[i], pDE->d_name, FNM_FTFLAGS) == FNM_MATCH) {
+      DEBUG_PRINTF(("// Excluding %s\n", pszPath));
+      return (pDE->d_type == DT_DIR) ? WDT_SKIPDIR : 0;
+    }
+  }
+  if (pDE->d_type == DT_DIR) return 0;
+  if (pfto->nInclude) {
+    for (i=0; i<pfto->nInclude; i++) {
+      if (fnmatch(pfto->ppszInclude[i], pDE->d_name, FNM_FTFLAGS) == FNM_MATCH) break;
+    }
+    if (i == pfto->nInclude) return 0;
+  }
+  if ((pszPath[0] == '.') && (pszPath[1] == DIRSEPARATOR_CHAR)) pszPath += 2; /* Skip the initial ./ */
+
+  pfto->nFiles += 1;
+  if (pfto->iFlags & FT_NOEXEC) {
+    printf("%s\n", pszPath);
+    return 0;
+  }
+#if HAS_THREADS
+  if (pPool->nThreads && !ftQueue(pPool, pszPath)) return 0;
+#endif
+  ftFilterFile(pPool, pszPath); /* No worker thread, or not enough memory to queue it */
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    FilterTree						      |
+|									      |
+|   Description     Filter in place all matching files in a directory tree    |
+|									      |
+|   Parameters      const char *pszDir	The directory tree root		      |
+|		    filterTreeOpts *pfto The options and the counters	      |
+|		    pTextFilter_t pFilter The text filter to apply	      |
+|		    void *pRef		The filter-specific options	      |
+|		    							      |
+|   Returns	    0 if success, or -1 if any error occurred.		      |
+|		    							      |
+|   Notes	    Files match if their name matches any include pattern, or |
+|		    if there's none, and if it matches no exclude pattern.    |
+|		    Directories matching an exclude pattern are not scanned.  |
+|		    							      |
+|		    The filter may run in several threads at the same time,   |
+|		    so it must not modify any shared state, including *pRef. |
+|		    Errors are reported as they occur, and counted.	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int FilterTree(const char *pszDir, filterTreeOpts *pfto, pTextFilter_t pFilter, void *pRef) {
+  ftPool pool = {0};
+  wdt_opts wo = {0};
+  int iResult;
+#if HAS_THREADS
+  pthread_t *pThreads = NULL;
+  int nThreads = pfto->nThreads;
+  int i;
+#endif
+
+  DEBUG_ENTER(("FilterTree(\"%s\", ...);\n", pszDir));
+
+  pool.pfto = pfto;
+  pool.pFilter = pFilter;
+  pool.pRef = pRef;
+  wo.iFlags = WDT_CONTINUE;
+
+#if HAS_THREADS
+  if (nThreads <= 0) {
+    long nCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+    nThreads = (nCPUs > 0) ? (int)nCPUs : 1;
+  }
+  if (nThreads > FT_MAX_THREADS) nThreads = FT_MAX_THREADS;
+  if (pfto->iFlags & FT_NOEXEC) nThreads = 1;
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+  if (nThreads > 1) pThreads = calloc(nThreads, sizeof(pthread_t));
+  if (pThreads) {
+    for (i=0; i<nThreads; i++) {
+      if (pthread_create(pThreads + pool.nThreads, NULL, ftWorker, &pool)) break;
+      pool.nThreads += 1;
+    }
+  }
+  DEBUG_PRINTF(("// Filtering files with %d worker threads\n", pool.nThreads));
+#endif
+
+  iResult = WalkDirTree(pszDir, &wo, ftWalkCB, &pool);
+
+#if HAS_THREADS
+  pthread_mutex_lock(&pool.mutex);
+  pool.iDone = TRUE;
+  pthread_cond_broadcast(&pool.cond);
+  pthread_mutex_unlock(&pool.mutex);
+  for (i=0; i<pool.nThreads; i++) pthread_join(pThreads[i], NULL);
+  free(pThreads);
+  pthread_cond_destroy(&pool.cond);
+  pthread_mutex_destroy(&pool.mutex);
+#endif
+
+  pfto->nErrors += wo.nErr;
+  if ((iResult < 0) || pfto->nErrors) iResult = -1;
+  RETURN_INT_COMMENT(iResult, ("%ld files, %ld changed\n", pfto->nFiles, pfto->nChanged));
+}
@@ -0,0 +1,495 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        metaio.c                                                  *
+*                                                                             *
+*   Description     Batched file metadata operations                          *
+*                                                                             *
+*   Notes           Tree walkers spend most of their time waiting for one     *
+*		    lstat() or unlink() after another. On network file	      *
+*		    systems, each one costs a full round trip to the server.  *
+*		    These routines queue such requests, and keep up to a      *
+*		    configurable number of them in flight at once.	      *
+*		    							      *
+*		    In Linux, they're submitted to the kernel in batches via  *
+*		    io_uring, using the raw system calls, so that there's no  *
+*		    dependency on liburing. If io_uring is not available (Old *
+*		    kernel, or disabled by a seccomp policy), or for the      *
+*		    operations that the kernel does not support, or in other  *
+*		    Unix flavors, the requests are executed synchronously,    *
+*		    and their callback is called immediately.		      *
+*		    							      *
+*		    A METAIO queue must only be used by one thread at a time. *
+*		    Multithreaded programs must create one queue per thread.  *
+*		    							      *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.                                        *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define _GNU_SOURCE		/* Include as many extensions as possible */
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "debugm.h"		/* SysToolsLib debug macros */
+
+#include "metaio.h"		/* Public definitions for this file */
+
+#if HAS_METAIO
+
+/************************ Linux-specific definitions *************************/
+
+#if defined(__linux__)
+
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/sysmacros.h>	/* For makedev() */
+#include <linux/io_uring.h>
+
+/* IORING_FEAT_NATIVE_WORKERS appeared in Linux 5.12, after IORING_OP_UNLINKAT */
+#if defined(SYS_io_uring_setup) && defined(IORING_FEAT_NATIVE_WORKERS) && defined(STATX_BASIC_STATS)
+#define USE_IO_URING 1
+#endif
+
+#endif /* __linux__ */
+
+/*********************** End of OS-specific definitions **********************/
+
+#ifndef USE_IO_URING
+#define USE_IO_URING 0
+#endif
+
+#define METAIO_MAX_DEPTH 4096
+
+static int iMetaIoDepth = METAIO_DEFAULT_DEPTH;
+
+#if USE_IO_URING
+
+typedef struct _METAREQ {	/* A request in flight */
+  struct _METAREQ *pNext;	/* Next free request */
+  pMetaIoCB_t pCB;
+  void *pRef;
+  struct stat *pStat;		/* For lstat: Where to store the result */
+  struct statx sx;		/* For lstat: The statx buffer filled by the kernel */
+} METAREQ;
+
+#endif /* USE_IO_URING */
+
+struct _METAIO {
+  int iDepth;			/* Max # of requests in flight */
+  int nPending;			/* # of requests queued or in flight */
+#if USE_IO_URING
+  int fdRing;			/* The io_uring handle. -1 = Synchronous mode */
+  unsigned nToSubmit;		/* # of SQEs queued but not submitted yet */
+  unsigned *pSqHead, *pSqTail, *pSqMask, *pSqArray;
+  unsigned *pCqHead, *pCqTail, *pCqMask;
+  struct io_uring_sqe *pSqes;
+  struct io_uring_cqe *pCqes;
+  void *pSqRing, *pCqRing;
+  size_t lSqRing, lCqRing, lSqes;
+  METAREQ *pReqs;		/* Array of iDepth requests */
+  METAREQ *pFree;		/* List of free requests */
+  unsigned char abSupported[IORING_OP_LAST]; /* TRUE if the kernel supports that op */
+#endif /* USE_IO_URING */
+};
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    SetMetaIoDepth					      |
+|									      |
+|   Description     Set the default number of requests kept in flight	      |
+|									      |
+|   Parameters      int iDepth			0=Default. 1=Synchronous      |
+|		    							      |
+|   Returns	    The previous value					      |
+|		    							      |
+|   Notes	    Affects the queues created afterwards.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int SetMetaIoDepth(int iDepth) {
+  int iPrevious = iMetaIoDepth;
+  if (iDepth <= 0) iDepth = METAIO_DEFAULT_DEPTH;
+  if (iDepth > METAIO_MAX_DEPTH) iDepth = METAIO_MAX_DEPTH;
+  iMetaIoDepth = iDepth;
+  return iPrevious;
+}
+
+int GetMetaIoDepth(void) {
+  return iMetaIoDepth;
+}
+
+#if USE_IO_URING
+
+/* Convert the statx structure returned by the kernel to a stat structure */
+static void statx2stat(const struct statx *pSx, struct stat *pStat) {
+  memset(pStat, 0, sizeof(*pStat));
+  pStat->st_dev = makedev(pSx->stx_dev_major, pSx->stx_dev_minor);
+  pStat->st_ino = pSx->stx_ino;
+  pStat->st_mode = pSx->stx_mode;
+  pStat->st_nlink = pSx->stx_nlink;
+  pStat->st_uid = pSx->stx_uid;
+  pStat->st_gid = pSx->stx_gid;
+  pStat->st_rdev = makedev(pSx->stx_rdev_major, pSx->stx_rdev_minor);
+  pStat->st_size = pSx->stx_size;
+  pStat->st_blksize = pSx->stx_blksize;
+  pStat->st_blocks = pSx->stx_blocks;
+  pStat->st_atim.tv_sec = pSx->stx_atime.tv_sec;
+  pStat->st_atim.tv_nsec = pSx->stx_atime.tv_nsec;
+  pStat->st_mtim.tv_sec = pSx->stx_mtime.tv_sec;
+  pStat->st_mtim.tv_nsec = pSx->stx_mtime.tv_nsec;
+  pStat->st_ctim.tv_sec = pSx->stx_ctime.tv_sec;
+  pStat->st_ctim.tv_nsec = pSx->stx_ctime.tv_nsec;
+}
+
+/* Create the io_uring, and map its rings. Returns 0, or -1 if not available */
+static int MetaIoSetupRing(METAIO *pMio) {
+  struct io_uring_params params;
+  struct io_uring_probe *pProbe;
+  size_t lProbe;
+  int i;
+
+  memset(&params, 0, sizeof(params));
+  pMio->fdRing = (int)syscall(SYS_io_uring_setup, (unsigned)pMio->iDepth, &params);
+  if (pMio->fdRing == -1) {
+    DEBUG_PRINTF(("// io_uring_setup() failed: %s\n", strerror(errno)));
+    return -1;
+  }
+
+  pMio->lSqRing = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  pMio->lCqRing = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (pMio->lCqRing > pMio->lSqRing) pMio->lSqRing = pMio->lCqRing;
+    pMio->lCqRing = pMio->lSqRing;
+  }
+  pMio->pSqRing = mmap(NULL, pMio->lSqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		       pMio->fdRing, IORING_OFF_SQ_RING);
+  if (pMio->pSqRing == MAP_FAILED) goto failed;
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    pMio->pCqRing = pMio->pSqRing;
+  } else {
+    pMio->pCqRing = mmap(NULL, pMio->lCqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			 pMio->fdRing, IORING_OFF_CQ_RING);
+    if (pMio->pCqRing == MAP_FAILED) goto failed;
+  }
+  pMio->lSqes = params.sq_entries * sizeof(struct io_uring_sqe);
+  pMio->pSqes = mmap(NULL, pMio->lSqes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		     pMio->fdRing, IORING_OFF_SQES);
+  if (pMio->pSqes == MAP_FAILED) {
+    pMio->pSqes = NULL;
+    goto failed;
+  }
+
+  pMio->pSqHead = (unsigned *)((char *)pMio->pSqRing + params.sq_off.head);
+  pMio->pSqTail = (unsigned *)((char *)pMio->pSqRing + params.sq_off.tail);
+  pMio->pSqMask = (unsigned *)((char *)pMio->pSqRing + params.sq_off.ring_mask);
+  pMio->pSqArray = (unsigned *)((char *)pMio->pSqRing + params.sq_off.array);
+  pMio->pCqHead = (unsigned *)((char *)pMio->pCqRing + params.cq_off.head);
+  pMio->pCqTail = (unsigned *)((char *)pMio->pCqRing + params.cq_off.tail);
+  pMio->pCqMask = (unsigned *)((char *)pMio->pCqRing + params.cq_off.ring_mask);
+  pMio->pCqes = (struct io_uring_cqe *)((char *)pMio->pCqRing + params.cq_off.cqes);
+  if ((int)params.sq_entries < pMio->iDepth) pMio->iDepth = (int)params.sq_entries;
+
+  /* Find which operations this kernel supports */
+  lProbe = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+  pProbe = calloc(1, lProbe);
+  if (!pProbe) goto failed;
+  if (syscall(SYS_io_uring_register, pMio->fdRing, IORING_REGISTER_PROBE, pProbe, IORING_OP_LAST) < 0) {
+    free(pProbe);
+    goto failed;
+  }
+  for (i = 0; (i < pProbe->ops_len) && (i < IORING_OP_LAST); i++) {
+    pMio->abSupported[i] = (unsigned char)((pProbe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0);
+  }
+  free(pProbe);
+
+  /* Allocate the request slots */
+  pMio->pReqs = calloc(pMio->iDepth, sizeof(METAREQ));
+  if (!pMio->pReqs) goto failed;
+  for (i = 0; i < pMio->iDepth; i++) {
+    pMio->pReqs[i].pNext = pMio->pFree;
+    pMio->pFree = pMio->pReqs + i;
+  }
+  DEBUG_PRINTF(("// Using io_uring with %d entries\n", pMio->iDepth));
+  return 0;
+
+failed:
+  if (pMio->pSqes) munmap(pMio->pSqes, pMio->lSqes);
+  if (pMio->pCqRing && (pMio->pCqRing != MAP_FAILED) && (pMio->pCqRing != pMio->pSqRing)) munmap(pMio->pCqRing, pMio->lCqRing);
+  if (pMio->pSqRing && (pMio->pSqRing != MAP_FAILED)) munmap(pMio->pSqRing, pMio->lSqRing);
+  pMio->pSqes = NULL;
+  pMio->pSqRing = pMio->pCqRing = NULL;
+  close(pMio->fdRing);
+  pMio->fdRing = -1;
+  return -1;
+}
+
+#endif /* USE_IO_URING */
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    NewMetaIo						      |
+|									      |
+|   Description     Create a queue of metadata requests			      |
+|									      |
+|   Parameters      int iDepth			Max # of requests in flight   |
+|						0=Use the default depth	      |
+|		    							      |
+|   Returns	    The new queue, or NULL if out of memory		      |
+|		    							      |
+|   Notes	    Falls back to synchronous calls if io_uring is missing.   |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+METAIO *NewMetaIo(int iDepth) {
+  METAIO *pMio = calloc(1, sizeof(METAIO));
+  if (!pMio) return NULL;
+  if (iDepth <= 0) iDepth = iMetaIoDepth;
+  if (iDepth > METAIO_MAX_DEPTH) iDepth = METAIO_MAX_DEPTH;
+  pMio->iDepth = iDepth;
+#if USE_IO_URING
+  pMio->fdRing = -1;
+  if (iDepth > 1) MetaIoSetupRing(pMio);
+#endif
+  return pMio;
+}
+
+int MetaIoIsAsync(METAIO *pMio) {
+#if USE_IO_URING
+  return pMio->fdRing != -1;
+#else
+  return FALSE;
+#endif
+}
+
+void FreeMetaIo(METAIO *pMio) {
+  if (!pMio) return;
+  MetaIoWait(pMio);
+#if USE_IO_URING
+  if (pMio->fdRing != -1) {
+    munmap(pMio->pSqes, pMio->lSqes);
+    if (pMio->pCqRing != pMio->pSqRing) munmap(pMio->pCqRing, pMio->lCqRing);
+    munmap(pMio->pSqRing, pMio->lSqRing);
+    close(pMio->fdRing);
+  }
+  free(pMio->pReqs);
+#endif
+  free(pMio);
+}
+
+#if USE_IO_URING
+
+/* Submit the queued SQEs, and optionally wait for iMinComplete completions */
+static int MetaIoEnter(METAIO *pMio, unsigned iMinComplete) {
+  int iRet;
+  unsigned iFlags = iMinComplete ? IORING_ENTER_GETEVENTS : 0;
+  do {
+    iRet = (int)syscall(SYS_io_uring_enter, pMio->fdRing, pMio->nToSubmit, iMinComplete, iFlags, NULL, 0);
+  } while ((iRet == -1) && (errno == EINTR));
+  if (iRet > 0) pMio->nToSubmit -= (unsigned)iRet;
+  return (iRet == -1) ? -1 : 0;
+}
+
+/* Process all available completions */
+static void MetaIoReap(METAIO *pMio) {
+  unsigned iHead = *(pMio->pCqHead);
+  for (;;) {
+    struct io_uring_cqe *pCqe;
+    METAREQ *pReq;
+    pMetaIoCB_t pCB;
+    void *pRef;
+    int iRes;
+    if (iHead == __atomic_load_n(pMio->pCqTail, __ATOMIC_ACQUIRE)) break;
+    pCqe = pMio->pCqes + (iHead & *(pMio->pCqMask));
+    pReq = (METAREQ *)(uintptr_t)(pCqe->user_data);
+    iRes = pCqe->res;
+    /* Release the CQE and the request before the callback, which may queue new ones */
+    __atomic_store_n(pMio->pCqHead, ++iHead, __ATOMIC_RELEASE);
+    if (pReq->pStat && (iRes == 0)) statx2stat(&(pReq->sx), pReq->pStat);
+    pCB = pReq->pCB;
+    pRef = pReq->pRef;
+    pReq->pNext = pMio->pFree;
+    pMio->pFree = pReq;
+    pMio->nPending -= 1;
+    if (pCB) pCB(pRef, iRes);
+    iHead = *(pMio->pCqHead); /* The callback may have reaped more */
+  }
+}
+
+/* Get a free request and its SQE. Waits for a completion if the queue is full */
+static struct io_uring_sqe *MetaIoGetSqe(METAIO *pMio, pMetaIoCB_t pCB, void *pRef, struct stat *pStat) {
+  METAREQ *pReq;
+  struct io_uring_sqe *pSqe;
+  unsigned iTail, iIndex;
+
+  while (!pMio->pFree) {
+    if (MetaIoEnter(pMio, 1)) return NULL;
+    MetaIoReap(pMio);
+  }
+  pReq = pMio->pFree;
+  pMio->pFree = pReq->pNext;
+  pReq->pCB = pCB;
+  pReq->pRef = pRef;
+  pReq->pStat = pStat;
+
+  iTail = *(pMio->pSqTail);
+  iIndex = iTail & *(pMio->pSqMask);
+  pSqe = pMio->pSqes + iIndex;
+  memset(pSqe, 0, sizeof(*pSqe));
+  pSqe->user_data = (uintptr_t)pReq;
+  pMio->pSqArray[iIndex] = iIndex;
+  return pSqe;
+}
+
+/* Make the SQE filled visible to the kernel */
+static int MetaIoCommitSqe(METAIO *pMio) {
+  __atomic_store_n(pMio->pSqTail, *(pMio->pSqTail) + 1, __ATOMIC_RELEASE);
+  pMio->nToSubmit += 1;
+  pMio->nPending += 1;
+  /* Submit as soon as we have a full batch, without waiting */
+  if (pMio->nToSubmit >= (unsigned)(pMio->iDepth / 2)) return MetaIoEnter(pMio, 0);
+  return 0;
+}
+
+#define CAN_QUEUE(pMio, op) (((pMio)->fdRing != -1) && (pMio)->abSupported[op])
+
+#endif /* USE_IO_URING */
+
+/* Call the callback of a synchronous request */
+static int MetaIoSyncDone(int iResult, pMetaIoCB_t pCB, void *pRef) {
+  if (pCB) pCB(pRef, (iResult == -1) ? -errno : iResult);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    MetaIoLstatAt, MetaIoUnlinkAt, MetaIoOpenAt, MetaIoClose  |
+|									      |
+|   Description     Queue a metadata request				      |
+|									      |
+|   Parameters      METAIO *pMio		The request queue	      |
+|		    int iDirFD			Base directory handle, or     |
+|						AT_FDCWD		      |
+|		    const char *pszName		Pathname relative to iDirFD   |
+|		    ...				Same as for the xxxat() calls |
+|		    pMetaIoCB_t pCB		Completion callback, or NULL  |
+|		    void *pRef			Reference passed to pCB	      |
+|		    							      |
+|   Returns	    0 = Queued or done, or -1 with errno set		      |
+|		    							      |
+|   Notes	    The callback receives the same result as the equivalent   |
+|		    Unix function, or -errno in case of failure.	      |
+|		    It may be called before these routines return, if the     |
+|		    queue is full or synchronous, or later in MetaIoWait().   |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created these routines				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int MetaIoLstatAt(METAIO *pMio, int iDirFD, const char *pszName, struct stat *pStat, pMetaIoCB_t pCB, void *pRef) {
+#if USE_IO_URING
+  if (CAN_QUEUE(pMio, IORING_OP_STATX)) {
+    struct io_uring_sqe *pSqe = MetaIoGetSqe(pMio, pCB, pRef, pStat);
+    METAREQ *pReq;
+    if (!pSqe) return -1;
+    pReq = (METAREQ *)(uintptr_t)(pSqe->user_data);
+    pSqe->opcode = IORING_OP_STATX;
+    pSqe->fd = iDirFD;
+    pSqe->addr = (uintptr_t)pszName;
+    pSqe->len = STATX_BASIC_STATS;
+    pSqe->off = (uintptr_t)&(pReq->sx);
+    pSqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+    return MetaIoCommitSqe(pMio);
+  }
+#endif
+  return MetaIoSyncDone(fstatat(iDirFD, pszName, pStat, AT_SYMLINK_NOFOLLOW), pCB, pRef);
+}
+
+int MetaIoUnlinkAt(METAIO *pMio, int iDirFD, const char *pszName, int iFlags, pMetaIoCB_t pCB, void *pRef) {
+#if USE_IO_URING
+  if (CAN_QUEUE(pMio, IORING_OP_UNLINKAT)) {
+    struct io_uring_sqe *pSqe = MetaIoGetSqe(pMio, pCB, pRef, NULL);
+    if (!pSqe) return -1;
+    pSqe->opcode = IORING_OP_UNLINKAT;
+    pSqe->fd = iDirFD;
+    pSqe->addr = (uintptr_t)pszName;
+    pSqe->unlink_flags = (unsigned)iFlags;
+    return MetaIoCommitSqe(pMio);
+  }
+#endif
+  return MetaIoSyncDone(unlinkat(iDirFD, pszName, iFlags), pCB, pRef);
+}
+
+int MetaIoOpenAt(METAIO *pMio, int iDirFD, const char *pszName, int iFlags, mode_t iMode, pMetaIoCB_t pCB, void *pRef) {
+#if USE_IO_URING
+  if (CAN_QUEUE(pMio, IORING_OP_OPENAT)) {
+    struct io_uring_sqe *pSqe = MetaIoGetSqe(pMio, pCB, pRef, NULL);
+    if (!pSqe) return -1;
+    pSqe->opcode = IORING_OP_OPENAT;
+    pSqe->fd = iDirFD;
+    pSqe->addr = (uintptr_t)pszName;
+    pSqe->len = iMode;
+    pSqe->open_flags = (unsigned)iFlags;
+    return MetaIoCommitSqe(pMio);
+  }
+#endif
+  return MetaIoSyncDone(openat(iDirFD, pszName, iFlags, iMode), pCB, pRef);
+}
+
+int MetaIoClose(METAIO *pMio, int iFD, pMetaIoCB_t pCB, void *pRef) {
+#if USE_IO_URING
+  if (CAN_QUEUE(pMio, IORING_OP_CLOSE)) {
+    struct io_uring_sqe *pSqe = MetaIoGetSqe(pMio, pCB, pRef, NULL);
+    if (!pSqe) return -1;
+    pSqe->opcode = IORING_OP_CLOSE;
+    pSqe->fd = iFD;
+    return MetaIoCommitSqe(pMio);
+  }
+#endif
+  return MetaIoSyncDone(close(iFD), pCB, pRef);
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    MetaIoWait						      |
+|									      |
+|   Description     Wait for the completion of all pending requests	      |
+|									      |
+|   Parameters      METAIO *pMio		The request queue	      |
+|		    							      |
+|   Returns	    0 = Success, or -1 with errno set			      |
+|		    							      |
+|   Notes	    All callbacks have been called when it returns.	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int MetaIoWait(METAIO *pMio) {
+#if USE_IO_URING
+  while (pMio->nPending) {
+    if (MetaIoEnter(pMio, 1)) return -1;
+    MetaIoReap(pMio);
+  }
+#endif
+  return 0;
+}
+
+#endif /* HAS_METAIO */
@@ -0,0 +1,68 @@
+/*****************************************************************************\
+*                                                                             *
+*   Filename        metaio.h                                                  *
+*                                                                             *
+*   Description     Definitions for the batched file metadata operations      *
+*                                                                             *
+*   Notes           Lets tree walkers keep many lstat/unlinkat/openat/close   *
+*		    requests in flight at once, using io_uring in Linux, or   *
+*		    synchronous calls elsewhere.			      *
+*                                                                             *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.                                        *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#ifndef _METAIO_H_
+#define _METAIO_H_
+
+#include "SysLib.h"		/* SysLib Library core definitions */
+
+#ifdef _UNIX			/* The API is based on the Unix xxxat() functions */
+#define HAS_METAIO 1
+#else
+#define HAS_METAIO 0
+#endif
+
+#if HAS_METAIO
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+#define METAIO_DEFAULT_DEPTH 64	/* Default max # of requests in flight */
+
+typedef struct _METAIO METAIO;	/* Opaque queue of metadata requests */
+
+/* Completion callback. iResult = The function result if >= 0, or -errno */
+typedef void (*pMetaIoCB_t)(void *pRef, int iResult);
+
+int SetMetaIoDepth(int iDepth);	/* Set the default depth. 0=Default. 1=Synchronous. Returns the previous one */
+int GetMetaIoDepth(void);
+
+METAIO *NewMetaIo(int iDepth);	/* iDepth=0 uses the default depth set above */
+void FreeMetaIo(METAIO *pMio);	/* Completes the pending requests, then frees the queue */
+int MetaIoIsAsync(METAIO *pMio);	/* TRUE if using io_uring, FALSE if synchronous */
+
+/* Queue requests. The pathname and buffer arguments must remain valid until
+   the callback is called. The callback may be NULL. Returns 0, or -1 if the
+   request could not be queued, with errno set. */
+int MetaIoLstatAt(METAIO *pMio, int iDirFD, const char *pszName, struct stat *pStat, pMetaIoCB_t pCB, void *pRef);
+int MetaIoUnlinkAt(METAIO *pMio, int iDirFD, const char *pszName, int iFlags, pMetaIoCB_t pCB, void *pRef);
+int MetaIoOpenAt(METAIO *pMio, int iDirFD, const char *pszName, int iFlags, mode_t iMode, pMetaIoCB_t pCB, void *pRef);
+int MetaIoClose(METAIO *pMio, int iFD, pMetaIoCB_t pCB, void *pRef);
+
+int MetaIoWait(METAIO *pMio);	/* Wait for the completion of all pending requests */
+
+#ifdef __cplusplus
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* HAS_METAIO */
+
+#endif /* _METAIO_H_ */
@@ -20,6 +20,8 @@
 *    2025-12-17 JFL Added support for WDT_INONLY.                             *
 *    2025-12-21 JFL Fixed TRIM_PATHNAME_BUF() and TRIM_NODENAME_BUF().        *
 *    2025-12-30 JFL WalkDirTree() can now optionally sort directories.        *
+*    2026-10-18 JFL Added WalkDirTree flag WDT_STAT, and routine DirentStat().*
+*    2026-10-18 JFL Added WalkDirTree callback return value WDT_SKIPDIR.      *
 *		    							      *
 *         © Copyright 2021 Hewlett Packard Enterprise Development LP          *
 * Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
@@ -161,8 +163,9 @@ char *NewCompactJoinedPath(const char *pszPart1, const char *pszPart2);	/* Idem,
 #define WDT_DIRONLY	0x0040		/* Callback for effective directories (ie. links too if WDT_FOLLOW), but not for effective files */
 #define WDT_CD		0x0080		/* Change current directory to the directories scanned */
 #define WDT_INONLY	0x0100		/* Callback only when entering directories, but not for their content */
+#define WDT_STAT	0x0200		/* Get the lstat() of entries in batches. The callback gets it with DirentStat() */
 /* The following flag must be last, with the highest defined bit */
-#define WDT_USER_FLAG   0x0200		/* Allow adding user-defined flags, for use in the callbacks */
+#define WDT_USER_FLAG   0x0400		/* Allow adding user-defined flags, for use in the callbacks */
 
 /* Dummy dirent dir types, giving special infos to the callback.
    DT_XXX dir types defined in dirent.h typically are in the 0-15 range */
@@ -182,8 +185,12 @@ typedef struct {		/* WalkDirTree options. Must be cleared before use. */
   ino_t nFile;			/* [OUT] Number of directory entries processed */
   int nErr;			/* [OUT] Number of errors */
   void *pOnce;			/* [RESERVED] Used internally to process WDT_ONCE */
+  void *pMetaIo;		/* [RESERVED] Used internally to process WDT_STAT */
 } wdt_opts;
 
+/* WalkDirTree callbacks return 0=Continue; 1=Success, stop; -1=Error, abort; or: */
+#define WDT_SKIPDIR	2		/* Continue, but do not recurse into this directory */
+
 typedef int (*pWalkDirTreeCB_t)(const char *pszRelPath, const struct dirent *pDE, void *pRef);
 
 extern int WalkDirTree(const char *path, wdt_opts *pOpts, pWalkDirTreeCB_t pWalkDirTreeCB, void *pRef);
@@ -192,6 +199,10 @@ extern int *DirentExtraFlags(struct dirent *pDE); /* WalkDirTree() appends extra
 #define DEF_ISDIR	0x0001	/* If set, the entry is a directory, or a link to a dir. */
 #define DEF_RECURSE	0x0002	/* If set, WalkDirTree() will recurse in this dir */
 
+/* With WDT_STAT, get the lstat() of an entry passed to the callback. (Not for DT_ENTER & DT_LEAVE)
+   Returns NULL with errno set if it failed, in which case the callback may retry it itself. */
+extern struct stat *DirentStat(const struct dirent *pDE);
+
 /* ------------------------- cwd-pwd.c definitions ------------------------- */
 
 #ifdef _UNIX	/* In Unix, redefine chdir & getcwd as our extended routines */
@@ -0,0 +1,454 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        rewrite.c                                                 *
+*                                                                             *
+*   Description     Rewrite files in place, only when their content changes   *
+*                                                                             *
+*   Notes           The new content is written to a temporary file in the     *
+*		    same directory, which is then renamed over the original   *
+*		    file. So the original file is never seen half-written.    *
+*		    							      *
+*		    In Unix, the new content is first compared with the       *
+*		    original file. Nothing is written as long as it's the     *
+*		    same. The temporary file is only created at the first     *
+*		    difference, and the identical prefix is copied into it.   *
+*		    So checking files that are already clean only reads them. *
+*		    							      *
+*		    In Linux, the temporary file is created with O_TMPFILE,   *
+*		    so that it vanishes automatically if the program dies.    *
+*		    It's only given a name by linkat() just before the rename.*
+*		    							      *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file, with the in-place update sequence of   *
+*		    trim.c, detab.c, remplace.c, and textfilt.c.	      *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define _CRT_SECURE_NO_WARNINGS /* Prevent warnings about using fopen, etc */
+
+#define _GNU_SOURCE		/* Include as many extensions as possible */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "debugm.h"		/* SysToolsLib debug macros */
+
+#include "rewrite.h"		/* Public definitions for this file */
+
+/************************ Win32-specific definitions *************************/
+
+#ifdef _WIN32		/* Automatically defined when targeting a Win32 app. */
+
+#include <io.h>
+
+#pragma warning(disable:4996)	/* Ignore the deprecated name warning */
+
+#define DIRSEPARATOR_CHAR '\\'
+#define RENAME_OVERWRITES 0	/* rename() fails if the target exists */
+
+#endif /* _WIN32 */
+
+/************************ MS-DOS-specific definitions ************************/
+
+#ifdef _MSDOS		/* Automatically defined when targeting an MS-DOS app. */
+
+#include <io.h>
+
+#define DIRSEPARATOR_CHAR '\\'
+#define RENAME_OVERWRITES 0	/* rename() fails if the target exists */
+
+#endif /* _MSDOS */
+
+/************************* Unix-specific definitions *************************/
+
+#ifdef _UNIX		/* Defined in SysLib.h for Unix flavors we support */
+
+#define DIRSEPARATOR_CHAR '/'
+#define RENAME_OVERWRITES 1	/* rename() atomically replaces the target */
+#define HAS_LINK 1		/* Hard links are available for the backups */
+
+#if defined(__GLIBC__)
+#define HAS_FOPENCOOKIE 1	/* Custom streams are created by fopencookie() */
+#if (__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 27)
+#define HAS_COPY_FILE_RANGE 1	/* Copies can be done by the kernel */
+#endif
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define HAS_FUNOPEN 1		/* Custom streams are created by funopen() */
+#endif
+
+#endif /* _UNIX */
+
+/********************** End of OS-specific definitions ***********************/
+
+#if defined(HAS_FOPENCOOKIE) || defined(HAS_FUNOPEN)
+#define RW_COMPARE 1		/* Compare the output with the original file */
+#else
+#define RW_COMPARE 0		/* Write the output to a temp. file immediately */
+#endif
+
+#define RW_CMP_SIZE 0x40000	/* Size of the original data blocks compared */
+
+struct _REWRITE {
+  char *pszName;		/* The file to rewrite */
+  char *pszBakName;		/* The optional backup file name */
+  size_t lDir;			/* Length of the directory part of pszName */
+  struct stat sOrig;		/* The original file information */
+  int iOrigFD;			/* The original file, for comparing its content */
+  off_t offSame;		/* Size of the output so far, same as the original */
+  int iTmpFD;			/* The temporary file, or -1 if not created yet */
+  char *pszTmpName;		/* Its name, or NULL if it's still anonymous */
+  FILE *pf;			/* The stream where the caller writes */
+  char *pCmp;			/* Buffer for reading the original data */
+};
+
+/* Free the rewrite context, and remove the temporary file if any */
+static void RwFree(REWRITE *pRw) {
+  if (pRw->iTmpFD != -1) close(pRw->iTmpFD);
+  if (pRw->pszTmpName) {
+    unlink(pRw->pszTmpName);
+    free(pRw->pszTmpName);
+  }
+  if (pRw->iOrigFD != -1) close(pRw->iOrigFD);
+  free(pRw->pCmp);
+  free(pRw->pszBakName);
+  free(pRw->pszName);
+  free(pRw);
+}
+
+/* Create the temporary file in the same directory, so that it can be renamed */
+static int RwCreateTmp(REWRITE *pRw, int bAnonymous) {
+  char *pszTmpName = malloc(pRw->lDir + 32);
+  if (!pszTmpName) return -1;
+  memcpy(pszTmpName, pRw->pszName, pRw->lDir);
+#if defined(O_TMPFILE)
+  if (bAnonymous) {
+    strcpy(pszTmpName + pRw->lDir, ".");
+    pRw->iTmpFD = open(pszTmpName, O_TMPFILE | O_WRONLY, 0600);
+    DEBUG_PRINTF(("open(\"%s\", O_TMPFILE); // %d\n", pszTmpName, pRw->iTmpFD));
+    if (pRw->iTmpFD != -1) {
+      free(pszTmpName);
+      return 0;
+    } /* Else the file system does not support it. Use a named file instead. */
+  }
+#endif
+  strcpy(pszTmpName + pRw->lDir, "rwXXXXXX");
+  pRw->iTmpFD = mkstemp(pszTmpName);
+  DEBUG_PRINTF(("mkstemp(\"%s\"); // %d\n", pszTmpName, pRw->iTmpFD));
+  if (pRw->iTmpFD == -1) {
+    free(pszTmpName);
+    return -1;
+  }
+  pRw->pszTmpName = pszTmpName;
+  return 0;
+}
+
+#if RW_COMPARE
+
+/* Write data to the temporary file */
+static int RwWriteTmp(REWRITE *pRw, const char *pBuf, size_t nBuf) {
+  while (nBuf) {
+    ssize_t n = write(pRw->iTmpFD, pBuf, nBuf);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    pBuf += n;
+    nBuf -= (size_t)n;
+  }
+  return 0;
+}
+
+/* Copy a part of another file to the temporary file */
+static int RwCopy(REWRITE *pRw, int iFromFD, off_t off, off_t nCopy) {
+#if HAS_COPY_FILE_RANGE
+  while (nCopy > 0) {
+    size_t n = (nCopy < 0x40000000) ? (size_t)nCopy : 0x40000000;
+    ssize_t nDone = copy_file_range(iFromFD, &off, pRw->iTmpFD, NULL, n, 0);
+    if (nDone <= 0) break;	/* Not supported here. Finish with read/write */
+    nCopy -= nDone;
+  }
+#endif
+  while (nCopy > 0) {
+    size_t n = (nCopy < RW_CMP_SIZE) ? (size_t)nCopy : RW_CMP_SIZE;
+    ssize_t nRead = pread(iFromFD, pRw->pCmp, n, off);
+    if (nRead <= 0) {
+      if (!nRead) errno = EIO;	/* The file shrunk while we were reading it */
+      return -1;
+    }
+    if (RwWriteTmp(pRw, pRw->pCmp, (size_t)nRead)) return -1;
+    off += nRead;
+    nCopy -= nRead;
+  }
+  return 0;
+}
+
+/* The output differs from the original. Create the temp. file with the same prefix */
+static int RwDiverge(REWRITE *pRw) {
+  DEBUG_PRINTF(("// \"%s\" changes at offset %lld\n", pRw->pszName, (long long)pRw->offSame));
+  if (RwCreateTmp(pRw, 1)) return -1;
+  return RwCopy(pRw, pRw->iOrigFD, 0, pRw->offSame);
+}
+
+/* Write routine for the output stream */
+static ssize_t RwWrite(REWRITE *pRw, const char *pBuf, size_t nBuf) {
+  size_t nLeft = nBuf;
+  while ((pRw->iTmpFD == -1) && nLeft) { /* Everything was the same so far */
+    size_t n = (nLeft < RW_CMP_SIZE) ? nLeft : RW_CMP_SIZE;
+    ssize_t nRead = pread(pRw->iOrigFD, pRw->pCmp, n, pRw->offSame);
+    size_t i = 0;
+    if (nRead < 0) return -1;
+    if (((size_t)nRead == n) && !memcmp(pBuf, pRw->pCmp, n)) {
+      i = n;
+    } else {			/* Find the first difference */
+      while ((i < (size_t)nRead) && (pBuf[i] == pRw->pCmp[i])) i++;
+    }
+    pRw->offSame += i;
+    pBuf += i;
+    nLeft -= i;
+    if ((i < n) && RwDiverge(pRw)) return -1;
+  }
+  if (nLeft && RwWriteTmp(pRw, pBuf, nLeft)) return -1;
+  return (ssize_t)nBuf;
+}
+
+#if HAS_FOPENCOOKIE
+static ssize_t RwCookieWrite(void *pCookie, const char *pBuf, size_t nBuf) {
+  ssize_t n = RwWrite((REWRITE *)pCookie, pBuf, nBuf);
+  return (n < 0) ? 0 : n;	/* fopencookie() expects 0 for errors */
+}
+static cookie_io_functions_t RwCookieFunctions = {NULL, RwCookieWrite, NULL, NULL};
+#endif
+
+#if HAS_FUNOPEN
+static int RwFunWrite(void *pCookie, const char *pBuf, int nBuf) {
+  return (int)RwWrite((REWRITE *)pCookie, pBuf, (size_t)nBuf);
+}
+#endif
+
+#if defined(O_TMPFILE)
+/* Give a name to the anonymous temporary file, so that it can be renamed */
+static int RwLinkTmp(REWRITE *pRw) {
+  char szFdPath[32];
+  char *pszTmpName = malloc(pRw->lDir + 32);
+  int iAnonFD;
+  off_t nSize;
+  int i;
+
+  if (!pszTmpName) return -1;
+  sprintf(szFdPath, "/proc/self/fd/%d", pRw->iTmpFD);
+  memcpy(pszTmpName, pRw->pszName, pRw->lDir);
+  for (i = 0; i < 100; i++) {
+    sprintf(pszTmpName + pRw->lDir, "rw%lX_%d", (long)getpid(), i);
+    if (!linkat(AT_FDCWD, szFdPath, AT_FDCWD, pszTmpName, AT_SYMLINK_FOLLOW)) {
+      pRw->pszTmpName = pszTmpName;
+      return 0;
+    }
+    if (errno != EEXIST) break;
+  }
+  free(pszTmpName);
+
+  /* /proc is not mounted. Copy the data to a named temporary file */
+  DEBUG_PRINTF(("// Can't link the anonymous file. %s\n", strerror(errno)));
+  iAnonFD = pRw->iTmpFD;
+  pRw->iTmpFD = -1;
+  nSize = lseek(iAnonFD, 0, SEEK_CUR);
+  i = ((nSize == -1) || RwCreateTmp(pRw, 0) || RwCopy(pRw, iAnonFD, 0, nSize)) ? -1 : 0;
+  close(iAnonFD);
+  return i;
+}
+#endif
+
+#endif /* RW_COMPARE */
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    RewriteOpen						      |
+|									      |
+|   Description     Prepare to rewrite an existing file			      |
+|									      |
+|   Parameters      const char *pszName		The file to rewrite	      |
+|		    const char *pszBakName	The backup name, or NULL      |
+|		    							      |
+|   Returns	    A rewrite context, or NULL if error, with errno set.      |
+|		    							      |
+|   Notes	    Get the output stream with RewriteStream(), write the     |
+|		    new content to it, then call RewriteClose().	      |
+|		    The file is not modified before RewriteClose().	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+REWRITE *RewriteOpen(const char *pszName, const char *pszBakName) {
+  REWRITE *pRw;
+  const char *pc;
+  int iErr;
+
+  DEBUG_ENTER(("RewriteOpen(\"%s\", \"%s\");\n", pszName, pszBakName ? pszBakName : "(null)"));
+
+  pRw = calloc(1, sizeof(REWRITE));
+  if (!pRw) {
+    DEBUG_LEAVE(("return NULL; // Out of memory\n"));
+    return NULL;
+  }
+  pRw->iOrigFD = -1;
+  pRw->iTmpFD = -1;
+  pRw->pszName = strdup(pszName);
+  if (!pRw->pszName) goto failed;
+  if (pszBakName && !(pRw->pszBakName = strdup(pszBakName))) goto failed;
+  pc = strrchr(pszName, DIRSEPARATOR_CHAR);
+  pRw->lDir = pc ? (size_t)(pc + 1 - pszName) : 0;
+  if (stat(pszName, &pRw->sOrig)) goto failed;
+
+#if RW_COMPARE
+  pRw->iOrigFD = open(pszName, O_RDONLY);
+  if (pRw->iOrigFD == -1) goto failed;
+  pRw->pCmp = malloc(RW_CMP_SIZE);
+  if (!pRw->pCmp) goto failed;
+#if HAS_FOPENCOOKIE
+  pRw->pf = fopencookie(pRw, "w", RwCookieFunctions);
+#else
+  pRw->pf = funopen(pRw, NULL, RwFunWrite, NULL, NULL);
+#endif
+  if (!pRw->pf) goto failed;
+  setvbuf(pRw->pf, NULL, _IOFBF, RW_CMP_SIZE); /* Compare large blocks */
+#else
+  if (RwCreateTmp(pRw, 0)) goto failed;
+  pRw->pf = fdopen(pRw->iTmpFD, "wb");
+  if (!pRw->pf) goto failed;
+#endif
+
+  DEBUG_LEAVE(("return %p;\n", pRw));
+  return pRw;
+
+failed:
+  iErr = errno;
+  RwFree(pRw);
+  errno = iErr;
+  DEBUG_LEAVE(("return NULL; // %s\n", strerror(errno)));
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    RewriteStream					      |
+|									      |
+|   Description     Get the stream where to write the new file content	      |
+|									      |
+|   Parameters      REWRITE *pRw		The rewrite context	      |
+|		    							      |
+|   Returns	    The output stream. Do not close it.			      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+FILE *RewriteStream(REWRITE *pRw) {
+  return pRw->pf;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    RewriteClose					      |
+|									      |
+|   Description     Replace the file with the new content, if it changed      |
+|									      |
+|   Parameters      REWRITE *pRw		The rewrite context	      |
+|		    int iCommit			FALSE = Discard the output    |
+|		    							      |
+|   Returns	    1 if the file was replaced, 0 if not,		      |
+|		    or -1 if error, with errno set.			      |
+|		    							      |
+|   Notes	    The new file gets the mode, and if possible the owner,    |
+|		    of the original file. If a backup name was given, the     |
+|		    original file is renamed (Or hard-linked) to that name.   |
+|		    An unchanged file is not touched at all, so it keeps its  |
+|		    timestamps.						      |
+|		    In all cases, the context is freed.			      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int RewriteClose(REWRITE *pRw, int iCommit) {
+  int iResult = -1;
+  int iErr = 0;
+  int iMode = pRw->sOrig.st_mode & 07777;
+
+  DEBUG_ENTER(("RewriteClose(\"%s\", %d);\n", pRw->pszName, iCommit));
+
+  iErr = fclose(pRw->pf);
+  pRw->pf = NULL;
+#if !RW_COMPARE
+  pRw->iTmpFD = -1;		/* fclose() closed it */
+#endif
+  if (iErr) goto cleanup_and_return;
+  if (!iCommit) {
+    iResult = 0;
+    goto cleanup_and_return;
+  }
+
+#if RW_COMPARE
+  if (pRw->iTmpFD == -1) {	/* Everything written was the same */
+    if (pRw->offSame == pRw->sOrig.st_size) {
+      DEBUG_PRINTF(("// \"%s\" is unchanged\n", pRw->pszName));
+      iResult = 0;
+      goto cleanup_and_return;
+    }
+    if (RwDiverge(pRw)) goto cleanup_and_return; /* The new file is shorter */
+  }
+#if defined(O_TMPFILE)
+  if ((!pRw->pszTmpName) && RwLinkTmp(pRw)) goto cleanup_and_return;
+#endif
+  if (fchown(pRw->iTmpFD, pRw->sOrig.st_uid, pRw->sOrig.st_gid)) {
+    /* Only root can give files away. Else keep our own ownership */
+  }
+  fchmod(pRw->iTmpFD, (mode_t)iMode);
+  iErr = close(pRw->iTmpFD);
+  pRw->iTmpFD = -1;
+  if (iErr) goto cleanup_and_return;
+  close(pRw->iOrigFD);
+  pRw->iOrigFD = -1;
+#else
+  chmod(pRw->pszTmpName, iMode);
+#endif
+
+  if (pRw->pszBakName) {	/* Keep the original file as the backup */
+    DEBUG_PRINTF(("unlink(\"%s\");\n", pRw->pszBakName));
+    if (unlink(pRw->pszBakName) && (errno != ENOENT)) goto cleanup_and_return;
+#if HAS_LINK
+    DEBUG_PRINTF(("link(\"%s\", \"%s\");\n", pRw->pszName, pRw->pszBakName));
+    if (link(pRw->pszName, pRw->pszBakName)) /* Else rename it below */
+#endif
+    {
+      DEBUG_PRINTF(("rename(\"%s\", \"%s\");\n", pRw->pszName, pRw->pszBakName));
+      if (rename(pRw->pszName, pRw->pszBakName)) goto cleanup_and_return;
+    }
+  }
+#if !RENAME_OVERWRITES
+  if (unlink(pRw->pszName) && (errno != ENOENT)) goto cleanup_and_return;
+#endif
+  DEBUG_PRINTF(("rename(\"%s\", \"%s\");\n", pRw->pszTmpName, pRw->pszName));
+  if (rename(pRw->pszTmpName, pRw->pszName)) goto cleanup_and_return;
+  free(pRw->pszTmpName);
+  pRw->pszTmpName = NULL;	/* It does not exist anymore */
+  iResult = 1;
+
+cleanup_and_return:
+  if (iResult < 0) iErr = errno;
+  RwFree(pRw);
+  if (iResult < 0) errno = iErr;
+  DEBUG_LEAVE(("return %d;\n", iResult));
+  return iResult;
+}
@@ -0,0 +1,46 @@
+/*****************************************************************************\
+*                                                                             *
+*   Filename        rewrite.h                                                 *
+*                                                                             *
+*   Description     Definitions for the safe in-place file rewrite routines   *
+*                                                                             *
+*   Notes           Shared by trim.c, detab.c, remplace.c, and textfilt.c,    *
+*		    which used to have their own temp file / backup / rename  *
+*		    sequences.						      *
+*                                                                             *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.                                        *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#ifndef _REWRITE_H_
+#define _REWRITE_H_
+
+#include "SysLib.h"		/* SysLib Library core definitions */
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+typedef struct _REWRITE REWRITE;	/* Opaque rewrite context */
+
+/* Prepare to rewrite an existing file. pszBakName = Optional backup name.
+   Returns NULL if error, with errno set. */
+REWRITE *RewriteOpen(const char *pszName, const char *pszBakName);
+
+/* Get the stream where to write the new content */
+FILE *RewriteStream(REWRITE *pRw);
+
+/* Close the stream, and replace the file if iCommit and the content changed.
+   Returns 1 if the file was replaced, 0 if not, or -1 if error, with errno set. */
+int RewriteClose(REWRITE *pRw, int iCommit);
+
+#ifdef __cplusplus
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* _REWRITE_H_ */
@@ -0,0 +1,512 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        syncfile.c                                                *
+*                                                                             *
+*   Description     Make the files written durable, using a selectable policy *
+*                                                                             *
+*   Notes           Syncing every file as soon as it's written is safe, but   *
+*		    very slow when copying many small files. The alternative  *
+*		    policies defined here give crash-consistency at a lower   *
+*		    cost:						      *
+*		    none   Don't sync anything. (The historical behavior)     *
+*		    file   fsync() every file before closing it.	      *
+*		    batch  Start the write-back of every file immediately,    *
+*		           but only wait for its completion when a batch of   *
+*		           files is complete. The kernel writes the batch in  *
+*		           the background while we write the next files.      *
+*		    end    Sync the target file systems once at the end.      *
+*		    							      *
+*		    The names of new files and directories are made durable   *
+*		    by syncing their parent directory, immediately in file    *
+*		    mode, and along with the files in batch mode. In end mode *
+*		    in Linux, syncfs() covers them. DOS and Windows can't     *
+*		    sync directories, so there they rely on the file system.  *
+*		    							      *
+*		    The time spent waiting for syncs is recorded, so that     *
+*		    the programs can report it.				      *
+*		    							      *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.                                        *
+*    2026-10-18 JFL Added syncfilenow() and syncname(). Use fsync() instead   *
+*		    of fdatasync() in batch mode, so that the file times set  *
+*		    before the sync are durable too.			      *
+*    2026-10-18 JFL In end mode, sync every file system written to, not just  *
+*		    the one containing the first file.			      *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define _CRT_SECURE_NO_WARNINGS /* Prevent warnings about using fopen, etc */
+
+#define _GNU_SOURCE		/* Include as many extensions as possible */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "debugm.h"		/* SysToolsLib debug macros */
+
+#include "copyfile.h"		/* Public definitions for this file */
+
+/************************ Win32-specific definitions *************************/
+
+#ifdef _WIN32		/* Automatically defined when targeting a Win32 app. */
+
+#include <io.h>
+
+#pragma warning(disable:4996)	/* Ignore the deprecated name warning */
+
+#define fsync _commit
+
+#define NO_DIRSYNC	/* _commit() does not work on directories */
+
+#endif /* _WIN32 */
+
+/************************ MS-DOS-specific definitions ************************/
+
+#ifdef _MSDOS		/* Automatically defined when targeting an MS-DOS app. */
+
+#define NO_FSYNC	/* There's no write cache to flush in DOS */
+#define NO_DIRSYNC	/* And no way to sync a directory */
+
+#endif /* _MSDOS */
+
+/************************* Unix-specific definitions *************************/
+
+#if defined(__unix__) || defined(__MACH__) /* Automatically defined when targeting Unix or Mach apps. */
+
+#include <sys/stat.h>
+
+#ifndef O_DIRECTORY
+#define O_DIRECTORY 0
+#endif
+
+#endif /* __unix__ */
+
+/*********************** End of OS-specific definitions **********************/
+
+#define SYNC_BATCH_SIZE 64	/* Number of files written back in parallel */
+
+static int iSyncPolicy = SYNC_NONE;
+static int aBatch[SYNC_BATCH_SIZE];	/* Duplicate handles of files not synced yet */
+static int nBatch = 0;			/* Number of handles in aBatch */
+#ifndef NO_DIRSYNC
+static char *apszDirs[SYNC_BATCH_SIZE];	/* Parent directories of the new names not synced yet */
+static int nDirs = 0;			/* Number of names in apszDirs */
+#endif
+#if defined(__linux__)
+static int *ahSyncFS = NULL;		/* Handles on the file systems to sync at the end */
+static dev_t *aSyncDev = NULL;		/* Their device numbers */
+static int nSyncFS = 0;			/* Number of handles in ahSyncFS */
+#endif
+static long nSyncFiles = 0;		/* Number of files synced */
+static double dSyncTime = 0;		/* Time spent waiting for syncs, in seconds */
+
+static char *pszSyncPolicies[] = {"none", "file", "batch", "end", NULL};
+
+/* Get a monotonic time in seconds, for measuring the time spent in syncs */
+static double SyncClock(void) {
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec / 1E9);
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function 	    SetSyncPolicy					      |
+|									      |
+|   Description     Select the durability policy for the files written	      |
+|									      |
+|   Parameters      const char *pszPolicy	none|file|batch|end	      |
+|									      |
+|   Returns 	    0=success, else -1 and errno set			      |
+|									      |
+|   Notes 	    							      |
+|									      |
+|   History 								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int SetSyncPolicy(const char *pszPolicy) {
+  int i;
+  for (i = 0; pszSyncPolicies[i]; i++) {
+    if (!strcmp(pszPolicy, pszSyncPolicies[i])) {
+      iSyncPolicy = i;
+      DEBUG_PRINTF(("// Sync policy = %s\n", pszPolicy));
+      return 0;
+    }
+  }
+  errno = EINVAL;
+  return -1;
+}
+
+int GetSyncPolicy(void) {
+  return iSyncPolicy;
+}
+
+const char *GetSyncPolicyName(void) {
+  return pszSyncPolicies[iSyncPolicy];
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function 	    GetSyncStats					      |
+|									      |
+|   Description     Get the number of files synced, and the time spent on it  |
+|									      |
+|   Parameters      long *pnFiles		Where to store the # of files |
+|		    double *pdSeconds		Where to store the time       |
+|									      |
+|   Returns 	    Nothing						      |
+|									      |
+|   Notes 	    Call syncall() first, to include the pending syncs.	      |
+|									      |
+|   History 								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+void GetSyncStats(long *pnFiles, double *pdSeconds) {
+  if (pnFiles) *pnFiles = nSyncFiles;
+  if (pdSeconds) *pdSeconds = dSyncTime;
+}
+
+#ifndef NO_DIRSYNC
+/* Sync a directory, to make durable the names created in it */
+static int syncdir(const char *pszDir) {
+  int iErr;
+  int fd = open(pszDir, O_RDONLY | O_DIRECTORY);
+  DEBUG_PRINTF(("// Syncing directory %s\n", pszDir));
+  if (fd == -1) return -1;
+  iErr = fsync(fd);
+  close(fd);
+  return iErr;
+}
+
+/* Get the parent directory of a pathname. Returns a new string, or NULL */
+static char *parentdir(const char *pszPath) {
+  size_t l = strlen(pszPath);
+  char *pszDir;
+  while ((l > 1) && (pszPath[l-1] == '/')) l--; /* Ignore trailing slashes */
+  while (l && (pszPath[l-1] != '/')) l--;	/* Remove the last name */
+  while ((l > 1) && (pszPath[l-1] == '/')) l--; /* And the slashes before it */
+  if (!l) return strdup(".");
+  pszDir = malloc(l + 1);
+  if (pszDir) {
+    memcpy(pszDir, pszPath, l);
+    pszDir[l] = '\0';
+  }
+  return pszDir;
+}
+#endif /* !defined(NO_DIRSYNC) */
+
+#if defined(__linux__)
+/* Record the file system containing fd, for syncall() to sync it.
+   If iOwn, fd is ours to keep or close, else it's duplicated if needed. */
+static int addsyncfs(int fd, int iOwn) {
+  struct stat st;
+  int i;
+  int *ah;
+  dev_t *aDev;
+
+  if (fstat(fd, &st)) goto fail;
+  for (i = nSyncFS; i; i--) { /* Most files are on the same file system as the previous one */
+    if (aSyncDev[i-1] == st.st_dev) {
+      if (iOwn) close(fd);
+      return 0;
+    }
+  }
+  ah = realloc(ahSyncFS, (nSyncFS + 1) * sizeof(int));
+  if (ah) ahSyncFS = ah;
+  aDev = realloc(aSyncDev, (nSyncFS + 1) * sizeof(dev_t));
+  if (aDev) aSyncDev = aDev;
+  if ((!ah) || (!aDev)) goto fail;
+  if (!iOwn) fd = dup(fd);
+  if (fd == -1) return -1;
+  DEBUG_PRINTF(("// Will sync the file system of device 0x%lX\n", (unsigned long)st.st_dev));
+  ahSyncFS[nSyncFS] = fd;
+  aSyncDev[nSyncFS++] = st.st_dev;
+  return 0;
+fail:
+  if (iOwn) close(fd);
+  return -1;
+}
+#endif
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function 	    syncbatch						      |
+|									      |
+|   Description     Wait for the completion of the current batch of files     |
+|									      |
+|   Parameters      None						      |
+|									      |
+|   Returns 	    0=success, else -1 and errno set			      |
+|									      |
+|   Notes 	    							      |
+|									      |
+|   History 								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+static int syncbatch(void) {
+  int i;
+  int iErr = 0;
+  int iErrno = 0;
+  double d0;
+
+#ifndef NO_DIRSYNC
+  if ((!nBatch) && (!nDirs)) return 0;
+#else
+  if (!nBatch) return 0;
+#endif
+  DEBUG_PRINTF(("// Syncing a batch of %d files\n", nBatch));
+  d0 = SyncClock();
+  for (i = 0; i < nBatch; i++) {
+#ifndef NO_FSYNC
+    if (fsync(aBatch[i]) && !iErr) {
+      iErr = -1;
+      iErrno = errno;
+    }
+#endif
+    close(aBatch[i]);
+  }
+#ifndef NO_DIRSYNC
+  /* Then the directories containing the new names, now that the data is there */
+  for (i = 0; i < nDirs; i++) {
+    if (syncdir(apszDirs[i]) && !iErr) {
+      iErr = -1;
+      iErrno = errno;
+    }
+    free(apszDirs[i]);
+  }
+  nDirs = 0;
+#endif
+  dSyncTime += SyncClock() - d0;
+  nSyncFiles += nBatch;
+  nBatch = 0;
+  if (iErr) errno = iErrno;
+  return iErr;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function 	    syncfile						      |
+|									      |
+|   Description     Make a file durable, according to the selected policy     |
+|									      |
+|   Parameters      int fd			The file handle		      |
+|									      |
+|   Returns 	    0=success, else -1 and errno set			      |
+|									      |
+|   Notes 	    Call it after writing the file data, before closing it.   |
+|		    If using C streams, fflush() the stream first.	      |
+|		    The handle may then be closed immediately, as the batch   |
+|		    mode keeps its own duplicate handle when needed.	      |
+|									      |
+|   History 								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int syncfile(int fd) {
+  int iErr = 0;
+  double d0;
+
+  switch (iSyncPolicy) {
+    case SYNC_FILE:
+#ifndef NO_FSYNC
+      d0 = SyncClock();
+      iErr = fsync(fd);
+      dSyncTime += SyncClock() - d0;
+#endif
+      nSyncFiles += 1;
+      break;
+    case SYNC_END:
+#if defined(__linux__)
+      if (addsyncfs(fd, 0)) { /* Else syncall() will sync the file system containing it */
+	d0 = SyncClock();
+	iErr = fsync(fd);
+	dSyncTime += SyncClock() - d0;
+      }
+      nSyncFiles += 1;
+      break;
+#endif
+      /* Else fall through to the batch mode, which is the closest alternative */
+    case SYNC_BATCH: {
+      int fd2;
+#if defined(__linux__)
+      /* Start the write-back now, but don't wait for its completion */
+      sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+#endif
+      if (nBatch == SYNC_BATCH_SIZE) iErr = syncbatch();
+      fd2 = dup(fd);
+      if (fd2 == -1) { /* Out of handles. Sync it now. */
+#ifndef NO_FSYNC
+	d0 = SyncClock();
+	if (fsync(fd) && !iErr) iErr = -1;
+	dSyncTime += SyncClock() - d0;
+#endif
+	nSyncFiles += 1;
+      } else {
+	aBatch[nBatch++] = fd2;
+      }
+      break;
+    }
+    default: /* SYNC_NONE */
+      break;
+  }
+  return iErr;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function 	    syncfilenow						      |
+|									      |
+|   Description     Sync a file immediately, unless the policy is none	      |
+|									      |
+|   Parameters      int fd			The file handle		      |
+|									      |
+|   Returns 	    0=success, else -1 and errno set			      |
+|									      |
+|   Notes 	    For files that must be durable before the next step,      |
+|		    like a temporary file before renaming it.		      |
+|									      |
+|   History 								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int syncfilenow(int fd) {
+  int iErr = 0;
+#ifndef NO_FSYNC
+  double d0;
+
+  if (iSyncPolicy == SYNC_NONE) return 0;
+  d0 = SyncClock();
+  iErr = fsync(fd);
+  dSyncTime += SyncClock() - d0;
+#endif
+  return iErr;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function 	    syncname						      |
+|									      |
+|   Description     Make the name of a new file or directory durable	      |
+|									      |
+|   Parameters      const char *pszPath		The new file or directory     |
+|									      |
+|   Returns 	    0=success, else -1 and errno set			      |
+|									      |
+|   Notes 	    Call it after creating or renaming the file or directory. |
+|		    Syncs its parent directory according to the policy.	      |
+|		    Overwriting an existing file does not need it.	      |
+|									      |
+|   History 								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#ifdef NO_DIRSYNC
+#pragma warning(disable:4100) /* Ignore the "unreferenced formal parameter" warning */
+#endif
+
+int syncname(const char *pszPath) {
+  int iErr = 0;
+#ifndef NO_DIRSYNC
+  char *pszDir;
+  int i;
+  double d0;
+
+  if (iSyncPolicy == SYNC_NONE) return 0;
+  pszDir = parentdir(pszPath);
+  if (!pszDir) return -1;
+  switch (iSyncPolicy) {
+    case SYNC_FILE:
+      d0 = SyncClock();
+      iErr = syncdir(pszDir);
+      dSyncTime += SyncClock() - d0;
+      break;
+    case SYNC_END:
+#if defined(__linux__)
+    { /* syncfs() will sync it, provided it knows which file system to sync */
+      int fd = open(pszDir, O_RDONLY | O_DIRECTORY);
+      if ((fd == -1) || addsyncfs(fd, 1)) {
+	d0 = SyncClock();
+	iErr = syncdir(pszDir);
+	dSyncTime += SyncClock() - d0;
+      }
+      break;
+    }
+#endif
+      /* Else fall through to the batch mode, which is the closest alternative */
+    case SYNC_BATCH:
+      for (i = nDirs; i; i--) { /* Most new names are in the same directory as the previous one */
+	if (!strcmp(apszDirs[i-1], pszDir)) break;
+      }
+      if (i) break; /* This directory will already be synced */
+      if (nDirs == SYNC_BATCH_SIZE) iErr = syncbatch();
+      apszDirs[nDirs++] = pszDir;
+      pszDir = NULL; /* It's now owned by apszDirs[] */
+      break;
+    default:
+      break;
+  }
+  free(pszDir);
+#endif /* !defined(NO_DIRSYNC) */
+  return iErr;
+}
+
+#ifdef NO_DIRSYNC
+#pragma warning(default:4100)
+#endif
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function 	    syncall						      |
+|									      |
+|   Description     Complete all pending syncs				      |
+|									      |
+|   Parameters      None						      |
+|									      |
+|   Returns 	    0=success, else -1 and errno set			      |
+|									      |
+|   Notes 	    Call it once before exiting, and before GetSyncStats().   |
+|									      |
+|   History 								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int syncall(void) {
+  int iErr = syncbatch();
+
+#if defined(__linux__)
+  if (nSyncFS) {
+    double d0 = SyncClock();
+    int i;
+    for (i = 0; i < nSyncFS; i++) {
+      DEBUG_PRINTF(("syncfs(%d);\n", ahSyncFS[i]));
+      if (syncfs(ahSyncFS[i])) iErr = -1;
+      close(ahSyncFS[i]);
+    }
+    dSyncTime += SyncClock() - d0;
+    nSyncFS = 0;
+  }
+#endif
+
+  return iErr;
+}
@@ -0,0 +1,872 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        textfilt.c                                                *
+*                                                                             *
+*   Description     Reusable text filters                                     *
+*                                                                             *
+*   Notes           The transforms initially in trim.c and detab.c, factored  *
+*		    here so that other programs can apply them in-process,    *
+*		    without spawning one process per file.		      *
+*		    							      *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file, with the main loops of trim.c and      *
+*		    detab.c.						      *
+*    2026-10-18 JFL Rewrote DetabStream() to process large blocks.	      *
+*    2026-10-18 JFL Idem for TrimStream(), which now supports NUL bytes.      *
+*    2026-10-18 JFL FilterFileInPlace() now uses the rewrite.c routines.      *
+*    2026-10-18 JFL Added DeffeedStream(), moved here from deffeed.c main().  *
+*    2026-10-18 JFL Added DumpStream(), with the output format of dump.c.     *
+*		    TfRead() now supports streams without a file descriptor.  *
+*    2026-10-18 JFL Added DumpLine(), a table-driven dump line formatter.     *
+*    2026-10-18 JFL Rewrote DeffeedStream() to process large blocks, with     *
+*		    lines of any length.				      *
+*    2026-10-18 JFL Added DumpTitle() and DumpOffsetDigits(), so that the     *
+*		    title columns match the offsets width beyond 4GB.	      *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define _CRT_SECURE_NO_WARNINGS /* Prevent warnings about using fopen, etc */
+
+#define _GNU_SOURCE		/* Include as many extensions as possible */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "debugm.h"		/* SysToolsLib debug macros */
+
+#include "textfilt.h"		/* Public definitions for this file */
+#include "rewrite.h"		/* SysLib safe in-place file rewrite */
+
+#define FALSE 0
+#define TRUE 1
+
+/************************ Win32-specific definitions *************************/
+
+#ifdef _WIN32		/* Automatically defined when targeting a Win32 app. */
+
+#include <io.h>
+
+#pragma warning(disable:4996)	/* Ignore the deprecated name warning */
+
+#endif /* _WIN32 */
+
+/************************ MS-DOS-specific definitions ************************/
+
+#ifdef _MSDOS		/* Automatically defined when targeting an MS-DOS app. */
+
+#include <io.h>
+
+#define TF_BLOCK_SIZE 0x2000	/* Keep buffers small in the 64KB data segment */
+
+#endif /* _MSDOS */
+
+/********************** End of OS-specific definitions ***********************/
+
+#ifndef TF_BLOCK_SIZE
+#define TF_BLOCK_SIZE 0x40000	/* Input and output blocks size */
+#endif
+
+#if defined(__GLIBC__)
+#define TfMemRChr memrchr	/* Optimized in the GNU C library */
+#else
+static void *TfMemRChr(const void *pBuf, int c, size_t n) {
+  const char *p = (const char *)pBuf + n;
+  while (n--) if (*(--p) == (char)c) return (void *)p;
+  return NULL;
+}
+#endif
+
+/* Buffered output, to avoid the overhead of one fwrite() per small span */
+typedef struct {
+  FILE *df;			/* The output stream */
+  char *pBuf;			/* The output buffer */
+  size_t nBuf;			/* The number of bytes in the buffer */
+  int iErr;			/* errno of the first write error, else 0 */
+} TFOUT;
+
+static void TfFlush(TFOUT *pOut) {
+  if (pOut->nBuf && !pOut->iErr) {
+    if (fwrite(pOut->pBuf, pOut->nBuf, 1, pOut->df) != 1) pOut->iErr = errno ? errno : EIO;
+  }
+  pOut->nBuf = 0;
+}
+
+static void TfWrite(TFOUT *pOut, const char *p, size_t n) {
+  if ((pOut->nBuf + n) > TF_BLOCK_SIZE) TfFlush(pOut);
+  if (n >= TF_BLOCK_SIZE) {	/* Write large spans directly from the input buffer */
+    if (!pOut->iErr && (fwrite(p, n, 1, pOut->df) != 1)) pOut->iErr = errno ? errno : EIO;
+    return;
+  }
+  memcpy(pOut->pBuf + pOut->nBuf, p, n);
+  pOut->nBuf += n;
+}
+
+/* Write n spaces */
+static void TfWriteSpaces(TFOUT *pOut, size_t n) {
+  static const char szSpaces[] = "                                                                ";
+  while (n) {
+    size_t n1 = (n < (sizeof(szSpaces) - 1)) ? n : (sizeof(szSpaces) - 1);
+    TfWrite(pOut, szSpaces, n1);
+    n -= n1;
+  }
+}
+
+/* Read a block. Files are read in full blocks. Pipes and consoles return
+   what's available, so that the output follows the input in real time.
+   So the stream must not have been read by stdio functions before.
+   Custom streams, like textpipe.c pipes, have no file descriptor. */
+static size_t TfRead(FILE *sf, char *pBuf, size_t nSize, int *piErr) {
+  struct stat st;
+  int iFD = fileno(sf);
+  int iRead;
+
+  if ((iFD < 0) || (!fstat(iFD, &st) && S_ISREG(st.st_mode))) {
+    size_t nRead = fread(pBuf, 1, nSize, sf);
+    if (!nRead && ferror(sf)) *piErr = errno ? errno : EIO;
+    return nRead;
+  }
+  do {
+    iRead = (int)read(iFD, pBuf, (unsigned int)nSize);
+  } while ((iRead == -1) && (errno == EINTR));
+  if (iRead == -1) {
+    *piErr = errno;
+    return 0;
+  }
+  return (size_t)iRead;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    TrimStream						      |
+|									      |
+|   Description     Remove blanks at the end of lines			      |
+|									      |
+|   Parameters      FILE *sf		The input stream		      |
+|		    FILE *df		The output stream		      |
+|		    void *pRef		Unused				      |
+|		    							      |
+|   Returns	    The number of lines changed, or -1 if error.	      |
+|		    							      |
+|   Notes	    The final \r and \n, if any, are preserved.		      |
+|		    Processes the input in large blocks. Line ends are found  |
+|		    with memchr(), and only the last bytes of each line are   |
+|		    checked. The unchanged spans, often many lines long, are  |
+|		    written as a whole, directly from the input buffer.	      |
+|		    The trailing blanks of an incomplete line at the end of a |
+|		    block are kept, until the next block tells if they're     |
+|		    at the end of that line.				      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Moved here from trim.c main().			      |
+|    2026-10-18 JFL Process large blocks instead of lines. This also fixes    |
+|		    the loss of the end of lines after a NUL.		      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+/* Skip back the blanks that trim removes */
+static char *TfTrimEnd(char *p, char *pEnd) {
+  while ((pEnd > p) && ((pEnd[-1] == ' ') || (pEnd[-1] == '\t') || (pEnd[-1] == '\r'))) pEnd--;
+  return pEnd;
+}
+
+long TrimStream(FILE *sf, FILE *df, void *pRef) {
+  long lnChanges = 0;		/* Number of lines changed */
+  size_t lIn = TF_BLOCK_SIZE;	/* The input buffer size */
+  char *pIn;			/* The input buffer */
+  size_t nKeep = 0;		/* Number of bytes kept from the previous block */
+  size_t nAsked;
+  size_t nRead;
+  TFOUT out;
+  int iErr = 0;
+
+  (void)pRef;
+  pIn = malloc(lIn);
+  out.df = df;
+  out.pBuf = malloc(TF_BLOCK_SIZE);
+  out.nBuf = 0;
+  out.iErr = 0;
+  if (!pIn || !out.pBuf) {
+    free(pIn);
+    free(out.pBuf);
+    return -1;
+  }
+  for (;;) {
+    char *p = pIn;
+    char *pSpan = pIn;		/* Beginning of the unchanged span */
+    char *pEnd;
+    char *pLF;
+    char *pLast;
+    int hasCR;
+
+    nAsked = lIn - nKeep;
+    nRead = TfRead(sf, pIn + nKeep, nAsked, &iErr);
+    if (iErr) break;
+    pEnd = pIn + nKeep + nRead;
+    while ((pLF = memchr(p, '\n', pEnd - p)) != NULL) {
+      pLast = TfTrimEnd(p, pLF);	/* End of the data to preserve */
+      hasCR = (pLF > p) && (pLF[-1] == '\r');
+      if ((pLast != pLF) && !(hasCR && (pLast == (pLF - 1)))) { /* This line changed */
+	TfWrite(&out, pSpan, pLast - pSpan);
+	if (hasCR) TfWrite(&out, "\r", 1); /* Restore the final \r */
+	pSpan = pLF;
+	lnChanges += 1;
+      }
+      p = pLF + 1;
+    }
+    if (!nRead) {		/* End of file. Trim the last line, if any. */
+      pLast = TfTrimEnd(p, pEnd);
+      hasCR = (pEnd > p) && (pEnd[-1] == '\r');
+      if ((pLast != pEnd) && !(hasCR && (pLast == (pEnd - 1)))) {
+	TfWrite(&out, pSpan, pLast - pSpan);
+	if (hasCR) TfWrite(&out, "\r", 1);
+	pSpan = pEnd;
+	lnChanges += 1;
+      }
+      TfWrite(&out, pSpan, pEnd - pSpan);
+      break;
+    }
+    /* Keep the trailing blanks of the incomplete last line for the next block */
+    pLast = TfTrimEnd(p, pEnd);
+    TfWrite(&out, pSpan, pLast - pSpan);
+    nKeep = pEnd - pLast;
+    if (nKeep) memmove(pIn, pLast, nKeep);
+    if (nKeep == lIn) {		/* A huge run of blanks */
+      char *pIn2 = realloc(pIn, 2 * lIn);
+      if (!pIn2) {
+	iErr = ENOMEM;
+	break;
+      }
+      pIn = pIn2;
+      lIn *= 2;
+    }
+    if (nRead < nAsked) {	/* A pipe or console may wait for more */
+      TfFlush(&out);
+      fflush(df);
+    }
+  }
+  TfFlush(&out);
+  free(pIn);
+  free(out.pBuf);
+  if (!iErr) iErr = out.iErr;
+  if (iErr) {
+    errno = iErr;
+    return -1;
+  }
+  return lnChanges;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    DetabStream						      |
+|									      |
+|   Description     Convert tabs to spaces				      |
+|									      |
+|   Parameters      FILE *sf		The input stream		      |
+|		    FILE *df		The output stream		      |
+|		    void *pRef		int *piTabSize. NULL = 8	      |
+|		    							      |
+|   Returns	    The number of tabs converted, or -1 if error.	      |
+|		    							      |
+|   Notes	    Processes the input in large blocks. Tabs are found with  |
+|		    memchr(), and the last \n before each with memrchr(),     |
+|		    which are vectorized in the C library. The spans in	      |
+|		    between are copied as a whole, and the tabs padding comes |
+|		    from a constant string of spaces.			      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Moved here from detab.c main().			      |
+|    2026-10-18 JFL Process large blocks instead of one character at a time.  |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+long DetabStream(FILE *sf, FILE *df, void *pRef) {
+  int n = pRef ? *(int *)pRef : 8;
+  size_t col = 0;		/* Current column, modulo n */
+  long lnChanges = 0;		/* Number of tabs converted */
+  char *pIn;
+  size_t nRead;
+  TFOUT out;
+  int iErr = 0;
+
+  if (n < 1) n = 1;
+  pIn = malloc(TF_BLOCK_SIZE);
+  out.df = df;
+  out.pBuf = malloc(TF_BLOCK_SIZE);
+  out.nBuf = 0;
+  out.iErr = 0;
+  if (!pIn || !out.pBuf) {
+    free(pIn);
+    free(out.pBuf);
+    return -1;
+  }
+  while ((nRead = TfRead(sf, pIn, TF_BLOCK_SIZE, &iErr)) != 0) {
+    char *p = pIn;
+    char *pEnd = pIn + nRead;
+    while (p < pEnd) {
+      char *pTab = memchr(p, '\t', pEnd - p);
+      char *pStop = pTab ? pTab : pEnd;
+      char *pLF = TfMemRChr(p, '\n', pStop - p);
+      /* Copy the span up to the tab, and update the column */
+      if (pLF) {
+	col = (size_t)(pStop - pLF - 1) % n;
+      } else {
+	col = (col + (size_t)(pStop - p)) % n;
+      }
+      TfWrite(&out, p, pStop - p);
+      if (!pTab) break;
+      TfWriteSpaces(&out, n - col); /* Pad with spaces up to the next tab stop */
+      col = 0;
+      lnChanges += 1;			/* Count the # of tabs converted */
+      p = pTab + 1;
+    }
+    if (nRead < TF_BLOCK_SIZE) {	/* A pipe or console may wait for more */
+      TfFlush(&out);
+      fflush(df);
+    }
+  }
+  TfFlush(&out);
+  free(pIn);
+  free(out.pBuf);
+  if (!iErr) iErr = out.iErr;
+  if (iErr) {
+    errno = iErr;
+    return -1;
+  }
+  return lnChanges;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    DeffeedStream					      |
+|									      |
+|   Description     Paginate a text, removing form feeds and tabs	      |
+|									      |
+|   Parameters      FILE *sf		The input stream		      |
+|		    FILE *df		The output stream		      |
+|		    void *pRef		deffeedOpts *. The page layout	      |
+|		    							      |
+|   Returns	    The number of lines read, or -1 if error.		      |
+|		    							      |
+|   Notes	    Form feeds are replaced by blank lines up to the end of   |
+|		    the page. Several pages can be output side-by-side, with  |
+|		    ncols > 1, for printing in landscape mode.		      |
+|		    Lines can have any length. They're only truncated to the  |
+|		    column width in multicolumn mode.			      |
+|		    All the state is local, so that several threads can	      |
+|		    paginate different files at the same time.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Moved here from deffeed.c main().			      |
+|    2026-10-18 JFL Process large blocks instead of one line at a time, and   |
+|		    removed the line size limit.			      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#define DF_NBLANKS 64		/* Number of blank lines written at once */
+
+typedef struct {		/* DeffeedStream() state */
+  deffeedOpts *pdo;		/* The page layout */
+  int lpp;			/* Lines per page */
+  int nsp;			/* Spaces before each line. 0 to 10 */
+  int iWidth;			/* Columns width, including the distance */
+  int iText;			/* Columns text width. 0 to iWidth */
+  size_t lRow;			/* Size of the first ncols-1 columns in a row */
+  char *pCols;			/* The first ncols-1 columns of every line */
+  char *pBlanks;		/* DF_NBLANKS blank lines */
+  int nl;			/* Current line number (0 to lpp+extra-1) */
+  int np;			/* Current page number, modulo modnp */
+  int modnp;			/* Number of logical pages on a physical page */
+  int top_without_ff;		/* TRUE if we've reached the top of page without a form-feed */
+  long lnLines;			/* Number of lines read */
+  TFOUT out;			/* The buffered output */
+} DFSTATE;
+
+/* Output the spaces before a line, then the line with its tabs converted */
+static void DfWriteText(DFSTATE *pds, const char *p, size_t n) {
+  const char *pEnd = p + n;
+  int tab = pds->pdo->tab;
+  size_t col = 0;		/* Current column, excluding the spaces before */
+
+  TfWriteSpaces(&pds->out, pds->nsp);
+  while (p < pEnd) {
+    const char *pTab = memchr(p, '\t', pEnd - p);
+    const char *pStop = pTab ? pTab : pEnd;
+    TfWrite(&pds->out, p, pStop - p);
+    if (!pTab) break;
+    col += pStop - p;
+    if (tab > 0) {		/* Pad with spaces up to the next tab stop */
+      size_t nSpaces = tab - (col % tab);
+      TfWriteSpaces(&pds->out, nSpaces);
+      col += nSpaces;
+    }				/* Else tabs are just removed */
+    p = pTab + 1;
+  }
+}
+
+/* Render a line in a column, truncated to the text width, and padded with spaces */
+static void DfRenderColumn(DFSTATE *pds, char *pCol, const char *p, size_t n) {
+  char *pc = pCol;
+  char *pMax = pCol + pds->iText;
+  const char *pEnd = p + n;
+  int tab = pds->pdo->tab;
+  int i;
+
+  for (i = 0; (i < pds->nsp) && (pc < pMax); i++) *(pc++) = ' ';
+  for ( ; (p < pEnd) && (pc < pMax); p++) {
+    if (*p != '\t') {
+      *(pc++) = *p;
+    } else if (tab > 0) {
+      i = tab - (int)((pc - pCol - pds->nsp) % tab);
+      while (i-- && (pc < pMax)) *(pc++) = ' ';
+    }
+  }
+  memset(pc, ' ', pCol + pds->iWidth - pc);
+}
+
+/* Output a line, or store it in the multicolumn buffer until the last column */
+static void DfOutputLine(DFSTATE *pds, const char *p, size_t n, const char *pszEOL) {
+  int ncols = pds->pdo->ncols;
+  int iCol = pds->np % ncols;
+  char *pRow = pds->pCols + (pds->lRow * pds->nl);
+
+  if (iCol < ncols - 1) {	/* For all but the last column, accumulate */
+    DfRenderColumn(pds, pRow + (pds->iWidth * iCol), p, n);
+    return;
+  }
+  /* Output the accumulated columns if any, then the last column */
+  TfWrite(&pds->out, pRow, pds->lRow);
+  DfWriteText(pds, p, n);
+  TfWrite(&pds->out, pszEOL, strlen(pszEOL));
+}
+
+/* Output blank lines up to line nlEnd */
+static void DfOutputBlanks(DFSTATE *pds, int nlEnd) {
+  if (pds->pdo->ncols == 1) {	/* Write blank lines in bulk */
+    while (pds->nl < nlEnd) {
+      int n = nlEnd - pds->nl;
+      if (n > DF_NBLANKS) n = DF_NBLANKS;
+      TfWrite(&pds->out, pds->pBlanks, (size_t)n * (pds->nsp + 1));
+      pds->nl += n;
+    }
+  } else {
+    for ( ; pds->nl < nlEnd; pds->nl++) DfOutputLine(pds, "", 0, "\n");
+  }
+}
+
+/* Move to the top of the next page */
+static void DfNextPage(DFSTATE *pds) {
+  DfOutputBlanks(pds, pds->lpp + pds->pdo->extra);
+  pds->nl = 0;
+  pds->np += 1;
+  pds->np %= pds->modnp;
+}
+
+/* Paginate one input line, without its final \n */
+static void DfLine(DFSTATE *pds, const char *p, size_t n) {
+  pds->lnLines += 1;
+  if (pds->nl > 0) pds->top_without_ff = FALSE; /* It's not the top line anymore */
+
+  /* Remove the trailing carrier-return(s) */
+  while (n && (p[n-1] == '\r')) n--;
+
+  while (n && (*p == '\f')) {	/* If line begins with a form feed */
+    p += 1;
+    n -= 1;
+    /* Except in the case where we're at top line without a form-feed... */
+    /*  ... fill-up the rest of the page with blank lines. */
+    if (!pds->top_without_ff) DfNextPage(pds);
+    pds->top_without_ff = FALSE; /* Do this exception only once. (We've had a form-feed now.) */
+  }
+  if ((pds->nl == 0) && (!n) && (pds->top_without_ff == FALSE)) return; /* Ignore CRLF immediately following a FF */
+  if (n && (*p == '\b')) {	/* Remove backspaces at column 0 */
+    p += 1;
+    n -= 1;
+  }
+  DfOutputLine(pds, p, n, "\n");
+  pds->nl += 1;
+  if (pds->nl == pds->lpp) {
+    DfNextPage(pds);
+    pds->top_without_ff = TRUE;	/* Flag the fact we automatically fed a page. */
+  }
+}
+
+long DeffeedStream(FILE *sf, FILE *df, void *pRef) {
+  deffeedOpts *pdo = pRef;
+  DFSTATE ds = {0};
+  int fptp = pdo->fptp;		/* Number of logical full pages to print (0 = Off) */
+  size_t lIn = TF_BLOCK_SIZE;	/* The input buffer size */
+  char *pIn;			/* The input buffer */
+  size_t nKeep = 0;		/* Size of the incomplete line kept from the previous block */
+  size_t nAsked;
+  size_t nRead;
+  int iErr = 0;
+  int i;
+
+  ds.pdo = pdo;
+  ds.lpp = (pdo->lpp > 0) ? pdo->lpp : 1;
+  ds.nsp = pdo->nsp;
+  if (ds.nsp < 0) ds.nsp = 0;
+  if (ds.nsp > 10) ds.nsp = 10;
+  ds.iWidth = pdo->wcols + pdo->dcols;
+  if (ds.iWidth < 0) ds.iWidth = 0;
+  ds.iText = pdo->wcols;
+  if (ds.iText < 0) ds.iText = 0;
+  if (ds.iText > ds.iWidth) ds.iText = ds.iWidth;
+  ds.modnp = 1;
+  ds.top_without_ff = TRUE;
+  if (pdo->ncols > 1) {		/* fptp must be set for multicolumn operation */
+    if (!fptp) fptp = 1;
+    fptp *= pdo->ncols;		/* One physical page is ncols logical pages */
+    ds.lRow = (size_t)ds.iWidth * (pdo->ncols - 1);
+  }
+  if (fptp) ds.modnp = fptp;	/* Else default 1 */
+
+  pIn = malloc(lIn);
+  ds.pCols = malloc(ds.lRow * (ds.lpp + pdo->extra) + 1);
+  ds.pBlanks = malloc(DF_NBLANKS * (ds.nsp + 1));
+  ds.out.df = df;
+  ds.out.pBuf = malloc(TF_BLOCK_SIZE);
+  if (!pIn || !ds.pCols || !ds.pBlanks || !ds.out.pBuf) {
+    iErr = ENOMEM;
+    goto cleanup_and_return;
+  }
+  memset(ds.pCols, ' ', ds.lRow * (ds.lpp + pdo->extra));
+  for (i = 0; i < DF_NBLANKS; i++) {
+    char *pc = ds.pBlanks + (i * (ds.nsp + 1));
+    memset(pc, ' ', ds.nsp);
+    pc[ds.nsp] = '\n';
+  }
+
+  /* Process the input in large blocks. The lines are found with memchr(),
+     which is vectorized in the C library, and used in place in the block.
+     Only the incomplete last line is moved to the beginning of the buffer,
+     which grows if a single line does not fit in it. */
+  for (;;) {
+    char *p = pIn;
+    char *pEnd;
+    char *pLF;
+
+    nAsked = lIn - nKeep;
+    nRead = TfRead(sf, pIn + nKeep, nAsked, &iErr);
+    if (iErr) break;
+    pEnd = pIn + nKeep + nRead;
+    while ((pLF = memchr(p, '\n', pEnd - p)) != NULL) {
+      DfLine(&ds, p, pLF - p);
+      p = pLF + 1;
+    }
+    if (!nRead) {		/* End of file */
+      if (p < pEnd) DfLine(&ds, p, pEnd - p); /* The last line without a \n */
+      break;
+    }
+    nKeep = pEnd - p;
+    if (nKeep) memmove(pIn, p, nKeep);
+    if (nKeep == lIn) {		/* A huge line */
+      char *pIn2 = realloc(pIn, 2 * lIn);
+      if (!pIn2) {
+	iErr = ENOMEM;
+	break;
+      }
+      pIn = pIn2;
+      lIn *= 2;
+    }
+    if (nRead < nAsked) {	/* A pipe or console may wait for more */
+      TfFlush(&ds.out);
+      fflush(df);
+    }
+  }
+
+  if (fptp && (ds.np || ds.nl)) {
+    if ((pdo->ncols == 1) || pdo->fptp) {
+      while (ds.np < fptp) {
+	DfOutputBlanks(&ds, ds.lpp + pdo->extra);
+	ds.nl = 0;
+	ds.np += 1;
+      }
+    } else { /* Do not output the very last line feed in multicolumn mode */
+      while (ds.np < fptp - 1) {
+	DfOutputBlanks(&ds, ds.lpp + pdo->extra);
+	ds.nl = 0;
+	ds.np += 1;
+      }
+      DfOutputBlanks(&ds, ds.lpp + pdo->extra - 1);
+      DfOutputLine(&ds, "", 0, " ");
+    }
+  }
+  TfFlush(&ds.out);
+  if (!iErr) iErr = ds.out.iErr;
+
+cleanup_and_return:
+  free(pIn);
+  free(ds.pCols);
+  free(ds.pBlanks);
+  free(ds.out.pBuf);
+  if (iErr) {
+    errno = iErr;
+    return -1;
+  }
+  return ds.lnLines;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    DumpLine						      |
+|									      |
+|   Description     Format one line of an hexadecimal dump		      |
+|									      |
+|   Parameters      char *pLine		Output buffer. DUMP_LINE_MAX bytes    |
+|		    int nDigits		Min # of offset digits. 8 to 16	      |
+|		    dumpOffset_t offset	The offset of pData[0]		      |
+|		    const unsigned char *pData	16 bytes of data	      |
+|		    size_t iFirst	Index of the first byte to show	      |
+|		    size_t iEnd		Index after the last byte to show     |
+|		    							      |
+|   Returns	    The line length, including the final \n.		      |
+|		    							      |
+|   Notes	    Bytes outside of [iFirst, iEnd[ are displayed as blanks.  |
+|		    Offsets use more than nDigits digits if needed. Use       |
+|		    DumpOffsetDigits() to get the number of digits needed for |
+|		    the last offset, and DumpTitle() for matching titles.     |
+|		    The line is built from a blank template, in which every   |
+|		    byte is stored at a fixed position, using tables of the   |
+|		    hexadecimal pairs and of the characters to display.       |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+|    2026-10-18 JFL Added the nDigits argument.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+static const char szHexPairs[] =	/* The hexadecimal representation of every byte */
+  "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+  "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+  "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+  "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+  "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+  "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+  "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+  "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static const unsigned char abDumpChars[256] = { /* The character displayed for every byte */
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+  0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
+  0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B, 0x5C, 0x5D, 0x5E, 0x5F,
+  0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F,
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x7B, 0x7C, 0x7D, 0x7E, 0x7F,
+#ifdef _UNIX			/* C1 control characters */
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+#else
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F,
+  0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9F,
+#endif
+  0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF,
+  0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF,
+  0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF,
+  0xD0, 0xD1, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF,
+  0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xEB, 0xEC, 0xED, 0xEE, 0xEF,
+  0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF,
+};
+
+/* The line template after the offset, and the positions of each byte in it */
+static const char szDumpTemplate[] =
+  "                                    "
+  "                                   \n";
+static const unsigned char abHexPos[16] = {2, 5, 8, 11, 15, 18, 21, 24, 28, 31, 34, 37, 41, 44, 47, 50};
+static const unsigned char abCharPos[16] = {54, 55, 56, 57, 58, 59, 60, 61, 63, 64, 65, 66, 67, 68, 69, 70};
+
+int DumpOffsetDigits(dumpOffset_t offLast) {
+  int n = 8;
+  while ((n < (int)(sizeof(offLast) * 2)) && (offLast >> (4 * n))) n += 1;
+  return n;
+}
+
+size_t DumpTitle(char *pBuf, int nDigits) {
+  static const char szTitle1[] = "00           04           08           0C           0   4    8   C   \n";
+  static const char szTitle2[] = "  -----------  -----------  -----------  -----------  -------- --------\n";
+  char *pc = pBuf;
+
+  if (nDigits < 8) nDigits = 8;
+  if (nDigits > (int)(sizeof(dumpOffset_t) * 2)) nDigits = (int)(sizeof(dumpOffset_t) * 2);
+  *(pc++) = '\n';
+  memcpy(pc, "Offset", 6);	/* Then pad it to the offsets width + 2 */
+  memset(pc + 6, ' ', nDigits - 4);
+  pc += nDigits + 2;
+  memcpy(pc, szTitle1, sizeof(szTitle1) - 1);
+  pc += sizeof(szTitle1) - 1;
+  memset(pc, '-', nDigits);
+  pc += nDigits;
+  memcpy(pc, szTitle2, sizeof(szTitle2) - 1);
+  pc += sizeof(szTitle2) - 1;
+  return (size_t)(pc - pBuf);
+}
+
+size_t DumpLine(char *pLine, int nDigits, dumpOffset_t offset, const unsigned char *pData, size_t iFirst, size_t iEnd) {
+  char *pc = pLine;
+  int i;
+  size_t u;
+
+  /* The offset, with at least nDigits digits */
+  for (i = (int)(sizeof(offset) * 8) - 4; (i > (4 * (nDigits - 1))) && !(offset >> i); i -= 4) ;
+  for ( ; i >= 0; i -= 4) *(pc++) = szHexPairs[2 * (int)((offset >> i) & 0xF) + 1];
+  /* The blank line, then the bytes at their fixed positions in it */
+  memcpy(pc, szDumpTemplate, sizeof(szDumpTemplate) - 1);
+  if (iEnd > 16) iEnd = 16;
+  for (u = iFirst; u < iEnd; u++) {
+    const char *pHex = szHexPairs + 2 * pData[u];
+    pc[abHexPos[u]] = pHex[0];
+    pc[abHexPos[u] + 1] = pHex[1];
+    pc[abCharPos[u]] = (char)abDumpChars[pData[u]];
+  }
+  return (size_t)(pc - pLine) + sizeof(szDumpTemplate) - 1;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    DumpStream						      |
+|									      |
+|   Description     Dump data in hexadecimal and text			      |
+|									      |
+|   Parameters      FILE *sf		The input stream		      |
+|		    FILE *df		The output stream		      |
+|		    void *pRef		Unused				      |
+|		    							      |
+|   Returns	    The number of lines dumped, or -1 if error.		      |
+|		    							      |
+|   Notes	    Same output as dump.exe without options.		      |
+|		    The offsets width is based on the size of files. Pipes    |
+|		    use 8 digits, and wider offsets beyond 4GB.		      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+|    2026-10-18 JFL Use the offsets width needed for the file size.	      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+long DumpStream(FILE *sf, FILE *df, void *pRef) {
+  unsigned char *pIn;
+  size_t nKeep = 0;		/* Bytes left from the previous block */
+  size_t nRead;
+  dumpOffset_t offset = 0;
+  long lnLines = 0;
+  char szLine[DUMP_TITLE_MAX];	/* Also used for the title */
+  TFOUT out;
+  int iErr = 0;
+  int nDigits = 8;
+  int fd = fileno(sf);
+  struct stat st;
+
+  (void)pRef;
+  if ((fd >= 0) && !fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size) {
+    nDigits = DumpOffsetDigits((dumpOffset_t)(st.st_size - 1));
+  }
+  pIn = malloc(TF_BLOCK_SIZE);
+  out.df = df;
+  out.pBuf = malloc(TF_BLOCK_SIZE);
+  out.nBuf = 0;
+  out.iErr = 0;
+  if (!pIn || !out.pBuf) {
+    free(pIn);
+    free(out.pBuf);
+    errno = ENOMEM;
+    return -1;
+  }
+  TfWrite(&out, szLine, DumpTitle(szLine, nDigits));
+  do {
+    size_t n, nLine;
+    nRead = TfRead(sf, (char *)pIn + nKeep, TF_BLOCK_SIZE - nKeep, &iErr);
+    nKeep += nRead;
+    /* Dump full lines, and the partial last line at the end of file */
+    for (n = 0; (n < nKeep) && (((nKeep - n) >= 16) || !nRead); n += nLine) {
+      nLine = ((nKeep - n) < 16) ? (nKeep - n) : 16;
+      TfWrite(&out, szLine, DumpLine(szLine, nDigits, offset, pIn + n, 0, nLine));
+      offset += 16;
+      lnLines += 1;
+    }
+    nKeep -= n;
+    if (nKeep) memmove(pIn, pIn + n, nKeep);
+    if (nRead && (nRead < TF_BLOCK_SIZE)) { /* A pipe or console may wait for more */
+      TfFlush(&out);
+      fflush(df);
+    }
+  } while (nRead);
+#ifdef _UNIX
+  TfWrite(&out, "\n", 1);
+#endif
+  TfFlush(&out);
+  free(pIn);
+  free(out.pBuf);
+  if (!iErr) iErr = out.iErr;
+  if (iErr) {
+    errno = iErr;
+    return -1;
+  }
+  return lnLines;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    FilterFileInPlace					      |
+|									      |
+|   Description     Apply a text filter to a file, replacing its content      |
+|									      |
+|   Parameters      const char *pszName	The file to filter		      |
+|		    pTextFilter_t pFilter	The filter routine	      |
+|		    void *pRef		The filter options		      |
+|		    							      |
+|   Returns	    The number of changes, or -1 if error, with errno set.    |
+|		    							      |
+|   Notes	    The file is rewritten by the rewrite.c routines. If       |
+|		    nothing changed, the original file is left untouched.     |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine, based on trim.c main().	      |
+|    2026-10-18 JFL Use the rewrite.c routines, which only write a new file  |
+|		    when the content actually changes.			      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+long FilterFileInPlace(const char *pszName, pTextFilter_t pFilter, void *pRef) {
+  FILE *sf;
+  REWRITE *pRw;
+  int iErr;
+  int iDone;
+  long lnChanges = -1;
+
+  DEBUG_ENTER(("FilterFileInPlace(\"%s\", %p, %p);\n", pszName, pFilter, pRef));
+
+  sf = fopen(pszName, "rb");
+  if (!sf) goto cleanup_and_return;
+  pRw = RewriteOpen(pszName, NULL);
+  if (!pRw) {
+    iErr = errno;
+    fclose(sf);
+    errno = iErr;
+    goto cleanup_and_return;
+  }
+
+  lnChanges = pFilter(sf, RewriteStream(pRw), pRef);
+  iErr = errno;
+  fclose(sf);			/* Windows can't replace files that are open */
+  iDone = RewriteClose(pRw, lnChanges > 0);
+  if (iDone < 0) {
+    if (lnChanges >= 0) iErr = errno;
+    lnChanges = -1;
+  } else if (!iDone && (lnChanges > 0)) {
+    lnChanges = 0;		/* The content did not actually change */
+  }
+  errno = iErr;
+
+cleanup_and_return:
+  DEBUG_LEAVE(("return %ld;\n", lnChanges));
+  return lnChanges;
+}
@@ -0,0 +1,112 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        textfilt.h                                                *
+*                                                                             *
+*   Description     Definitions for the reusable text filters                 *
+*                                                                             *
+*   Notes           The transforms of the trim and detab programs, callable   *
+*		    in-process by other programs, like redo.		      *
+*                                                                             *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.                                        *
+*    2026-10-18 JFL Added FilterTree() and DeffeedStream().                   *
+*    2026-10-18 JFL Added DumpStream() and the TextPipe routines.             *
+*    2026-10-18 JFL Added DumpLine().                                         *
+*    2026-10-18 JFL Added DumpTitle() and DumpOffsetDigits().                 *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#ifndef _TEXTFILT_H_
+#define _TEXTFILT_H_
+
+#include "SysLib.h"		/* SysLib Library core definitions */
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/* Text filter: Copy sf to df, transforming it. pRef = Filter-specific options.
+   Returns the number of changes done, or -1 if error, with errno set. */
+typedef long (*pTextFilter_t)(FILE *sf, FILE *df, void *pRef);
+
+long TrimStream(FILE *sf, FILE *df, void *pRef);   /* Remove blanks at the end of lines. pRef unused */
+long DetabStream(FILE *sf, FILE *df, void *pRef);  /* Convert tabs to spaces. pRef = int *piTabSize, or NULL for 8 */
+long DeffeedStream(FILE *sf, FILE *df, void *pRef); /* Paginate, removing form feeds. pRef = deffeedOpts * */
+long DumpStream(FILE *sf, FILE *df, void *pRef);   /* Dump in hexadecimal and text. pRef unused */
+
+/* DeffeedStream() options */
+typedef struct deffeedOpts {
+  int lpp;			/* Lines per page */
+  int tab;			/* Spaces per tab */
+  int nsp;			/* Spaces before each line. 0 to 10 */
+  int extra;			/* Extra lines after each page */
+  int fptp;			/* Fill a multiple of this number of pages. 0=Don't */
+  int ncols;			/* Number of pages side-by-side */
+  int wcols;			/* Columns width */
+  int dcols;			/* Distance between columns */
+} deffeedOpts;
+
+/* Dump lines formatting, for DumpStream() and dump.exe */
+#ifdef _MSDOS
+typedef unsigned long dumpOffset_t;	/* 16-bits compilers have no 64-bits integers */
+#else
+typedef unsigned long long dumpOffset_t;
+#endif
+#define DUMP_LINE_MAX 96		/* Max size of a dump line, including the final \n */
+#define DUMP_TITLE_MAX 192		/* Max size of the dump title lines */
+/* Get the number of offset digits for dumping up to offLast. At least 8 */
+int DumpOffsetDigits(dumpOffset_t offLast);
+/* Format the title lines, for offsets with nDigits. Returns the title length */
+size_t DumpTitle(char *pBuf, int nDigits);
+/* Format the bytes pData[iFirst to iEnd-1] of a 16-bytes line. Returns the line length */
+size_t DumpLine(char *pLine, int nDigits, dumpOffset_t offset, const unsigned char *pData, size_t iFirst, size_t iEnd);
+
+/* Filter a file in place. Returns the number of changes, or -1 if error.
+   The file is left unchanged if the filter did not change anything. */
+long FilterFileInPlace(const char *pszName, pTextFilter_t pFilter, void *pRef);
+
+/* FilterTree() options */
+typedef struct filterTreeOpts {	/* Must be cleared before use */
+  int iFlags;			/* [IN] FT_XXX flags below */
+  int nThreads;			/* [IN] Number of worker threads. 0=One per CPU */
+  char **ppszInclude;		/* [IN] Names of the files to filter */
+  int nInclude;			/* [IN] Number of include patterns. 0=All files */
+  char **ppszExclude;		/* [IN] Names of the files and dirs to skip */
+  int nExclude;			/* [IN] Number of exclude patterns */
+  long nFiles;			/* [OUT] Number of files filtered */
+  long nChanged;		/* [OUT] Number of files changed */
+  long nErrors;			/* [OUT] Number of errors */
+  long lnChanges;		/* [OUT] Total number of changes */
+} filterTreeOpts;
+
+/* filterTreeOpts iFlags */
+#define FT_VERBOSE	0x0001		/* Display the pathnames of the files changed */
+#define FT_NOEXEC	0x0002		/* Display the pathnames of the files to filter, but don't change them */
+
+/* Filter in place all matching files in a directory tree, in parallel threads.
+   Returns 0 if success, or -1 if any error occurred. */
+int FilterTree(const char *pszDir, filterTreeOpts *pfto, pTextFilter_t pFilter, void *pRef);
+
+/* In-process pipeline of text filters, running in parallel threads if possible */
+typedef struct _TEXTPIPE TEXTPIPE;	/* Opaque pipeline context */
+
+/* Create a pipeline from its description: --pipe STAGE [ARGS] [--pipe STAGE [ARGS]]...
+   STAGE = trim | detab [N] | deffeed [LPP [TAB]] | dump
+   Returns NULL if error, after displaying an error message. */
+TEXTPIPE *TextPipeNew(int argc, char *argv[]);
+/* Start the stages, the last one writing to df. Returns the stream where to
+   write the pipeline input, or NULL if error. Call TextPipeClose() in all cases. */
+FILE *TextPipeOpen(TEXTPIPE *pPipe, FILE *df);
+/* Close the input, and wait for all stages to complete. Frees pPipe.
+   Returns 0 if success, or -1 if any stage failed, with errno set. */
+int TextPipeClose(TEXTPIPE *pPipe);
+
+#ifdef __cplusplus
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* _TEXTFILT_H_ */
@@ -0,0 +1,553 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        textpipe.c                                                *
+*                                                                             *
+*   Description     Chain text filters in-process, like a shell pipeline      *
+*                                                                             *
+*   Notes           A pipeline is described by a list of stages on the        *
+*		    command line: --pipe STAGE [ARGS] [--pipe STAGE [ARGS]]...*
+*		    The calling program writes its own output to the stream   *
+*		    returned by TextPipeOpen(), which feeds the first stage.  *
+*		    							      *
+*		    In Unix, each stage runs in its own thread. The stages    *
+*		    are connected by in-memory pipes, which queue large data  *
+*		    blocks. So the data is never copied through the kernel,   *
+*		    and there are no system calls between the stages.	      *
+*		    							      *
+*		    Elsewhere, the stages run one after the other when the    *
+*		    pipeline is closed, through temporary files.	      *
+*		    							      *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.					      *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define _CRT_SECURE_NO_WARNINGS /* Prevent warnings about using fopen, etc */
+
+#define _GNU_SOURCE		/* Include as many extensions as possible */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "debugm.h"		/* SysToolsLib debug macros */
+
+#include "mainutil.h"		/* Print errors, streq, etc */
+#include "textfilt.h"		/* Public definitions for this file */
+
+/************************* Unix-specific definitions *************************/
+
+#ifdef _UNIX		/* Defined in SysLib.h for Unix flavors we support */
+
+#include <pthread.h>
+
+#if defined(__GLIBC__)
+#define HAS_FOPENCOOKIE 1	/* Custom streams are created by fopencookie() */
+#define HAS_THREADS 1		/* Stages can run in parallel */
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define HAS_FUNOPEN 1		/* Custom streams are created by funopen() */
+#define HAS_THREADS 1		/* Stages can run in parallel */
+#endif
+
+#endif /* _UNIX */
+
+/*********************** End of OS-specific definitions **********************/
+
+#ifndef HAS_THREADS
+#define HAS_THREADS 0
+#endif
+
+#define TP_BLOCK_SIZE 0x40000	/* Size of the blocks passed between stages */
+#define TP_MAX_BLOCKS 4		/* Max # of blocks queued between two stages */
+#define TP_STDIO_SIZE 0x1000	/* Small writes are grouped in stdio buffers */
+
+#define DEFLPP 60		/* deffeed default number of lines per page */
+
+#if HAS_THREADS
+
+typedef struct tpBlock {	/* A data block queued between two stages */
+  struct tpBlock *pNext;
+  size_t nData;			/* Number of bytes in data[] */
+  size_t iData;			/* Index of the first byte not yet read */
+  char data[TP_BLOCK_SIZE];
+} tpBlock;
+
+typedef struct {		/* An in-memory pipe between two stages */
+  pthread_mutex_t mutex;	/* Protects everything up to bBroken */
+  pthread_cond_t cond;		/* Signaled when anything below changes */
+  tpBlock *pFirst;		/* The queue of full blocks */
+  tpBlock *pLast;
+  int nQueued;			/* Number of blocks in the queue */
+  tpBlock *pFree;		/* Blocks read, which can be reused */
+  int bEOF;			/* TRUE when the writer closed its stream */
+  int bBroken;			/* TRUE when the reader closed its stream */
+  tpBlock *pWrite;		/* The block being filled by the writer */
+  tpBlock *pRead;		/* The block being emptied by the reader */
+  FILE *pfWrite;		/* The stream where the upstream stage writes */
+  FILE *pfRead;			/* The stream where the downstream stage reads */
+} tpPipe;
+
+#endif /* HAS_THREADS */
+
+typedef struct {		/* A pipeline stage */
+  const char *pszName;		/* The stage name, for error messages */
+  pTextFilter_t pFilter;	/* The filter routine */
+  void *pRef;			/* Its options: One of the structures below */
+  int iTab;			/* detab options */
+  deffeedOpts dfo;		/* deffeed options */
+  FILE *sf;			/* The stage input */
+  FILE *df;			/* The stage output */
+  long lnResult;		/* The filter result */
+  int iErr;			/* errno if the filter failed */
+#if HAS_THREADS
+  pthread_t tid;		/* The thread running the stage */
+  int bStarted;			/* TRUE if that thread was created */
+#endif
+} tpStage;
+
+struct _TEXTPIPE {
+  int nStages;
+  tpStage *pStages;
+  FILE *pfIn;			/* The pipeline input stream */
+  FILE *df;			/* The pipeline output stream */
+#if HAS_THREADS
+  tpPipe *pPipes;		/* nStages pipes. Pipe i feeds stage i */
+#endif
+};
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    TextPipeNew						      |
+|									      |
+|   Description     Create a pipeline from its command line description       |
+|									      |
+|   Parameters      int argc		Number of arguments		      |
+|		    char *argv[]	--pipe STAGE [ARGS] [--pipe ...]...   |
+|		    							      |
+|   Returns	    The pipeline, or NULL if error, with a message displayed. |
+|		    							      |
+|   Notes	    Stages:						      |
+|		    trim		Remove blanks at the end of lines     |
+|		    detab [N]		Convert tabs to N spaces. Default: 8  |
+|		    deffeed [LPP [TAB]]	Paginate, removing form feeds	      |
+|		    dump		Dump in hexadecimal and text	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+static int IsPipeSwitch(char *pszArg) {
+  return IsSwitch(pszArg) && streq(pszArg+1, "-pipe");
+}
+
+/* Parse an optional positive number stage argument */
+static int TpNumArg(int argc, char *argv[], int *pi, int *piValue) {
+  int i = *pi + 1;
+  char *pszEnd;
+  long l;
+  if ((i >= argc) || IsPipeSwitch(argv[i])) return 0;
+  l = strtol(argv[i], &pszEnd, 10);
+  if ((pszEnd == argv[i]) || *pszEnd || (l <= 0)) return -1;
+  *piValue = (int)l;
+  *pi = i;
+  return 1;
+}
+
+TEXTPIPE *TextPipeNew(int argc, char *argv[]) {
+  TEXTPIPE *pPipe;
+  tpStage *pStage;
+  int i;
+
+  DEBUG_ENTER(("TextPipeNew(%d, %p);\n", argc, argv));
+
+  pPipe = calloc(1, sizeof(TEXTPIPE));
+  if (pPipe) pPipe->pStages = calloc(argc, sizeof(tpStage)); /* More than enough */
+  if (!pPipe || !pPipe->pStages) {
+    pferror("Not enough memory");
+    goto failed;
+  }
+
+  for (i = 0; i < argc; i++) {
+    char *pszName;
+    if (!IsPipeSwitch(argv[i])) {
+      pferror("Unexpected argument in the pipeline: %s", argv[i]);
+      goto failed;
+    }
+    if (++i >= argc) {
+      pferror("Missing pipeline stage name");
+      goto failed;
+    }
+    pszName = argv[i];
+    pStage = pPipe->pStages + pPipe->nStages++;
+    pStage->pszName = pszName;
+    if (streq(pszName, "trim")) {
+      pStage->pFilter = TrimStream;
+    } else if (streq(pszName, "detab")) {
+      pStage->pFilter = DetabStream;
+      pStage->pRef = &pStage->iTab;
+      pStage->iTab = 8;
+      if (TpNumArg(argc, argv, &i, &pStage->iTab) < 0) goto bad_arg;
+    } else if (streq(pszName, "deffeed")) {
+      pStage->pFilter = DeffeedStream;
+      pStage->pRef = &pStage->dfo;
+      pStage->dfo.lpp = DEFLPP;
+      pStage->dfo.tab = 8;
+      pStage->dfo.ncols = 1;
+      pStage->dfo.wcols = 80;
+      if (   (TpNumArg(argc, argv, &i, &pStage->dfo.lpp) < 0)
+	  || (TpNumArg(argc, argv, &i, &pStage->dfo.tab) < 0)) goto bad_arg;
+    } else if (streq(pszName, "dump")) {
+      pStage->pFilter = DumpStream;
+    } else {
+      pferror("Unknown pipeline stage: %s", pszName);
+      goto failed;
+    }
+    continue;
+bad_arg:
+    pferror("Invalid %s argument: %s", pszName, argv[i+1]);
+    goto failed;
+  }
+  if (!pPipe->nStages) {
+    pferror("Missing pipeline stage name");
+    goto failed;
+  }
+
+  DEBUG_LEAVE(("return %p; // %d stages\n", pPipe, pPipe->nStages));
+  return pPipe;
+
+failed:
+  if (pPipe) free(pPipe->pStages);
+  free(pPipe);
+  DEBUG_LEAVE(("return NULL;\n"));
+  return NULL;
+}
+
+#if HAS_THREADS
+
+/* Write routine for the stream feeding a pipe */
+static ssize_t TpWrite(tpPipe *pTp, const char *pBuf, size_t nBuf) {
+  size_t nLeft = nBuf;
+  while (nLeft) {
+    tpBlock *pBlock = pTp->pWrite;
+    size_t n;
+    if (!pBlock) {		/* Get an empty block */
+      pthread_mutex_lock(&pTp->mutex);
+      pBlock = pTp->pFree;
+      if (pBlock) pTp->pFree = pBlock->pNext;
+      pthread_mutex_unlock(&pTp->mutex);
+      if (!pBlock) pBlock = malloc(sizeof(tpBlock));
+      if (!pBlock) return -1;
+      pBlock->nData = 0;
+      pBlock->iData = 0;
+      pBlock->pNext = NULL;
+      pTp->pWrite = pBlock;
+    }
+    n = TP_BLOCK_SIZE - pBlock->nData;
+    if (n > nLeft) n = nLeft;
+    memcpy(pBlock->data + pBlock->nData, pBuf, n);
+    pBlock->nData += n;
+    pBuf += n;
+    nLeft -= n;
+    if (pBlock->nData == TP_BLOCK_SIZE) { /* Pass the full block to the reader */
+      pthread_mutex_lock(&pTp->mutex);
+      while ((pTp->nQueued >= TP_MAX_BLOCKS) && !pTp->bBroken) {
+	pthread_cond_wait(&pTp->cond, &pTp->mutex);
+      }
+      if (pTp->bBroken) {	/* Nobody will ever read it */
+	pthread_mutex_unlock(&pTp->mutex);
+	errno = EPIPE;
+	return -1;
+      }
+      if (pTp->pLast) pTp->pLast->pNext = pBlock; else pTp->pFirst = pBlock;
+      pTp->pLast = pBlock;
+      pTp->nQueued += 1;
+      pTp->pWrite = NULL;
+      pthread_cond_broadcast(&pTp->cond);
+      pthread_mutex_unlock(&pTp->mutex);
+    }
+  }
+  return (ssize_t)nBuf;
+}
+
+/* Close routine for the stream feeding a pipe */
+static int TpCloseWrite(tpPipe *pTp) {
+  tpBlock *pBlock = pTp->pWrite;
+  int iErr = 0;
+  pthread_mutex_lock(&pTp->mutex);
+  if (pBlock) {			/* Pass the last partial block */
+    pTp->pWrite = NULL;
+    if (pTp->bBroken) {
+      pBlock->pNext = pTp->pFree;
+      pTp->pFree = pBlock;
+      iErr = EPIPE;
+    } else {
+      if (pTp->pLast) pTp->pLast->pNext = pBlock; else pTp->pFirst = pBlock;
+      pTp->pLast = pBlock;
+      pTp->nQueued += 1;
+    }
+  }
+  pTp->bEOF = TRUE;
+  pthread_cond_broadcast(&pTp->cond);
+  pthread_mutex_unlock(&pTp->mutex);
+  if (iErr) {
+    errno = iErr;
+    return -1;
+  }
+  return 0;
+}
+
+/* Read routine for the stream reading a pipe */
+static ssize_t TpRead(tpPipe *pTp, char *pBuf, size_t nBuf) {
+  tpBlock *pBlock = pTp->pRead;
+  size_t n;
+  if (!pBlock || (pBlock->iData == pBlock->nData)) { /* Get the next block */
+    pthread_mutex_lock(&pTp->mutex);
+    if (pBlock) {		/* Recycle the one we're done with */
+      pBlock->pNext = pTp->pFree;
+      pTp->pFree = pBlock;
+      pTp->pRead = NULL;
+    }
+    while (!pTp->pFirst && !pTp->bEOF) pthread_cond_wait(&pTp->cond, &pTp->mutex);
+    pBlock = pTp->pFirst;
+    if (pBlock) {
+      pTp->pFirst = pBlock->pNext;
+      if (!pTp->pFirst) pTp->pLast = NULL;
+      pTp->nQueued -= 1;
+      pTp->pRead = pBlock;
+      pthread_cond_broadcast(&pTp->cond); /* Unblock the writer if the queue was full */
+    }
+    pthread_mutex_unlock(&pTp->mutex);
+    if (!pBlock) return 0;	/* End of file */
+  }
+  n = pBlock->nData - pBlock->iData;
+  if (n > nBuf) n = nBuf;
+  memcpy(pBuf, pBlock->data + pBlock->iData, n);
+  pBlock->iData += n;
+  return (ssize_t)n;
+}
+
+/* Close routine for the stream reading a pipe */
+static int TpCloseRead(tpPipe *pTp) {
+  pthread_mutex_lock(&pTp->mutex);
+  pTp->bBroken = TRUE;		/* Unblock the writer, if it's still writing */
+  pthread_cond_broadcast(&pTp->cond);
+  pthread_mutex_unlock(&pTp->mutex);
+  return 0;
+}
+
+#if HAS_FOPENCOOKIE
+static ssize_t TpCookieWrite(void *pCookie, const char *pBuf, size_t nBuf) {
+  ssize_t n = TpWrite((tpPipe *)pCookie, pBuf, nBuf);
+  return (n < 0) ? 0 : n;	/* fopencookie() expects 0 for errors */
+}
+static ssize_t TpCookieRead(void *pCookie, char *pBuf, size_t nBuf) {
+  return TpRead((tpPipe *)pCookie, pBuf, nBuf);
+}
+static int TpCookieCloseWrite(void *pCookie) {
+  return TpCloseWrite((tpPipe *)pCookie);
+}
+static int TpCookieCloseRead(void *pCookie) {
+  return TpCloseRead((tpPipe *)pCookie);
+}
+static cookie_io_functions_t TpWriteFunctions = {NULL, TpCookieWrite, NULL, TpCookieCloseWrite};
+static cookie_io_functions_t TpReadFunctions = {TpCookieRead, NULL, NULL, TpCookieCloseRead};
+#endif
+
+#if HAS_FUNOPEN
+static int TpFunWrite(void *pCookie, const char *pBuf, int nBuf) {
+  return (int)TpWrite((tpPipe *)pCookie, pBuf, (size_t)nBuf);
+}
+static int TpFunRead(void *pCookie, char *pBuf, int nBuf) {
+  return (int)TpRead((tpPipe *)pCookie, pBuf, (size_t)nBuf);
+}
+static int TpFunCloseWrite(void *pCookie) {
+  return TpCloseWrite((tpPipe *)pCookie);
+}
+static int TpFunCloseRead(void *pCookie) {
+  return TpCloseRead((tpPipe *)pCookie);
+}
+#endif
+
+/* Create the two streams of an in-memory pipe */
+static int TpPipeInit(tpPipe *pTp) {
+  pthread_mutex_init(&pTp->mutex, NULL);
+  pthread_cond_init(&pTp->cond, NULL);
+#if HAS_FOPENCOOKIE
+  pTp->pfWrite = fopencookie(pTp, "w", TpWriteFunctions);
+  pTp->pfRead = fopencookie(pTp, "r", TpReadFunctions);
+#else
+  pTp->pfWrite = funopen(pTp, NULL, TpFunWrite, NULL, TpFunCloseWrite);
+  pTp->pfRead = funopen(pTp, TpFunRead, NULL, NULL, TpFunCloseRead);
+#endif
+  if (!pTp->pfWrite || !pTp->pfRead) return -1;
+  /* Large reads and writes bypass the stdio buffers, and go directly
+     to the data blocks. Only small ones are grouped in these buffers. */
+  setvbuf(pTp->pfWrite, NULL, _IOFBF, TP_STDIO_SIZE);
+  setvbuf(pTp->pfRead, NULL, _IOFBF, TP_STDIO_SIZE);
+  return 0;
+}
+
+/* Free the blocks of an in-memory pipe, after both streams were closed */
+static void TpPipeFree(tpPipe *pTp) {
+  tpBlock *pBlock;
+  while ((pBlock = pTp->pFirst) != NULL) {
+    pTp->pFirst = pBlock->pNext;
+    free(pBlock);
+  }
+  while ((pBlock = pTp->pFree) != NULL) {
+    pTp->pFree = pBlock->pNext;
+    free(pBlock);
+  }
+  free(pTp->pRead);
+  free(pTp->pWrite);
+  pthread_cond_destroy(&pTp->cond);
+  pthread_mutex_destroy(&pTp->mutex);
+}
+
+/* Stage thread: Filter the stage input pipe into the next pipe or the output */
+static void *TpStageThread(void *pParam) {
+  tpStage *pStage = (tpStage *)pParam;
+  pStage->lnResult = pStage->pFilter(pStage->sf, pStage->df, pStage->pRef);
+  if (pStage->lnResult < 0) pStage->iErr = errno ? errno : EIO;
+  fclose(pStage->sf);		/* Stops the upstream stage if it's not done */
+  return NULL;
+}
+
+#endif /* HAS_THREADS */
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    TextPipeOpen					      |
+|									      |
+|   Description     Start a pipeline					      |
+|									      |
+|   Parameters      TEXTPIPE *pPipe	The pipeline from TextPipeNew()	      |
+|		    FILE *df		Where to write the pipeline output    |
+|		    							      |
+|   Returns	    The pipeline input stream, or NULL if error, with errno.  |
+|		    							      |
+|   Notes	    Do not close the input stream. Call TextPipeClose().      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+FILE *TextPipeOpen(TEXTPIPE *pPipe, FILE *df) {
+  DEBUG_ENTER(("TextPipeOpen(%p, %p);\n", pPipe, df));
+
+  pPipe->df = df;
+#if HAS_THREADS
+  {
+  int i;
+  pPipe->pPipes = calloc(pPipe->nStages, sizeof(tpPipe));
+  if (!pPipe->pPipes) goto failed;
+  for (i = 0; i < pPipe->nStages; i++) {
+    if (TpPipeInit(pPipe->pPipes + i)) goto failed;
+  }
+  for (i = 0; i < pPipe->nStages; i++) {
+    tpStage *pStage = pPipe->pStages + i;
+    pStage->sf = pPipe->pPipes[i].pfRead;
+    pStage->df = ((i+1) < pPipe->nStages) ? pPipe->pPipes[i+1].pfWrite : df;
+  }
+  for (i = pPipe->nStages - 1; i >= 0; i--) {
+    tpStage *pStage = pPipe->pStages + i;
+    if (pthread_create(&pStage->tid, NULL, TpStageThread, pStage)) goto failed;
+    pStage->bStarted = TRUE;
+  }
+  pPipe->pfIn = pPipe->pPipes[0].pfWrite;
+  }
+#else
+  pPipe->pfIn = tmpfile();	/* Run the stages later, in TextPipeClose() */
+  if (!pPipe->pfIn) goto failed;
+#endif
+
+  DEBUG_LEAVE(("return %p;\n", pPipe->pfIn));
+  return pPipe->pfIn;
+
+failed:
+  DEBUG_LEAVE(("return NULL; // %s\n", strerror(errno)));
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    TextPipeClose					      |
+|									      |
+|   Description     Flush the pipeline input, and wait for all stages	      |
+|									      |
+|   Parameters      TEXTPIPE *pPipe	The pipeline from TextPipeNew()	      |
+|		    							      |
+|   Returns	    0 if success, or -1 if any stage failed, with errno set.  |
+|		    							      |
+|   Notes	    Frees the pipeline. The output stream is flushed, but     |
+|		    not closed.						      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine.				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int TextPipeClose(TEXTPIPE *pPipe) {
+  int i;
+  int iErr = 0;
+
+  DEBUG_ENTER(("TextPipeClose(%p);\n", pPipe));
+
+#if HAS_THREADS
+  if (pPipe->pPipes) {
+    /* Close the pipes from upstream to downstream, as each stage completes.
+       Pipes not attached to a running stage are closed at both ends. */
+    for (i = 0; i < pPipe->nStages; i++) {
+      tpStage *pStage = pPipe->pStages + i;
+      tpPipe *pTp = pPipe->pPipes + i;
+      if (pTp->pfWrite && fclose(pTp->pfWrite) && !iErr) iErr = errno;
+      if (pStage->bStarted) {
+	pthread_join(pStage->tid, NULL);
+      } else if (pTp->pfRead) {
+	fclose(pTp->pfRead);
+      }
+      if (pStage->iErr && (!iErr || (iErr == EPIPE))) iErr = pStage->iErr;
+    }
+    for (i = 0; i < pPipe->nStages; i++) TpPipeFree(pPipe->pPipes + i);
+    free(pPipe->pPipes);
+  }
+#else
+  if (pPipe->pfIn) {
+    FILE *sf = pPipe->pfIn;
+    for (i = 0; i < pPipe->nStages; i++) {
+      tpStage *pStage = pPipe->pStages + i;
+      FILE *df = ((i+1) < pPipe->nStages) ? tmpfile() : pPipe->df;
+      if (!df || fflush(sf) || fseek(sf, 0, SEEK_SET)) {
+	iErr = errno;
+	if (df && (df != pPipe->df)) fclose(df);
+	fclose(sf);
+	break;
+      }
+      pStage->lnResult = pStage->pFilter(sf, df, pStage->pRef);
+      if (pStage->lnResult < 0) iErr = errno ? errno : EIO;
+      fclose(sf);
+      sf = df;
+      if (iErr) {
+	if (df != pPipe->df) fclose(df);
+	break;
+      }
+    }
+  }
+#endif
+  if (fflush(pPipe->df) && !iErr) iErr = errno;
+
+  free(pPipe->pStages);
+  free(pPipe);
+  if (iErr) {
+    errno = iErr;
+    DEBUG_LEAVE(("return -1; // %s\n", strerror(iErr)));
+    return -1;
+  }
+  DEBUG_LEAVE(("return 0;\n"));
+  return 0;
+}
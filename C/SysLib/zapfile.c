@@ -0,0 +1,743 @@
+﻿/*****************************************************************************\
+*                                                                             *
+*   Filename        zapfile.c                                                 *
+*                                                                             *
+*   Description     Delete files, and complete directory trees                *
+*                                                                             *
+*   Notes           Initially zap.c, rd.c, and update.c each had their own    *
+*		    copy of these routines. They're now shared here.	      *
+*		    							      *
+*		    In Unix, directory trees are deleted using handles	      *
+*		    relative to the parent directory (openat, unlinkat), so   *
+*		    that the kernel does not parse the full pathname again    *
+*		    for every file; d_type is trusted, so that no lstat() is  *
+*		    needed except when it's unknown; and sibling subtrees are *
+*		    deleted in parallel by a small pool of worker threads.    *
+*		    Each thread keeps many file deletions in flight at once,  *
+*		    using the batched metadata operations in metaio.c.	      *
+*		    The other OSs use the historical sequential algorithm.    *
+*		    							      *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file, merging the zapXxx() routines from     *
+*		    zap.c, rd.c, and update.c.				      *
+*    2026-10-18 JFL Queue the file deletions using metaio.c.		      *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#define _CRT_SECURE_NO_WARNINGS /* Prevent warnings about using fopen, etc */
+
+#define _GNU_SOURCE		/* Include as many extensions as possible */
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "debugm.h"		/* SysToolsLib debug macros */
+
+#include "dirx.h"		/* Directory access functions eXtensions */
+#include "pathnames.h"		/* Pathname management definitions and functions */
+#include "mainutil.h"		/* Print errors, streq, etc */
+#include "zapfile.h"		/* Public definitions for this file */
+
+/************************ Win32-specific definitions *************************/
+
+#ifdef _WIN32		/* Automatically defined when targeting a Win32 app. */
+
+#pragma warning(disable:4996)	/* Ignore the deprecated name warning */
+
+#define DEL_FILE "del"
+#define DEL_DIR  "rd"
+
+#endif /* _WIN32 */
+
+/************************ MS-DOS-specific definitions ************************/
+
+#ifdef _MSDOS		/* Automatically defined when targeting an MS-DOS app. */
+
+#define DEL_FILE "del"
+#define DEL_DIR  "rd"
+
+#endif /* _MSDOS */
+
+/************************* Unix-specific definitions *************************/
+
+#ifdef _UNIX		/* Defined in SysLib.h for Unix flavors we support */
+
+#define DEL_FILE "rm"
+#define DEL_DIR  "rmdir"
+
+#if defined(AT_REMOVEDIR) && defined(O_DIRECTORY)
+#define USE_ZAPAT 1	/* Use the handle-relative multithreaded engine */
+#include <pthread.h>
+#include "metaio.h"		/* Batched file metadata operations */
+#endif
+
+#endif /* _UNIX */
+
+/*********************** End of OS-specific definitions **********************/
+
+#ifndef USE_ZAPAT
+#define USE_ZAPAT 0
+#endif
+
+#define ZAP_MAX_THREADS 16	/* Deleting is limited by the file system, not the CPU */
+#define ZAP_MAX_OPEN_DIRS 256	/* Beyond this, process subdirectories inline */
+
+static int nZapThreads = 0;	/* Max # of threads. 0=Auto */
+
+/* Display the pathname deleted, or the equivalent command */
+static void ShowZap(zapOpts *pzo, const char *path, const char *pszSuffix, int iDir) {
+  if (pzo->iFlags & FLAG_COMMAND) {
+    printf("%s \"%s\"\n", iDir ? DEL_DIR : DEL_FILE, path);
+  } else if (pzo->iFlags & FLAG_VERBOSE) {
+    printf("%s%s%s\n", pzo->pszPrefix, path, pszSuffix);
+  }
+}
+
+/* Get the suffix to display after a directory name */
+static const char *DirSuffix(const char *path) {
+  size_t len = strlen(path);
+  if (len && (path[len - 1] == DIRSEPARATOR_CHAR)) return ""; /* There's already a trailing separator */
+  return DIRSEPARATOR_STRING;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    SetZapThreads					      |
+|									      |
+|   Description     Set the maximum number of threads used by zapDirM()	      |
+|									      |
+|   Parameters      int nThreads		Max # of threads. 0=Auto      |
+|		    							      |
+|   Returns	    The previous value					      |
+|		    							      |
+|   Notes	    The default is the number of CPUs, up to 16.	      |
+|		    The no-exec mode always uses a single thread, so that the |
+|		    list of files displayed is in the usual order.	      |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int SetZapThreads(int nThreads) {
+  int nOld = nZapThreads;
+  nZapThreads = nThreads;
+  return nOld;
+}
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    zapFileM						      |
+|									      |
+|   Description     Delete a file or a link, knowing its mode		      |
+|									      |
+|   Parameters      const char *path		The file pathname	      |
+|		    int iMode			Its st_mode from lstat()      |
+|		    zapOpts *pzo		Zap options		      |
+|		    							      |
+|   Returns	    0 = Success, else 1 = # of failures encountered.	      |
+|		    							      |
+|   Notes	    Errors are reported on stderr.			      |
+|		    							      |
+|   History								      |
+|    2018-05-31 JFL Created this routine in zap.c			      |
+|    2026-10-18 JFL Moved it to SysLib, and merged the versions from rd.c and |
+|		    update.c.						      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+#ifdef _MSC_VER
+#pragma warning(disable:4706) /* Ignore the "assignment within conditional expression" warning */
+#endif
+
+int zapFileM(const char *path, int iMode, zapOpts *pzo) {
+  int iFlags = pzo->iFlags;
+  char *pszSuffix = "";
+  int iErr = 0;
+
+  DEBUG_ENTER(("zapFileM(\"%s\", 0x%04X);\n", path, iMode));
+
+  if (S_ISDIR(iMode)) {
+    errno = EISDIR;
+    iErr = 1;
+    goto cleanup_and_return;
+  }
+#if OS_HAS_LINKS
+  if (S_ISLNK(iMode)) {
+    pszSuffix = ">";
+  }
+#endif
+
+  ShowZap(pzo, path, pszSuffix, FALSE);
+  if (iFlags & FLAG_NOEXEC) RETURN_INT(0);
+  if (iFlags & FLAG_FORCE) {
+    if (!(iMode & S_IWRITE)) {
+      iMode |= S_IWRITE;
+      DEBUG_PRINTF(("chmod(%p, 0x%X);\n", path, iMode));
+      iErr = -chmod(path, iMode); /* Try making the target file writable */
+      DEBUG_PRINTF(("  return %d; // errno = %d\n", iErr, errno));
+    }
+    if (iErr) goto cleanup_and_return;
+  }
+  iErr = -unlink(path); /* If error, iErr = 1 = # of errors */
+
+cleanup_and_return:
+  if (iErr) {
+    pfcerror("Can't delete \"%s%s\"", path, pszSuffix);
+  } else {
+    if (pzo->pNDeleted) *(pzo->pNDeleted) += 1; /* Number of files successfully deleted */
+  }
+
+  RETURN_INT(iErr);
+}
+
+/* Delete one file or link */
+int zapFile(const char *path, zapOpts *pzo) {
+  int iErr;
+  struct stat sStat;
+
+  DEBUG_ENTER(("zapFile(\"%s\");\n", path));
+
+  if ((!path) || !path[0]) RETURN_INT_COMMENT(1, ("path is empty\n"));
+
+  iErr = lstat(path, &sStat); /* Use lstat, as stat does not detect SYMLINKDs. */
+  if (iErr && (errno == ENOENT)) RETURN_INT(0); /* Already deleted. Not an error. */
+  if (iErr) {
+    pfcerror("Can't delete \"%s\"", path);
+    RETURN_INT(1);
+  }
+
+  iErr = zapFileM(path, sStat.st_mode, pzo);
+  RETURN_INT(iErr);
+}
+
+#if USE_ZAPAT
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    zapDirContent (Unix version)			      |
+|									      |
+|   Description     Delete everything inside a directory, in parallel	      |
+|									      |
+|   Parameters      const char *path		The directory pathname	      |
+|		    zapOpts *pzo		Zap options		      |
+|		    							      |
+|   Returns	    The # of failures encountered, or -1 if the directory     |
+|		    itself can't be opened.				      |
+|		    							      |
+|   Notes	    Every subdirectory found is a task, that a worker opens   |
+|		    relative to its parent directory handle, and scans. The   |
+|		    files are deleted immediately, and the subdirectories     |
+|		    become new tasks. A directory is removed by the thread    |
+|		    that completes its last pending subdirectory. Its handle  |
+|		    is kept open until then, for use by its children.	      |
+|		    							      |
+|		    The queue is LIFO, so that the tree is walked mostly      |
+|		    depth-first, limiting the number of open handles.	      |
+|		    Beyond ZAP_MAX_OPEN_DIRS, or if there's a single thread,  |
+|		    the subdirectories are processed inline by the thread     |
+|		    that found them.					      |
+|		    							      |
+|		    Unix does not need files to be writable to delete them,   |
+|		    so the FLAG_FORCE chmod() is not necessary here.	      |
+|		    							      |
+|		    Each thread has its own METAIO queue, where the files     |
+|		    unlinks are queued. A directory scan waits for all its    |
+|		    unlinks to complete before the directory can be removed.  |
+|		    							      |
+|   History								      |
+|    2026-10-18 JFL Created this routine				      |
+|    2026-10-18 JFL Queue the file deletions using metaio.c.		      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+typedef struct zapTask {
+  struct zapTask *pParent;	/* The parent directory task. NULL for the root */
+  struct zapTask *pNext;	/* Next task in the queue */
+  int fd;			/* This directory handle, once opened */
+  int nPending;			/* 1 for the scan + # of subdirectories not removed yet */
+  char *pszPath;		/* Pathname, for the messages */
+  char *pszName;		/* Name relative to the parent, inside pszPath */
+} zapTask;
+
+typedef struct zapPool {
+  pthread_mutex_t mutex;	/* Protects everything below, and all nPending */
+  pthread_cond_t cond;		/* Signaled when a task is queued, or when done */
+  zapTask *pQueue;		/* LIFO of directories to scan */
+  int nOpen;			/* Number of directory handles open */
+  int nIdle;			/* Number of threads waiting for a task */
+  int nThreads;			/* Number of worker threads started */
+  int nMaxThreads;		/* Max number of threads, including the caller's */
+  pthread_t *pThreads;		/* Worker threads handles */
+  int iDone;			/* TRUE when the root task is complete */
+  int nErr;			/* Number of failures */
+  unsigned long nDeleted;	/* Number of files and dirs deleted */
+  zapOpts *pzo;
+} zapPool;
+
+static void *zapWorker(void *pArg);
+
+/* A file deletion in flight */
+typedef struct zapUnlink {
+  zapPool *pPool;
+  zapTask *pTask;		/* The directory containing the file */
+  unsigned long *pnDeleted;	/* Where to count the file deleted */
+  const char *pszSuffix;	/* Suffix for the error message */
+  char szName[1];		/* The file name. Must be last */
+} zapUnlink;
+
+static zapTask *NewZapTask(zapTask *pParent, const char *pszParentPath, const char *pszName) {
+  zapTask *pTask = calloc(1, sizeof(zapTask));
+  if (!pTask) return NULL;
+  pTask->pParent = pParent;
+  pTask->fd = -1;
+  pTask->nPending = 1;
+  pTask->pszPath = NewJoinedPath(pszParentPath, pszName);
+  if (!pTask->pszPath) {
+    free(pTask);
+    return NULL;
+  }
+  pTask->pszName = pTask->pszPath + strlen(pTask->pszPath) - strlen(pszName);
+  return pTask;
+}
+
+static void zapError(zapPool *pPool, const char *pszPath, const char *pszName, const char *pszSuffix) {
+  int iErrno = errno;
+  char *pszFullName = pszName ? NewJoinedPath(pszPath, pszName) : NULL;
+  errno = iErrno;
+  pfcerror("Can't delete \"%s%s\"", pszFullName ? pszFullName : pszPath, pszSuffix);
+  free(pszFullName);
+  pthread_mutex_lock(&pPool->mutex);
+  pPool->nErr += 1;
+  pthread_mutex_unlock(&pPool->mutex);
+}
+
+/* Remove a directory whose content has been deleted, then release its parent */
+static void zapTaskDone(zapPool *pPool, zapTask *pTask) {
+  while (pTask) {
+    zapTask *pParent = pTask->pParent;
+    int iErr = 0;
+    if (pTask->fd != -1) {
+      close(pTask->fd);
+      pthread_mutex_lock(&pPool->mutex);
+      pPool->nOpen -= 1;
+      pthread_mutex_unlock(&pPool->mutex);
+    }
+    if (!pParent) { /* This is the root. The caller will remove it. */
+      pthread_mutex_lock(&pPool->mutex);
+      pPool->iDone = TRUE;
+      pthread_cond_broadcast(&pPool->cond);
+      pthread_mutex_unlock(&pPool->mutex);
+      free(pTask->pszPath);
+      free(pTask);
+      return;
+    }
+    if (pTask->fd != -1) { /* Else it could not be opened, and the error is already reported */
+      ShowZap(pPool->pzo, pTask->pszPath, DIRSEPARATOR_STRING, TRUE);
+      if (!(pPool->pzo->iFlags & FLAG_NOEXEC)) iErr = unlinkat(pParent->fd, pTask->pszName, AT_REMOVEDIR);
+      if (iErr) {
+	zapError(pPool, pTask->pszPath, NULL, DIRSEPARATOR_STRING);
+      } else {
+	pthread_mutex_lock(&pPool->mutex);
+	pPool->nDeleted += 1;
+	pthread_mutex_unlock(&pPool->mutex);
+      }
+    }
+    free(pTask->pszPath);
+    free(pTask);
+    /* Release the parent, and remove it too if this was its last pending subdirectory */
+    pthread_mutex_lock(&pPool->mutex);
+    pTask = (--(pParent->nPending)) ? NULL : pParent;
+    pthread_mutex_unlock(&pPool->mutex);
+  }
+}
+
+/* Completion of a queued file deletion */
+static void zapUnlinkDone(void *pRef, int iResult) {
+  zapUnlink *pUL = pRef;
+  if (iResult < 0) {
+    errno = -iResult;
+    zapError(pUL->pPool, pUL->pTask->pszPath, pUL->szName, pUL->pszSuffix);
+  } else {
+    *(pUL->pnDeleted) += 1;
+  }
+  free(pUL);
+}
+
+/* Open a directory, delete its files, and queue its subdirectories */
+static void zapTaskScan(zapPool *pPool, zapTask *pTask, METAIO *pMio) {
+  int iFlags = pPool->pzo->iFlags;
+  int fdParent = pTask->pParent ? pTask->pParent->fd : AT_FDCWD;
+  const char *pszName = pTask->pszName;
+  int fd2;
+  DIR *pDir = NULL;
+  struct dirent *pDE;
+  unsigned long nDeleted = 0;
+
+  if (pTask->fd == -1) { /* The root is already open. Open the others relative to their parent */
+    pTask->fd = openat(fdParent, pszName, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (pTask->fd == -1) {
+      zapError(pPool, pTask->pszPath, NULL, DIRSEPARATOR_STRING);
+      goto scan_done;
+    }
+    pthread_mutex_lock(&pPool->mutex);
+    pPool->nOpen += 1;
+    pthread_mutex_unlock(&pPool->mutex);
+  }
+  /* fdopendir() takes ownership of the handle, and we need to keep ours for the children */
+  fd2 = dup(pTask->fd);
+  if (fd2 != -1) pDir = fdopendir(fd2);
+  if (!pDir) {
+    if (fd2 != -1) close(fd2);
+    zapError(pPool, pTask->pszPath, NULL, DIRSEPARATOR_STRING);
+    goto scan_done;
+  }
+
+  while ((pDE = readdir(pDir))) {
+    int iType = pDE->d_type;
+    char *pszSuffix = "";
+    int iErr = 0;
+
+    if (streq(pDE->d_name, ".") || streq(pDE->d_name, "..")) continue;
+    if (iType == DT_UNKNOWN) { /* Some file systems don't report it */
+      struct stat sStat;
+      if (fstatat(pTask->fd, pDE->d_name, &sStat, AT_SYMLINK_NOFOLLOW)) {
+	zapError(pPool, pTask->pszPath, pDE->d_name, "");
+	continue;
+      }
+      iType = IFTODT(sStat.st_mode);
+    }
+    switch (iType) {
+      case DT_DIR: {
+	zapTask *pChild = NewZapTask(pTask, pTask->pszPath, pDE->d_name);
+	int iInline;
+	if (!pChild) {
+	  errno = ENOMEM;
+	  zapError(pPool, pTask->pszPath, pDE->d_name, DIRSEPARATOR_STRING);
+	  break;
+	}
+	pthread_mutex_lock(&pPool->mutex);
+	pTask->nPending += 1;
+	iInline = (pPool->nMaxThreads == 1) || (pPool->nOpen >= ZAP_MAX_OPEN_DIRS);
+	if (!iInline) {
+	  pChild->pNext = pPool->pQueue;
+	  pPool->pQueue = pChild;
+	  if (pPool->nIdle) {
+	    pthread_cond_signal(&pPool->cond);
+	  } else if (pPool->nThreads < (pPool->nMaxThreads - 1)) { /* Start another worker */
+	    if (!pthread_create(pPool->pThreads + pPool->nThreads, NULL, zapWorker, pPool)) {
+	      pPool->nThreads += 1;
+	    }
+	  }
+	}
+	pthread_mutex_unlock(&pPool->mutex);
+	if (iInline) zapTaskScan(pPool, pChild, pMio);
+	break;
+      }
+#if OS_HAS_LINKS
+      case DT_LNK:
+	pszSuffix = ">";
+	/* Fall through into the DT_REG case */
+#endif
+      case DT_REG:
+	if ((iFlags & (FLAG_VERBOSE | FLAG_COMMAND))) {
+	  char *pszPath = NewJoinedPath(pTask->pszPath, pDE->d_name);
+	  if (pszPath) ShowZap(pPool->pzo, pszPath, pszSuffix, FALSE);
+	  free(pszPath);
+	}
+	if (iFlags & FLAG_NOEXEC) {
+	  nDeleted += 1;
+	  break;
+	}
+	if (pMio && MetaIoIsAsync(pMio)) { /* Queue it, with a copy of the name that readdir() will reuse */
+	  size_t lName = strlen(pDE->d_name);
+	  zapUnlink *pUL = malloc(sizeof(zapUnlink) + lName);
+	  if (pUL) {
+	    pUL->pPool = pPool;
+	    pUL->pTask = pTask;
+	    pUL->pnDeleted = &nDeleted;
+	    pUL->pszSuffix = pszSuffix;
+	    memcpy(pUL->szName, pDE->d_name, lName + 1);
+	    if (!MetaIoUnlinkAt(pMio, pTask->fd, pUL->szName, 0, zapUnlinkDone, pUL)) break;
+	    free(pUL);
+	  }
+	}
+	iErr = unlinkat(pTask->fd, pDE->d_name, 0);
+	if (iErr) {
+	  zapError(pPool, pTask->pszPath, pDE->d_name, pszSuffix);
+	} else {
+	  nDeleted += 1;
+	}
+	break;
+      default:			/* We don't support deleting there */
+#if defined(ENOSYS)
+	errno = ENOSYS;		/* Function not supported */
+#else
+	errno = EPERM;		/* Operation not permitted */
+#endif
+	zapError(pPool, pTask->pszPath, pDE->d_name, "?");
+	break;
+    }
+  }
+  closedir(pDir);
+  if (pMio) MetaIoWait(pMio); /* The directory must be empty before it's removed */
+
+scan_done:
+  pthread_mutex_lock(&pPool->mutex);
+  pPool->nDeleted += nDeleted;
+  pTask = (--(pTask->nPending)) ? NULL : pTask;
+  pthread_mutex_unlock(&pPool->mutex);
+  if (pTask) zapTaskDone(pPool, pTask);
+}
+
+/* Scan queued directories until the whole tree is done */
+static void zapWork(zapPool *pPool, METAIO *pMio) {
+  pthread_mutex_lock(&pPool->mutex);
+  while (!pPool->iDone) {
+    zapTask *pTask = pPool->pQueue;
+    if (!pTask) {
+      pPool->nIdle += 1;
+      pthread_cond_wait(&pPool->cond, &pPool->mutex);
+      pPool->nIdle -= 1;
+      continue;
+    }
+    pPool->pQueue = pTask->pNext;
+    pthread_mutex_unlock(&pPool->mutex);
+    zapTaskScan(pPool, pTask, pMio);
+    pthread_mutex_lock(&pPool->mutex);
+  }
+  pthread_mutex_unlock(&pPool->mutex);
+}
+
+/* Worker thread, with its own queue of metadata requests */
+static void *zapWorker(void *pArg) {
+  METAIO *pMio = NewMetaIo(0); /* If NULL, zapTaskScan() deletes files synchronously */
+  zapWork((zapPool *)pArg, pMio);
+  FreeMetaIo(pMio);
+  return NULL;
+}
+
+static int zapDirContent(const char *path, zapOpts *pzo) {
+  zapPool pool = {0};
+  zapTask *pRoot;
+  int i;
+  int nMaxThreads = nZapThreads;
+  METAIO *pMio;
+
+  if (!nMaxThreads) {
+    long nCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+    nMaxThreads = (nCPUs > 0) ? (int)nCPUs : 1;
+    if (nMaxThreads > ZAP_MAX_THREADS) nMaxThreads = ZAP_MAX_THREADS;
+  }
+  if (pzo->iFlags & FLAG_NOEXEC) nMaxThreads = 1; /* Keep the usual display order */
+  DEBUG_PRINTF(("// Deleting the content of %s with up to %d threads\n", path, nMaxThreads));
+
+  pRoot = calloc(1, sizeof(zapTask));
+  if (pRoot) pRoot->pszPath = strdup(path);
+  pool.pThreads = calloc(nMaxThreads, sizeof(pthread_t));
+  if ((!pRoot) || (!pRoot->pszPath) || (!pool.pThreads)) {
+    if (pRoot) free(pRoot->pszPath);
+    free(pRoot);
+    free(pool.pThreads);
+    errno = ENOMEM;
+    return -1;
+  }
+  pRoot->nPending = 1;
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+  pool.nMaxThreads = nMaxThreads;
+  pool.pzo = pzo;
+
+  /* Open the root here, so that the caller reports the failure as usual */
+  pRoot->fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (pRoot->fd == -1) {
+    int iErrno = errno;
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&pool.mutex);
+    free(pRoot->pszPath);
+    free(pRoot);
+    free(pool.pThreads);
+    errno = iErrno;
+    return -1;
+  }
+  pool.nOpen = 1;
+
+  /* Scan the root in this thread, then help the workers with the queued subdirectories */
+  pMio = NewMetaIo(0);
+  zapTaskScan(&pool, pRoot, pMio);
+  zapWork(&pool, pMio);
+  FreeMetaIo(pMio);
+  for (i = 0; i < pool.nThreads; i++) pthread_join(pool.pThreads[i], NULL);
+
+  pthread_cond_destroy(&pool.cond);
+  pthread_mutex_destroy(&pool.mutex);
+  free(pool.pThreads);
+  if (pzo->pNDeleted) *(pzo->pNDeleted) += pool.nDeleted;
+  return pool.nErr;
+}
+
+#else /* !USE_ZAPAT */
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    zapDirContent (Generic version)			      |
+|									      |
+|   Description     Delete everything inside a directory		      |
+|									      |
+|   Parameters      const char *path		The directory pathname	      |
+|		    zapOpts *pzo		Zap options		      |
+|		    							      |
+|   Returns	    The # of failures encountered, or -1 if the directory     |
+|		    itself can't be opened.				      |
+|		    							      |
+|   Notes	    MsvcLibX returns the DOS/Windows stat info in the dirent  |
+|		    structure, so this does not need to call lstat() either.  |
+|		    							      |
+|   History								      |
+|    2017-10-05 JFL Created this routine in zap.c, as part of zapDir()	      |
+|    2026-10-18 JFL Moved it to SysLib.					      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+static int zapDirContent(const char *path, zapOpts *pzo) {
+  char *pPath;
+  int iErr;
+  struct stat sStat;
+  DIR *pDir;
+  struct dirent *pDE;
+  int nErr = 0;
+  char *pszSuffix;
+
+  pDir = opendirx(path);
+  if (!pDir) return -1;
+  while ((pDE = readdirx(pDir))) { /* readdirx() ensures d_type is set */
+    DEBUG_PRINTF(("// Dir Entry \"%s\" d_type=%d\n", pDE->d_name, (int)(pDE->d_type)));
+    if (streq(pDE->d_name, ".") || streq(pDE->d_name, "..")) continue;
+    pPath = NewJoinedPath(path, pDE->d_name);
+    if (!pPath) {
+      errno = ENOMEM;
+      pfcerror("Can't delete \"%s\"", pDE->d_name);
+      nErr += 1;
+      continue;
+    }
+    pszSuffix = "";
+#if _DIRENT2STAT_DEFINED /* MsvcLibX return DOS/Windows stat info in the dirent structure */
+    iErr = dirent2stat(pDE, &sStat);
+#else /* Other OSs have to query it separately */
+    iErr = -lstat(pPath, &sStat); /* If error, iErr = 1 = # of errors */
+#endif
+    if (!iErr) switch (pDE->d_type) {
+      case DT_DIR:
+	/* Do not update iErr, as the error is already reported by the subroutine */
+	nErr += zapDirM(pPath, sStat.st_mode, pzo);
+	break;
+#if OS_HAS_LINKS
+      case DT_LNK:
+#endif
+      case DT_REG:
+	/* Do not update iErr, as the error is already reported by the subroutine */
+	nErr += zapFileM(pPath, sStat.st_mode, pzo);
+	break;
+      default:
+	iErr = 1;		/* We don't support deleting there */
+#if defined(ENOSYS)
+	errno = ENOSYS;		/* Function not supported */
+#else
+	errno = EPERM;		/* Operation not permitted */
+#endif
+	pszSuffix = "?";
+	break;
+    }
+    if (iErr) {
+      pfcerror("Can't delete \"%s%s\"", pPath, pszSuffix);
+      nErr += iErr;
+      /* Continue the directory scan, looking for other files to delete */
+    }
+    free(pPath);
+  }
+  closedirx(pDir);
+
+  return nErr;
+}
+
+#endif /* USE_ZAPAT */
+
+/*---------------------------------------------------------------------------*\
+*                                                                             *
+|   Function	    zapDirM						      |
+|									      |
+|   Description     Remove a directory, and all its files and subdirectories. |
+|									      |
+|   Parameters      const char *path		The directory pathname	      |
+|		    int iMode			Its st_mode from lstat()      |
+|		    zapOpts *pzo		Zap options		      |
+|		    							      |
+|   Returns	    0 = Success, else # of failures encountered.	      |
+|		    							      |
+|   Notes	    The directory content is deleted only if FLAG_RECURSE is  |
+|		    set. Else the directory must be empty.		      |
+|		    The directory . itself is never deleted, only its content.|
+|		    							      |
+|   History								      |
+|    2017-10-05 JFL Created this routine in zap.c			      |
+|    2018-05-31 JFL Added zapXxxM routines, with an additional iMode argument,|
+|		     to avoid unnecessary slow calls to lstat() in Windows.   |
+|    2026-10-18 JFL Moved it to SysLib, and use the new zapDirContent().      |
+*									      *
+\*---------------------------------------------------------------------------*/
+
+int zapDirM(const char *path, int iMode, zapOpts *pzo) {
+  int iErr;
+  int nErr = 0;
+  const char *pszSuffix = DirSuffix(path);
+  const char *pszName;
+
+  DEBUG_ENTER(("zapDirM(\"%s\", 0x%04X);\n", path, iMode));
+
+  if (!S_ISDIR(iMode)) {
+    errno = ENOTDIR;
+    goto fail;
+  }
+
+  if (pzo->iFlags & FLAG_RECURSE) { /* If in recursive mode, delete everything inside */
+    nErr = zapDirContent(path, pzo);
+    if (nErr < 0) {
+      nErr = 0;
+      goto fail;
+    }
+  }
+
+  /* Skip the directory deletion if the directory is . or PATH/. or D:. */
+  pszName = strrchr(path, DIRSEPARATOR_CHAR);
+  pszName = pszName ? pszName+1 : path;
+#if HAS_DRIVES
+  if ((pszName == path) && path[0] && (path[1] == ':')) pszName += 2;
+#endif
+  if (!streq(pszName, ".")) {
+    iErr = 0;
+    ShowZap(pzo, path, pszSuffix, TRUE);
+    if (!(pzo->iFlags & FLAG_NOEXEC)) iErr = rmdir(path);
+    if (iErr) {
+fail:
+      pfcerror("Can't delete \"%s%s\"", path, pszSuffix);
+      nErr += 1;
+    } else {
+      if (pzo->pNDeleted) *(pzo->pNDeleted) += 1; /* Number of files successfully deleted */
+    }
+  }
+
+  RETURN_INT_COMMENT(nErr, (nErr ? "%d deletions failed\n" : "Success\n", nErr));
+}
+
+#ifdef _MSC_VER
+#pragma warning(default:4706)
+#endif
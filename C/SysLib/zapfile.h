@@ -0,0 +1,53 @@
+/*****************************************************************************\
+*                                                                             *
+*   Filename        zapfile.h                                                 *
+*                                                                             *
+*   Description     Definitions for the file and directory deletion routines  *
+*                                                                             *
+*   Notes           Shared by zap.c, rd.c, and update.c, which used to have   *
+*		    their own copies of these routines.			      *
+*                                                                             *
+*   History                                                                   *
+*    2026-10-18 JFL Created this file.                                        *
+*                                                                             *
+*                   © Copyright 2026 Jean-François Larvoire                   *
+* Licensed under the Apache 2.0 license - www.apache.org/licenses/LICENSE-2.0 *
+\*****************************************************************************/
+
+#ifndef _ZAPFILE_H_
+#define _ZAPFILE_H_
+
+#include "SysLib.h"		/* SysLib Library core definitions */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/* zap functions options */
+typedef struct zapOpts {
+  int iFlags;			/* FLAG_XXX options below */
+  char *pszPrefix;		/* Prefix displayed before the pathnames deleted */
+  unsigned long *pNDeleted;	/* Optional: Where to count the files and dirs deleted */
+} zapOpts;
+
+/* zapOpts iFlags */
+#define FLAG_VERBOSE	0x0001		/* Display the pathname operated on */
+#define FLAG_NOEXEC	0x0002		/* Do not actually execute */
+#define FLAG_RECURSE	0x0004		/* Recursive operation */
+#define FLAG_NOCASE	0x0008		/* Ignore case */
+#define FLAG_FORCE	0x0010		/* Force operation on read-only files */
+#define FLAG_COMMAND	0x0020		/* Display the equivalent shell commands */
+/* The following flag must be last, with the highest defined bit */
+#define FLAG_USER_FLAG	0x0040		/* Allow adding program-specific flags */
+
+int zapFile(const char *path, zapOpts *pzo); /* Delete a file or link */
+int zapFileM(const char *path, int iMode, zapOpts *pzo); /* Faster, if the mode is known */
+int zapDirM(const char *path, int iMode, zapOpts *pzo); /* Delete a directory, and its content if FLAG_RECURSE */
+
+int SetZapThreads(int nThreads);	/* Set the max # of threads deleting subdirectories in parallel. 0=Auto */
+
+#ifdef __cplusplus
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* _ZAPFILE_H_ */